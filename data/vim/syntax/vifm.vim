@@ -107,11 +107,12 @@ syntax case match
 
 " Options
 syntax keyword vifmOption contained aproposprg autochpos cdpath cd chaselinks
-		\ classify columns co confirm cf cpoptions cpo dotdirs fastrun fillchars fcs
+		\ classify columns co confirm cf copythreads cpoptions cpo dotdirs fastrun
+		\ fillchars fcs
 		\ findprg followlinks fusehome gdefault grepprg history hi hlsearch hls iec
 		\ ignorecase ic incsearch is laststatus lines locateprg ls lsview
-		\ mintimeoutlen number nu numberwidth nuw relativenumber rnu rulerformat
-		\ ruf runexec scrollbind scb scrolloff so sort sortorder shell sh shortmess
+		\ mintimeoutlen number nu numberwidth nuw parallelsort relativenumber rnu
+		\ rulerformat ruf runexec scrollbind scb scrolloff so sort sortorder shell sh shortmess
 		\ shm slowfs smartcase scs sortnumbers statusline stl syscalls tabstop
 		\ timefmt timeoutlen tm trash trashdir ts tuioptions to undolevels ul vicmd
 		\ viewcolumns vifminfo vimhelp vixcmd wildmenu wmnu wrap wrapscan ws
@@ -36,16 +36,16 @@
 #include <sys/stat.h>
 #include <sys/types.h> /* pid_t ssize_t */
 #ifndef _WIN32
-#include <sys/select.h> /* FD_* select */
-#include <sys/time.h> /* timeval */
 #include <sys/wait.h> /* WEXITSTATUS() waitpid() */
 #endif
 
 #include "cfg/config.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "ui/cancellation.h"
+#include "utils/log.h"
 #include "utils/str.h"
 #include "utils/utils.h"
+#include "utils/wakeup.h"
 #include "commands_completion.h"
 
 /* Special value of process id for internal tasks running in background
@@ -62,15 +62,62 @@
 #define NO_JOB_ID INVALID_HANDLE_VALUE
 #endif
 
-/* Structure with passed to background_task_bootstrap() so it can perform
- * correct initialization/cleanup. */
+/* Bounds of number of threads that execute background tasks. */
+#define MIN_WORKERS 4
+#define MAX_WORKERS 16
+
+/* Maximum number of tasks that can access the same device at the same time,
+ * running more of them just makes disk seek back and forth. */
+#define MAX_IO_PER_DEVICE 2
+
+/* Task that is waiting in a queue or is being executed by a worker. */
+typedef struct bg_task_t
+{
+	bg_task_func func;      /* Function to execute in a background thread. */
+	void *args;             /* Argument to pass. */
+	job_t *job;             /* Job identifier that corresponds to the task. */
+	char *path;             /* Path to query for dev or NULL once it's done. */
+	int resolving;          /* Whether a worker is querying the path. */
+	int has_dev;            /* Whether dev field is set. */
+	dev_t dev;              /* Device accessed by the task. */
+	struct bg_task_t *next; /* Next task in the queue. */
+}
+bg_task_t;
+
+/* Number of tasks running on a device. */
 typedef struct
 {
-	bg_task_func func; /* Function to execute in a background thread. */
-	void *args;        /* Argument to pass. */
-	job_t *job;        /* Job identifier that corresponds to the task. */
+	dev_t dev; /* Device identifier. */
+	int count; /* Number of tasks. */
 }
-background_task_args;
+dev_load_t;
+
+/* Indexes of queues of tasks, in order of their priority. */
+enum
+{
+	QUEUE_OPERATIONS, /* Queue of BJT_OPERATION tasks. */
+	QUEUE_TASKS,      /* Queue of BJT_TASK tasks. */
+	QUEUE_COUNT       /* Number of queues. */
+};
+
+/* State of the executor of background tasks. */
+typedef struct
+{
+	pthread_mutex_t lock; /* Protects all fields below. */
+	pthread_cond_t cond;  /* Signaled on new task and on finish of a task. */
+
+	bg_task_t *heads[QUEUE_COUNT]; /* First tasks of the queues. */
+	bg_task_t *tails[QUEUE_COUNT]; /* Last tasks of the queues. */
+	int queued;                    /* Number of queued tasks. */
+
+	int nworkers;      /* Number of started worker threads. */
+	int busy;          /* Number of workers executing a task. */
+	int running_tasks; /* Number of running BJT_TASK tasks. */
+
+	dev_load_t devs[MAX_WORKERS]; /* Load of devices used by running tasks. */
+	int ndevs;                    /* Number of elements in devs. */
+}
+executor_t;
 
 static void job_check(job_t *const job);
 static void job_free(job_t *const job);
@@ -81,7 +128,14 @@ static job_t * add_background_job(pid_t pid, const char cmd[], int fd,
 static job_t * add_background_job(pid_t pid, const char cmd[], HANDLE hprocess,
 		BgJobType type);
 #endif
-static void * background_task_bootstrap(void *arg);
+static int start_workers(void);
+static void * worker_thread(void *arg);
+static bg_task_t * find_unresolved_task(void);
+static void resolve_dev(bg_task_t *task);
+static bg_task_t * take_task(void);
+static int can_run(const bg_task_t *task, int queue);
+static void update_dev_load(const bg_task_t *task, int delta);
+static dev_load_t * find_dev_load(dev_t dev);
 static void set_current_job(job_t *job);
 static void make_current_job_key(void);
 static void finish_current_job(void);
@@ -91,11 +145,22 @@ job_t *jobs;
 static pthread_key_t current_job;
 static pthread_once_t current_job_once = PTHREAD_ONCE_INIT;
 
+/* Executor of tasks started by bg_execute(). */
+static executor_t executor = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
 void
 init_background(void)
 {
 	/* Initialize state for the main thread. */
 	set_current_job(NULL);
+
+	if(wakeup_init() != 0)
+	{
+		LOG_ERROR_MSG("Can't create wakeup pipe");
+	}
 }
 
 void
@@ -118,10 +183,14 @@ add_finished_job(pid_t pid, int status)
 void
 check_background_jobs(void)
 {
+	/* Displaying errors runs nested event loop, which calls this function again
+	 * and could free the job that is being checked. */
+	static int checking;
+
 	job_t *p = jobs;
 	job_t *prev = NULL;
 
-	if(p == NULL)
+	if(p == NULL || checking)
 	{
 		return;
 	}
@@ -131,6 +200,8 @@ check_background_jobs(void)
 		return;
 	}
 
+	checking = 1;
+
 	while(p != NULL)
 	{
 		job_check(p);
@@ -154,6 +225,8 @@ check_background_jobs(void)
 		}
 	}
 
+	checking = 0;
+
 	bg_jobs_unfreeze();
 }
 
@@ -163,18 +236,6 @@ static void
 job_check(job_t *const job)
 {
 #ifndef _WIN32
-	fd_set ready;
-	int max_fd = 0;
-	struct timeval ts = { .tv_sec = 0, .tv_usec = 1000 };
-
-	/* Setup pipe for reading */
-	FD_ZERO(&ready);
-	if(job->fd >= 0)
-	{
-		FD_SET(job->fd, &ready);
-		max_fd = job->fd;
-	}
-
 	if(job->error != NULL)
 	{
 		if(!job->skip_errors)
@@ -186,16 +247,24 @@ job_check(job_t *const job)
 		job->error = NULL;
 	}
 
-	while(select(max_fd + 1, &ready, NULL, NULL, &ts) > 0)
+	/* The pipe is non-blocking, so this reads only what is available. */
+	while(job->fd != NO_JOB_ID)
 	{
 		char err_msg[ERR_MSG_LEN];
 
 		const ssize_t nread = read(job->fd, err_msg, sizeof(err_msg) - 1);
 		if(nread == 0)
+		{
+			/* Closing the stream at its end keeps it from being reported as readable
+			 * by the event loop over and over again. */
+			close(job->fd);
+			job->fd = NO_JOB_ID;
+		}
+		else if(nread < 0)
 		{
 			break;
 		}
-		else if(nread > 0 && !job->skip_errors)
+		else if(!job->skip_errors)
 		{
 			err_msg[nread] = '\0';
 			job->skip_errors = prompt_error_msg("Background Process Error", err_msg);
@@ -603,6 +672,10 @@ start_background_job(const char *cmd, int skip_errors)
 	{
 		close(error_pipe[1]); /* Close write end of pipe. */
 
+		/* Errors are read by job_check() only when they are available. */
+		(void)fcntl(error_pipe[0], F_SETFL,
+				fcntl(error_pipe[0], F_GETFL) | O_NONBLOCK);
+
 		job = add_background_job(pid, command, error_pipe[0], BJT_COMMAND);
 		if(job == NULL)
 		{
@@ -663,39 +736,320 @@ inner_bg_next(void)
 }
 
 int
-bg_execute(const char desc[], int total, int important, bg_task_func task_func,
-		void *args)
+bg_execute(const char desc[], const char path[], int total, int important,
+		bg_task_func task_func, void *args)
 {
-	pthread_t id;
+	bg_task_t *task;
+	const int queue = important ? QUEUE_OPERATIONS : QUEUE_TASKS;
 
-	background_task_args *const task_args = malloc(sizeof(*task_args));
-	if(task_args == NULL)
+	if(start_workers() != 0)
+	{
+		return 3;
+	}
+
+	task = malloc(sizeof(*task));
+	if(task == NULL)
 	{
 		return 1;
 	}
 
-	task_args->func = task_func;
-	task_args->args = args;
-	task_args->job = add_background_job(WRONG_PID, desc, NO_JOB_ID,
+	task->func = task_func;
+	task->args = args;
+	/* Querying file system can block, so device is determined by a worker. */
+	task->path = (path == NULL) ? NULL : strdup(path);
+	task->resolving = 0;
+	task->has_dev = 0;
+	task->dev = 0;
+	task->next = NULL;
+	task->job = add_background_job(WRONG_PID, desc, NO_JOB_ID,
 			important ? BJT_OPERATION : BJT_TASK);
 
-	if(task_args->job == NULL)
+	if(task->job == NULL)
 	{
-		free(task_args);
+		free(task->path);
+		free(task);
 		return 2;
 	}
 
-	task_args->job->total = total;
+	task->job->total = total;
+	task->job->queued = 1;
 
-	if(pthread_create(&id, NULL, background_task_bootstrap, task_args) != 0)
+	pthread_mutex_lock(&executor.lock);
+	if(executor.tails[queue] == NULL)
 	{
-		free(task_args);
-		return 3;
+		executor.heads[queue] = task;
 	}
+	else
+	{
+		executor.tails[queue]->next = task;
+	}
+	executor.tails[queue] = task;
+	++executor.queued;
+	pthread_cond_broadcast(&executor.cond);
+	pthread_mutex_unlock(&executor.lock);
 
 	return 0;
 }
 
+int
+bg_job_is_queued(const job_t *job)
+{
+	int queued;
+	pthread_mutex_lock(&executor.lock);
+	queued = job->queued;
+	pthread_mutex_unlock(&executor.lock);
+	return queued;
+}
+
+void
+bg_get_executor_stats(int *workers, int *busy, int *queued)
+{
+	pthread_mutex_lock(&executor.lock);
+	*workers = executor.nworkers;
+	*busy = executor.busy;
+	*queued = executor.queued;
+	pthread_mutex_unlock(&executor.lock);
+}
+
+/* Starts worker threads on the first call.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+start_workers(void)
+{
+	pthread_attr_t attr;
+	const int nworkers = MIN(MAX_WORKERS, MAX(MIN_WORKERS, get_cpu_count()));
+
+	if(executor.nworkers != 0)
+	{
+		return 0;
+	}
+
+	if(pthread_attr_init(&attr) != 0)
+	{
+		return 1;
+	}
+
+	if(pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) == 0)
+	{
+		pthread_mutex_lock(&executor.lock);
+		while(executor.nworkers < nworkers)
+		{
+			pthread_t id;
+			if(pthread_create(&id, &attr, &worker_thread, NULL) != 0)
+			{
+				break;
+			}
+			++executor.nworkers;
+		}
+		pthread_mutex_unlock(&executor.lock);
+	}
+
+	(void)pthread_attr_destroy(&attr);
+
+	return executor.nworkers == 0;
+}
+
+/* Entry point of a worker thread.  Executes queued tasks one by one performing
+ * correct startup/exit with related updates of internal data structures.
+ * Never returns. */
+static void *
+worker_thread(void *arg)
+{
+	pthread_mutex_lock(&executor.lock);
+	while(1)
+	{
+		bg_task_t *task = find_unresolved_task();
+		if(task != NULL)
+		{
+			resolve_dev(task);
+			continue;
+		}
+
+		task = take_task();
+		if(task == NULL)
+		{
+			pthread_cond_wait(&executor.cond, &executor.lock);
+			continue;
+		}
+
+		++executor.busy;
+		executor.running_tasks += (task->job->type == BJT_TASK);
+		update_dev_load(task, 1);
+		task->job->queued = 0;
+		pthread_mutex_unlock(&executor.lock);
+
+		set_current_job(task->job);
+		task->func(task->args);
+		finish_current_job();
+		set_current_job(NULL);
+
+		pthread_mutex_lock(&executor.lock);
+		--executor.busy;
+		executor.running_tasks -= (task->job->type == BJT_TASK);
+		update_dev_load(task, -1);
+		free(task);
+
+		/* Finished task might have been holding back some of queued tasks. */
+		pthread_cond_broadcast(&executor.cond);
+	}
+
+	return NULL;
+}
+
+/* Looks for a queued task whose device isn't known yet and isn't being
+ * determined by another worker.  Must be called with the lock held.  Returns
+ * the task or NULL if there is none. */
+static bg_task_t *
+find_unresolved_task(void)
+{
+	int queue;
+	for(queue = 0; queue < QUEUE_COUNT; ++queue)
+	{
+		bg_task_t *task;
+		for(task = executor.heads[queue]; task != NULL; task = task->next)
+		{
+			if(task->path != NULL && !task->resolving)
+			{
+				return task;
+			}
+		}
+	}
+	return NULL;
+}
+
+/* Determines device accessed by the queued task.  Must be called with the lock
+ * held, which is released while file system is queried. */
+static void
+resolve_dev(bg_task_t *task)
+{
+	struct stat st;
+	char *const path = task->path;
+	int has_dev;
+
+	/* The task stays in the queue, but isn't taken until this is done. */
+	task->resolving = 1;
+	pthread_mutex_unlock(&executor.lock);
+	has_dev = (stat(path, &st) == 0);
+	pthread_mutex_lock(&executor.lock);
+
+	task->has_dev = has_dev;
+	task->dev = has_dev ? st.st_dev : 0;
+	task->path = NULL;
+	task->resolving = 0;
+	free(path);
+
+	/* Other workers might be waiting for the task to become runnable. */
+	pthread_cond_broadcast(&executor.cond);
+}
+
+/* Removes the first task that can be run right now from the queues, looking at
+ * more important tasks first.  Must be called with the lock held.  Returns the
+ * task or NULL if there is none. */
+static bg_task_t *
+take_task(void)
+{
+	int queue;
+	for(queue = 0; queue < QUEUE_COUNT; ++queue)
+	{
+		bg_task_t **link = &executor.heads[queue];
+		bg_task_t *prev = NULL;
+		while(*link != NULL)
+		{
+			bg_task_t *const task = *link;
+			if(can_run(task, queue))
+			{
+				*link = task->next;
+				if(executor.tails[queue] == task)
+				{
+					executor.tails[queue] = prev;
+				}
+				--executor.queued;
+				task->next = NULL;
+				return task;
+			}
+			prev = task;
+			link = &task->next;
+		}
+	}
+	return NULL;
+}
+
+/* Checks whether the task from the queue can be started without exceeding
+ * limits.  Must be called with the lock held.  Returns non-zero if so,
+ * otherwise zero is returned. */
+static int
+can_run(const bg_task_t *task, int queue)
+{
+	dev_load_t *load;
+
+	if(task->path != NULL)
+	{
+		/* Device isn't known yet. */
+		return 0;
+	}
+
+	/* Unimportant tasks always leave a worker for operations. */
+	if(queue == QUEUE_TASKS &&
+			executor.running_tasks >= MAX(1, executor.nworkers - 1))
+	{
+		return 0;
+	}
+
+	if(!task->has_dev)
+	{
+		return 1;
+	}
+
+	load = find_dev_load(task->dev);
+	return load == NULL || load->count < MAX_IO_PER_DEVICE;
+}
+
+/* Changes number of running tasks that use device of the task by delta.  Must
+ * be called with the lock held. */
+static void
+update_dev_load(const bg_task_t *task, int delta)
+{
+	dev_load_t *load;
+
+	if(!task->has_dev)
+	{
+		return;
+	}
+
+	load = find_dev_load(task->dev);
+	if(load == NULL)
+	{
+		/* There are at most as many devices as there are workers. */
+		assert(delta > 0 && executor.ndevs < MAX_WORKERS);
+		load = &executor.devs[executor.ndevs++];
+		load->dev = task->dev;
+		load->count = 0;
+	}
+
+	load->count += delta;
+	if(load->count == 0)
+	{
+		*load = executor.devs[--executor.ndevs];
+	}
+}
+
+/* Looks up load of the device among devices used by running tasks.  Must be
+ * called with the lock held.  Returns pointer to the load or NULL if device
+ * isn't used. */
+static dev_load_t *
+find_dev_load(dev_t dev)
+{
+	int i;
+	for(i = 0; i < executor.ndevs; ++i)
+	{
+		if(executor.devs[i].dev == dev)
+		{
+			return &executor.devs[i];
+		}
+	}
+	return NULL;
+}
+
 /* Creates structure that describes background job and registers it in the list
  * of jobs. */
 #ifndef _WIN32
@@ -728,30 +1082,12 @@ add_background_job(pid_t pid, const char cmd[], HANDLE hprocess, BgJobType type)
 
 	new->total = 0;
 	new->done = 0;
+	new->queued = 0;
 
 	jobs = new;
 	return new;
 }
 
-/* Pthreads entry point for a new background task.  Performs correct
- * startup/exit with related updates of internal data structures.  Returns
- * result for this thread. */
-static void *
-background_task_bootstrap(void *arg)
-{
-	background_task_args *const task_args = arg;
-
-	set_current_job(task_args->job);
-
-	task_args->func(task_args->args);
-
-	finish_current_job();
-
-	free(task_args);
-
-	return NULL;
-}
-
 /* Stores pointer to the job in a thread-local storage. */
 static void
 set_current_job(job_t *job)
@@ -777,6 +1113,9 @@ finish_current_job(void)
 	{
 		job->running = 0;
 		job->exit_code = 0;
+
+		/* Let the main loop remove the job. */
+		wakeup_notify();
 	}
 }
 
@@ -55,6 +55,8 @@ typedef struct job_t
 	/* For background operations and tasks. */
 	int total;
 	int done;
+	int queued; /* Whether the task waits for a free worker, see
+	               bg_job_is_queued(). */
 
 #ifndef _WIN32
 	int fd;
@@ -97,11 +99,23 @@ void check_background_jobs(void);
 
 void inner_bg_next(void);
 
-/* Start new background task, executed in a separate thread.  Returns zero on
- * success, otherwise non-zero is returned. */
-int bg_execute(const char desc[], int total, int important,
+/* Queues new background task, which is executed by one of worker threads.
+ * Important tasks (operations) are started before unimportant ones.  The path
+ * specifies file or directory which device is accessed by the task, number of
+ * tasks running on the same device at the same time is limited.  The path can
+ * be NULL.  Returns zero on success, otherwise non-zero is returned. */
+int bg_execute(const char desc[], const char path[], int total, int important,
 		bg_task_func task_func, void *args);
 
+/* Retrieves state of the executor of tasks started by bg_execute(): number of
+ * worker threads, how many of them are busy and number of tasks waiting in
+ * queues. */
+void bg_get_executor_stats(int *workers, int *busy, int *queued);
+
+/* Checks whether task of the job started by bg_execute() waits for a free
+ * worker.  Returns non-zero if so, otherwise zero is returned. */
+int bg_job_is_queued(const job_t *job);
+
 /* Checks whether there are any internal jobs (not external applications tracked
  * by vifm) running in background. */
 int bg_has_active_jobs(void);
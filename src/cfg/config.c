@@ -189,6 +189,9 @@ cfg_init(void)
 	cfg.timeout_len = 1000;
 	cfg.min_timeout_len = 150;
 
+	cfg.parallel_sort = 10000;
+	cfg.copy_threads = 4;
+
 #ifndef _WIN32
 	copy_str(cfg.log_file, sizeof(cfg.log_file), "/var/log/vifm-startup-log");
 #else
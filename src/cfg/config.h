@@ -150,6 +150,14 @@ typedef struct config_t
 
 	int timeout_len;     /* Maximum period on waiting for the input. */
 	int min_timeout_len; /* Minimum period on waiting for the input. */
+
+	/* Minimal number of files in a list to sort it using several threads, zero
+	 * disables parallel sorting. */
+	int parallel_sort;
+
+	/* Number of threads that copy files of a directory, one means copying files
+	 * sequentially. */
+	int copy_threads;
 }
 config_t;
 
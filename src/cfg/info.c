@@ -881,6 +881,7 @@ write_options(FILE *const fp)
 	fprintf(fp, "=%schaselinks\n", cfg.chase_links ? "" : "no");
 	fprintf(fp, "=columns=%d\n", cfg.columns);
 	fprintf(fp, "=%sconfirm\n", cfg.confirm ? "" : "no");
+	fprintf(fp, "=copythreads=%d\n", cfg.copy_threads);
 	fprintf(fp, "=cpoptions=%s%s%s\n",
 			cfg.filter_inverted_by_default ? "f" : "",
 			cfg.selection_is_primary ? "s" : "",
@@ -904,6 +905,7 @@ write_options(FILE *const fp)
 	fprintf(fp, "=lines=%d\n", cfg.lines);
 	fprintf(fp, "=locateprg=%s\n", escape_spaces(cfg.locate_prg));
 	fprintf(fp, "=mintimeoutlen=%d\n", cfg.min_timeout_len);
+	fprintf(fp, "=parallelsort=%d\n", cfg.parallel_sort);
 	fprintf(fp, "=rulerformat=%s\n", escape_spaces(cfg.ruler_format));
 	fprintf(fp, "=%srunexec\n", cfg.auto_execute ? "" : "no");
 	fprintf(fp, "=%sscrollbind\n", cfg.scroll_bind ? "" : "no");
@@ -631,6 +631,42 @@ complete_command_name(const char beginning[])
 	size_t paths_count;
 
 	paths = get_paths(&paths_count);
+
+#ifndef _WIN32
+	if(!contains_slash(beginning))
+	{
+		const size_t len = strlen(beginning);
+		size_t count;
+		size_t j;
+		char **const names = get_path_execs(&count);
+
+		for(j = 0U; j < count; ++j)
+		{
+			if(beginning[0] == '\0' && names[j][0] == '.')
+			{
+				continue;
+			}
+			if(strncmp(names[j], beginning, len) == 0)
+			{
+				vle_compl_add_path_match(names[j]);
+			}
+		}
+		vle_compl_finish_group();
+
+		/* Relative directories are not indexed. */
+		for(i = 0; i < paths_count; i++)
+		{
+			if(!is_path_absolute(paths[i]) && vifm_chdir(paths[i]) == 0)
+			{
+				filename_completion(beginning, CT_EXECONLY);
+			}
+		}
+
+		vle_compl_add_last_path_match(beginning);
+		return;
+	}
+#endif
+
 	for(i = 0; i < paths_count; i++)
 	{
 		if(vifm_chdir(paths[i]) == 0)
@@ -0,0 +1 @@
+const char GIT_INFO[] = "627cfa32f622-dirty";
@@ -0,0 +1,426 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "dir_loader.h"
+
+#include <pthread.h>
+
+#ifndef _WIN32
+#include <dirent.h> /* DIR dirent dirfd() opendir() readdir() closedir() */
+#include <fcntl.h> /* AT_SYMLINK_NOFOLLOW */
+#include <sys/stat.h> /* fstatat() stat */
+#endif
+
+#include <errno.h> /* ETIMEDOUT errno */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uintmax_t */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() malloc() realloc() */
+#include <string.h> /* memcpy() strcmp() strdup() */
+#include <sys/time.h> /* gettimeofday() timeval */
+#include <time.h> /* timespec */
+
+#include "cfg/config.h"
+#include "utils/arena.h"
+#include "utils/fs.h"
+#include "utils/fs_limits.h"
+#include "utils/log.h"
+#include "utils/utils.h"
+#include "utils/wakeup.h"
+#include "types.h"
+
+/* Number of entries collected by the loader before handing them over to the
+ * main thread. */
+#define BATCH_SIZE 256
+
+struct dir_loader_t
+{
+	pthread_mutex_t lock; /* Protects all fields below. */
+	pthread_cond_t cond;  /* Signaled on each published batch and on finish. */
+
+	char *path; /* Path to the directory being read. */
+	/* Copy of 'slowfs' option, which can be changed while loading is going
+	 * on. */
+	char *slow_fs_list;
+
+	/* Storage of names of entries, which is used only by the loader thread and
+	 * released along with the loader. */
+	arena_t names;
+
+	dir_entry_t *entries; /* Entries which were read, but not taken yet. */
+	size_t count;         /* Number of elements in the entries array. */
+	size_t capacity;      /* Number of allocated elements of the entries. */
+
+	int finished;  /* Whether reading is over. */
+	int failed;    /* Whether directory couldn't be read. */
+	int cancelled; /* Whether reading should be stopped as soon as possible. */
+	int refs;      /* Number of references (thread and handle owner). */
+};
+
+#ifndef _WIN32
+static void * loader_thread(void *arg);
+static void load_entry(const char dir[], int dir_fd, const struct dirent *d,
+		const char slow_fs_list[], arena_t *names, dir_entry_t *entry);
+static int publish_batch(dir_loader_t *dl, dir_entry_t batch[], size_t count);
+#endif
+static void finish_loading(dir_loader_t *dl, int failed);
+static void put_loader(dir_loader_t *dl);
+
+dir_loader_t *
+dl_start(const char path[])
+{
+#ifndef _WIN32
+	pthread_t id;
+	pthread_attr_t attr;
+	int failed;
+
+	dir_loader_t *const dl = malloc(sizeof(*dl));
+	if(dl == NULL)
+	{
+		return NULL;
+	}
+
+	dl->path = strdup(path);
+	dl->slow_fs_list = strdup(cfg.slow_fs_list);
+	if(dl->path == NULL || dl->slow_fs_list == NULL)
+	{
+		free(dl->path);
+		free(dl->slow_fs_list);
+		free(dl);
+		return NULL;
+	}
+
+	(void)pthread_mutex_init(&dl->lock, NULL);
+	(void)pthread_cond_init(&dl->cond, NULL);
+	dl->names.head = NULL;
+	dl->names.next_size = 0U;
+	dl->entries = NULL;
+	dl->count = 0U;
+	dl->capacity = 0U;
+	dl->finished = 0;
+	dl->failed = 0;
+	dl->cancelled = 0;
+	dl->refs = 2;
+
+	failed = pthread_attr_init(&attr) != 0;
+	failed = failed
+	      || pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) != 0
+	      || pthread_create(&id, &attr, &loader_thread, dl) != 0;
+	(void)pthread_attr_destroy(&attr);
+
+	if(failed)
+	{
+		dl->refs = 1;
+		put_loader(dl);
+		return NULL;
+	}
+
+	return dl;
+#else
+	return NULL;
+#endif
+}
+
+void
+dl_wait(dir_loader_t *dl, size_t count, int timeout)
+{
+	struct timeval tv;
+	struct timespec deadline;
+
+	(void)gettimeofday(&tv, NULL);
+	deadline.tv_sec = tv.tv_sec + timeout/1000;
+	deadline.tv_nsec = tv.tv_usec*1000L + (timeout%1000)*1000000L;
+	if(deadline.tv_nsec >= 1000000000L)
+	{
+		++deadline.tv_sec;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	pthread_mutex_lock(&dl->lock);
+	while(!dl->finished && dl->count < count)
+	{
+		if(pthread_cond_timedwait(&dl->cond, &dl->lock, &deadline) == ETIMEDOUT)
+		{
+			break;
+		}
+	}
+	pthread_mutex_unlock(&dl->lock);
+}
+
+int
+dl_query(dir_loader_t *dl, size_t *pending)
+{
+	int finished;
+
+	pthread_mutex_lock(&dl->lock);
+	*pending = dl->count;
+	finished = dl->finished;
+	pthread_mutex_unlock(&dl->lock);
+
+	return finished;
+}
+
+int
+dl_take(dir_loader_t *dl, dir_entry_t **entries, size_t *count)
+{
+	int finished;
+
+	pthread_mutex_lock(&dl->lock);
+	*entries = dl->entries;
+	*count = dl->count;
+	finished = dl->finished;
+	dl->entries = NULL;
+	dl->count = 0U;
+	dl->capacity = 0U;
+	pthread_mutex_unlock(&dl->lock);
+
+	return finished;
+}
+
+int
+dl_failed(dir_loader_t *dl)
+{
+	int failed;
+
+	pthread_mutex_lock(&dl->lock);
+	failed = dl->failed;
+	pthread_mutex_unlock(&dl->lock);
+
+	return failed;
+}
+
+void
+dl_release(dir_loader_t *dl)
+{
+	if(dl == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&dl->lock);
+	dl->cancelled = 1;
+	pthread_mutex_unlock(&dl->lock);
+
+	put_loader(dl);
+}
+
+#ifndef _WIN32
+/* Entry point of the loader thread.  Returns NULL. */
+static void *
+loader_thread(void *arg)
+{
+	dir_loader_t *const dl = arg;
+	dir_entry_t batch[BATCH_SIZE];
+	size_t batch_len = 0U;
+	struct dirent *d;
+
+	DIR *const dir = opendir(dl->path);
+	if(dir == NULL)
+	{
+		LOG_SERROR_MSG(errno, "Can't opendir() \"%s\"", dl->path);
+		finish_loading(dl, 1);
+		put_loader(dl);
+		return NULL;
+	}
+
+	while((d = readdir(dir)) != NULL)
+	{
+		/* The "." directory is never displayed. */
+		if(strcmp(d->d_name, ".") == 0)
+		{
+			continue;
+		}
+
+		load_entry(dl->path, dirfd(dir), d, dl->slow_fs_list, &dl->names,
+				&batch[batch_len]);
+		if(batch[batch_len].name == NULL)
+		{
+			continue;
+		}
+
+		if(++batch_len == BATCH_SIZE)
+		{
+			if(publish_batch(dl, batch, batch_len) != 0)
+			{
+				batch_len = 0U;
+				break;
+			}
+			batch_len = 0U;
+		}
+	}
+	closedir(dir);
+
+	(void)publish_batch(dl, batch, batch_len);
+	finish_loading(dl, 0);
+	put_loader(dl);
+	return NULL;
+}
+
+/* Fills the entry with information about file described by the d.  The
+ * slow_fs_list is a copy of 'slowfs' that's safe to use in this thread.  Leaves
+ * name field of the entry set to NULL on failure. */
+static void
+load_entry(const char dir[], int dir_fd, const struct dirent *d,
+		const char slow_fs_list[], arena_t *names, dir_entry_t *entry)
+{
+	struct stat s;
+
+	entry->name = arena_strdup(names, d->d_name);
+	entry->origin = NULL;
+
+	entry->size = 0ULL;
+	entry->uid = (uid_t)-1;
+	entry->gid = (gid_t)-1;
+	entry->mode = (mode_t)0;
+	entry->mtime = (time_t)0;
+	entry->atime = (time_t)0;
+	entry->ctime = (time_t)0;
+	entry->type = UNKNOWN;
+	entry->hi_num = -1;
+	entry->selected = 0;
+	entry->was_selected = 0;
+	entry->search_match = 0;
+	entry->marked = 0;
+
+	if(entry->name == NULL)
+	{
+		return;
+	}
+
+	/* Relative *at() calls don't depend on current working directory, which
+	 * belongs to the main thread. */
+	if(fstatat(dir_fd, d->d_name, &s, AT_SYMLINK_NOFOLLOW) == 0)
+	{
+		entry->type = get_type_from_mode(s.st_mode);
+		entry->size = (uintmax_t)s.st_size;
+		entry->mode = s.st_mode;
+		entry->uid = s.st_uid;
+		entry->gid = s.st_gid;
+		entry->mtime = s.st_mtime;
+		entry->atime = s.st_atime;
+		entry->ctime = s.st_ctime;
+	}
+	else
+	{
+		LOG_SERROR_MSG(errno, "Can't lstat() \"%s/%s\"", dir, d->d_name);
+	}
+
+	if(entry->type == UNKNOWN)
+	{
+		entry->type = type_from_dir_entry(d);
+	}
+
+	if(entry->type == LINK)
+	{
+		char full_path[PATH_MAX];
+		char target[PATH_MAX];
+
+		snprintf(full_path, sizeof(full_path), "%s/%s", dir, d->d_name);
+		if(get_link_target_abs(full_path, dir, target, sizeof(target)) == 0 &&
+				!refers_to_slower_fs_in(full_path, target, slow_fs_list) &&
+				fstatat(dir_fd, d->d_name, &s, 0) == 0)
+		{
+			entry->mode = s.st_mode;
+		}
+	}
+}
+
+/* Makes batch of entries available to the main thread.  Returns non-zero if
+ * loading was cancelled, in which case the batch is discarded. */
+static int
+publish_batch(dir_loader_t *dl, dir_entry_t batch[], size_t count)
+{
+	int cancelled;
+
+	pthread_mutex_lock(&dl->lock);
+
+	cancelled = dl->cancelled;
+	if(!cancelled && dl->count + count > dl->capacity)
+	{
+		const size_t new_capacity = (dl->count + count)*2U;
+		dir_entry_t *const entries = realloc(dl->entries,
+				new_capacity*sizeof(*entries));
+		if(entries == NULL)
+		{
+			cancelled = 1;
+		}
+		else
+		{
+			dl->entries = entries;
+			dl->capacity = new_capacity;
+		}
+	}
+
+	if(!cancelled)
+	{
+		memcpy(&dl->entries[dl->count], batch, count*sizeof(*batch));
+		dl->count += count;
+		pthread_cond_signal(&dl->cond);
+	}
+
+	pthread_mutex_unlock(&dl->lock);
+
+	if(!cancelled)
+	{
+		wakeup_notify();
+	}
+
+	return cancelled;
+}
+#endif
+
+/* Marks loading as finished and wakes up waiting thread. */
+static void
+finish_loading(dir_loader_t *dl, int failed)
+{
+	pthread_mutex_lock(&dl->lock);
+	dl->finished = 1;
+	dl->failed = failed;
+	pthread_cond_signal(&dl->cond);
+	pthread_mutex_unlock(&dl->lock);
+
+	wakeup_notify();
+}
+
+/* Drops reference to the loader freeing it when it's not referenced
+ * anymore. */
+static void
+put_loader(dir_loader_t *dl)
+{
+	int refs;
+
+	pthread_mutex_lock(&dl->lock);
+	refs = --dl->refs;
+	pthread_mutex_unlock(&dl->lock);
+
+	if(refs != 0)
+	{
+		return;
+	}
+
+	arena_free(&dl->names);
+	free(dl->entries);
+	free(dl->path);
+	free(dl->slow_fs_list);
+	pthread_cond_destroy(&dl->cond);
+	pthread_mutex_destroy(&dl->lock);
+	free(dl);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,63 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__DIR_LOADER_H__
+#define VIFM__DIR_LOADER_H__
+
+#include <stddef.h> /* size_t */
+
+#include "ui/ui.h"
+
+/* Reads list of files of a directory in a background thread handing entries
+ * over to the main thread in batches.  Only names and inode information are
+ * read by the loader, filtering of entries is left to the caller. */
+
+/* Opaque handle of a running loader. */
+typedef struct dir_loader_t dir_loader_t;
+
+/* Starts reading list of files of the path directory in a background thread.
+ * Returns handle of the loader or NULL on error or when asynchronous loading
+ * isn't available. */
+dir_loader_t * dl_start(const char path[]);
+
+/* Waits for at most timeout milliseconds until either count entries are
+ * available or loading is finished. */
+void dl_wait(dir_loader_t *dl, size_t count, int timeout);
+
+/* Queries state of the loader.  Sets *pending to number of entries that can be
+ * taken.  Returns non-zero if reading is over. */
+int dl_query(dir_loader_t *dl, size_t *pending);
+
+/* Moves entries read so far out of the loader.  *entries receives dynamically
+ * allocated array (can be NULL) of *count elements with NULL origins.  Names of
+ * the entries are owned by the loader and stay valid until it's released.
+ * Returns non-zero if reading is over and there will be no more entries. */
+int dl_take(dir_loader_t *dl, dir_entry_t **entries, size_t *count);
+
+/* Checks whether loading has failed to read the directory at all.  Returns
+ * non-zero if so, otherwise zero is returned. */
+int dl_failed(dir_loader_t *dl);
+
+/* Requests loading to stop (if it's still in progress) and frees the handle.
+ * The dl can be NULL. */
+void dl_release(dir_loader_t *dl);
+
+#endif /* VIFM__DIR_LOADER_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,614 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "dirsize_cache.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <pthread.h>
+
+#include <sys/stat.h> /* stat */
+
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* strcmp() strdup() strrchr() */
+
+#include "compat/os.h"
+#include "utils/fs_limits.h"
+#include "utils/str.h"
+#include "utils/utf8.h"
+
+/* Initial number of slots in the hash tables (must be a power of two). */
+#define INITIAL_CAPACITY 64U
+
+/* Identity and state of a directory. */
+typedef struct
+{
+	uint64_t dev;        /* Device number. */
+	uint64_t ino;        /* Inode number (unique within the device). */
+	uint64_t mtime_sec;  /* Modification time (seconds part). */
+	uint64_t mtime_nsec; /* Modification time (nanoseconds part). */
+}
+dir_id_t;
+
+/* Single slot of the hash table of sizes. */
+typedef struct
+{
+	dir_id_t id;   /* Identity of the directory. */
+	uint64_t size; /* Size of the directory. */
+	int used;      /* Whether this slot is occupied. */
+	int has_size;  /* Whether size was ever stored. */
+	int outdated;  /* Whether size was outdated or was never stored. */
+
+	/* Size accumulated so far by calculation that's in progress.  It's only
+	 * for display and is never treated as a size of the directory. */
+	uint64_t partial;
+	int has_partial; /* Whether partial field is set. */
+}
+slot_t;
+
+/* Single slot of the hash table of path identities. */
+typedef struct
+{
+	char *path;  /* Path as it was looked up or NULL for an empty slot. */
+	dir_id_t id; /* Identity of the path at the moment of the check. */
+	int exists;  /* Whether the path referred to an existing directory. */
+}
+path_slot_t;
+
+struct dirsize_cache_t
+{
+	pthread_mutex_t lock; /* Protects all fields below. */
+	slot_t *slots;        /* Open addressing hash table of sizes. */
+	size_t capacity;      /* Number of slots (a power of two). */
+	size_t count;         /* Number of occupied slots. */
+
+	path_slot_t *paths;     /* Open addressing hash table of path identities. */
+	size_t paths_capacity;  /* Number of path slots (a power of two). */
+	size_t paths_count;     /* Number of occupied path slots. */
+};
+
+static slot_t * get_slot(dirsize_cache_t *dsc, const dir_id_t *id);
+static int lookup(dirsize_cache_t *dsc, const char path[], int fresh,
+		uint64_t *size);
+static int get_path_id(dirsize_cache_t *dsc, const char path[], int fresh,
+		dir_id_t *id);
+static void remember_path(dirsize_cache_t *dsc, const char path[],
+		const dir_id_t *id, int exists);
+static void outdate_parents(dirsize_cache_t *dsc, const char path[]);
+static int get_dir_id(const char path[], dir_id_t *id);
+static slot_t * find_slot(slot_t slots[], size_t capacity, const dir_id_t *id);
+static path_slot_t * find_path_slot(path_slot_t paths[], size_t capacity,
+		const char path[]);
+static int grow(dirsize_cache_t *dsc);
+static int grow_paths(dirsize_cache_t *dsc);
+static void clear_paths(dirsize_cache_t *dsc);
+static size_t hash_id(const dir_id_t *id);
+static size_t hash_path(const char path[]);
+
+dirsize_cache_t *
+dsc_create(void)
+{
+	dirsize_cache_t *const dsc = malloc(sizeof(*dsc));
+	if(dsc == NULL)
+	{
+		return NULL;
+	}
+
+	dsc->slots = calloc(INITIAL_CAPACITY, sizeof(*dsc->slots));
+	dsc->paths = calloc(INITIAL_CAPACITY, sizeof(*dsc->paths));
+	if(dsc->slots == NULL || dsc->paths == NULL)
+	{
+		free(dsc->slots);
+		free(dsc->paths);
+		free(dsc);
+		return NULL;
+	}
+
+	(void)pthread_mutex_init(&dsc->lock, NULL);
+	dsc->capacity = INITIAL_CAPACITY;
+	dsc->count = 0U;
+	dsc->paths_capacity = INITIAL_CAPACITY;
+	dsc->paths_count = 0U;
+	return dsc;
+}
+
+void
+dsc_free(dirsize_cache_t *dsc)
+{
+	if(dsc == NULL)
+	{
+		return;
+	}
+
+	clear_paths(dsc);
+	pthread_mutex_destroy(&dsc->lock);
+	free(dsc->slots);
+	free(dsc->paths);
+	free(dsc);
+}
+
+int
+dsc_set(dirsize_cache_t *dsc, const char path[], uint64_t size)
+{
+	dir_id_t id;
+	slot_t *slot;
+	int error = 0;
+	int changed = 0;
+
+	if(get_path_id(dsc, path, 1, &id) != 0)
+	{
+		return 1;
+	}
+
+	pthread_mutex_lock(&dsc->lock);
+
+	slot = get_slot(dsc, &id);
+	if(slot == NULL)
+	{
+		error = 1;
+	}
+	else
+	{
+		changed = (slot->has_size && slot->size != size);
+		/* Overwrite modification time along with size to drop outdated data. */
+		slot->id = id;
+		slot->size = size;
+		slot->has_size = 1;
+		slot->outdated = 0;
+		slot->has_partial = 0;
+	}
+
+	pthread_mutex_unlock(&dsc->lock);
+
+	if(changed)
+	{
+		outdate_parents(dsc, path);
+	}
+
+	return error;
+}
+
+int
+dsc_set_partial(dirsize_cache_t *dsc, const char path[], uint64_t size)
+{
+	dir_id_t id;
+	slot_t *slot;
+
+	if(get_path_id(dsc, path, 0, &id) != 0)
+	{
+		return 1;
+	}
+
+	pthread_mutex_lock(&dsc->lock);
+	slot = get_slot(dsc, &id);
+	if(slot != NULL)
+	{
+		slot->partial = size;
+		slot->has_partial = 1;
+	}
+	pthread_mutex_unlock(&dsc->lock);
+
+	return slot == NULL;
+}
+
+int
+dsc_get_partial(dirsize_cache_t *dsc, const char path[], uint64_t *size)
+{
+	dir_id_t id;
+	const slot_t *slot;
+	int not_found;
+
+	if(get_path_id(dsc, path, 0, &id) != 0)
+	{
+		return 1;
+	}
+
+	pthread_mutex_lock(&dsc->lock);
+	slot = find_slot(dsc->slots, dsc->capacity, &id);
+	not_found = !slot->used || !slot->has_partial;
+	if(!not_found)
+	{
+		*size = slot->partial;
+	}
+	pthread_mutex_unlock(&dsc->lock);
+
+	return not_found;
+}
+
+int
+dsc_get(dirsize_cache_t *dsc, const char path[], uint64_t *size)
+{
+	return lookup(dsc, path, 0, size);
+}
+
+int
+dsc_get_fresh(dirsize_cache_t *dsc, const char path[], uint64_t *size)
+{
+	return lookup(dsc, path, 1, size);
+}
+
+void
+dsc_revalidate(dirsize_cache_t *dsc)
+{
+	pthread_mutex_lock(&dsc->lock);
+	clear_paths(dsc);
+	pthread_mutex_unlock(&dsc->lock);
+}
+
+/* Finds slot of the directory adding it if necessary.  Newly added slot has
+ * no valid size.  Must be called with dsc->lock held.  Returns the slot or NULL
+ * on error. */
+static slot_t *
+get_slot(dirsize_cache_t *dsc, const dir_id_t *id)
+{
+	slot_t *slot;
+
+	/* Keep load factor below 3/4 to make probe sequences short. */
+	if((dsc->count + 1U)*4U > dsc->capacity*3U && grow(dsc) != 0)
+	{
+		return NULL;
+	}
+
+	slot = find_slot(dsc->slots, dsc->capacity, id);
+	if(!slot->used)
+	{
+		slot->id = *id;
+		slot->size = 0U;
+		slot->used = 1;
+		slot->has_size = 0;
+		slot->outdated = 1;
+		slot->has_partial = 0;
+		++dsc->count;
+	}
+	return slot;
+}
+
+/* Looks up size of the directory.  Non-zero fresh forces checking current
+ * state of the directory.  Returns zero if size was found, otherwise non-zero
+ * is returned. */
+static int
+lookup(dirsize_cache_t *dsc, const char path[], int fresh, uint64_t *size)
+{
+	dir_id_t id;
+	const slot_t *slot;
+	int not_found;
+
+	if(get_path_id(dsc, path, fresh, &id) != 0)
+	{
+		return 1;
+	}
+
+	pthread_mutex_lock(&dsc->lock);
+	slot = find_slot(dsc->slots, dsc->capacity, &id);
+	not_found = !slot->used
+	         || slot->outdated
+	         || slot->id.mtime_sec != id.mtime_sec
+	         || slot->id.mtime_nsec != id.mtime_nsec;
+	if(!not_found)
+	{
+		*size = slot->size;
+	}
+	pthread_mutex_unlock(&dsc->lock);
+
+	return not_found;
+}
+
+/* Retrieves identity of the path either from the table of paths or by querying
+ * file system (always done for non-zero fresh).  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+get_path_id(dirsize_cache_t *dsc, const char path[], int fresh, dir_id_t *id)
+{
+	int exists;
+
+	if(!fresh)
+	{
+		const path_slot_t *slot;
+		int found;
+
+		pthread_mutex_lock(&dsc->lock);
+		slot = find_path_slot(dsc->paths, dsc->paths_capacity, path);
+		found = (slot->path != NULL);
+		if(found)
+		{
+			*id = slot->id;
+			exists = slot->exists;
+		}
+		pthread_mutex_unlock(&dsc->lock);
+
+		if(found)
+		{
+			return !exists;
+		}
+	}
+
+	/* File system is queried without holding the lock as it might take a
+	 * while. */
+	exists = (get_dir_id(path, id) == 0);
+	remember_path(dsc, path, id, exists);
+	return !exists;
+}
+
+/* Stores identity of the path in the table of paths.  Failing to do this
+ * isn't an error, the path will just be checked again. */
+static void
+remember_path(dirsize_cache_t *dsc, const char path[], const dir_id_t *id,
+		int exists)
+{
+	path_slot_t *slot;
+
+	pthread_mutex_lock(&dsc->lock);
+
+	if((dsc->paths_count + 1U)*4U <= dsc->paths_capacity*3U ||
+			grow_paths(dsc) == 0)
+	{
+		slot = find_path_slot(dsc->paths, dsc->paths_capacity, path);
+		if(slot->path == NULL)
+		{
+			slot->path = strdup(path);
+			dsc->paths_count += (slot->path != NULL);
+		}
+		if(slot->path != NULL)
+		{
+			slot->id = *id;
+			slot->exists = exists;
+		}
+	}
+
+	pthread_mutex_unlock(&dsc->lock);
+}
+
+/* Marks sizes of all parents of the path as outdated, because they include size
+ * of the path. */
+static void
+outdate_parents(dirsize_cache_t *dsc, const char path[])
+{
+	char parent[PATH_MAX];
+	copy_str(parent, sizeof(parent), path);
+
+	while(1)
+	{
+		dir_id_t id;
+		slot_t *slot;
+
+		char *const slash = strrchr(parent, '/');
+		if(slash == NULL)
+		{
+			break;
+		}
+
+		if(slash == parent || (slash == parent + 2 && parent[1] == ':'))
+		{
+			/* Root directory is the last one to process. */
+			if(slash[1] == '\0')
+			{
+				break;
+			}
+			slash[1] = '\0';
+		}
+		else
+		{
+			slash[0] = '\0';
+			if(slash[1] == '\0')
+			{
+				/* Path ended with a slash, this wasn't a parent. */
+				continue;
+			}
+		}
+
+		if(get_path_id(dsc, parent, 0, &id) != 0)
+		{
+			continue;
+		}
+
+		pthread_mutex_lock(&dsc->lock);
+		slot = find_slot(dsc->slots, dsc->capacity, &id);
+		if(slot->used)
+		{
+			slot->outdated = 1;
+		}
+		pthread_mutex_unlock(&dsc->lock);
+	}
+}
+
+/* Queries identity of a directory following symbolic links.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+get_dir_id(const char path[], dir_id_t *id)
+{
+#ifndef _WIN32
+	struct stat s;
+	if(os_stat(path, &s) != 0)
+	{
+		return 1;
+	}
+
+	id->dev = s.st_dev;
+	id->ino = s.st_ino;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+	id->mtime_sec = s.st_mtim.tv_sec;
+	id->mtime_nsec = s.st_mtim.tv_nsec;
+#else
+	id->mtime_sec = s.st_mtime;
+	id->mtime_nsec = 0U;
+#endif
+	return 0;
+#else
+	/* Inode numbers aren't reported by stat() on Windows, file index is its
+	 * counterpart. */
+	BY_HANDLE_FILE_INFORMATION info;
+	HANDLE hfile;
+	BOOL success;
+
+	wchar_t *const utf16_path = utf8_to_utf16(path);
+	if(utf16_path == NULL)
+	{
+		return 1;
+	}
+
+	hfile = CreateFileW(utf16_path, 0, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+			OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+	free(utf16_path);
+	if(hfile == INVALID_HANDLE_VALUE)
+	{
+		return 1;
+	}
+
+	success = GetFileInformationByHandle(hfile, &info);
+	CloseHandle(hfile);
+	if(!success)
+	{
+		return 1;
+	}
+
+	id->dev = info.dwVolumeSerialNumber;
+	id->ino = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+	id->mtime_sec = info.ftLastWriteTime.dwHighDateTime;
+	id->mtime_nsec = info.ftLastWriteTime.dwLowDateTime;
+	return 0;
+#endif
+}
+
+/* Looks up slot of the directory in the table.  Returns either slot that holds
+ * the directory or an empty slot where it should be put. */
+static slot_t *
+find_slot(slot_t slots[], size_t capacity, const dir_id_t *id)
+{
+	size_t i = hash_id(id) & (capacity - 1U);
+	while(slots[i].used && (slots[i].id.dev != id->dev ||
+				slots[i].id.ino != id->ino))
+	{
+		i = (i + 1U) & (capacity - 1U);
+	}
+	return &slots[i];
+}
+
+/* Looks up slot of the path in the table.  Returns either slot that holds the
+ * path or an empty slot where it should be put. */
+static path_slot_t *
+find_path_slot(path_slot_t paths[], size_t capacity, const char path[])
+{
+	size_t i = hash_path(path) & (capacity - 1U);
+	while(paths[i].path != NULL && strcmp(paths[i].path, path) != 0)
+	{
+		i = (i + 1U) & (capacity - 1U);
+	}
+	return &paths[i];
+}
+
+/* Doubles capacity of the table rehashing its elements.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+grow(dirsize_cache_t *dsc)
+{
+	size_t i;
+	const size_t new_capacity = dsc->capacity*2U;
+	slot_t *const new_slots = calloc(new_capacity, sizeof(*new_slots));
+	if(new_slots == NULL)
+	{
+		return 1;
+	}
+
+	for(i = 0U; i < dsc->capacity; ++i)
+	{
+		if(dsc->slots[i].used)
+		{
+			*find_slot(new_slots, new_capacity, &dsc->slots[i].id) = dsc->slots[i];
+		}
+	}
+
+	free(dsc->slots);
+	dsc->slots = new_slots;
+	dsc->capacity = new_capacity;
+	return 0;
+}
+
+/* Doubles capacity of the table of paths rehashing its elements.  Returns zero
+ * on success, otherwise non-zero is returned. */
+static int
+grow_paths(dirsize_cache_t *dsc)
+{
+	size_t i;
+	const size_t new_capacity = dsc->paths_capacity*2U;
+	path_slot_t *const new_paths = calloc(new_capacity, sizeof(*new_paths));
+	if(new_paths == NULL)
+	{
+		return 1;
+	}
+
+	for(i = 0U; i < dsc->paths_capacity; ++i)
+	{
+		if(dsc->paths[i].path != NULL)
+		{
+			*find_path_slot(new_paths, new_capacity, dsc->paths[i].path) =
+				dsc->paths[i];
+		}
+	}
+
+	free(dsc->paths);
+	dsc->paths = new_paths;
+	dsc->paths_capacity = new_capacity;
+	return 0;
+}
+
+/* Empties table of paths. */
+static void
+clear_paths(dirsize_cache_t *dsc)
+{
+	size_t i;
+	for(i = 0U; i < dsc->paths_capacity; ++i)
+	{
+		free(dsc->paths[i].path);
+		dsc->paths[i].path = NULL;
+	}
+	dsc->paths_count = 0U;
+}
+
+/* Computes hash of directory identity (modification time isn't taken into
+ * account).  Returns the hash. */
+static size_t
+hash_id(const dir_id_t *id)
+{
+	/* Inode numbers are often sequential, so mix bits well to spread them over
+	 * the table. */
+	uint64_t h = id->ino*0x9e3779b97f4a7c15ULL ^ id->dev;
+	h ^= h >> 31;
+	h *= 0xbf58476d1ce4e5b9ULL;
+	h ^= h >> 29;
+	return (size_t)h;
+}
+
+/* Computes FNV-1a hash of the path.  Returns the hash. */
+static size_t
+hash_path(const char path[])
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	while(*path != '\0')
+	{
+		h ^= (unsigned char)*path++;
+		h *= 0x100000001b3ULL;
+	}
+	return (size_t)(h ^ (h >> 32));
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,79 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__DIRSIZE_CACHE_H__
+#define VIFM__DIRSIZE_CACHE_H__
+
+#include <stdint.h> /* uint64_t */
+
+/* Storage of calculated directory sizes.  Directories are identified by device
+ * and inode numbers, so lookup doesn't depend on how path is spelled.  Size is
+ * considered outdated once modification time of the directory changes.
+ *
+ * Identity of a path is queried by stat() once and then remembered until
+ * dsc_revalidate() is called (on loading a directory), so changes made after
+ * that aren't noticed by dsc_get().  Modification time of a directory doesn't
+ * change when its subdirectories grow, so storing changed size of a directory
+ * outdates sizes of all its parents.  Sizes of other directories that contain
+ * modified subtrees stay stale until they are recalculated.
+ *
+ * All functions are thread-safe. */
+
+/* Opaque cache type. */
+typedef struct dirsize_cache_t dirsize_cache_t;
+
+/* Creates empty cache.  Returns the cache or NULL on error. */
+dirsize_cache_t * dsc_create(void);
+
+/* Frees the cache.  The dsc can be NULL. */
+void dsc_free(dirsize_cache_t *dsc);
+
+/* Stores size of the directory specified by its path.  Sizes of parent
+ * directories are outdated if the size differs from the previously stored one.
+ * Returns zero on success, otherwise non-zero is returned. */
+int dsc_set(dirsize_cache_t *dsc, const char path[], uint64_t size);
+
+/* Stores partial size of the directory whose calculation is in progress.  The
+ * value is dropped by dsc_set() and is never returned by dsc_get() or
+ * dsc_get_fresh().  Returns zero on success, otherwise non-zero is
+ * returned. */
+int dsc_set_partial(dirsize_cache_t *dsc, const char path[], uint64_t size);
+
+/* Looks up partial size of the directory stored by dsc_set_partial().  *size is
+ * left intact if there is no partial size.  Returns zero if it was found,
+ * otherwise non-zero is returned. */
+int dsc_get_partial(dirsize_cache_t *dsc, const char path[], uint64_t *size);
+
+/* Looks up size of the directory specified by its path using remembered
+ * identity of the path.  *size is left intact if the size is unknown or
+ * outdated.  Returns zero if size was found, otherwise non-zero is returned. */
+int dsc_get(dirsize_cache_t *dsc, const char path[], uint64_t *size);
+
+/* Same as dsc_get(), but always queries current state of the directory, which
+ * is what size calculation needs.  Returns zero if size was found, otherwise
+ * non-zero is returned. */
+int dsc_get_fresh(dirsize_cache_t *dsc, const char path[], uint64_t *size);
+
+/* Forgets identities of paths, so that following lookups check state of
+ * directories again. */
+void dsc_revalidate(dirsize_cache_t *dsc);
+
+#endif /* VIFM__DIRSIZE_CACHE_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,741 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "dirsize_calc.h"
+
+#include <pthread.h>
+
+#ifndef _WIN32
+#include <fcntl.h> /* AT_SYMLINK_NOFOLLOW */
+#include <sys/stat.h> /* S_ISDIR() fstatat() stat */
+#endif
+
+#include <dirent.h> /* DIR dirent dirfd() opendir() readdir() closedir() */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* calloc() free() malloc() realloc() */
+#include <string.h> /* memmove() strdup() strlen() */
+#include <sys/time.h> /* gettimeofday() timeval */
+
+#include "compat/os.h"
+#include "utils/fs.h"
+#include "utils/fs_limits.h"
+#include "utils/macros.h"
+#include "utils/path.h"
+#include "utils/utils.h"
+#include "dirsize_cache.h"
+
+#ifndef _WIN32
+
+/* Traversal is mostly waiting for file system, so it makes sense to have more
+ * threads than there are CPUs. */
+#define MIN_WORKERS 4
+#define MAX_WORKERS 16
+
+/* Minimal interval between publishing partial sizes, in microseconds. */
+#define PROGRESS_PERIOD 250000
+
+/* Initial number of slots in the set of seen hard links (a power of two). */
+#define INITIAL_LINKS_CAPACITY 64U
+
+/* Directory which is being processed. */
+typedef struct node_t node_t;
+struct node_t
+{
+	node_t *parent; /* Parent directory or NULL for the root. */
+	node_t *next;   /* Next node in a list of finished nodes. */
+	char *path;     /* Full path to the directory. */
+	uint64_t size;  /* Accumulated size of the directory. */
+	int pending;    /* Number of unfinished parts (scan itself and children). */
+};
+
+/* Queue of directories of a single worker.  Owner works on the tail, while
+ * other workers steal from the head, thus taking bigger chunks of work. */
+typedef struct
+{
+	pthread_mutex_t lock; /* Protects all fields below. */
+	node_t **nodes;       /* Nodes in the [head; tail) range are queued. */
+	size_t head;          /* Index of the first queued node. */
+	size_t tail;          /* Index past the last queued node. */
+	size_t capacity;      /* Number of allocated elements of the nodes. */
+}
+queue_t;
+
+/* Identity of a file with several hard links. */
+typedef struct
+{
+	uint64_t dev; /* Device number. */
+	uint64_t ino; /* Inode number. */
+}
+file_id_t;
+
+/* State of a single calculation. */
+typedef struct
+{
+	dirsize_cache_t *dsc;     /* Where to store results. */
+	const char *root_path;    /* Path to the root directory. */
+	int force;                /* Whether to ignore cached sizes. */
+	dsc_progress_cb progress; /* Progress callback or NULL. */
+	void *arg;                /* Argument for the progress callback. */
+
+	queue_t queues[MAX_WORKERS]; /* One queue per worker. */
+	int nworkers;                /* Number of queues in use. */
+
+	pthread_mutex_t lock; /* Protects all fields below. */
+	pthread_cond_t cond;  /* Signaled on new work and on finish. */
+	size_t queued;        /* Total number of queued nodes. */
+	int done;             /* Whether root directory is processed. */
+	uint64_t total;       /* Size of the root directory when done. */
+	uint64_t last_report; /* Time of the last partial report. */
+
+	pthread_mutex_t report_lock; /* Protects all fields below. */
+	int root_stored;             /* Whether size of the root is in the cache. */
+
+	pthread_mutex_t links_lock; /* Protects all fields below. */
+	file_id_t *links;           /* Open addressing set of seen hard links. */
+	size_t links_count;         /* Number of elements in the set. */
+	size_t links_capacity;      /* Number of slots of the set. */
+}
+calc_t;
+
+/* Argument of a worker thread. */
+typedef struct
+{
+	calc_t *calc; /* Calculation to participate in. */
+	int id;       /* Index of worker's queue. */
+}
+worker_t;
+
+static void * worker_thread(void *arg);
+static void run_worker(calc_t *calc, int id);
+static void process_dir(calc_t *calc, int id, node_t *node);
+static node_t * make_node(node_t *parent, const char path[]);
+static char * join_paths(const char dir[], const char name[]);
+static void finish_part(calc_t *calc, node_t *node, uint64_t size);
+static int is_time_to_report(calc_t *calc);
+static void report_progress(calc_t *calc, uint64_t size);
+static void store_finished(calc_t *calc, node_t *finished);
+static void push_node(calc_t *calc, int id, node_t *node);
+static node_t * take_node(calc_t *calc, int id);
+static node_t * pop_tail(queue_t *queue);
+static node_t * pop_head(queue_t *queue);
+static int is_first_link(calc_t *calc, const struct stat *s);
+static int grow_links(calc_t *calc);
+static file_id_t * find_link(file_id_t links[], size_t capacity,
+		const file_id_t *id);
+static uint64_t get_time_us(void);
+
+#else
+
+static uint64_t calc_serially(dirsize_cache_t *dsc, const char path[],
+		int force);
+
+#endif
+
+uint64_t
+dsc_calc(dirsize_cache_t *dsc, const char path[], int force,
+		dsc_progress_cb progress, void *arg)
+{
+#ifndef _WIN32
+	calc_t calc;
+	pthread_t ids[MAX_WORKERS];
+	worker_t workers[MAX_WORKERS];
+	int nthreads;
+	int i;
+
+	node_t *const root = make_node(NULL, path);
+	if(root == NULL)
+	{
+		return 0U;
+	}
+
+	calc.dsc = dsc;
+	calc.root_path = path;
+	calc.force = force;
+	calc.progress = progress;
+	calc.arg = arg;
+	calc.nworkers = MIN(MAX_WORKERS, MAX(MIN_WORKERS, get_cpu_count()*2));
+	calc.queued = 0U;
+	calc.done = 0;
+	calc.total = 0U;
+	calc.last_report = get_time_us();
+	calc.root_stored = 0;
+	calc.links = NULL;
+	calc.links_count = 0U;
+	calc.links_capacity = 0U;
+	(void)pthread_mutex_init(&calc.lock, NULL);
+	(void)pthread_cond_init(&calc.cond, NULL);
+	(void)pthread_mutex_init(&calc.report_lock, NULL);
+	(void)pthread_mutex_init(&calc.links_lock, NULL);
+
+	for(i = 0; i < calc.nworkers; ++i)
+	{
+		queue_t *const queue = &calc.queues[i];
+		(void)pthread_mutex_init(&queue->lock, NULL);
+		queue->nodes = NULL;
+		queue->head = 0U;
+		queue->tail = 0U;
+		queue->capacity = 0U;
+	}
+
+	push_node(&calc, 0, root);
+
+	/* The calling thread is worker number zero, the rest are optional. */
+	nthreads = 0;
+	for(i = 1; i < calc.nworkers; ++i)
+	{
+		workers[nthreads].calc = &calc;
+		workers[nthreads].id = i;
+		if(pthread_create(&ids[nthreads], NULL, &worker_thread,
+					&workers[nthreads]) == 0)
+		{
+			++nthreads;
+		}
+	}
+
+	run_worker(&calc, 0);
+
+	for(i = 0; i < nthreads; ++i)
+	{
+		(void)pthread_join(ids[i], NULL);
+	}
+
+	for(i = 0; i < calc.nworkers; ++i)
+	{
+		free(calc.queues[i].nodes);
+		pthread_mutex_destroy(&calc.queues[i].lock);
+	}
+	free(calc.links);
+	pthread_mutex_destroy(&calc.links_lock);
+	pthread_mutex_destroy(&calc.report_lock);
+	pthread_cond_destroy(&calc.cond);
+	pthread_mutex_destroy(&calc.lock);
+
+	return calc.total;
+#else
+	return calc_serially(dsc, path, force);
+#endif
+}
+
+#ifndef _WIN32
+
+/* Entry point of a worker thread.  Returns NULL. */
+static void *
+worker_thread(void *arg)
+{
+	const worker_t *const worker = arg;
+	run_worker(worker->calc, worker->id);
+	return NULL;
+}
+
+/* Processes directories until whole tree is traversed. */
+static void
+run_worker(calc_t *calc, int id)
+{
+	while(1)
+	{
+		node_t *const node = take_node(calc, id);
+		if(node != NULL)
+		{
+			process_dir(calc, id, node);
+			continue;
+		}
+
+		pthread_mutex_lock(&calc->lock);
+		while(!calc->done && calc->queued == 0U)
+		{
+			pthread_cond_wait(&calc->cond, &calc->lock);
+		}
+		if(calc->done)
+		{
+			pthread_mutex_unlock(&calc->lock);
+			break;
+		}
+		pthread_mutex_unlock(&calc->lock);
+	}
+}
+
+/* Sums up sizes of files of the directory and queues its subdirectories. */
+static void
+process_dir(calc_t *calc, int id, node_t *node)
+{
+	struct dirent *d;
+	uint64_t size = 0U;
+
+	DIR *const dir = os_opendir(node->path);
+	if(dir == NULL)
+	{
+		finish_part(calc, node, 0U);
+		return;
+	}
+
+	while((d = os_readdir(dir)) != NULL)
+	{
+		struct stat s;
+		int is_dir;
+
+		if(is_builtin_dir(d->d_name))
+		{
+			continue;
+		}
+
+		/* Relative *at() calls save kernel from resolving whole path for every
+		 * file. */
+		if(d->d_type == DT_DIR)
+		{
+			is_dir = 1;
+		}
+		else if(fstatat(dirfd(dir), d->d_name, &s, AT_SYMLINK_NOFOLLOW) == 0)
+		{
+			is_dir = S_ISDIR(s.st_mode);
+		}
+		else
+		{
+			continue;
+		}
+
+		if(is_dir)
+		{
+			uint64_t dir_size;
+			node_t *child;
+
+			char *const path = join_paths(node->path, d->d_name);
+			if(path == NULL)
+			{
+				continue;
+			}
+
+			if(!calc->force && dsc_get_fresh(calc->dsc, path, &dir_size) == 0)
+			{
+				size += dir_size;
+				free(path);
+				continue;
+			}
+
+			child = make_node(node, NULL);
+			if(child == NULL)
+			{
+				free(path);
+				continue;
+			}
+			child->path = path;
+
+			/* Parent must know about the child before it can finish. */
+			pthread_mutex_lock(&calc->lock);
+			++node->pending;
+			pthread_mutex_unlock(&calc->lock);
+
+			push_node(calc, id, child);
+		}
+		else if(s.st_nlink <= 1 || is_first_link(calc, &s))
+		{
+			size += s.st_size;
+		}
+	}
+	os_closedir(dir);
+
+	finish_part(calc, node, size);
+}
+
+/* Allocates new node of the tree.  Path is duplicated if it's not NULL.
+ * Returns the node or NULL on error. */
+static node_t *
+make_node(node_t *parent, const char path[])
+{
+	node_t *const node = malloc(sizeof(*node));
+	if(node == NULL)
+	{
+		return NULL;
+	}
+
+	node->path = NULL;
+	if(path != NULL && (node->path = strdup(path)) == NULL)
+	{
+		free(node);
+		return NULL;
+	}
+
+	node->parent = parent;
+	node->next = NULL;
+	node->size = 0U;
+	node->pending = 1;
+	return node;
+}
+
+/* Forms path of a file in the directory.  Returns newly allocated string or
+ * NULL on error. */
+static char *
+join_paths(const char dir[], const char name[])
+{
+	const char *const slash = ends_with_slash(dir) ? "" : "/";
+	const size_t len = strlen(dir) + strlen(slash) + strlen(name) + 1U;
+	char *const path = malloc(len);
+	if(path != NULL)
+	{
+		snprintf(path, len, "%s%s%s", dir, slash, name);
+	}
+	return path;
+}
+
+/* Accounts size of a finished part of the node (its scan or a subdirectory).
+ * Nodes whose parts are all finished are stored in the cache and freed.  Only
+ * counters are updated under the lock, cache is accessed after releasing it,
+ * because it queries file system. */
+static void
+finish_part(calc_t *calc, node_t *node, uint64_t size)
+{
+	node_t *finished = NULL;
+	node_t **last = &finished;
+	int report = 0;
+
+	pthread_mutex_lock(&calc->lock);
+
+	while(1)
+	{
+		node_t *const parent = node->parent;
+
+		node->size += size;
+		if(--node->pending != 0)
+		{
+			if(parent == NULL && is_time_to_report(calc))
+			{
+				report = 1;
+				size = node->size;
+			}
+			break;
+		}
+
+		size = node->size;
+		*last = node;
+		last = &node->next;
+
+		if(parent == NULL)
+		{
+			calc->done = 1;
+			calc->total = size;
+			pthread_cond_broadcast(&calc->cond);
+			break;
+		}
+		node = parent;
+	}
+
+	pthread_mutex_unlock(&calc->lock);
+
+	if(report)
+	{
+		report_progress(calc, size);
+	}
+	store_finished(calc, finished);
+}
+
+/* Checks whether partial size of the root directory wasn't published for a
+ * while.  Must be called with calc->lock held.  Returns non-zero if so and
+ * marks that the report is made, otherwise zero is returned. */
+static int
+is_time_to_report(calc_t *calc)
+{
+	const uint64_t now = get_time_us();
+	if(now - calc->last_report < PROGRESS_PERIOD)
+	{
+		return 0;
+	}
+	calc->last_report = now;
+	return 1;
+}
+
+/* Publishes partial size of the root directory unless its final size is
+ * already known. */
+static void
+report_progress(calc_t *calc, uint64_t size)
+{
+	pthread_mutex_lock(&calc->report_lock);
+
+	/* Partial size is kept apart from sizes, so that neither interrupted
+	 * calculation nor lookups in the meantime treat it as a size of the
+	 * directory. */
+	if(!calc->root_stored)
+	{
+		(void)dsc_set_partial(calc->dsc, calc->root_path, size);
+		if(calc->progress != NULL)
+		{
+			calc->progress(calc->root_path, calc->arg);
+		}
+	}
+
+	pthread_mutex_unlock(&calc->report_lock);
+}
+
+/* Stores sizes of the list of finished nodes in the cache and frees the
+ * nodes. */
+static void
+store_finished(calc_t *calc, node_t *finished)
+{
+	while(finished != NULL)
+	{
+		node_t *const next = finished->next;
+
+		if(finished->parent == NULL)
+		{
+			/* Publishing of a partial size after this point would leave stale
+			 * value around. */
+			pthread_mutex_lock(&calc->report_lock);
+			(void)dsc_set(calc->dsc, finished->path, finished->size);
+			calc->root_stored = 1;
+			pthread_mutex_unlock(&calc->report_lock);
+		}
+		else
+		{
+			(void)dsc_set(calc->dsc, finished->path, finished->size);
+		}
+
+		free(finished->path);
+		free(finished);
+		finished = next;
+	}
+}
+
+/* Queues node for processing by the worker. */
+static void
+push_node(calc_t *calc, int id, node_t *node)
+{
+	queue_t *const queue = &calc->queues[id];
+
+	pthread_mutex_lock(&queue->lock);
+	if(queue->head != 0U && queue->tail == queue->capacity)
+	{
+		memmove(queue->nodes, &queue->nodes[queue->head],
+				(queue->tail - queue->head)*sizeof(*queue->nodes));
+		queue->tail -= queue->head;
+		queue->head = 0U;
+	}
+	if(queue->tail == queue->capacity)
+	{
+		const size_t new_capacity = MAX(16U, queue->capacity*2U);
+		node_t **const nodes = realloc(queue->nodes,
+				new_capacity*sizeof(*nodes));
+		if(nodes == NULL)
+		{
+			pthread_mutex_unlock(&queue->lock);
+			/* Process it right away to not lose it. */
+			process_dir(calc, id, node);
+			return;
+		}
+		queue->nodes = nodes;
+		queue->capacity = new_capacity;
+	}
+	queue->nodes[queue->tail++] = node;
+	pthread_mutex_unlock(&queue->lock);
+
+	pthread_mutex_lock(&calc->lock);
+	++calc->queued;
+	pthread_cond_signal(&calc->cond);
+	pthread_mutex_unlock(&calc->lock);
+}
+
+/* Takes next node to process either from own queue or from queue of another
+ * worker.  Returns the node or NULL if all queues are empty. */
+static node_t *
+take_node(calc_t *calc, int id)
+{
+	int i;
+
+	node_t *node = pop_tail(&calc->queues[id]);
+	for(i = 1; node == NULL && i < calc->nworkers; ++i)
+	{
+		node = pop_head(&calc->queues[(id + i)%calc->nworkers]);
+	}
+
+	if(node != NULL)
+	{
+		pthread_mutex_lock(&calc->lock);
+		--calc->queued;
+		pthread_mutex_unlock(&calc->lock);
+	}
+
+	return node;
+}
+
+/* Takes the most recently queued node.  Returns the node or NULL. */
+static node_t *
+pop_tail(queue_t *queue)
+{
+	node_t *node = NULL;
+
+	pthread_mutex_lock(&queue->lock);
+	if(queue->tail != queue->head)
+	{
+		node = queue->nodes[--queue->tail];
+	}
+	pthread_mutex_unlock(&queue->lock);
+
+	return node;
+}
+
+/* Takes the least recently queued node.  Returns the node or NULL. */
+static node_t *
+pop_head(queue_t *queue)
+{
+	node_t *node = NULL;
+
+	pthread_mutex_lock(&queue->lock);
+	if(queue->tail != queue->head)
+	{
+		node = queue->nodes[queue->head++];
+	}
+	pthread_mutex_unlock(&queue->lock);
+
+	return node;
+}
+
+/* Registers file with several hard links.  Returns non-zero if it's seen for
+ * the first time, otherwise zero is returned. */
+static int
+is_first_link(calc_t *calc, const struct stat *s)
+{
+	file_id_t *slot;
+	int first = 1;
+	const file_id_t id = { s->st_dev, s->st_ino };
+
+	pthread_mutex_lock(&calc->links_lock);
+
+	/* Keep load factor below 3/4 to make probe sequences short. */
+	if((calc->links_count + 1U)*4U <= calc->links_capacity*3U ||
+			grow_links(calc) == 0)
+	{
+		slot = find_link(calc->links, calc->links_capacity, &id);
+		first = (slot->ino == 0U);
+		if(first)
+		{
+			*slot = id;
+			++calc->links_count;
+		}
+	}
+
+	pthread_mutex_unlock(&calc->links_lock);
+
+	return first;
+}
+
+/* Doubles capacity of the set of hard links.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+grow_links(calc_t *calc)
+{
+	size_t i;
+	const size_t new_capacity = (calc->links_capacity == 0U)
+	                          ? INITIAL_LINKS_CAPACITY
+	                          : calc->links_capacity*2U;
+	file_id_t *const links = calloc(new_capacity, sizeof(*links));
+	if(links == NULL)
+	{
+		return 1;
+	}
+
+	for(i = 0U; i < calc->links_capacity; ++i)
+	{
+		if(calc->links[i].ino != 0U)
+		{
+			*find_link(links, new_capacity, &calc->links[i]) = calc->links[i];
+		}
+	}
+
+	free(calc->links);
+	calc->links = links;
+	calc->links_capacity = new_capacity;
+	return 0;
+}
+
+/* Looks up file in the set of hard links.  Zero inode marks empty slot.
+ * Returns either slot that holds the file or an empty slot for it. */
+static file_id_t *
+find_link(file_id_t links[], size_t capacity, const file_id_t *id)
+{
+	uint64_t h = id->ino*0x9e3779b97f4a7c15ULL ^ id->dev;
+	size_t i = (size_t)(h ^ (h >> 32)) & (capacity - 1U);
+	while(links[i].ino != 0U &&
+			(links[i].ino != id->ino || links[i].dev != id->dev))
+	{
+		i = (i + 1U) & (capacity - 1U);
+	}
+	return &links[i];
+}
+
+/* Retrieves current time.  Returns the time in microseconds. */
+static uint64_t
+get_time_us(void)
+{
+	struct timeval tv;
+	(void)gettimeofday(&tv, NULL);
+	return tv.tv_sec*1000000ULL + tv.tv_usec;
+}
+
+#else
+
+/* Calculates size of a directory possibly using cache of known sizes.  Returns
+ * size of a directory or zero on error. */
+static uint64_t
+calc_serially(dirsize_cache_t *dsc, const char path[], int force)
+{
+	DIR *dir;
+	struct dirent *d;
+	const char *const slash = ends_with_slash(path) ? "" : "/";
+	uint64_t size;
+
+	dir = os_opendir(path);
+	if(dir == NULL)
+	{
+		return 0U;
+	}
+
+	size = 0U;
+	while((d = os_readdir(dir)) != NULL)
+	{
+		char buf[PATH_MAX];
+
+		if(is_builtin_dir(d->d_name))
+		{
+			continue;
+		}
+
+		snprintf(buf, sizeof(buf), "%s%s%s", path, slash, d->d_name);
+		if(is_dir(buf))
+		{
+			uint64_t dir_size = 0U;
+			if(force || dsc_get_fresh(dsc, buf, &dir_size) != 0)
+			{
+				dir_size = calc_serially(dsc, buf, force);
+			}
+			size += dir_size;
+		}
+		else
+		{
+			size += get_file_size(buf);
+		}
+	}
+
+	os_closedir(dir);
+
+	(void)dsc_set(dsc, path, size);
+	return size;
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
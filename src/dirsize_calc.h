@@ -0,0 +1,43 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__DIRSIZE_CALC_H__
+#define VIFM__DIRSIZE_CALC_H__
+
+#include <stdint.h> /* uint64_t */
+
+#include "dirsize_cache.h"
+
+/* Callback invoked after partial size of the directory has been published in
+ * the cache (see dsc_get_partial()).  Might be called from any thread. */
+typedef void (*dsc_progress_cb)(const char path[], void *arg);
+
+/* Calculates size of directory tree at the path by walking it with several
+ * threads.  Sizes of subdirectories are stored in the dsc as soon as they are
+ * known, while partial size of the path directory is periodically published
+ * via dsc_set_partial() (progress is called after that, it can be NULL).
+ * Cached sizes of subdirectories are reused unless force is non-zero.  Files
+ * with several hard links are counted once.  Returns size of the directory or
+ * zero on error. */
+uint64_t dsc_calc(dirsize_cache_t *dsc, const char path[], int force,
+		dsc_progress_cb progress, void *arg);
+
+#endif /* VIFM__DIRSIZE_CALC_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
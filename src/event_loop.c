@@ -21,11 +21,17 @@
 
 #include <curses.h>
 
-#include <unistd.h> /* select() */
+#ifndef _WIN32
+#include <poll.h> /* POLLIN poll() pollfd */
+#include <sys/time.h> /* gettimeofday() timeval */
+#endif
+#include <unistd.h> /* STDIN_FILENO */
 
 #include <assert.h> /* assert() */
 #include <signal.h> /* signal() */
 #include <stddef.h> /* NULL size_t wchar_t wint_t */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* realloc() */
 #include <string.h> /* memmove() strncpy() */
 #include <wchar.h> /* wcslen() wcscmp() */
 
@@ -35,9 +41,12 @@
 #include "modes/modes.h"
 #include "ui/statusbar.h"
 #include "ui/ui.h"
+#include "utils/fswatch.h"
 #include "utils/log.h"
 #include "utils/macros.h"
+#include "utils/str.h"
 #include "utils/utils.h"
+#include "utils/wakeup.h"
 #include "background.h"
 #include "filelist.h"
 #include "ipc.h"
@@ -48,6 +57,15 @@ static void process_scheduled_updates(void);
 static void process_scheduled_updates_of_view(FileView *view);
 static int should_check_views_for_changes(void);
 static void check_view_for_changes(FileView *view);
+#ifndef _WIN32
+static int needs_polling(void);
+static int view_needs_polling(const FileView *view);
+static int wait_for_events(int delay);
+static void add_pollfd(struct pollfd **fds, size_t *capacity, size_t *nfds,
+		int fd);
+static uint64_t get_time_ms(void);
+static int get_watcher_fd(const FileView *view);
+#endif
 
 /* Current input buffer. */
 static const wchar_t *curr_input_buf;
@@ -119,8 +137,6 @@ event_loop(const int *quit)
 
 		modes_pre();
 
-		check_background_jobs();
-
 		/* Waits for timeout then skips if no keypress.  Short-circuit if we're not
 		 * waiting for the next key after timeout. */
 		do
@@ -246,17 +262,28 @@ event_loop(const int *quit)
  * performing the following tasks while waiting for input:
  *  - checks for new IPC messages;
  *  - checks whether contents of displayed directories changed;
+ *  - processes errors and completion of background jobs;
  *  - redraws UI if requested.
- * Returns KEY_CODE_YES for functional keys, OK for wide character and ERR
- * otherwise (e.g. after timeout). */
+ * Sleeps until any of event sources becomes ready, periodic wake ups happen
+ * only for sources that can't signal about their changes.  The timeout is
+ * respected only while a key sequence is being entered.  Returns KEY_CODE_YES
+ * for functional keys, OK for wide character and ERR otherwise (e.g. after
+ * timeout). */
 static int
 get_char_async_loop(WINDOW *win, wint_t *c, int timeout)
 {
-	const int IPC_F = (ipc_enabled() && ipc_server()) ? 10 : 1;
-
-	do
+	while(1)
 	{
-		int i;
+		int result;
+		int delay;
+		int polling;
+
+		if(is_input_buf_empty())
+		{
+			/* This might display errors, so don't do it in the middle of a key
+			 * sequence. */
+			check_background_jobs();
+		}
 
 		process_scheduled_updates();
 
@@ -266,27 +293,54 @@ get_char_async_loop(WINDOW *win, wint_t *c, int timeout)
 			check_view_for_changes(other_view);
 		}
 
-		for(i = 0; i < IPC_F; ++i)
-		{
-			int result;
+		polling = modes_periodic();
 
-			ipc_check();
-			wtimeout(win, MIN(cfg.min_timeout_len, timeout)/IPC_F);
+		ipc_check();
 
-			result = wget_wch(win, c);
-			if(result != ERR)
-			{
-				return result;
-			}
+		wtimeout(win, 0);
+		result = wget_wch(win, c);
+		if(result != ERR)
+		{
+			return result;
+		}
 
-			process_scheduled_updates();
+		if(is_input_buf_empty())
+		{
+			/* There is no key sequence to time out. */
+			delay = -1;
+		}
+		else if(timeout <= 0)
+		{
+			return ERR;
+		}
+		else
+		{
+			delay = timeout;
 		}
 
-		timeout -= cfg.min_timeout_len;
-	}
-	while(timeout > 0);
+#ifndef _WIN32
+		if(polling || needs_polling())
+		{
+			delay = (delay < 0) ? cfg.min_timeout_len
+			                    : MIN(delay, cfg.min_timeout_len);
+		}
 
-	return ERR;
+		timeout -= wait_for_events(delay);
+#else
+		(void)polling;
+
+		/* Only input can be waited for here, everything else is polled. */
+		delay = (delay < 0) ? cfg.min_timeout_len
+		                    : MIN(delay, cfg.min_timeout_len);
+		wtimeout(win, delay);
+		result = wget_wch(win, c);
+		if(result != ERR)
+		{
+			return result;
+		}
+		timeout -= delay;
+#endif
+	}
 }
 
 /* Updates TUI or its elements if something is scheduled. */
@@ -314,6 +368,8 @@ process_scheduled_updates_of_view(FileView *view)
 		return;
 	}
 
+	process_dir_loading(view);
+
 	switch(ui_view_query_scheduled_event(view))
 	{
 		case UUE_NONE:
@@ -321,6 +377,8 @@ process_scheduled_updates_of_view(FileView *view)
 			break;
 		case UUE_REDRAW:
 			redraw_view_imm(view);
+			/* Nothing else might update the screen until the next key press. */
+			refresh_view_win(view);
 			break;
 		case UUE_RELOAD:
 			load_saving_pos(view, 1);
@@ -355,6 +413,146 @@ check_view_for_changes(FileView *view)
 	}
 }
 
+#ifndef _WIN32
+
+/* Checks whether some of event sources can't signal about their changes and
+ * need to be checked periodically.  Returns non-zero if so, otherwise zero is
+ * returned. */
+static int
+needs_polling(void)
+{
+	/* Server can go away, in which case this instance might take its place.
+	 * Clients that stopped sending their requests need to be timed out. */
+	if(ipc_enabled() && (!ipc_server() || ipc_has_clients()))
+	{
+		return 1;
+	}
+
+	return should_check_views_for_changes()
+	    && (view_needs_polling(curr_view) || view_needs_polling(other_view));
+}
+
+/* Checks whether changes of directory displayed by the view can be detected
+ * only by checking it.  Returns non-zero if so, otherwise zero is returned. */
+static int
+view_needs_polling(const FileView *view)
+{
+	return window_shows_dirlist(view) && get_watcher_fd(view) == -1;
+}
+
+/* Waits for at most delay milliseconds (forever if it's negative) until any of
+ * event sources becomes ready: terminal input, IPC messages, errors of
+ * background jobs, notifications from other threads and signal handlers or
+ * changes in directories displayed by views.  Returns number of milliseconds
+ * spent waiting. */
+static int
+wait_for_events(int delay)
+{
+	static struct pollfd *fds;
+	static size_t capacity;
+
+	size_t nfds = 0U;
+	const int wakeup_fd = wakeup_get_fd();
+	const uint64_t start = get_time_ms();
+	int ipc_fds[IPC_MAX_FDS];
+	int nipc_fds;
+	int i;
+
+	add_pollfd(&fds, &capacity, &nfds, STDIN_FILENO);
+	add_pollfd(&fds, &capacity, &nfds, wakeup_fd);
+
+	nipc_fds = ipc_get_fds(ipc_fds, IPC_MAX_FDS);
+	for(i = 0; i < nipc_fds; ++i)
+	{
+		add_pollfd(&fds, &capacity, &nfds, ipc_fds[i]);
+	}
+
+	/* Unprocessed events would wake us up over and over again, so wait only for
+	 * those that will be processed. */
+	if(should_check_views_for_changes())
+	{
+		add_pollfd(&fds, &capacity, &nfds, get_watcher_fd(curr_view));
+		add_pollfd(&fds, &capacity, &nfds, get_watcher_fd(other_view));
+	}
+	if(is_input_buf_empty() && bg_jobs_freeze() == 0)
+	{
+		const job_t *job;
+		for(job = jobs; job != NULL; job = job->next)
+		{
+			add_pollfd(&fds, &capacity, &nfds, job->fd);
+		}
+		bg_jobs_unfreeze();
+	}
+
+	if(poll(fds, nfds, delay) > 0 && wakeup_fd != -1 && fds[1].revents != 0)
+	{
+		wakeup_drain();
+	}
+
+	return (delay < 0) ? 0 : (int)(get_time_ms() - start);
+}
+
+/* Appends descriptor to the array of descriptors to poll for input, growing it
+ * if needed.  Does nothing for negative descriptor except for the first two,
+ * which always occupy the same positions. */
+static void
+add_pollfd(struct pollfd **fds, size_t *capacity, size_t *nfds, int fd)
+{
+	if(fd < 0 && *nfds >= 2U)
+	{
+		return;
+	}
+
+	if(*nfds == *capacity)
+	{
+		const size_t new_capacity = (*capacity == 0U) ? 8U : *capacity*2U;
+		struct pollfd *const new_fds =
+			realloc(*fds, new_capacity*sizeof(**fds));
+		if(new_fds == NULL)
+		{
+			return;
+		}
+		*fds = new_fds;
+		*capacity = new_capacity;
+	}
+
+	/* poll() ignores negative descriptors. */
+	(*fds)[*nfds].fd = fd;
+	(*fds)[*nfds].events = POLLIN;
+	(*fds)[*nfds].revents = 0;
+	++*nfds;
+}
+
+/* Retrieves current time.  Returns the time in milliseconds. */
+static uint64_t
+get_time_ms(void)
+{
+	struct timeval tv;
+	(void)gettimeofday(&tv, NULL);
+	return tv.tv_sec*1000ULL + tv.tv_usec/1000U;
+}
+
+#endif
+
+#ifndef _WIN32
+
+/* Retrieves file descriptor that signals changes in directory of the view.
+ * Returns the descriptor or -1 if there is none or events won't be processed by
+ * check_if_filelist_have_changed() at the moment. */
+static int
+get_watcher_fd(const FileView *view)
+{
+	if(!window_shows_dirlist(view) || view->dir_watcher == NULL ||
+			view->loader != NULL || view->on_slow_fs ||
+			stroscmp(view->watched_dir, view->curr_dir) != 0)
+	{
+		return -1;
+	}
+	return fswatch_get_fd(view->dir_watcher);
+}
+
+#endif
+
 void
 update_input_buf(void)
 {
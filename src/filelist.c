@@ -52,23 +52,25 @@
 #include "ui/statusbar.h"
 #include "ui/statusline.h"
 #include "ui/ui.h"
+#include "utils/arena.h"
 #include "utils/env.h"
 #include "utils/filter.h"
 #include "utils/fs.h"
 #include "utils/fs_limits.h"
+#include "utils/fswatch.h"
 #include "utils/log.h"
 #include "utils/macros.h"
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
 #include "utils/test_helpers.h"
-#include "utils/tree.h"
 #include "utils/ts.h"
 #include "utils/utf8.h"
 #include "utils/utils.h"
 #include "color_manager.h"
 #include "color_scheme.h"
 #include "column_view.h"
+#include "dir_loader.h"
 #include "fuse.h"
 #include "macros.h"
 #include "opt_handlers.h"
@@ -81,6 +83,13 @@
 /* Mark for a cursor position of inactive pane. */
 #define INACTIVE_CURSOR_MARK "*"
 
+/* Maximum time in milliseconds to wait for the first screenful of entries when
+ * loading directory in background. */
+#define FIRST_SCREEN_WAIT_MS 250
+
+/* Minimal number of allocated elements of a non-empty list of file entries. */
+#define MIN_DIR_LIST_CAPACITY 16U
+
 /* Packet set of parameters to pass as user data for processing columns. */
 typedef struct
 {
@@ -116,7 +125,6 @@ static void init_view(FileView *view);
 static void reset_view(FileView *view);
 static void reset_filter(filter_t *filter);
 static void init_view_history(FileView *view);
-static char * get_viewer_command(const char *viewer);
 static void capture_selection(FileView *view);
 static void capture_file_or_selection(FileView *view, int skip_if_no_selection);
 static void draw_dir_list_only(FileView *view);
@@ -147,13 +155,30 @@ static void free_saved_selection(FileView *view);
 TSTATIC int file_is_visible(FileView *view, const char filename[], int is_dir);
 static void load_dir_list_internal(FileView *view, int reload, int draw_only);
 static int populate_dir_list_internal(FileView *view, int reload);
+#ifndef _WIN32
+static void update_dir_watcher(FileView *view);
+#endif
+static int fill_dir_list_async(FileView *view);
+#ifndef _WIN32
+static int fill_entry_info(dir_entry_t *entry, const char path[]);
+static int apply_dir_changes(FileView *view, fswatch_change_t changes[],
+		int count);
+static int apply_dir_change(FileView *view, const fswatch_change_t *change);
+static int find_changed_entry(FileView *view, dir_entry_t *entry,
+		int exists);
+static void remove_list_entry(FileView *view, int pos);
+static int insert_list_entry(FileView *view, const dir_entry_t *entry);
+#endif
+static int append_loaded_entries(FileView *view);
+static void add_parent_dir_if_needed(FileView *view, int with_parent_dir);
 static int is_dir_big(const char path[]);
 static void sort_dir_list(int msg, FileView *view);
 static int rescue_from_empty_filelist(FileView *view);
 static void add_parent_dir(FileView *view);
 static void append_slash(const char name[], char buf[], size_t buf_size);
 static void local_filter_finish(FileView *view);
-static void update_filtering_lists(FileView *view, int add, int clear);
+static void update_filtering_lists(FileView *view);
+static void reset_dir_entry(FileView *view, dir_entry_t *entry);
 static void init_dir_entry(FileView *view, dir_entry_t *entry,
 		const char name[]);
 static size_t get_max_filename_width(const FileView *view);
@@ -167,10 +192,14 @@ static void clear_local_filter_hist_after(FileView *const view, int pos);
 static int find_nearest_neighour(const FileView *const view);
 static int add_dir_entry(dir_entry_t **list, size_t *list_size,
 		const dir_entry_t *entry);
+static dir_entry_t * extend_dir_list(dir_entry_t **list, size_t count,
+		size_t extra);
+static size_t get_dir_list_capacity(size_t count);
 static int file_can_be_displayed(const char directory[], const char filename[]);
 static int parent_dir_is_visible(int in_root);
 static void find_dir_in_cdpath(const char base_dir[], const char dst[],
 		char buf[], size_t buf_size);
+static char * format_viewer_command(const char viewer[], const char name[]);
 static int iter_entries(FileView *view, dir_entry_t **entry,
 		predicate_func pred);
 static int is_entry_selected(const dir_entry_t *entry);
@@ -453,6 +482,12 @@ init_view(FileView *view)
 	view->history_pos = 0;
 	view->local_cs = 0;
 	view->on_slow_fs = 0;
+	view->loader = NULL;
+	view->loader_pos = -1;
+#ifndef _WIN32
+	view->dir_watcher = NULL;
+	view->watched_dir[0] = '\0';
+#endif
 
 	view->hide_dot = 1;
 	view->matches = 0;
@@ -547,9 +582,11 @@ load_initial_directory(FileView *view, const char *dir)
 		dir = view->curr_dir;
 	}
 
-	view->dir_entry = calloc(1, sizeof(dir_entry_t));
+	view->dir_entry = NULL;
+	(void)extend_dir_list(&view->dir_entry, 0U, 1U);
+	memset(&view->dir_entry[0], 0, sizeof(view->dir_entry[0]));
 
-	view->dir_entry[0].name = strdup("");
+	view->dir_entry[0].name = arena_strdup(&view->names, "");
 	view->dir_entry[0].type = DIRECTORY;
 	view->dir_entry[0].hi_num = -1;
 	view->dir_entry[0].origin = &view->curr_dir[0];
@@ -658,22 +695,35 @@ use_info_prog(const char *viewer)
 }
 #endif
 
-/* Returns a pointer to newly allocated memory, which should be released by the
- * caller. */
-static char *
+char *
 get_viewer_command(const char *viewer)
 {
-	char *result;
 	if(strchr(viewer, '%') == NULL)
 	{
-		char *const escaped = escape_filename(get_current_file_name(curr_view), 0);
-		result = format_str("%s %s", viewer, escaped);
-		free(escaped);
+		return format_viewer_command(viewer, get_current_file_name(curr_view));
 	}
-	else
+	return expand_macros(viewer, NULL, NULL, 1);
+}
+
+char *
+get_entry_viewer_command(const char viewer[], const dir_entry_t *entry)
+{
+	if(strchr(viewer, '%') != NULL)
 	{
-		result = expand_macros(viewer, NULL, NULL, 1);
+		/* Macros are expanded for the file under cursor of the current view. */
+		return NULL;
 	}
+	return format_viewer_command(viewer, entry->name);
+}
+
+/* Appends escaped file name to the viewer.  Returns a pointer to newly
+ * allocated memory, which should be released by the caller. */
+static char *
+format_viewer_command(const char viewer[], const char name[])
+{
+	char *const escaped = escape_filename(name, 0);
+	char *const result = format_str("%s %s", viewer, escaped);
+	free(escaped);
 	return result;
 }
 
@@ -2243,16 +2293,13 @@ fill_with_shared(FileView *view)
 				dir_entry_t *dir_entry;
 				char *utf8_name;
 
-				view->dir_entry = realloc(view->dir_entry,
-						(view->list_rows + 1)*sizeof(dir_entry_t));
-				if(view->dir_entry == NULL)
+				dir_entry = extend_dir_list(&view->dir_entry, view->list_rows, 1);
+				if(dir_entry == NULL)
 				{
 					show_error_msg("Memory Error", "Unable to allocate enough memory");
 					continue;
 				}
 
-				dir_entry = &view->dir_entry[view->list_rows];
-
 				utf8_name = utf8_from_utf16((wchar_t *)p->shi0_netname);
 
 				init_dir_entry(view, dir_entry, utf8_name);
@@ -2302,7 +2349,6 @@ fill_dir_list(FileView *view)
 	for(view->list_rows = 0; (d = os_readdir(dir)); view->list_rows++)
 	{
 		dir_entry_t *dir_entry;
-		struct stat s;
 
 		/* Ignore the "." directory. */
 		if(stroscmp(d->d_name, ".") == 0)
@@ -2332,32 +2378,18 @@ fill_dir_list(FileView *view)
 			continue;
 		}
 
-		view->dir_entry = realloc(view->dir_entry,
-				(view->list_rows + 1)*sizeof(dir_entry_t));
-		if(view->dir_entry == NULL)
+		dir_entry = extend_dir_list(&view->dir_entry, view->list_rows, 1);
+		if(dir_entry == NULL)
 		{
 			os_closedir(dir);
 			show_error_msg("Memory Error", "Unable to allocate enough memory");
 			return -1;
 		}
 
-		dir_entry = &view->dir_entry[view->list_rows];
-
 		init_dir_entry(view, dir_entry, d->d_name);
 
 		/* Load the inode info or leave blank values in dir_entry. */
-		if(os_lstat(dir_entry->name, &s) == 0)
-		{
-			dir_entry->type = get_type_from_mode(s.st_mode);
-			dir_entry->size = (uintmax_t)s.st_size;
-			dir_entry->mode = s.st_mode;
-			dir_entry->uid = s.st_uid;
-			dir_entry->gid = s.st_gid;
-			dir_entry->mtime = s.st_mtime;
-			dir_entry->atime = s.st_atime;
-			dir_entry->ctime = s.st_ctime;
-		}
-		else
+		if(fill_entry_info(dir_entry, dir_entry->name) != 0)
 		{
 			LOG_SERROR_MSG(errno, "Can't lstat() \"%s/%s\"", view->curr_dir,
 					dir_entry->name);
@@ -2368,17 +2400,6 @@ fill_dir_list(FileView *view)
 		{
 			dir_entry->type = type_from_dir_entry(d);
 		}
-
-		if(dir_entry->type == LINK)
-		{
-			struct stat st;
-
-			const SymLinkType symlink_type = get_symlink_type(dir_entry->name);
-			if(symlink_type != SLT_SLOW && os_stat(dir_entry->name, &st) == 0)
-			{
-				dir_entry->mode = st.st_mode;
-			}
-		}
 	}
 	os_closedir(dir);
 #else
@@ -2441,17 +2462,14 @@ fill_dir_list(FileView *view)
 			continue;
 		}
 
-		view->dir_entry = realloc(view->dir_entry,
-				(view->list_rows + 1)*sizeof(dir_entry_t));
-		if(view->dir_entry == NULL)
+		dir_entry = extend_dir_list(&view->dir_entry, view->list_rows, 1);
+		if(dir_entry == NULL)
 		{
 			show_error_msg("Memory Error", "Unable to allocate enough memory");
 			FindClose(hfind);
 			return -1;
 		}
 
-		dir_entry = &view->dir_entry[view->list_rows];
-
 		init_dir_entry(view, dir_entry, name);
 
 		dir_entry->size = ((uintmax_t)ffd.nFileSizeHigh << 32) + ffd.nFileSizeLow;
@@ -2491,17 +2509,160 @@ fill_dir_list(FileView *view)
 
 #endif
 
-	if(!with_parent_dir && !is_root)
+	add_parent_dir_if_needed(view, with_parent_dir);
+	return 0;
+}
+
+#ifndef _WIN32
+
+/* Loads information about file at the path (can be relative) into the entry.
+ * Returns zero on success, otherwise non-zero is returned and the entry is left
+ * unchanged. */
+static int
+fill_entry_info(dir_entry_t *entry, const char path[])
+{
+	struct stat s;
+
+	if(os_lstat(path, &s) != 0)
 	{
-		if((cfg.dot_dirs & DD_NONROOT_PARENT) || view->list_rows == 0)
+		return 1;
+	}
+
+	entry->type = get_type_from_mode(s.st_mode);
+	entry->size = (uintmax_t)s.st_size;
+	entry->mode = s.st_mode;
+	entry->uid = s.st_uid;
+	entry->gid = s.st_gid;
+	entry->mtime = s.st_mtime;
+	entry->atime = s.st_atime;
+	entry->ctime = s.st_ctime;
+
+	if(entry->type == LINK)
+	{
+		struct stat st;
+
+		const SymLinkType symlink_type = get_symlink_type(path);
+		if(symlink_type != SLT_SLOW && os_stat(path, &st) == 0)
 		{
-			add_parent_dir(view);
+			entry->mode = st.st_mode;
 		}
 	}
 
 	return 0;
 }
 
+#endif
+
+/* Starts loading file list of the view in background and fills the view with
+ * the first screenful of entries.  Returns zero on success, otherwise non-zero
+ * is returned and the list should be loaded in a regular way. */
+static int
+fill_dir_list_async(FileView *view)
+{
+	view->loader = dl_start(view->curr_dir);
+	if(view->loader == NULL)
+	{
+		return 1;
+	}
+
+	view->matches = 0;
+	view->list_rows = 0;
+
+	dl_wait(view->loader, view->window_cells + 1U, FIRST_SCREEN_WAIT_MS);
+	(void)append_loaded_entries(view);
+	return 0;
+}
+
+/* Moves entries loaded so far by background loader of the view into its file
+ * list applying filters.  Releases the loader when loading is over.  Returns
+ * non-zero if loading is over. */
+static int
+append_loaded_entries(FileView *view)
+{
+	const int is_root = is_root_dir(view->curr_dir);
+	dir_entry_t *entries;
+	size_t count;
+	size_t i;
+
+	const int finished = dl_take(view->loader, &entries, &count);
+
+	if(count != 0U &&
+			extend_dir_list(&view->dir_entry, view->list_rows, count) == NULL)
+	{
+		free(entries);
+		show_error_msg("Memory Error", "Unable to allocate enough memory");
+		cancel_dir_loading(view);
+		return 1;
+	}
+
+	for(i = 0U; i < count; ++i)
+	{
+		dir_entry_t *const entry = &entries[i];
+		/* Loader resolves targets of symbolic links, no need to do it again. */
+#ifndef _WIN32
+		const int is_dir = entry->type == DIRECTORY
+		                || (entry->type == LINK && S_ISDIR(entry->mode));
+#else
+		const int is_dir = is_directory_entry(entry);
+#endif
+
+		if(stroscmp(entry->name, "..") == 0)
+		{
+			if(!parent_dir_is_visible(is_root))
+			{
+				continue;
+			}
+		}
+		else if(!file_is_visible(view, entry->name, is_dir) ||
+				(view->hide_dot && entry->name[0] == '.'))
+		{
+			view->filtered++;
+			continue;
+		}
+
+		/* Names are copied as they belong to the loader. */
+		entry->name = arena_strdup(&view->names, entry->name);
+		entry->origin = &view->curr_dir[0];
+		view->dir_entry[view->list_rows++] = *entry;
+	}
+	free(entries);
+
+	if(finished)
+	{
+		const int failed = dl_failed(view->loader);
+
+		dl_release(view->loader);
+		view->loader = NULL;
+
+		if(failed)
+		{
+			/* There are no entries, same as for synchronous loading. */
+			add_parent_dir(view);
+		}
+		else
+		{
+			add_parent_dir_if_needed(view,
+					find_file_pos_in_list(view, "..") >= 0);
+		}
+	}
+
+	return finished;
+}
+
+/* Adds parent directory entry to the list of the view if it's absent and should
+ * be displayed. */
+static void
+add_parent_dir_if_needed(FileView *view, int with_parent_dir)
+{
+	if(!with_parent_dir && !is_root_dir(view->curr_dir))
+	{
+		if((cfg.dot_dirs & DD_NONROOT_PARENT) || view->list_rows == 0)
+		{
+			add_parent_dir(view);
+		}
+	}
+}
+
 /* Checks whether file/directory passes filename filters of the view.  Returns
  * non-zero if given filename passes filter and should be visible, otherwise
  * zero is returned, in which case the file should be hidden. */
@@ -2605,23 +2766,59 @@ load_dir_list_internal(FileView *view, int reload, int draw_only)
 	}
 }
 
+#ifndef _WIN32
+
+/* Makes sure that watcher of the view tracks its current directory unless it's
+ * on a slow file system, where changes are checked via modification time.
+ * Pending events are dropped as directory is about to be reread. */
+static void
+update_dir_watcher(FileView *view)
+{
+	if(!view->on_slow_fs && view->dir_watcher != NULL &&
+			stroscmp(view->watched_dir, view->curr_dir) == 0 &&
+			fswatch_poll(view->dir_watcher) != FSWS_ERRORED)
+	{
+		return;
+	}
+
+	fswatch_free(view->dir_watcher);
+	view->dir_watcher = view->on_slow_fs ? NULL : fswatch_create(view->curr_dir);
+	copy_str(view->watched_dir, sizeof(view->watched_dir), view->curr_dir);
+}
+
+#endif
+
 /* Loads filelist for the view.  The reload parameter should be set in case of
  * view refresh operation.  Returns non-zero on error. */
 static int
 populate_dir_list_internal(FileView *view, int reload)
 {
-	int old_list = view->list_rows;
 	int need_free = (view->selected_filelist == NULL);
+	int big_dir;
+
+	cancel_dir_loading(view);
 
 	view->filtered = 0;
 
+	/* Sizes of directories are looked up by identities of their paths, which
+	 * need to be checked again once per loading of a directory. */
+	if(curr_stats.dirsize_cache != NULL)
+	{
+		dsc_revalidate(curr_stats.dirsize_cache);
+	}
+
+#ifndef _WIN32
+	update_dir_watcher(view);
+#endif
+
 	if(update_dir_mtime(view) != 0 && !is_unc_root(view->curr_dir))
 	{
 		LOG_SERROR_MSG(errno, "Can't get directory mtime \"%s\"", view->curr_dir);
 		return 1;
 	}
 
-	if(!reload && is_dir_big(view->curr_dir))
+	big_dir = !reload && is_dir_big(view->curr_dir);
+	if(big_dir)
 	{
 		if(!vle_mode_is(CMDLINE_MODE))
 		{
@@ -2646,35 +2843,28 @@ populate_dir_list_internal(FileView *view, int reload)
 		capture_selection(view);
 	}
 
-	if(view->dir_entry != NULL)
-	{
-		int i;
-		for(i = 0; i < old_list; ++i)
-		{
-			free(view->dir_entry[i].name);
-		}
+	/* All names are released at once, while the list itself is allocated anew
+	 * as it's likely to be of quite different size. */
+	arena_reset(&view->names);
+	free(view->dir_entry);
+	view->dir_entry = NULL;
+	view->list_rows = 0;
 
-		free(view->dir_entry);
-		view->dir_entry = NULL;
-	}
-	view->dir_entry = malloc(sizeof(dir_entry_t));
-	if(view->dir_entry == NULL)
+	if(big_dir && fill_dir_list_async(view) == 0)
 	{
-		show_error_msg("Memory Error", "Unable to allocate enough memory.");
-		return 1;
+		/* Rest of the list is merged in by process_dir_loading(). */
 	}
-
-	if(fill_dir_list(view) != 0)
+	else if(fill_dir_list(view) != 0)
 	{
 		/* we don't have read access, only execute, or there were other problems */
-		/* all memory from file names was released in a loop above */
+		/* memory of file names was released along with the arena above */
 		view->list_rows = 0;
 		add_parent_dir(view);
 	}
 
 	sort_dir_list(!reload, view);
 
-	if(!reload && !vle_mode_is(CMDLINE_MODE))
+	if(!reload && !vle_mode_is(CMDLINE_MODE) && view->loader == NULL)
 	{
 		clean_status_bar();
 	}
@@ -2685,7 +2875,10 @@ populate_dir_list_internal(FileView *view, int reload)
 	 * history position.  Stay at the current line
 	 */
 	if(!reload)
+	{
 		check_view_dir_history(view);
+		view->loader_pos = view->list_pos;
+	}
 
 	view->local_cs = check_directory_for_color_scheme(view == &lwin,
 			view->curr_dir);
@@ -2807,16 +3000,13 @@ add_parent_dir(FileView *view)
 	dir_entry_t *dir_entry;
 	struct stat s;
 
-	view->dir_entry = realloc(view->dir_entry,
-			sizeof(dir_entry_t)*(view->list_rows + 1));
-	if(view->dir_entry == NULL)
+	dir_entry = extend_dir_list(&view->dir_entry, view->list_rows, 1);
+	if(dir_entry == NULL)
 	{
 		show_error_msg("Memory Error", "Unable to allocate enough memory");
 		return;
 	}
 
-	dir_entry = &view->dir_entry[view->list_rows];
-
 	init_dir_entry(view, dir_entry, "..");
 	dir_entry->type = DIRECTORY;
 
@@ -2847,7 +3037,14 @@ add_parent_dir(FileView *view)
 static void
 init_dir_entry(FileView *view, dir_entry_t *entry, const char name[])
 {
-	entry->name = strdup(name);
+	entry->name = arena_strdup(&view->names, name);
+	reset_dir_entry(view, entry);
+}
+
+/* Sets all fields of dir_entry_t except for the name to default values. */
+static void
+reset_dir_entry(FileView *view, dir_entry_t *entry)
+{
 	entry->origin = &view->curr_dir[0];
 
 	entry->size = 0ULL;
@@ -2872,7 +3069,6 @@ init_dir_entry(FileView *view, dir_entry_t *entry, const char name[])
 	entry->search_match = 0;
 	entry->marked = 0;
 
-	entry->list_num = -1;
 }
 
 /* Finds maximum filename width (length in character positions on the screen)
@@ -3001,7 +3197,7 @@ local_filter_set(FileView *view, const char filter[])
 	(void)filter_change(&view->local_filter.filter, filter,
 			!regexp_should_ignore_case(filter));
 
-	update_filtering_lists(view, 1, 0);
+	update_filtering_lists(view);
 }
 
 /* Loads full list of files into unfiltered list of the view.  Returns positon
@@ -3152,8 +3348,6 @@ local_filter_accept(FileView *view)
 		return;
 	}
 
-	update_filtering_lists(view, 0, 1);
-
 	local_filter_finish(view);
 
 	cfg_save_filter_history(view->local_filter.filter.raw);
@@ -3190,16 +3384,15 @@ local_filter_cancel(FileView *view)
 	view->dir_entry = NULL;
 	view->list_rows = 0;
 
-	update_filtering_lists(view, 1, 1);
+	update_filtering_lists(view);
 	local_filter_finish(view);
 }
 
-/* Copies/moves elements of the unfiltered list into dir_entry list.  add
- * parameter controls whether entries matching filter are copied into dir_entry
- * list.  clear parameter controls whether entries not matching filter are
- * cleared in unfiltered list. */
+/* Copies elements of the unfiltered list that match local filter into
+ * dir_entry list.  Names are shared by both lists and belong to the names arena
+ * of the view. */
 static void
-update_filtering_lists(FileView *view, int add, int clear)
+update_filtering_lists(FileView *view)
 {
 	size_t i;
 	size_t list_size = 0U;
@@ -3215,7 +3408,7 @@ update_filtering_lists(FileView *view, int add, int clear)
 
 		if(is_parent_dir(name))
 		{
-			if(add && parent_dir_is_visible(is_root_dir(view->curr_dir)))
+			if(parent_dir_is_visible(is_root_dir(view->curr_dir)))
 			{
 				(void)add_dir_entry(&view->dir_entry, &list_size, entry);
 			}
@@ -3230,29 +3423,16 @@ update_filtering_lists(FileView *view, int add, int clear)
 
 		if(filter_matches(&view->local_filter.filter, name) != 0)
 		{
-			if(add)
-			{
-				(void)add_dir_entry(&view->dir_entry, &list_size, entry);
-			}
-		}
-		else
-		{
-			if(clear)
-			{
-				free(entry->name);
-			}
+			(void)add_dir_entry(&view->dir_entry, &list_size, entry);
 		}
 	}
 
-	if(add)
-	{
-		view->list_rows = list_size;
-		view->filtered = view->local_filter.unfiltered_count - list_size;
+	view->list_rows = list_size;
+	view->filtered = view->local_filter.unfiltered_count - list_size;
 
-		if(list_size == 0U)
-		{
-			add_parent_dir(view);
-		}
+	if(list_size == 0U)
+	{
+		add_parent_dir(view);
 	}
 }
 
@@ -3297,19 +3477,62 @@ local_filter_restore(FileView *view)
 static int
 add_dir_entry(dir_entry_t **list, size_t *list_size, const dir_entry_t *entry)
 {
-	dir_entry_t *const new_entry_list = realloc(*list,
-			sizeof(dir_entry_t)*(*list_size + 1));
-	if(new_entry_list == NULL)
+	dir_entry_t *const new_entry = extend_dir_list(list, *list_size, 1);
+	if(new_entry == NULL)
 	{
 		return 1;
 	}
 
-	*list = new_entry_list;
-	new_entry_list[*list_size] = *entry;
+	*new_entry = *entry;
 	++*list_size;
 	return 0;
 }
 
+/* Makes sure that the list of count elements has room for extra more elements.
+ * All lists of entries are grown by this function, so their capacity is
+ * derived from number of elements.  Returns pointer to the element right after
+ * the last one or NULL on error. */
+static dir_entry_t *
+extend_dir_list(dir_entry_t **list, size_t count, size_t extra)
+{
+	const size_t capacity = get_dir_list_capacity(count);
+	const size_t new_capacity = get_dir_list_capacity(count + extra);
+
+	if(new_capacity != capacity)
+	{
+		dir_entry_t *const new_list = realloc(*list,
+				new_capacity*sizeof(dir_entry_t));
+		if(new_list == NULL)
+		{
+			return NULL;
+		}
+		*list = new_list;
+	}
+
+	return &(*list)[count];
+}
+
+/* Computes number of allocated elements of a list of count file entries.
+ * Capacity grows geometrically to make appending take amortized constant time.
+ * Returns the capacity. */
+static size_t
+get_dir_list_capacity(size_t count)
+{
+	size_t capacity;
+
+	if(count == 0U)
+	{
+		return 0U;
+	}
+
+	capacity = MIN_DIR_LIST_CAPACITY;
+	while(capacity < count)
+	{
+		capacity *= 2U;
+	}
+	return capacity;
+}
+
 void
 redraw_view(FileView *view)
 {
@@ -3364,13 +3587,40 @@ reload_window(FileView *view)
 void
 check_if_filelist_have_changed(FileView *view)
 {
-	if(view->on_slow_fs)
+	/* Changes made during loading in background are likely to be loaded. */
+	if(view->on_slow_fs || view->loader != NULL)
 	{
 		return;
 	}
 
 #ifndef _WIN32
 	timestamp_t dir_mtime;
+
+	if(view->dir_watcher != NULL &&
+			stroscmp(view->watched_dir, view->curr_dir) == 0)
+	{
+		fswatch_change_t *changes;
+		int count;
+
+		switch(fswatch_poll_changes(view->dir_watcher, &changes, &count))
+		{
+			case FSWS_UNCHANGED:
+				return;
+			case FSWS_UPDATED:
+				if(changes == NULL || apply_dir_changes(view, changes, count) != 0)
+				{
+					reload_window(view);
+				}
+				fswatch_free_changes(changes, count);
+				return;
+			case FSWS_ERRORED:
+				/* Directory might be gone, let code below figure it out. */
+				fswatch_free(view->dir_watcher);
+				view->dir_watcher = NULL;
+				break;
+		}
+	}
+
 	if(ts_get_file_mtime(view->curr_dir, &dir_mtime) != 0)
 #else
 	int r;
@@ -3402,6 +3652,210 @@ check_if_filelist_have_changed(FileView *view)
 	}
 }
 
+#ifndef _WIN32
+
+/* Updates file list of the view in place according to changes of its entries
+ * instead of rereading whole directory.  Returns zero on success, otherwise
+ * non-zero is returned and the view needs to be reloaded. */
+static int
+apply_dir_changes(FileView *view, fswatch_change_t changes[], int count)
+{
+	char curr_file[NAME_MAX];
+	int i;
+
+	/* Reload takes care of these cases. */
+	if(curr_stats.load_stage < 2 || !window_shows_dirlist(view) ||
+			!is_dir_list_loaded(view) || view->local_filter.in_progress ||
+			view->selected_filelist != NULL)
+	{
+		return 1;
+	}
+
+	copy_str(curr_file, sizeof(curr_file), view->dir_entry[view->list_pos].name);
+
+	for(i = 0; i < count; ++i)
+	{
+		if(apply_dir_change(view, &changes[i]) != 0)
+		{
+			return 1;
+		}
+	}
+
+	if(view->list_rows == 0)
+	{
+		return 1;
+	}
+
+	if(stroscmp(view->dir_entry[view->list_pos].name, curr_file) != 0)
+	{
+		const int pos = find_file_pos_in_list(view, curr_file);
+		if(pos >= 0)
+		{
+			view->list_pos = pos;
+		}
+	}
+
+	(void)update_dir_mtime(view);
+	view->column_count = calculate_columns_count(view);
+	ui_view_schedule_redraw(view);
+	return 0;
+}
+
+/* Updates file list of the view according to change of a single entry.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+apply_dir_change(FileView *view, const fswatch_change_t *change)
+{
+	char full_path[PATH_MAX];
+	dir_entry_t entry;
+	int exists, visible, pos;
+	dir_entry_t *old;
+	char *name;
+
+	if(snprintf(full_path, sizeof(full_path), "%s/%s", view->curr_dir,
+				change->name) >= (int)sizeof(full_path))
+	{
+		return 1;
+	}
+
+	/* Name is stored in the arena only when the entry is going to be listed and
+	 * there is no copy of it already, otherwise names of files that are changed
+	 * over and over again would pile up there until next reload. */
+	entry.name = change->name;
+	reset_dir_entry(view, &entry);
+	exists = (fill_entry_info(&entry, full_path) == 0);
+	visible = exists
+	       && file_is_visible(view, entry.name, is_directory_entry(&entry))
+	       && !(view->hide_dot && entry.name[0] == '.');
+
+	/* New entries are unlikely to be listed, so don't look for them too hard. */
+	pos = change->existed ? find_changed_entry(view, &entry, exists)
+	                      : sort_find_entry(view, &entry);
+	old = (pos >= 0) ? &view->dir_entry[pos] : NULL;
+
+	/* Entry that existed, but wasn't listed, was filtered out. */
+	view->filtered -= (old == NULL && change->existed);
+	view->filtered += (exists && !visible);
+	if(view->filtered < 0)
+	{
+		view->filtered = 0;
+	}
+
+	name = NULL;
+	if(old != NULL)
+	{
+		name = old->name;
+		entry.selected = old->selected;
+		entry.was_selected = old->was_selected;
+		entry.marked = old->marked;
+		remove_list_entry(view, pos);
+	}
+
+	if(!visible)
+	{
+		return 0;
+	}
+
+	entry.name = (name != NULL) ? name : arena_strdup(&view->names, change->name);
+	if(entry.name == NULL)
+	{
+		return 1;
+	}
+	return insert_list_entry(view, &entry);
+}
+
+/* Finds entry of file list of the view that corresponds to the entry, which
+ * contains current state of the file.  Removed entries are looked up as files
+ * and as directories.  Entries that can't be found by their sorting position
+ * (e.g. when sorting by size of a modified file) are checked one by one.
+ * Returns the position or -1 if there is no such entry. */
+static int
+find_changed_entry(FileView *view, dir_entry_t *entry, int exists)
+{
+	int pos = sort_find_entry(view, entry);
+	if(pos < 0 && !exists)
+	{
+		/* Type of removed entry is unknown, which is the same as a file for
+		 * sorting. */
+		const FileType type = entry->type;
+		entry->type = DIRECTORY;
+		pos = sort_find_entry(view, entry);
+		entry->type = type;
+	}
+	return (pos >= 0) ? pos : find_file_pos_in_list(view, entry->name);
+}
+
+/* Removes entry at the pos from file list of the view keeping cursor at the
+ * same file when possible.  Name of the entry stays in the arena until next
+ * reload. */
+static void
+remove_list_entry(FileView *view, int pos)
+{
+	dir_entry_t *const entry = &view->dir_entry[pos];
+
+	if(entry->selected)
+	{
+		--view->selected_files;
+	}
+	if(entry->search_match)
+	{
+		--view->matches;
+	}
+
+	memmove(entry, entry + 1, sizeof(*entry)*(view->list_rows - pos - 1));
+	--view->list_rows;
+
+	if(pos < view->list_pos)
+	{
+		--view->list_pos;
+	}
+	if(pos < view->top_line)
+	{
+		--view->top_line;
+	}
+	if(view->list_pos >= view->list_rows)
+	{
+		view->list_pos = MAX(0, view->list_rows - 1);
+	}
+}
+
+/* Inserts entry into file list of the view at a position dictated by sorting
+ * keeping cursor at the same file.  Returns zero on success, otherwise non-zero
+ * is returned. */
+static int
+insert_list_entry(FileView *view, const dir_entry_t *entry)
+{
+	int pos;
+
+	if(extend_dir_list(&view->dir_entry, view->list_rows, 1) == NULL)
+	{
+		return 1;
+	}
+
+	pos = sort_find_pos(view, (dir_entry_t *)entry);
+	memmove(&view->dir_entry[pos + 1], &view->dir_entry[pos],
+			sizeof(*entry)*(view->list_rows - pos));
+	view->dir_entry[pos] = *entry;
+	++view->list_rows;
+
+	if(entry->selected)
+	{
+		++view->selected_files;
+	}
+
+	if(pos <= view->list_pos && view->list_rows > 1)
+	{
+		++view->list_pos;
+	}
+	if(pos < view->top_line)
+	{
+		++view->top_line;
+	}
+	return 0;
+}
+
+#endif
+
 int
 cd_is_possible(const char *path)
 {
@@ -3425,6 +3879,72 @@ cd_is_possible(const char *path)
 	}
 }
 
+void
+process_dir_loading(FileView *view)
+{
+	size_t pending;
+	int finished;
+
+	if(view->loader == NULL || view->local_filter.in_progress)
+	{
+		return;
+	}
+
+	/* Merging and resorting reorders entries, which would confuse selection in
+	 * visual mode or ranges being typed in command-line mode. */
+	if(!vle_mode_is(NORMAL_MODE))
+	{
+		return;
+	}
+
+	/* Merge entries in geometrically growing chunks to keep total sorting cost
+	 * close to the cost of sorting the list once. */
+	finished = dl_query(view->loader, &pending);
+	if(!finished && pending < MAX(view->window_cells, view->list_rows/2U))
+	{
+		return;
+	}
+
+	finished = append_loaded_entries(view);
+
+	if(view->list_pos == view->loader_pos)
+	{
+		/* User hasn't moved the cursor, so keep looking for position from
+		 * history, which might have been not loaded yet. */
+		sort_dir_list(0, view);
+		check_view_dir_history(view);
+		view->loader_pos = view->list_pos;
+	}
+	else
+	{
+		resort_dir_list(0, view);
+	}
+
+	view->column_count = calculate_columns_count(view);
+	view->max_filename_width = get_max_filename_width(view);
+
+	if(view == curr_view && !curr_stats.save_msg)
+	{
+		if(finished)
+		{
+			clean_status_bar();
+		}
+		else
+		{
+			ui_sb_quick_msgf("Reading directory... %d", view->list_rows);
+		}
+	}
+
+	ui_view_schedule_redraw(view);
+}
+
+void
+cancel_dir_loading(FileView *view)
+{
+	dl_release(view->loader);
+	view->loader = NULL;
+}
+
 void
 load_saving_pos(FileView *view, int reload)
 {
@@ -3705,7 +4225,11 @@ get_file_size_by_entry(const FileView *view, size_t pos)
 	{
 		char full_path[PATH_MAX];
 		get_full_path_of(entry, sizeof(full_path), full_path);
-		tree_get_data(curr_stats.dirsize_cache, full_path, &size);
+		if(dsc_get(curr_stats.dirsize_cache, full_path, &size) != 0)
+		{
+			/* Display progress of calculation that's still running. */
+			(void)dsc_get_partial(curr_stats.dirsize_cache, full_path, &size);
+		}
 	}
 
 	return (size == 0) ? entry->size : size;
@@ -3769,6 +4293,17 @@ entry_to_pos(const FileView *view, const dir_entry_t *entry)
 	return (pos >= 0 && pos < view->list_rows) ? pos : -1;
 }
 
+void
+rename_entry(FileView *view, dir_entry_t *entry, const char new_name[])
+{
+	/* Old name is left in the arena until the list is reloaded. */
+	char *const name = arena_strdup(&view->names, new_name);
+	if(name != NULL)
+	{
+		entry->name = name;
+	}
+}
+
 void
 get_current_full_path(const FileView *view, size_t buf_len, char buf[])
 {
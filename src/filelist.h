@@ -257,6 +257,15 @@ char * get_typed_fname(const char path[]);
 /* Other functions. */
 
 FILE * use_info_prog(const char *viewer);
+/* Composes command that runs the viewer for file under cursor of current view.
+ * Returns a pointer to newly allocated memory, which should be released by the
+ * caller. */
+char * get_viewer_command(const char *viewer);
+/* Composes command that runs the viewer for the entry, which doesn't need to be
+ * under cursor.  Returns a pointer to newly allocated memory, which should be
+ * released by the caller, or NULL for viewers with macros, which are expanded
+ * only for the file under cursor. */
+char * get_entry_viewer_command(const char viewer[], const dir_entry_t *entry);
 /* Loads filelist for the view, but doesn't redraw the view.  The reload
  * parameter should be set in case of view refresh operation. */
 void populate_dir_list(FileView *view, int reload);
@@ -268,6 +277,12 @@ void load_dir_list(FileView *view, int reload);
  * to show "Sorting..." statusbar message. */
 void resort_dir_list(int msg, FileView *view);
 void load_saving_pos(FileView *view, int reload);
+/* Merges entries read in background into the file list of the view and
+ * schedules its redraw.  Does nothing if view isn't being loaded. */
+void process_dir_loading(FileView *view);
+/* Stops loading file list of the view in background (if any), leaving entries
+ * that are already in the list. */
+void cancel_dir_loading(FileView *view);
 char * get_current_file_name(FileView *view);
 /* Checks whether content in the current directory of the view changed and
  * reloads the view if so. */
@@ -298,6 +313,9 @@ int iter_marked_entries(FileView *view, dir_entry_t **entry);
 /* Maps one of file list entries to its position in the list.  Returns the
  * position or -1 on wrong entry. */
 int entry_to_pos(const FileView *view, const dir_entry_t *entry);
+/* Changes name of file list entry of the view to the new_name.  Used to update
+ * entries of renamed files for correct cursor positioning on reload. */
+void rename_entry(FileView *view, dir_entry_t *entry, const char new_name[]);
 /* Fills the buffer with the full path to file under cursor. */
 void get_current_full_path(const FileView *view, size_t buf_len, char buf[]);
 /* Fills the buffer with the full path to file at specified position. */
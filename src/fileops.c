@@ -21,8 +21,6 @@
 
 #include <regex.h>
 
-#include <pthread.h>
-
 #include <fcntl.h>
 #include <sys/stat.h> /* stat */
 #include <sys/types.h> /* waitpid() */
@@ -60,11 +58,11 @@
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
-#include "utils/tree.h"
 #include "utils/test_helpers.h"
 #include "utils/utils.h"
 #include "background.h"
 #include "commands_completion.h"
+#include "dirsize_calc.h"
 #include "filelist.h"
 #include "ops.h"
 #include "registers.h"
@@ -155,7 +153,6 @@ static int clone_file(const dir_entry_t *entry, const char path[],
 		const char clone[], ops_t *ops);
 static void put_decide_cb(const char dest_name[]);
 static void put_continue(int force);
-static int is_dir_entry(const char full_path[], const struct dirent* dentry);
 static int initiate_put_files_from_register(FileView *view, CopyMoveLikeOp op,
 				const char descr[], int reg_name);
 static OPS cmlo_to_op(CopyMoveLikeOp op);
@@ -200,8 +197,7 @@ static const char * get_cancellation_suffix(void);
 static void update_dir_entry_size(const FileView *view, int index, int force);
 static void start_dir_size_calc(const char path[], int force);
 static void dir_size_bg(void *arg);
-static uint64_t calc_dirsize(const char path[], int force_update);
-static void set_dir_size(const char path[], uint64_t size);
+static void redraw_views_of(const char path[], void *arg);
 
 void
 init_fileops(void)
@@ -216,6 +212,9 @@ io_progress_changed(const io_progress_t *const state)
 	enum { PRECISION = 10 };
 
 	static int prev_progress = -1;
+	/* Counts updates that don't change percentage to report only some of
+	 * them. */
+	static int skipped_updates;
 
 	const ioeta_estim_t *const estim = state->estim;
 	ops_t *const ops = estim->param;
@@ -229,6 +228,15 @@ io_progress_changed(const io_progress_t *const state)
 	{
 		progress = estim->total_items/PRECISION;
 	}
+	else if(estim->estimating)
+	{
+		/* Totals aren't known yet, so percentage makes no sense. */
+		if(++skipped_updates%PRECISION != 0)
+		{
+			return;
+		}
+		progress = -1;
+	}
 	else if(estim->total_bytes == 0)
 	{
 		progress = 0;
@@ -237,8 +245,7 @@ io_progress_changed(const io_progress_t *const state)
 			estim->current_byte == estim->total_bytes)
 	{
 		/* Special handling for unknown total size. */
-		++prev_progress;
-		if(prev_progress%PRECISION != 0)
+		if(++skipped_updates%PRECISION != 0)
 		{
 			return;
 		}
@@ -274,7 +281,16 @@ io_progress_changed(const io_progress_t *const state)
 			(void)friendly_size_notation(estim->current_byte,
 					sizeof(current_size_str), current_size_str);
 
-			if(progress < 0)
+			if(estim->estimating)
+			{
+				(void)friendly_size_notation(MAX(estim->total_bytes,
+							estim->current_byte), sizeof(total_size_str), total_size_str);
+				ui_sb_quick_msgf("%s: %d of %d+ (estimating...); %s/%s+ %s",
+						ops_describe(ops), (int)estim->current_item + 1,
+						(int)MAX(estim->total_items, estim->current_item + 1),
+						current_size_str, total_size_str, pretty_path);
+			}
+			else if(progress < 0)
 			{
 				/* Simplified message for unknown total size. */
 				ui_sb_quick_msgf("%s: %d of %d; %s %s", ops_describe(ops),
@@ -525,8 +541,8 @@ delete_files_bg(FileView *view, int use_trash)
 
 	append_marked_files(view, task_desc, NULL);
 
-	if(bg_execute(task_desc, args->sel_list_len, 1, &delete_files_in_bg,
-				args) != 0)
+	if(bg_execute(task_desc, view->curr_dir, args->sel_list_len, 1,
+				&delete_files_in_bg, args) != 0)
 	{
 		free_bg_args(args);
 
@@ -614,9 +630,8 @@ rename_file_cb(const char new_name[])
 	}
 
 	/* Rename file in internal structures for correct positioning of cursor after
-	 * reloading, as cursor will be positioned on the file with the same name.
-	 * TODO: maybe create a function in ui or filelist to do this. */
-	(void)replace_string(&entry->name, new);
+	 * reloading, as cursor will be positioned on the file with the same name. */
+	rename_entry(curr_view, entry, new);
 
 	ui_view_schedule_reload(curr_view);
 }
@@ -790,7 +805,7 @@ perform_renaming(FileView *view, char **files, int *is_dup, int len,
 				/* Rename file in internal structures for correct positioning of cursor
 				 * after reloading, as cursor will be positioned on the file with the
 				 * same name. */
-				(void)replace_string(&view->dir_entry[pos].name, list[i]);
+				rename_entry(view, &view->dir_entry[pos], list[i]);
 			}
 		}
 	}
@@ -1977,27 +1992,6 @@ clone_file(const dir_entry_t *entry, const char path[], const char clone[],
 	return 0;
 }
 
-/* Uses dentry to check file type and falls back to lstat() if dentry contains
- * unknown type. */
-static int
-is_dir_entry(const char full_path[], const struct dirent* dentry)
-{
-#ifndef _WIN32
-	struct stat s;
-	if(dentry->d_type != DT_UNKNOWN)
-	{
-		return dentry->d_type == DT_DIR;
-	}
-	if(os_lstat(full_path, &s) == 0 && s.st_ino != 0)
-	{
-		return (s.st_mode&S_IFMT) == S_IFDIR;
-	}
-	return 0;
-#else
-	return is_dir(full_path);
-#endif
-}
-
 int
 put_links(FileView *view, int reg_name, int relative)
 {
@@ -2576,7 +2570,7 @@ fixup_current_fname(FileView *view, dir_entry_t *entry, const char new_fname[])
 		/* Rename file in internal structures for correct positioning of cursor
 		 * after reloading, as cursor will be positioned on the file with the same
 		 * name. */
-		(void)replace_string(&entry->name, new_fname);
+		rename_entry(view, entry, new_fname);
 	}
 }
 
@@ -2839,7 +2833,8 @@ cpmv_files_bg(FileView *view, char **list, int nlines, int move, int force)
 
 	general_prepare_for_bg_task(view, args);
 
-	if(bg_execute(task_desc, args->sel_list_len, 1, &cpmv_files_in_bg, args) != 0)
+	if(bg_execute(task_desc, args->path, args->sel_list_len, 1, &cpmv_files_in_bg,
+				args) != 0)
 	{
 		free_bg_args(args);
 
@@ -3544,7 +3539,8 @@ start_dir_size_calc(const char path[], int force)
 
 	snprintf(task_desc, sizeof(task_desc), "Calculating size: %s", path);
 
-	if(bg_execute(task_desc, BG_UNDEFINED_TOTAL, 0, &dir_size_bg, dir_size) != 0)
+	if(bg_execute(task_desc, path, BG_UNDEFINED_TOTAL, 0, &dir_size_bg,
+				dir_size) != 0)
 	{
 		free(dir_size->path);
 		free(dir_size);
@@ -3560,83 +3556,31 @@ dir_size_bg(void *arg)
 {
 	dir_size_args_t *const dir_size = arg;
 
-	(void)calc_dirsize(dir_size->path, dir_size->force);
-
-	remove_last_path_component(dir_size->path);
-	if(path_starts_with(lwin.curr_dir, dir_size->path))
-	{
-		ui_view_schedule_redraw(&lwin);
-	}
-	if(path_starts_with(rwin.curr_dir, dir_size->path))
-	{
-		ui_view_schedule_redraw(&rwin);
-	}
+	(void)dsc_calc(curr_stats.dirsize_cache, dir_size->path, dir_size->force,
+			&redraw_views_of, NULL);
+	redraw_views_of(dir_size->path, NULL);
 
 	free(dir_size->path);
 	free(dir_size);
 }
 
-/* Calculates size of a directory possibly using cache of known sizes.  Returns
- * size of a directory or zero on error. */
-static uint64_t
-calc_dirsize(const char path[], int force_update)
+/* Schedules redraw of views that might display size of the path directory. */
+static void
+redraw_views_of(const char path[], void *arg)
 {
-	DIR* dir;
-	struct dirent* dentry;
-	const char* slash = "";
-	uint64_t size;
+	char parent[PATH_MAX];
 
-	dir = os_opendir(path);
-	if(dir == NULL)
-	{
-		return 0;
-	}
+	copy_str(parent, sizeof(parent), path);
+	remove_last_path_component(parent);
 
-	if(!ends_with_slash(path))
+	if(path_starts_with(lwin.curr_dir, parent))
 	{
-		slash = "/";
+		ui_view_schedule_redraw(&lwin);
 	}
-
-	size = 0;
-	while((dentry = os_readdir(dir)) != NULL)
+	if(path_starts_with(rwin.curr_dir, parent))
 	{
-		char buf[PATH_MAX];
-
-		if(is_builtin_dir(dentry->d_name))
-		{
-			continue;
-		}
-
-		snprintf(buf, sizeof(buf), "%s%s%s", path, slash, dentry->d_name);
-		if(is_dir_entry(buf, dentry))
-		{
-			uint64_t dir_size = 0;
-			if(tree_get_data(curr_stats.dirsize_cache, buf, &dir_size) != 0
-					|| force_update)
-				dir_size = calc_dirsize(buf, force_update);
-			size += dir_size;
-		}
-		else
-		{
-			size += get_file_size(buf);
-		}
+		ui_view_schedule_redraw(&rwin);
 	}
-
-	os_closedir(dir);
-
-	set_dir_size(path, size);
-	return size;
-}
-
-/* Updates cached directory size in a thread-safe way. */
-static void
-set_dir_size(const char path[], uint64_t size)
-{
-	static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
-
-	pthread_mutex_lock(&mutex);
-	tree_set_data(curr_stats.dirsize_cache, path, size);
-	pthread_mutex_unlock(&mutex);
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
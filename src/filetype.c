@@ -19,13 +19,17 @@
 
 #include "filetype.h"
 
-#include <ctype.h> /* isspace() */
-#include <stddef.h> /* NULL */
-#include <stdlib.h> /* free() realloc() */
-#include <string.h> /* strchr() strdup() strcasecmp() */
+#include <regex.h> /* regex_t regexec() regfree() */
+
+#include <ctype.h> /* isspace() tolower() */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* calloc() free() malloc() realloc() */
+#include <string.h> /* strchr() strcmp() strdup() strcasecmp() strlen() */
 
 #include "modes/dialogs/msg_dialog.h"
 #include "utils/fs_limits.h"
+#include "utils/int_stack.h"
 #include "utils/str.h"
 #include "utils/utils.h"
 #include "globals.h"
@@ -36,6 +40,46 @@ const assoc_record_t NONE_PSEUDO_PROG =
 	.description = "",
 };
 
+/* Maximum number of lists of candidates traversed by match iterator.  Names with
+ * more extensions are matched against all associations. */
+#define MAX_CANDIDATE_LISTS 16
+
+/* Associations that have specific extension. */
+typedef struct
+{
+	char *ext;             /* Lowercased extension, NULL for unused slot. */
+	int_stack_t assocs;    /* Indexes of associations in ascending order. */
+}
+ext_entry_t;
+
+/* Index that dispatches associations which patterns consist only of "*.ext"
+ * globals by extension and keeps the rest in a separate list.  This way lookup
+ * doesn't need to test every association. */
+struct assoc_index_t
+{
+	ext_entry_t *table;  /* Hash table with open addressing. */
+	size_t size;         /* Number of slots in the table (power of two). */
+	size_t used;         /* Number of used slots. */
+	int_stack_t complex; /* Ascending indexes of all other associations. */
+	int broken;          /* Set on memory error, index shouldn't be used. */
+};
+
+/* Iterator over associations that match a file in order of their definition. */
+typedef struct
+{
+	const assoc_list_t *assocs; /* List of associations. */
+	const char *file;           /* File being matched. */
+	int linear;                 /* Whether index isn't used. */
+	int next;                   /* Next index for linear traversal. */
+	int last;                   /* Last returned index. */
+	int nlists;                 /* Number of lists of candidates. */
+	int complex;                /* Position of list of complex associations. */
+	/* Lists of candidates, which are sorted. */
+	const int_stack_t *lists[MAX_CANDIDATE_LISTS + 1];
+	size_t pos[MAX_CANDIDATE_LISTS + 1]; /* Current positions in lists. */
+}
+match_iter_t;
+
 /* Internal list that stores only currently active associations.
  * Since it holds only copies of structures from filetype and filextype lists,
  * it doesn't consume much memory, and its items shouldn't be freed */
@@ -53,6 +97,20 @@ static assoc_record_t find_existing_cmd_record(const assoc_records_t *records);
 static void assoc_programs(const char pattern[],
 		const assoc_records_t *programs, int for_x, int in_x);
 static assoc_records_t parse_command_list(const char cmds[], int with_descr);
+static assoc_t make_assoc(const char pattern[], const assoc_records_t *records);
+static regex_t * compile_pattern(const char pattern[]);
+static int assoc_matches(const assoc_t *assoc, const char file[]);
+static void iter_init(match_iter_t *iter, const assoc_list_t *assocs,
+		const char file[]);
+static int iter_next(match_iter_t *iter);
+static void index_add(assoc_list_t *assoc_list, int i);
+static int get_pattern_exts(const char pattern[], char exts[]);
+static int is_ext_global(const char global[]);
+static int index_add_ext(assoc_index_t *index, const char ext[], int i);
+static ext_entry_t * index_find(const assoc_index_t *index, const char ext[]);
+static int index_grow(assoc_index_t *index);
+static void index_free(assoc_index_t *index);
+static size_t hash_ext(const char ext[]);
 TSTATIC void replace_double_comma(char cmd[], int put_null);
 static void register_assoc(assoc_t assoc, int for_x, int in_x);
 static assoc_records_t clone_all_matching_records(const char file[],
@@ -92,18 +150,14 @@ ft_get_viewer(const char file[])
 static const char *
 find_existing_cmd(const assoc_list_t *record_list, const char file[])
 {
+	match_iter_t iter;
 	int i;
 
-	for(i = 0; i < record_list->count; ++i)
+	iter_init(&iter, record_list, file);
+	while((i = iter_next(&iter)) >= 0)
 	{
-		assoc_record_t prog;
-
-		if(!global_matches(record_list->list[i].pattern, file))
-		{
-			continue;
-		}
-
-		prog = find_existing_cmd_record(&record_list->list[i].records);
+		const assoc_record_t prog =
+			find_existing_cmd_record(&record_list->list[i].records);
 		if(!is_assoc_record_empty(&prog))
 		{
 			return prog.command;
@@ -157,14 +211,415 @@ ft_set_programs(const char patterns[], const char programs[], int for_x,
 static void
 assoc_programs(const char pattern[], const assoc_records_t *programs, int for_x,
 		int in_x)
+{
+	register_assoc(make_assoc(pattern, programs), for_x, in_x);
+}
+
+/* Makes association of the pattern with copy of the records.  Returns the
+ * association. */
+static assoc_t
+make_assoc(const char pattern[], const assoc_records_t *records)
 {
 	const assoc_t assoc =
 	{
 		.pattern = strdup(pattern),
-		.records = clone_assoc_records(programs),
+		.re = compile_pattern(pattern),
+		.records = clone_assoc_records(records),
 	};
+	return assoc;
+}
+
+/* Compiles comma-separated list of globals.  Returns newly allocated regular
+ * expression or NULL on error. */
+static regex_t *
+compile_pattern(const char pattern[])
+{
+	regex_t *const re = malloc(sizeof(*re));
+	if(re == NULL)
+	{
+		return NULL;
+	}
+
+	if(global_compile_as_re(pattern, re) != 0)
+	{
+		regfree(re);
+		free(re);
+		return NULL;
+	}
+
+	return re;
+}
+
+/* Checks whether pattern of the association matches the file.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+assoc_matches(const assoc_t *assoc, const char file[])
+{
+	return assoc->re != NULL && regexec(assoc->re, file, 0, NULL, 0) == 0;
+}
+
+/* Prepares iterator over associations of the list that match the file. */
+static void
+iter_init(match_iter_t *iter, const assoc_list_t *assocs, const char file[])
+{
+	const assoc_index_t *const index = assocs->index;
+	char lowered[NAME_MAX + 1];
+	size_t len;
+	size_t i;
+
+	iter->assocs = assocs;
+	iter->file = file;
+	iter->linear = 1;
+	iter->next = 0;
+	iter->last = -1;
+	iter->nlists = 0;
+
+	len = strlen(file);
+	if(index == NULL || index->broken || len >= sizeof(lowered))
+	{
+		return;
+	}
+
+	/* "*" doesn't match leading dot, so extension-only patterns can't match such
+	 * files. */
+	if(file[0] != '.')
+	{
+		for(i = 0U; i <= len; ++i)
+		{
+			lowered[i] = tolower((unsigned char)file[i]);
+		}
+
+		for(i = 1U; i < len; ++i)
+		{
+			const ext_entry_t *entry;
+
+			if(lowered[i] != '.' || lowered[i + 1] == '\0')
+			{
+				continue;
+			}
+
+			entry = index_find(index, &lowered[i + 1]);
+			if(entry == NULL)
+			{
+				continue;
+			}
+
+			if(iter->nlists == MAX_CANDIDATE_LISTS)
+			{
+				return;
+			}
+			iter->lists[iter->nlists] = &entry->assocs;
+			iter->pos[iter->nlists] = 0U;
+			++iter->nlists;
+		}
+	}
+
+	iter->complex = iter->nlists;
+	iter->lists[iter->nlists] = &index->complex;
+	iter->pos[iter->nlists] = 0U;
+	++iter->nlists;
+
+	iter->linear = 0;
+}
+
+/* Advances iterator to the next matching association.  Returns its index or -1
+ * if there are no more matches. */
+static int
+iter_next(match_iter_t *iter)
+{
+	if(iter->linear)
+	{
+		while(iter->next < iter->assocs->count)
+		{
+			const int i = iter->next++;
+			if(assoc_matches(&iter->assocs->list[i], iter->file))
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	while(1)
+	{
+		int k;
+		int min = -1;
+		int from_complex = 0;
+
+		for(k = 0; k < iter->nlists; ++k)
+		{
+			const int_stack_t *const list = iter->lists[k];
+			int i;
+
+			/* The same association can be registered for several extensions. */
+			while(iter->pos[k] < list->top && list->data[iter->pos[k]] <= iter->last)
+			{
+				++iter->pos[k];
+			}
+			if(iter->pos[k] == list->top)
+			{
+				continue;
+			}
+
+			i = list->data[iter->pos[k]];
+			if(min < 0 || i < min)
+			{
+				min = i;
+				from_complex = (k == iter->complex);
+			}
+		}
+
+		if(min < 0)
+		{
+			return -1;
+		}
+
+		iter->last = min;
+		if(!from_complex || assoc_matches(&iter->assocs->list[min], iter->file))
+		{
+			return min;
+		}
+	}
+}
+
+/* Registers i-th association of the list in its index. */
+static void
+index_add(assoc_list_t *assoc_list, int i)
+{
+	assoc_index_t *index = assoc_list->index;
+	const char *const pattern = assoc_list->list[i].pattern;
+	char *exts;
+
+	if(index == NULL)
+	{
+		index = calloc(1U, sizeof(*index));
+		if(index == NULL)
+		{
+			return;
+		}
+		assoc_list->index = index;
+	}
+
+	if(index->broken)
+	{
+		return;
+	}
+
+	exts = (pattern == NULL) ? NULL : malloc(strlen(pattern) + 1U);
+	if(exts != NULL && get_pattern_exts(pattern, exts) == 0)
+	{
+		const char *ext;
+		for(ext = exts; *ext != '\0'; ext += strlen(ext) + 1U)
+		{
+			if(index_add_ext(index, ext, i) != 0)
+			{
+				index->broken = 1;
+				break;
+			}
+		}
+	}
+	else if(int_stack_push(&index->complex, i) != 0)
+	{
+		index->broken = 1;
+	}
+	free(exts);
+}
+
+/* Extracts lowercased extensions from the pattern if it consists only of
+ * "*.ext" globals.  Extensions are stored in the exts buffer (of size at least
+ * strlen(pattern) + 1) one after another, each followed by null character with
+ * the list terminated by empty string.  Returns zero on success and non-zero if
+ * the pattern isn't of that form. */
+static int
+get_pattern_exts(const char pattern[], char exts[])
+{
+	char *const copy = strdup(pattern);
+	char *global = copy, *state = NULL;
+	char *out = exts;
+
+	if(copy == NULL)
+	{
+		return 1;
+	}
+
+	while((global = split_and_get(global, ',', &state)) != NULL)
+	{
+		const char *ext;
+
+		if(!is_ext_global(global))
+		{
+			free(copy);
+			return 1;
+		}
+
+		for(ext = global + 2; *ext != '\0'; ++ext)
+		{
+			*out++ = tolower((unsigned char)*ext);
+		}
+		*out++ = '\0';
+	}
+	free(copy);
+
+	if(out == exts)
+	{
+		return 1;
+	}
+
+	*out = '\0';
+	return 0;
+}
+
+/* Checks whether the global is of "*.ext" form where ext consists of ASCII
+ * characters that don't have special meaning.  Returns non-zero if so,
+ * otherwise zero is returned. */
+static int
+is_ext_global(const char global[])
+{
+	if(global[0] != '*' || global[1] != '.' || global[2] == '\0')
+	{
+		return 0;
+	}
+
+	for(global += 2; *global != '\0'; ++global)
+	{
+		if((unsigned char)*global >= 0x80 || char_is_one_of("*?[]\\", *global))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Registers i-th association for the extension.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+index_add_ext(assoc_index_t *index, const char ext[], int i)
+{
+	ext_entry_t *entry = index_find(index, ext);
+	if(entry == NULL)
+	{
+		size_t slot;
+
+		if((index->used + 1U)*2U > index->size && index_grow(index) != 0)
+		{
+			return 1;
+		}
+
+		slot = hash_ext(ext) & (index->size - 1U);
+		while(index->table[slot].ext != NULL)
+		{
+			slot = (slot + 1U) & (index->size - 1U);
+		}
+
+		entry = &index->table[slot];
+		entry->ext = strdup(ext);
+		if(entry->ext == NULL)
+		{
+			return 1;
+		}
+		++index->used;
+	}
+
+	if(int_stack_top_is(&entry->assocs, i))
+	{
+		return 0;
+	}
+	return int_stack_push(&entry->assocs, i);
+}
 
-	register_assoc(assoc, for_x, in_x);
+/* Looks up entry of the extension.  Returns the entry or NULL if there is
+ * none. */
+static ext_entry_t *
+index_find(const assoc_index_t *index, const char ext[])
+{
+	size_t slot;
+
+	if(index->size == 0U)
+	{
+		return NULL;
+	}
+
+	slot = hash_ext(ext) & (index->size - 1U);
+	while(index->table[slot].ext != NULL)
+	{
+		if(strcmp(index->table[slot].ext, ext) == 0)
+		{
+			return &index->table[slot];
+		}
+		slot = (slot + 1U) & (index->size - 1U);
+	}
+	return NULL;
+}
+
+/* Doubles size of hash table of the index.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+index_grow(assoc_index_t *index)
+{
+	const size_t new_size = (index->size == 0U) ? 64U : index->size*2U;
+	ext_entry_t *const table = calloc(new_size, sizeof(*table));
+	size_t i;
+
+	if(table == NULL)
+	{
+		return 1;
+	}
+
+	for(i = 0U; i < index->size; ++i)
+	{
+		size_t slot;
+
+		if(index->table[i].ext == NULL)
+		{
+			continue;
+		}
+
+		slot = hash_ext(index->table[i].ext) & (new_size - 1U);
+		while(table[slot].ext != NULL)
+		{
+			slot = (slot + 1U) & (new_size - 1U);
+		}
+		table[slot] = index->table[i];
+	}
+
+	free(index->table);
+	index->table = table;
+	index->size = new_size;
+	return 0;
+}
+
+/* Frees the index.  The index can be NULL. */
+static void
+index_free(assoc_index_t *index)
+{
+	size_t i;
+
+	if(index == NULL)
+	{
+		return;
+	}
+
+	for(i = 0U; i < index->size; ++i)
+	{
+		free(index->table[i].ext);
+		free(index->table[i].assocs.data);
+	}
+	free(index->table);
+	free(index->complex.data);
+	free(index);
+}
+
+/* Computes FNV-1a hash of the extension.  Returns the hash. */
+static size_t
+hash_ext(const char ext[])
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	while(*ext != '\0')
+	{
+		h ^= (unsigned char)*ext++;
+		h *= 0x100000001b3ULL;
+	}
+	return (size_t)(h ^ (h >> 32));
 }
 
 /* Parses comma separated list of commands into array of associations.  Returns
@@ -275,15 +730,14 @@ ft_get_all_viewers(const char file[])
 static assoc_records_t
 clone_all_matching_records(const char file[], const assoc_list_t *record_list)
 {
+	match_iter_t iter;
 	int i;
 	assoc_records_t result = {};
 
-	for(i = 0; i < record_list->count; ++i)
+	iter_init(&iter, record_list, file);
+	while((i = iter_next(&iter)) >= 0)
 	{
-		if(global_matches(record_list->list[i].pattern, file))
-		{
-			ft_assoc_record_add_all(&result, &record_list->list[i].records);
-		}
+		ft_assoc_record_add_all(&result, &record_list->list[i].records);
 	}
 
 	return result;
@@ -301,13 +755,7 @@ ft_set_viewers(const char patterns[], const char viewers[])
 static void
 assoc_viewers(const char pattern[], const assoc_records_t *viewers)
 {
-	const assoc_t assoc =
-	{
-		.pattern = strdup(pattern),
-		.records = clone_assoc_records(viewers),
-	};
-
-	add_assoc(&fileviewers, assoc);
+	add_assoc(&fileviewers, make_assoc(pattern, viewers));
 }
 
 /* Clones list of association records.  Returns the clone. */
@@ -332,6 +780,8 @@ add_assoc(assoc_list_t *assoc_list, assoc_t assoc)
 	assoc_list->list = p;
 	assoc_list->list[assoc_list->count] = assoc;
 	assoc_list->count++;
+
+	index_add(assoc_list, assoc_list->count - 1);
 }
 
 void
@@ -377,12 +827,21 @@ reset_list_head(assoc_list_t *assoc_list)
 	free(assoc_list->list);
 	assoc_list->list = NULL;
 	assoc_list->count = 0;
+
+	index_free(assoc_list->index);
+	assoc_list->index = NULL;
 }
 
 static void
 free_assoc(assoc_t *assoc)
 {
 	safe_free(&assoc->pattern);
+	if(assoc->re != NULL)
+	{
+		regfree(assoc->re);
+		free(assoc->re);
+		assoc->re = NULL;
+	}
 	ft_assoc_records_free(&assoc->records);
 }
 
@@ -20,6 +20,8 @@
 #ifndef VIFM__FILETYPE_H__
 #define VIFM__FILETYPE_H__
 
+#include <regex.h> /* regex_t */
+
 #include "utils/test_helpers.h"
 
 #define VIFM_PSEUDO_CMD "vifm"
@@ -52,14 +54,21 @@ assoc_records_t;
 typedef struct
 {
 	char *pattern;
+	/* Pattern compiled once on association creation, NULL if it's invalid. */
+	regex_t *re;
 	assoc_records_t records;
 }
 assoc_t;
 
+/* Opaque index of associations by extensions. */
+typedef struct assoc_index_t assoc_index_t;
+
 typedef struct
 {
 	assoc_t *list;
 	int count;
+	/* Index for fast lookup of matching associations, can be NULL. */
+	assoc_index_t *index;
 }
 assoc_list_t;
 
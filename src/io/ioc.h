@@ -85,6 +85,9 @@ typedef struct
 	arg3;
 
 	int cancellable;
+	/* Maximum number of files copied concurrently by recursive operations.
+	 * Values less than two mean copying files one by one. */
+	int parallelism;
 
 	/* Set to NULL to do not use estimates. */
 	ioeta_estim_t *estim;
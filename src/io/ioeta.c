@@ -18,17 +18,49 @@
 
 #include "ioeta.h"
 
+#include <pthread.h>
+
 #include <assert.h> /* assert() */
 #include <stddef.h> /* NULL size_t */
 #include <stdint.h> /* uint64_t */
-#include <stdlib.h> /* calloc() free() */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* strdup() */
 
 #include "../ui/cancellation.h"
+#include "../utils/fs.h"
 #include "private/ioeta.h"
 #include "private/traverser.h"
 
+/* Path waiting to be processed by background estimation. */
+typedef struct queued_path_t
+{
+	char *path;                 /* Root of subtree to traverse. */
+	struct queued_path_t *next; /* Next path in the queue or NULL. */
+}
+queued_path_t;
+
+struct ioeta_scanner_t
+{
+	pthread_t thread;      /* Thread that traverses queued paths. */
+	pthread_mutex_t lock;  /* Protects all fields below. */
+	pthread_cond_t queued; /* Signaled when a path is queued or on stop. */
+	queued_path_t *head;   /* First queued path or NULL. */
+	queued_path_t *tail;   /* Last queued path or NULL. */
+	int busy;              /* Whether a path is being traversed right now. */
+	int stop;              /* Whether thread should finish as soon as possible. */
+	size_t items;          /* Number of items counted so far. */
+	uint64_t bytes;        /* Number of bytes counted so far. */
+	size_t synced_items;   /* Part of items already added to estimation. */
+	uint64_t synced_bytes; /* Part of bytes already added to estimation. */
+};
+
 static VisitResult eta_visitor(const char full_path[], VisitAction action,
 		void *param);
+static ioeta_scanner_t * scanner_start(void);
+static void scanner_stop(ioeta_scanner_t *scanner);
+static void * scanner_thread(void *arg);
+static VisitResult scan_visitor(const char full_path[], VisitAction action,
+		void *param);
 
 ioeta_estim_t *
 ioeta_alloc(void *param)
@@ -43,6 +75,7 @@ ioeta_free(ioeta_estim_t *estim)
 {
 	if(estim != NULL)
 	{
+		scanner_stop(estim->scanner);
 		free(estim->item);
 		free(estim);
 	}
@@ -61,6 +94,65 @@ ioeta_calculate(ioeta_estim_t *estim, const char path[], int shallow)
 	}
 }
 
+void
+ioeta_calculate_bg(ioeta_estim_t *estim, const char path[])
+{
+	ioeta_scanner_t *scanner;
+	queued_path_t *const queued = malloc(sizeof(*queued));
+
+	if(estim->scanner == NULL)
+	{
+		estim->scanner = scanner_start();
+	}
+
+	scanner = estim->scanner;
+	if(scanner == NULL || queued == NULL ||
+			(queued->path = strdup(path)) == NULL)
+	{
+		/* Fallback to synchronous estimation. */
+		free(queued);
+		ioeta_calculate(estim, path, 0);
+		return;
+	}
+	queued->next = NULL;
+
+	pthread_mutex_lock(&scanner->lock);
+	if(scanner->tail == NULL)
+	{
+		scanner->head = queued;
+	}
+	else
+	{
+		scanner->tail->next = queued;
+	}
+	scanner->tail = queued;
+	pthread_cond_signal(&scanner->queued);
+	pthread_mutex_unlock(&scanner->lock);
+
+	estim->estimating = 1;
+}
+
+void
+ioeta_sync(ioeta_estim_t *estim)
+{
+	ioeta_scanner_t *scanner;
+
+	if(estim == NULL || estim->scanner == NULL)
+	{
+		return;
+	}
+
+	scanner = estim->scanner;
+
+	pthread_mutex_lock(&scanner->lock);
+	estim->total_items += scanner->items - scanner->synced_items;
+	estim->total_bytes += scanner->bytes - scanner->synced_bytes;
+	scanner->synced_items = scanner->items;
+	scanner->synced_bytes = scanner->bytes;
+	estim->estimating = (scanner->busy || scanner->head != NULL);
+	pthread_mutex_unlock(&scanner->lock);
+}
+
 /* Implementation of traverse() visitor for subtree copying.  Returns 0 on
  * success, otherwise non-zero is returned. */
 static VisitResult
@@ -89,5 +181,134 @@ eta_visitor(const char full_path[], VisitAction action, void *param)
 	return VR_OK;
 }
 
+/* Creates background estimation thread.  Returns the scanner or NULL on
+ * error. */
+static ioeta_scanner_t *
+scanner_start(void)
+{
+	ioeta_scanner_t *const scanner = calloc(1U, sizeof(*scanner));
+	if(scanner == NULL)
+	{
+		return NULL;
+	}
+
+	(void)pthread_mutex_init(&scanner->lock, NULL);
+	(void)pthread_cond_init(&scanner->queued, NULL);
+
+	if(pthread_create(&scanner->thread, NULL, &scanner_thread, scanner) != 0)
+	{
+		pthread_cond_destroy(&scanner->queued);
+		pthread_mutex_destroy(&scanner->lock);
+		free(scanner);
+		return NULL;
+	}
+
+	return scanner;
+}
+
+/* Interrupts estimation, waits for the thread to finish and frees the
+ * scanner.  The scanner can be NULL. */
+static void
+scanner_stop(ioeta_scanner_t *scanner)
+{
+	if(scanner == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&scanner->lock);
+	scanner->stop = 1;
+	pthread_cond_signal(&scanner->queued);
+	pthread_mutex_unlock(&scanner->lock);
+
+	(void)pthread_join(scanner->thread, NULL);
+
+	while(scanner->head != NULL)
+	{
+		queued_path_t *const next = scanner->head->next;
+		free(scanner->head->path);
+		free(scanner->head);
+		scanner->head = next;
+	}
+
+	pthread_cond_destroy(&scanner->queued);
+	pthread_mutex_destroy(&scanner->lock);
+	free(scanner);
+}
+
+/* Entry point of background estimation thread.  Returns NULL. */
+static void *
+scanner_thread(void *arg)
+{
+	ioeta_scanner_t *const scanner = arg;
+
+	pthread_mutex_lock(&scanner->lock);
+	while(1)
+	{
+		queued_path_t *queued;
+
+		while(scanner->head == NULL && !scanner->stop)
+		{
+			pthread_cond_wait(&scanner->queued, &scanner->lock);
+		}
+		if(scanner->stop)
+		{
+			break;
+		}
+
+		queued = scanner->head;
+		scanner->head = queued->next;
+		if(scanner->head == NULL)
+		{
+			scanner->tail = NULL;
+		}
+		scanner->busy = 1;
+
+		pthread_mutex_unlock(&scanner->lock);
+		(void)traverse(queued->path, &scan_visitor, scanner);
+		free(queued->path);
+		free(queued);
+		pthread_mutex_lock(&scanner->lock);
+
+		scanner->busy = 0;
+	}
+	pthread_mutex_unlock(&scanner->lock);
+
+	return NULL;
+}
+
+/* Counterpart of eta_visitor() for background estimation, which doesn't touch
+ * the estimation and isn't affected by UI cancellation. */
+static VisitResult
+scan_visitor(const char full_path[], VisitAction action, void *param)
+{
+	ioeta_scanner_t *const scanner = param;
+	VisitResult result = VR_OK;
+	uint64_t size = 0U;
+
+	if(action == VA_FILE && !is_symlink(full_path))
+	{
+		size = get_file_size(full_path);
+	}
+
+	pthread_mutex_lock(&scanner->lock);
+	if(scanner->stop)
+	{
+		result = VR_CANCELLED;
+	}
+	else if(action == VA_FILE)
+	{
+		++scanner->items;
+		scanner->bytes += size;
+	}
+	else if(action == VA_DIR_ENTER)
+	{
+		result = VR_SKIP_DIR_LEAVE;
+	}
+	pthread_mutex_unlock(&scanner->lock);
+
+	return result;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -26,6 +26,9 @@
 
 /* TODO: add per file progress. */
 
+/* Opaque state of background estimation. */
+typedef struct ioeta_scanner_t ioeta_scanner_t;
+
 typedef struct
 {
 	/* Total number of items to process (T). */
@@ -50,13 +53,21 @@ typedef struct
 
 	/* Custom parameter for notification callbacks. */
 	void *param;
+
+	/* Whether totals are still being calculated in background and thus aren't
+	 * final. */
+	int estimating;
+
+	/* State of background estimation or NULL if it wasn't started. */
+	ioeta_scanner_t *scanner;
 }
 ioeta_estim_t;
 
 /* Allocates and initializes new ioeta_estim_t. */
 ioeta_estim_t * ioeta_alloc(void *param);
 
-/* Frees ioeta_estim_t.  The estim can be NULL. */
+/* Frees ioeta_estim_t stopping background estimation.  The estim can be
+ * NULL. */
 void ioeta_free(ioeta_estim_t *estim);
 
 /* Calculates estimates for a subtree rooted at path.  Adds them up to values
@@ -64,6 +75,22 @@ void ioeta_free(ioeta_estim_t *estim);
  * directories. */
 void ioeta_calculate(ioeta_estim_t *estim, const char path[], int shallow);
 
+/* Same as ioeta_calculate() without shallow flag, but only queues the path for
+ * traversal by a background thread (started on first call) and returns
+ * immediately setting estimating flag of the estim.  Queued paths are processed
+ * one by one in the order they were passed in.  If the thread can't be started
+ * or the path can't be queued, estimation is performed synchronously instead.
+ * Results of background traversal appear in the estim only via ioeta_sync(). */
+void ioeta_calculate_bg(ioeta_estim_t *estim, const char path[]);
+
+/* Adds results of background estimation gathered since previous call to the
+ * totals of the estim and resets its estimating flag once all queued paths are
+ * processed.  Totals are never changed behind the back of the caller, so this
+ * should be called by the same thread that reads them (ioeta_update() does
+ * it).  Does nothing if estim is NULL or no background estimation was
+ * started. */
+void ioeta_sync(ioeta_estim_t *estim);
+
 #endif /* VIFM__IO__IOETA_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -24,15 +24,25 @@
 
 #include "iop.h"
 
-#include <sys/stat.h> /* stat */
-#include <sys/types.h> /* mode_t */
-#include <unistd.h> /* rmdir() symlink() unlink() */
+#ifdef __linux__
+#include <linux/fs.h> /* FICLONE */
+#include <sys/ioctl.h> /* ioctl() */
+#include <sys/sendfile.h> /* sendfile() */
+#include <sys/syscall.h> /* SYS_copy_file_range */
+#endif
+
+#include <sys/stat.h> /* fstat() stat */
+#include <sys/types.h> /* mode_t off_t ssize_t */
+#include <fcntl.h> /* FALLOC_FL_KEEP_SIZE fallocate() */
+#include <unistd.h> /* SEEK_DATA SEEK_HOLE SEEK_SET ftruncate() lseek() read()
+                       rmdir() symlink() syscall() sysconf() unlink() write() */
 
-#include <errno.h> /* EEXIST errno */
+#include <errno.h> /* EEXIST EINTR ENXIO errno */
 #include <stddef.h> /* NULL size_t */
-#include <stdio.h> /* FILE fpos_t fclose() fgetpos() fread() fseek() fsetpos()
-                      fwrite() snprintf() */
-#include <stdlib.h> /* free() */
+#include <stdint.h> /* UINT64_MAX uint64_t */
+#include <stdio.h> /* FILE fileno() fpos_t fclose() fgetpos() fread() fseek()
+                      fsetpos() fwrite() snprintf() */
+#include <stdlib.h> /* free() posix_memalign() */
 #include <string.h> /* strchr() */
 
 #include "../compat/os.h"
@@ -49,10 +59,50 @@
 #include "private/ioeta.h"
 #include "ioc.h"
 
+#ifdef _WIN32
+
 /* Amount of data to transfer at once. */
 #define BLOCK_SIZE 32*1024
 
-#ifdef _WIN32
+#else
+
+/* Amount of data to transfer at once via user-space buffer. */
+#define BIG_BLOCK_SIZE (256*1024)
+
+/* Amount of data to transfer at once when copying is done by the kernel.  The
+ * limit is there to report progress and check for cancellation. */
+#define KERNEL_CHUNK_SIZE (8*1024*1024)
+
+/* Ways of copying file data from the fastest to the slowest one. */
+typedef enum
+{
+	CM_COPY_FILE_RANGE, /* copy_file_range(), can avoid copying at all. */
+	CM_SENDFILE,        /* sendfile(), doesn't copy data to user space. */
+	CM_READ_WRITE,      /* read() and write() through a buffer. */
+}
+CopyMethod;
+
+/* State of copying file contents. */
+typedef struct
+{
+	io_args_t *args;   /* Arguments of the operation. */
+	CopyMethod method; /* Method currently in use. */
+	char *buf;         /* Buffer for CM_READ_WRITE method or NULL. */
+}
+copy_state_t;
+
+#endif
+
+#ifndef _WIN32
+static int copy_contents(io_args_t *args, int in, int out, int append);
+static int clone_contents(int in, int out);
+static int copy_sparse(copy_state_t *state, int in, int out, off_t size);
+static void preallocate(int fd, off_t size);
+static int copy_range(copy_state_t *state, int in, int out, uint64_t len);
+static ssize_t transfer_chunk(copy_state_t *state, int in, int out,
+		uint64_t max);
+static ssize_t write_all(int fd, const char buf[], size_t len);
+#else
 static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
 		LARGE_INTEGER transferred, LARGE_INTEGER stream_size,
 		LARGE_INTEGER stream_transfered, DWORD stream_num, DWORD reason,
@@ -176,9 +226,11 @@ iop_cp(io_args_t *const args)
 	const IoCrs crs = args->arg3.crs;
 	const int cancellable = args->cancellable;
 
+#ifdef _WIN32
 	char block[BLOCK_SIZE];
-	FILE *in, *out;
 	size_t nread;
+#endif
+	FILE *in, *out;
 	int error;
 	struct stat src_st;
 	const char *open_mode = "wb";
@@ -292,8 +344,15 @@ iop_cp(io_args_t *const args)
 		}
 	}
 
-	/* TODO: use sendfile() if platform supports it. */
-
+#ifndef _WIN32
+	/* Nothing went through buffers of the streams, so their descriptors can be
+	 * used directly. */
+	if(!error)
+	{
+		error = copy_contents(args, fileno(in), fileno(out),
+				crs == IO_CRS_APPEND_TO_FILES);
+	}
+#else
 	while((nread = fread(&block, 1, sizeof(block), in)) != 0U)
 	{
 		if(cancellable && ui_cancellation_requested())
@@ -310,6 +369,7 @@ iop_cp(io_args_t *const args)
 
 		ioeta_update(args->estim, src, 0, nread);
 	}
+#endif
 
 	fclose(in);
 	fclose(out);
@@ -324,6 +384,252 @@ iop_cp(io_args_t *const args)
 	return error;
 }
 
+#ifndef _WIN32
+
+/* Copies data from current position of in to current position of out using
+ * the fastest available method.  Holes of sparse files are preserved.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+copy_contents(io_args_t *args, int in, int out, int append)
+{
+	copy_state_t state = { .args = args, .buf = NULL };
+	struct stat st;
+	int error;
+
+	if(!append && clone_contents(in, out) == 0)
+	{
+		if(fstat(out, &st) == 0)
+		{
+			ioeta_update(args->estim, args->arg1.src, 0, st.st_size);
+		}
+		return 0;
+	}
+
+	/* Kernel doesn't support appending for its copying methods. */
+	state.method = append ? CM_READ_WRITE : CM_COPY_FILE_RANGE;
+
+	if(append || fstat(in, &st) != 0 || !S_ISREG(st.st_mode))
+	{
+		error = copy_range(&state, in, out, UINT64_MAX);
+	}
+	else if((uint64_t)st.st_blocks*512U < (uint64_t)st.st_size)
+	{
+		error = copy_sparse(&state, in, out, st.st_size);
+	}
+	else
+	{
+		preallocate(out, st.st_size);
+		error = copy_range(&state, in, out, UINT64_MAX);
+	}
+
+	free(state.buf);
+	return error;
+}
+
+/* Makes out share data blocks with in on file systems that support it.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+clone_contents(int in, int out)
+{
+#ifdef FICLONE
+	return ioctl(out, FICLONE, in);
+#else
+	return 1;
+#endif
+}
+
+/* Copies file which has holes, only data extents are transferred, while holes
+ * are recreated by seeking over them.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+copy_sparse(copy_state_t *state, int in, int out, off_t size)
+{
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+	off_t pos = 0;
+
+	while(pos < size)
+	{
+		off_t data, hole;
+
+		data = lseek(in, pos, SEEK_DATA);
+		if(data < 0)
+		{
+			if(errno != ENXIO)
+			{
+				/* Holes can't be detected, copy everything starting at pos. */
+				break;
+			}
+			/* The rest of the file is a hole. */
+			data = size;
+		}
+
+		hole = (data < size) ? lseek(in, data, SEEK_HOLE) : size;
+		if(hole < 0)
+		{
+			break;
+		}
+
+		ioeta_update(state->args->estim, state->args->arg1.src, 0, data - pos);
+
+		if(data != hole && (lseek(in, data, SEEK_SET) < 0 ||
+				lseek(out, data, SEEK_SET) < 0 ||
+				copy_range(state, in, out, hole - data) != 0))
+		{
+			return 1;
+		}
+
+		pos = hole;
+	}
+
+	if(pos < size)
+	{
+		if(lseek(in, pos, SEEK_SET) < 0 || lseek(out, pos, SEEK_SET) < 0)
+		{
+			return 1;
+		}
+		return copy_range(state, in, out, UINT64_MAX);
+	}
+
+	/* Trailing hole doesn't extend the file, so set its size explicitly. */
+	return ftruncate(out, size) != 0;
+#else
+	return copy_range(state, in, out, UINT64_MAX);
+#endif
+}
+
+/* Asks file system to allocate space for the whole file at once, which makes
+ * allocation faster and less fragmented.  Size of the file is left intact, so
+ * that it reflects amount of data copied so far. */
+static void
+preallocate(int fd, off_t size)
+{
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+	if(size > 0)
+	{
+		/* Not all file systems support this and that's fine. */
+		(void)fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, size);
+	}
+#endif
+}
+
+/* Copies at most len bytes from current position of in to current position of
+ * out (less if end of in is reached).  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+copy_range(copy_state_t *state, int in, int out, uint64_t len)
+{
+	const char *const src = state->args->arg1.src;
+	const int cancellable = state->args->cancellable;
+
+	uint64_t copied = 0U;
+
+	while(copied < len)
+	{
+		ssize_t n;
+
+		if(cancellable && ui_cancellation_requested())
+		{
+			return 1;
+		}
+
+		n = transfer_chunk(state, in, out, len - copied);
+		if(n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		/* Kernel methods don't change file positions on failure, so it's safe to
+		 * continue with the next method.  Also some pseudo files report zero size
+		 * to the kernel, hence check that the end is really reached. */
+		if(state->method != CM_READ_WRITE && (n < 0 || (n == 0 && copied == 0U)))
+		{
+			++state->method;
+			continue;
+		}
+
+		if(n <= 0)
+		{
+			return (n < 0);
+		}
+
+		copied += n;
+		ioeta_update(state->args->estim, src, 0, n);
+	}
+
+	return 0;
+}
+
+/* Copies next piece of data (at most max bytes) using current method.  Buffer
+ * is allocated on first use of CM_READ_WRITE.  Returns number of bytes copied,
+ * zero at the end of input or negative number on error. */
+static ssize_t
+transfer_chunk(copy_state_t *state, int in, int out, uint64_t max)
+{
+	const size_t kernel_chunk = MIN(max, (uint64_t)KERNEL_CHUNK_SIZE);
+	const size_t block = MIN(max, (uint64_t)BIG_BLOCK_SIZE);
+	ssize_t nread;
+
+	switch(state->method)
+	{
+		case CM_COPY_FILE_RANGE:
+#if defined(__linux__) && defined(SYS_copy_file_range)
+			return syscall(SYS_copy_file_range, in, NULL, out, NULL, kernel_chunk,
+					0U);
+#else
+			errno = ENOSYS;
+			return -1;
+#endif
+		case CM_SENDFILE:
+#ifdef __linux__
+			return sendfile(out, in, NULL, kernel_chunk);
+#else
+			errno = ENOSYS;
+			return -1;
+#endif
+		case CM_READ_WRITE:
+			break;
+	}
+
+	/* Page-aligned buffer is friendlier to direct I/O and page cache. */
+	if(state->buf == NULL && posix_memalign((void **)&state->buf,
+				sysconf(_SC_PAGESIZE), BIG_BLOCK_SIZE) != 0)
+	{
+		state->buf = NULL;
+		return -1;
+	}
+
+	nread = read(in, state->buf, block);
+	if(nread <= 0)
+	{
+		return nread;
+	}
+	return write_all(out, state->buf, nread);
+}
+
+/* Writes whole buffer to the file descriptor retrying on partial writes.
+ * Returns len on success or negative number on error. */
+static ssize_t
+write_all(int fd, const char buf[], size_t len)
+{
+	size_t written = 0U;
+	while(written != len)
+	{
+		const ssize_t n = write(fd, buf + written, len - written);
+		if(n < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			return -1;
+		}
+		written += n;
+	}
+	return len;
+}
+
+#endif
+
 #ifdef _WIN32
 
 static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
@@ -22,10 +22,10 @@
 #include <unistd.h> /* unlink() */
 
 #include <errno.h> /* EEXIST EISDIR ENOTEMPTY EXDEV errno */
-#include <stddef.h> /* NULL */
+#include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* removee() snprintf() */
-#include <stdlib.h> /* free() */
-#include <string.h> /* strlen() */
+#include <stdlib.h> /* free() realloc() */
+#include <string.h> /* strdup() strlen() */
 
 #include "../compat/os.h"
 #include "../ui/cancellation.h"
@@ -36,12 +36,41 @@
 #include "../utils/str.h"
 #include "../background.h"
 #include "private/ioeta.h"
+#include "private/iopool.h"
 #include "private/traverser.h"
 #include "ioc.h"
 #include "iop.h"
 
+/* Files of this size and bigger are copied by the thread that traverses the
+ * tree even when copying is concurrent.  Copying them is limited by bandwidth
+ * rather than by latency and this way their progress is reported in full. */
+#define INLINE_COPY_SIZE (4*1024*1024)
+
+/* Permissions of a directory, which are set after copying its contents. */
+typedef struct
+{
+	char *path;  /* Path to the directory copy. */
+	mode_t mode; /* Mode of the original directory. */
+}
+dir_mode_t;
+
+/* State of concurrent subtree copying. */
+typedef struct
+{
+	io_args_t *args;  /* Arguments of the operation. */
+	iopool_t *pool;   /* Pool of copying threads, created on first use. */
+	dir_mode_t *dirs; /* Directories in the order they were left. */
+	size_t ndirs;     /* Number of elements in the dirs array. */
+}
+pool_cp_t;
+
 static VisitResult rm_visitor(const char full_path[], VisitAction action,
 		void *param);
+static int cp_concurrently(io_args_t *args);
+static VisitResult pool_cp_visitor(const char full_path[], VisitAction action,
+		void *param);
+static int queue_file_copy(pool_cp_t *cp, const char full_path[]);
+static int remember_dir_mode(pool_cp_t *cp, const char full_path[]);
 static VisitResult cp_visitor(const char full_path[], VisitAction action,
 		void *param);
 static int is_file(const char path[]);
@@ -49,6 +78,7 @@ static VisitResult mv_visitor(const char full_path[], VisitAction action,
 		void *param);
 static VisitResult cp_mv_visitor(const char full_path[], VisitAction action,
 		void *param, int cp);
+static char * make_dst_path(const io_args_t *args, const char full_path[]);
 
 int
 ior_rm(io_args_t *const args)
@@ -134,9 +164,136 @@ ior_cp(io_args_t *const args)
 		}
 	}
 
+	if(args->parallelism > 1)
+	{
+		return cp_concurrently(args);
+	}
+
 	return traverse(src, &cp_visitor, args);
 }
 
+/* Copies subtree using several threads.  Directories are created before their
+ * contents by the traversing thread, files are copied by a pool of workers and
+ * permissions of directories are set after all files are copied.  Returns 0 on
+ * success, otherwise non-zero is returned. */
+static int
+cp_concurrently(io_args_t *args)
+{
+	size_t i;
+	int result;
+	pool_cp_t cp = { .args = args, .pool = NULL, .dirs = NULL, .ndirs = 0U };
+
+	result = traverse(args->arg1.src, &pool_cp_visitor, &cp);
+
+	if(cp.pool != NULL)
+	{
+		result |= iopool_wait(cp.pool);
+		iopool_free(cp.pool);
+	}
+
+	for(i = 0U; i < cp.ndirs; ++i)
+	{
+		result |= (os_chmod(cp.dirs[i].path, cp.dirs[i].mode & 07777) != 0);
+		free(cp.dirs[i].path);
+	}
+	free(cp.dirs);
+
+	return result;
+}
+
+/* Implementation of traverse() visitor for concurrent subtree copying.  Returns
+ * 0 on success, otherwise non-zero is returned. */
+static VisitResult
+pool_cp_visitor(const char full_path[], VisitAction action, void *param)
+{
+	pool_cp_t *const cp = param;
+
+	if(cp->args->cancellable && ui_cancellation_requested())
+	{
+		return VR_CANCELLED;
+	}
+
+	if(cp->pool != NULL)
+	{
+		iopool_flush(cp->pool);
+	}
+
+	switch(action)
+	{
+		case VA_DIR_ENTER:
+			break;
+		case VA_FILE:
+			if(is_symlink(full_path) || get_file_size(full_path) < INLINE_COPY_SIZE)
+			{
+				return (queue_file_copy(cp, full_path) == 0) ? VR_OK : VR_ERROR;
+			}
+			break;
+		case VA_DIR_LEAVE:
+			return (remember_dir_mode(cp, full_path) == 0) ? VR_OK : VR_ERROR;
+	}
+
+	return cp_mv_visitor(full_path, action, cp->args, 1);
+}
+
+/* Hands copying of a file over to the pool creating it if needed.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+queue_file_copy(pool_cp_t *cp, const char full_path[])
+{
+	int result;
+	char *dst;
+
+	if(cp->pool == NULL)
+	{
+		cp->pool = iopool_create(cp->args->parallelism, cp->args->cancellable,
+				cp->args->estim);
+		if(cp->pool == NULL)
+		{
+			return cp_mv_visitor(full_path, VA_FILE, cp->args, 1) != VR_OK;
+		}
+	}
+
+	dst = make_dst_path(cp->args, full_path);
+	if(dst == NULL)
+	{
+		return 1;
+	}
+
+	result = iopool_cp(cp->pool, full_path, dst, cp->args->arg3.crs);
+	free(dst);
+	return result;
+}
+
+/* Records mode of the directory to be applied to its copy at the end.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+remember_dir_mode(pool_cp_t *cp, const char full_path[])
+{
+	struct stat st;
+	dir_mode_t *dirs;
+
+	if(os_stat(full_path, &st) != 0)
+	{
+		return 1;
+	}
+
+	dirs = realloc(cp->dirs, (cp->ndirs + 1U)*sizeof(*dirs));
+	if(dirs == NULL)
+	{
+		return 1;
+	}
+	cp->dirs = dirs;
+
+	dirs[cp->ndirs].path = make_dst_path(cp->args, full_path);
+	if(dirs[cp->ndirs].path == NULL)
+	{
+		return 1;
+	}
+	dirs[cp->ndirs].mode = st.st_mode;
+	++cp->ndirs;
+	return 0;
+}
+
 /* Implementation of traverse() visitor for subtree copying.  Returns 0 on
  * success, otherwise non-zero is returned. */
 static VisitResult
@@ -266,21 +423,19 @@ static VisitResult
 cp_mv_visitor(const char full_path[], VisitAction action, void *param, int cp)
 {
 	const io_args_t *const cp_args = param;
-	const char *dst_full_path;
-	char *free_me = NULL;
+	char *dst_full_path;
 	VisitResult result = VR_OK;
-	const char *rel_part;
 
 	if(cp_args->cancellable && ui_cancellation_requested())
 	{
 		return VR_CANCELLED;
 	}
 
-	/* TODO: come up with something better than this. */
-	rel_part = full_path + strlen(cp_args->arg1.src);
-	dst_full_path = (rel_part[0] == '\0')
-	              ? cp_args->arg2.dst
-	              : (free_me = format_str("%s/%s", cp_args->arg2.dst, rel_part));
+	dst_full_path = make_dst_path(cp_args, full_path);
+	if(dst_full_path == NULL)
+	{
+		return VR_ERROR;
+	}
 
 	switch(action)
 	{
@@ -338,10 +493,22 @@ cp_mv_visitor(const char full_path[], VisitAction action, void *param, int cp)
 			}
 	}
 
-	free(free_me);
+	free(dst_full_path);
 
 	return result;
 }
 
+/* Maps path inside source subtree to corresponding path inside destination
+ * subtree.  Returns newly allocated string or NULL on error. */
+static char *
+make_dst_path(const io_args_t *args, const char full_path[])
+{
+	/* TODO: come up with something better than this. */
+	const char *const rel_part = full_path + strlen(args->arg1.src);
+	return (rel_part[0] == '\0')
+	     ? strdup(args->arg2.dst)
+	     : format_str("%s/%s", args->arg2.dst, rel_part);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
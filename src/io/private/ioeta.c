@@ -64,8 +64,13 @@ ioeta_update(ioeta_estim_t *estim, const char path[], int finished,
 		return;
 	}
 
+	ioeta_sync(estim);
+
+	/* Totals are allowed to lag behind while background estimation is in
+	 * progress, it will catch up. */
+
 	estim->current_byte += bytes;
-	if(estim->current_byte > estim->total_bytes)
+	if(estim->current_byte > estim->total_bytes && !estim->estimating)
 	{
 		/* Estimation are out of date, update them. */
 		estim->total_bytes = estim->current_byte;
@@ -74,7 +79,7 @@ ioeta_update(ioeta_estim_t *estim, const char path[], int finished,
 	if(finished)
 	{
 		++estim->current_item;
-		if(estim->current_item > estim->total_items)
+		if(estim->current_item > estim->total_items && !estim->estimating)
 		{
 			/* Estimation are out of date, update them. */
 			estim->total_items = estim->current_item;
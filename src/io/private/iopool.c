@@ -0,0 +1,365 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "iopool.h"
+
+#include <pthread.h>
+
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* strdup() */
+#include <sys/time.h> /* gettimeofday() timeval */
+#include <time.h> /* timespec */
+
+#include "../../utils/fs.h"
+#include "../../utils/str.h"
+#include "../ioc.h"
+#include "../ioeta.h"
+#include "../iop.h"
+#include "ioeta.h"
+
+/* Maximum number of workers in a pool. */
+#define MAX_WORKERS 64
+
+/* Number of queued copies per worker. */
+#define QUEUE_PER_WORKER 8
+
+/* How often owner of the pool wakes up to report progress while waiting, in
+ * milliseconds. */
+#define FLUSH_PERIOD 100
+
+/* Single copy operation. */
+typedef struct
+{
+	char *src; /* Source file. */
+	char *dst; /* Destination file. */
+	IoCrs crs; /* Conflict resolution strategy. */
+}
+job_t;
+
+struct iopool_t
+{
+	ioeta_estim_t *estim; /* Where to report progress to, can be NULL. */
+	int cancellable;      /* Whether copies can be cancelled. */
+
+	pthread_t workers[MAX_WORKERS]; /* Worker threads. */
+	int nworkers;                   /* Number of started workers. */
+
+	pthread_mutex_t lock;   /* Protects all fields below. */
+	pthread_cond_t queued;  /* Signaled when a job is queued or on stop. */
+	pthread_cond_t done;    /* Signaled when a job is finished. */
+	job_t *jobs;            /* Ring buffer of queued jobs. */
+	size_t capacity;        /* Number of elements in the jobs. */
+	size_t head;            /* Index of the first queued job. */
+	size_t count;           /* Number of queued jobs. */
+	int active;             /* Number of jobs being processed. */
+	int failed;             /* Whether any of jobs has failed. */
+	int stop;               /* Whether workers should exit. */
+	size_t finished;        /* Number of finished, but unreported jobs. */
+	uint64_t bytes;         /* Size of finished, but unreported jobs. */
+	char *last;             /* Path of the last finished job or NULL. */
+};
+
+static void * worker_thread(void *arg);
+static void run_job(iopool_t *pool, job_t *job);
+static void wait_done(iopool_t *pool);
+
+iopool_t *
+iopool_create(int nworkers, int cancellable, ioeta_estim_t *estim)
+{
+	int i;
+
+	iopool_t *const pool = malloc(sizeof(*pool));
+	if(pool == NULL)
+	{
+		return NULL;
+	}
+
+	if(nworkers > MAX_WORKERS)
+	{
+		nworkers = MAX_WORKERS;
+	}
+
+	pool->capacity = nworkers*QUEUE_PER_WORKER;
+	pool->jobs = calloc(pool->capacity, sizeof(*pool->jobs));
+	if(pool->jobs == NULL)
+	{
+		free(pool);
+		return NULL;
+	}
+
+	pool->estim = estim;
+	pool->cancellable = cancellable;
+	pool->head = 0U;
+	pool->count = 0U;
+	pool->active = 0;
+	pool->failed = 0;
+	pool->stop = 0;
+	pool->finished = 0U;
+	pool->bytes = 0U;
+	pool->last = NULL;
+	(void)pthread_mutex_init(&pool->lock, NULL);
+	(void)pthread_cond_init(&pool->queued, NULL);
+	(void)pthread_cond_init(&pool->done, NULL);
+
+	pool->nworkers = 0;
+	for(i = 0; i < nworkers; ++i)
+	{
+		if(pthread_create(&pool->workers[pool->nworkers], NULL, &worker_thread,
+					pool) == 0)
+		{
+			++pool->nworkers;
+		}
+	}
+
+	if(pool->nworkers == 0)
+	{
+		iopool_free(pool);
+		return NULL;
+	}
+
+	return pool;
+}
+
+int
+iopool_cp(iopool_t *pool, const char src[], const char dst[], IoCrs crs)
+{
+	job_t job = { .src = strdup(src), .dst = strdup(dst), .crs = crs };
+	int failed;
+
+	if(job.src == NULL || job.dst == NULL)
+	{
+		free(job.src);
+		free(job.dst);
+		return 1;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	while(!pool->failed && pool->count == pool->capacity)
+	{
+		pthread_mutex_unlock(&pool->lock);
+		iopool_flush(pool);
+		pthread_mutex_lock(&pool->lock);
+		if(!pool->failed && pool->count == pool->capacity)
+		{
+			wait_done(pool);
+		}
+	}
+
+	failed = pool->failed;
+	if(!failed)
+	{
+		pool->jobs[(pool->head + pool->count)%pool->capacity] = job;
+		++pool->count;
+		pthread_cond_signal(&pool->queued);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	if(failed)
+	{
+		free(job.src);
+		free(job.dst);
+	}
+	return failed;
+}
+
+void
+iopool_flush(iopool_t *pool)
+{
+	size_t finished;
+	uint64_t bytes;
+	char *last;
+
+	pthread_mutex_lock(&pool->lock);
+	finished = pool->finished;
+	bytes = pool->bytes;
+	last = pool->last;
+	pool->finished = 0U;
+	pool->bytes = 0U;
+	pool->last = NULL;
+	pthread_mutex_unlock(&pool->lock);
+
+	if(finished != 0U)
+	{
+		ioeta_update(pool->estim, last, 0, bytes);
+		while(finished-- != 0U)
+		{
+			ioeta_update(pool->estim, NULL, 1, 0);
+		}
+	}
+
+	free(last);
+}
+
+int
+iopool_wait(iopool_t *pool)
+{
+	int failed;
+
+	pthread_mutex_lock(&pool->lock);
+	while(pool->count != 0U || pool->active != 0)
+	{
+		pthread_mutex_unlock(&pool->lock);
+		iopool_flush(pool);
+		pthread_mutex_lock(&pool->lock);
+		if(pool->count != 0U || pool->active != 0)
+		{
+			wait_done(pool);
+		}
+	}
+	failed = pool->failed;
+	pthread_mutex_unlock(&pool->lock);
+
+	iopool_flush(pool);
+	return failed;
+}
+
+void
+iopool_free(iopool_t *pool)
+{
+	int i;
+
+	if(pool == NULL)
+	{
+		return;
+	}
+
+	(void)iopool_wait(pool);
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->queued);
+	pthread_mutex_unlock(&pool->lock);
+
+	for(i = 0; i < pool->nworkers; ++i)
+	{
+		(void)pthread_join(pool->workers[i], NULL);
+	}
+
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->queued);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->last);
+	free(pool->jobs);
+	free(pool);
+}
+
+/* Entry point of a worker thread.  Returns NULL. */
+static void *
+worker_thread(void *arg)
+{
+	iopool_t *const pool = arg;
+
+	pthread_mutex_lock(&pool->lock);
+	while(1)
+	{
+		job_t job;
+
+		while(pool->count == 0U && !pool->stop)
+		{
+			pthread_cond_wait(&pool->queued, &pool->lock);
+		}
+		if(pool->count == 0U)
+		{
+			break;
+		}
+
+		job = pool->jobs[pool->head];
+		pool->head = (pool->head + 1U)%pool->capacity;
+		--pool->count;
+		++pool->active;
+
+		pthread_mutex_unlock(&pool->lock);
+		run_job(pool, &job);
+		pthread_mutex_lock(&pool->lock);
+
+		--pool->active;
+		pthread_cond_broadcast(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+/* Performs the job unless an error has already occurred and accounts for its
+ * result.  Frees resources of the job. */
+static void
+run_job(iopool_t *pool, job_t *job)
+{
+	io_args_t args =
+	{
+		.arg1.src = job->src,
+		.arg2.dst = job->dst,
+		.arg3.crs = job->crs,
+
+		.cancellable = pool->cancellable,
+	};
+	uint64_t size;
+	int failed;
+
+	pthread_mutex_lock(&pool->lock);
+	failed = pool->failed;
+	pthread_mutex_unlock(&pool->lock);
+
+	if(!failed)
+	{
+		/* Same as ioeta_add_file() does. */
+		size = is_symlink(job->src) ? 0U : get_file_size(job->src);
+		failed = (iop_cp(&args) != 0);
+
+		pthread_mutex_lock(&pool->lock);
+		if(failed)
+		{
+			pool->failed = 1;
+		}
+		else
+		{
+			++pool->finished;
+			pool->bytes += size;
+			replace_string(&pool->last, job->src);
+		}
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	free(job->src);
+	free(job->dst);
+}
+
+/* Waits for a job to finish for at most FLUSH_PERIOD milliseconds.  Must be
+ * called with pool->lock held. */
+static void
+wait_done(iopool_t *pool)
+{
+	struct timeval tv;
+	struct timespec deadline;
+
+	(void)gettimeofday(&tv, NULL);
+	deadline.tv_sec = tv.tv_sec;
+	deadline.tv_nsec = tv.tv_usec*1000L + FLUSH_PERIOD*1000000L;
+	if(deadline.tv_nsec >= 1000000000L)
+	{
+		++deadline.tv_sec;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	(void)pthread_cond_timedwait(&pool->done, &pool->lock, &deadline);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
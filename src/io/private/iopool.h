@@ -0,0 +1,57 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__IO__PRIVATE__IOPOOL_H__
+#define VIFM__IO__PRIVATE__IOPOOL_H__
+
+#include "../ioc.h"
+#include "../ioeta.h"
+
+/* iopool - bounded pool of threads that copy independent files concurrently.
+ *
+ * Workers don't report progress on their own, instead results of finished
+ * copies are handed over to the estim by the thread that owns the pool, so
+ * progress callbacks are always invoked by that thread. */
+
+/* Opaque pool type. */
+typedef struct iopool_t iopool_t;
+
+/* Starts nworkers threads.  The estim can be NULL.  Returns the pool or NULL on
+ * error. */
+iopool_t * iopool_create(int nworkers, int cancellable, ioeta_estim_t *estim);
+
+/* Queues copying of src file to dst.  Blocks while the queue is full.  Returns
+ * zero on success and non-zero if one of previous copies has failed, in which
+ * case nothing is queued. */
+int iopool_cp(iopool_t *pool, const char src[], const char dst[], IoCrs crs);
+
+/* Passes progress of finished copies to the estim. */
+void iopool_flush(iopool_t *pool);
+
+/* Waits until all queued copies are finished.  Returns zero if all of them
+ * succeeded, otherwise non-zero is returned. */
+int iopool_wait(iopool_t *pool);
+
+/* Waits for queued copies, stops workers and frees the pool.  The pool can be
+ * NULL. */
+void iopool_free(iopool_t *pool);
+
+#endif /* VIFM__IO__PRIVATE__IOPOOL_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -35,9 +35,22 @@ ipc_check(void)
 {
 }
 
-void
+int
+ipc_get_fds(int fds[], int max)
+{
+	return 0;
+}
+
+int
+ipc_has_clients(void)
+{
+	return 0;
+}
+
+int
 ipc_send(char *data[])
 {
+	return -1;
 }
 
 int
@@ -57,42 +70,120 @@ ipc_enabled(void)
 #ifdef _WIN32
 #include <winsock2.h>
 #else
-#include <arpa/inet.h>
-#include <netinet/in.h>
-#include <sys/socket.h>
-#include <sys/un.h>
+#include <arpa/inet.h> /* htonl() ntohl() */
+#include <sys/socket.h> /* AF_UNIX SOCK_STREAM accept() bind() connect() listen()
+                           recv() send() socket() */
+#include <sys/stat.h> /* S_ISDIR stat lstat() mkdir() */
+#include <sys/un.h> /* sockaddr_un */
+#include <fcntl.h> /* FD_CLOEXEC F_GETFL F_SETFD F_SETFL O_NONBLOCK fcntl() */
 #endif
-#include <sys/types.h>
-#include <unistd.h> /* getcwd() */
+#include <sys/types.h> /* pid_t */
+#include <unistd.h> /* close() getcwd() getpid() getuid() unlink() */
 
 #include <assert.h> /* assert() */
-#include <errno.h>
+#include <errno.h> /* EADDRINUSE EAGAIN ECONNREFUSED EEXIST EINTR EWOULDBLOCK
+                      errno */
 #include <stddef.h> /* NULL size_t ssize_t */
-#include <stdlib.h>
-#include <string.h> /* strlen() strcpy() */
-
+#include <stdint.h> /* uint32_t */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* atexit() free() malloc() */
+#include <string.h> /* memcpy() memset() strcpy() strlen() */
+#include <time.h> /* time_t time() */
+
+#include "utils/env.h"
+#include "utils/fs_limits.h"
 #include "utils/log.h"
-#include "utils/macros.h"
-#ifdef _WIN32
 #include "utils/path.h"
-#endif
+#include "utils/str.h"
 #include "utils/string_array.h"
-#include "utils/utils.h"
 #include "status.h"
 
+/* Messages are sent over a stream socket as frames, each of which consists of
+ * 32-bit length of payload in network byte order followed by the payload.
+ * Client sends a single frame with working directory and arguments as
+ * sequence of null-terminated strings, server replies with a frame that
+ * contains 32-bit result of processing the arguments.  Server listens on a
+ * Unix domain socket that is accessible only to the user that started it (on
+ * Windows TCP connection to loopback interface is used instead, which any local
+ * user can connect to).
+ *
+ * Server never blocks on clients: requests are received in parts as data
+ * arrives and are processed once they are complete. */
+
+#ifdef _WIN32
+/* Port number on loopback interface that is used by the server. */
 #define PORT 31230
+#endif
+
+/* Maximum size of payload of a frame, larger frames are rejected before memory
+ * is allocated for them. */
+#define MAX_FRAME_LEN (4U*1024U*1024U)
+
+/* Maximum number of clients whose requests are being received at the same time,
+ * other clients wait to be accepted. */
+#define MAX_CLIENTS (IPC_MAX_FDS - 1)
+
+/* Number of seconds client has to send its request, which keeps misbehaving
+ * clients from occupying slots. */
+#define CLIENT_TIMEOUT 5
+
+/* Maximum number of requests processed by a single ipc_check() call, the rest
+ * waits for the next call. */
+#define MAX_REQUESTS_PER_CHECK 4
+
+#ifndef _WIN32
+typedef struct sockaddr_un addr_t;
+#else
+typedef struct sockaddr_in addr_t;
+#endif
+
+/* Connection of a client, whose request is being received. */
+typedef struct
+{
+	int fd;            /* Socket of the connection. */
+	time_t deadline;   /* Time by which request should be received. */
+	uint32_t header;   /* Length of the request in network byte order. */
+	size_t header_got; /* Number of received bytes of the header. */
+	char *data;        /* Payload of the request, allocated after the header. */
+	size_t len;        /* Length of the payload. */
+	size_t got;        /* Number of received bytes of the payload. */
+}
+client_t;
 
 static void clean_at_exit(void);
-static void try_become_a_server(void);
+static void try_become_a_server(int remove_stale);
 static int create_socket(void);
 static void close_socket(void);
-static void receive_data(void);
-static void parse_data(const char *buf);
+static void close_fd(int fd);
+static int make_addr(addr_t *addr);
+#ifndef _WIN32
+static int get_socket_path(char buf[], size_t buf_len);
+static int is_stale_socket(const addr_t *addr);
+#endif
+static void set_nonblocking(int fd);
+static void accept_clients(void);
+static int recv_request(client_t *client);
+static void reply_to_client(client_t *client);
+static void drop_client(int i);
+static int would_block(void);
+static int parse_data(const char buf[], size_t len);
+static char * format_request(char *data[], size_t *len);
+static int send_frame(int fd, const char data[], size_t len);
+static char * recv_frame(int fd, size_t *len);
+static int send_all(int fd, const char data[], size_t len);
+static int recv_all(int fd, char data[], size_t len);
 
 static recieve_callback callback;
 static int initialized;
 static int server;
 static int sock = -1;
+/* Clients whose requests are being received. */
+static client_t clients[MAX_CLIENTS];
+static int nclients;
+#ifndef _WIN32
+/* Process that created socket file and should remove it on exit. */
+static pid_t server_pid;
+#endif
 
 void
 ipc_pre_init(void)
@@ -132,7 +223,7 @@ ipc_init(recieve_callback callback_func)
 		return;
 	}
 
-	try_become_a_server();
+	try_become_a_server(1);
 
 	atexit(&clean_at_exit);
 	initialized = 1;
@@ -141,6 +232,18 @@ ipc_init(recieve_callback callback_func)
 static void
 clean_at_exit(void)
 {
+#ifndef _WIN32
+	/* Children of this process shouldn't remove the socket of the parent. */
+	if(server && server_pid == getpid())
+	{
+		addr_t addr;
+		if(make_addr(&addr) == 0)
+		{
+			(void)unlink(addr.sun_path);
+		}
+	}
+#endif
+
 	close_socket();
 #ifdef _WIN32
 	WSACleanup();
@@ -150,65 +253,131 @@ clean_at_exit(void)
 void
 ipc_check(void)
 {
-	fd_set ready;
-	int maxfd;
-	struct timeval ts = { 0, 0 };
+	/* Processing of a request can lead to a nested call, which shouldn't touch
+	 * clients that are being processed. */
+	static int checking;
+
+	time_t now;
+	int nrequests;
+	int i;
 
 	assert(initialized);
-	if(initialized < 0)
+	if(initialized < 0 || checking)
 		return;
 
-	try_become_a_server();
+	try_become_a_server(0);
 	if(!server)
 		return;
 
-	FD_ZERO(&ready);
-	if(sock >= 0)
-		FD_SET(sock, &ready);
-	maxfd = MAX(sock, 0);
+	checking = 1;
 
-	if(select(maxfd + 1, &ready, NULL, NULL, &ts) > 0)
-		receive_data();
+	accept_clients();
+
+	now = time(NULL);
+	nrequests = 0;
+	i = 0;
+	while(i < nclients)
+	{
+		const int state = recv_request(&clients[i]);
+		if(state > 0 && nrequests < MAX_REQUESTS_PER_CHECK)
+		{
+			client_t client = clients[i];
+			drop_client(i);
+			reply_to_client(&client);
+			close_fd(client.fd);
+			free(client.data);
+			++nrequests;
+		}
+		else if(state < 0 || (state == 0 && now >= clients[i].deadline))
+		{
+			LOG_ERROR_MSG("Can't read IPC request");
+			close_fd(clients[i].fd);
+			free(clients[i].data);
+			drop_client(i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	checking = 0;
 }
 
+int
+ipc_get_fds(int fds[], int max)
+{
+	int i;
+	int n = 0;
+
+	if(initialized <= 0 || !server)
+		return 0;
+
+	/* Pending clients can't be accepted until there is a free slot. */
+	if(nclients < MAX_CLIENTS && n < max)
+	{
+		fds[n++] = sock;
+	}
+	for(i = 0; i < nclients && n < max; ++i)
+	{
+		fds[n++] = clients[i].fd;
+	}
+	return n;
+}
+
+int
+ipc_has_clients(void)
+{
+	return nclients != 0;
+}
+
+/* Tries to start listening for clients.  Socket file left by a server that
+ * didn't exit cleanly is removed when remove_stale is non-zero. */
 static void
-try_become_a_server(void)
+try_become_a_server(int remove_stale)
 {
-	struct sockaddr_in addr;
-#ifdef _WIN32
-	BOOL yes = TRUE;
-#else
-	int yes = 1;
-#endif
+	addr_t addr;
 
-	if(server)
+	if(server || sock == -1)
 		return;
 
-#ifdef _WIN32
-	if(setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char *)&yes,
-			sizeof(yes)) != 0)
-#else
-	if(setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) != 0)
+	if(make_addr(&addr) != 0)
+		return;
+
+	server = bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != -1;
+#ifndef _WIN32
+	if(!server && errno == EADDRINUSE && remove_stale && is_stale_socket(&addr))
+	{
+		(void)unlink(addr.sun_path);
+		server = bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != -1;
+	}
 #endif
+
+	if(server && listen(sock, SOMAXCONN) != 0)
 	{
-		LOG_SERROR_MSG(errno, "Can't set reusable option on a socket");
+		LOG_SERROR_MSG(errno, "Can't listen on a socket");
+#ifndef _WIN32
+		(void)unlink(addr.sun_path);
+#endif
+		close_socket();
+		server = 0;
+		return;
 	}
 
-	addr.sin_family = AF_INET;
-	addr.sin_addr.s_addr = inet_addr("127.0.0.1");
-	addr.sin_port = htons(PORT);
-	server = bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != -1;
 	if(!server)
 	{
 		if(curr_stats.load_stage < 3)
 		{
 			LOG_SERROR_MSG(errno, "Can't become an IPC server");
 		}
+		return;
 	}
-	else
-	{
-		LOG_INFO_MSG("Successfully became an IPC server");
-	}
+
+#ifndef _WIN32
+	server_pid = getpid();
+#endif
+	set_nonblocking(sock);
+	LOG_INFO_MSG("Successfully became an IPC server");
 }
 
 /* Returns zero on success. */
@@ -218,11 +387,21 @@ create_socket(void)
 	if(sock != -1)
 		return 0;
 
-	sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#ifndef _WIN32
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+#else
+	sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+#endif
 	if(sock == -1)
 	{
 		LOG_ERROR_MSG("Can't create socket");
 	}
+#ifndef _WIN32
+	else
+	{
+		(void)fcntl(sock, F_SETFD, FD_CLOEXEC);
+	}
+#endif
 	return sock == -1;
 }
 
@@ -231,88 +410,481 @@ close_socket(void)
 {
 	if(sock != -1)
 	{
+		close_fd(sock);
+		sock = -1;
+	}
+}
+
+/* Closes socket descriptor. */
+static void
+close_fd(int fd)
+{
 #ifdef _WIN32
-		closesocket(sock);
+	closesocket(fd);
 #else
-		close(sock);
+	close(fd);
 #endif
-		sock = -1;
+}
+
+/* Fills in address of the server.  Returns zero on success, otherwise non-zero
+ * is returned. */
+static int
+make_addr(addr_t *addr)
+{
+	memset(addr, 0, sizeof(*addr));
+#ifndef _WIN32
+	addr->sun_family = AF_UNIX;
+	return get_socket_path(addr->sun_path, sizeof(addr->sun_path));
+#else
+	addr->sin_family = AF_INET;
+	addr->sin_addr.s_addr = inet_addr("127.0.0.1");
+	addr->sin_port = htons(PORT);
+	return 0;
+#endif
+}
+
+#ifndef _WIN32
+
+/* Forms path to the socket of current user, creating private directory for it
+ * if needed.  Returns zero on success, otherwise non-zero is returned. */
+static int
+get_socket_path(char buf[], size_t buf_len)
+{
+	char dir[PATH_MAX];
+	struct stat st;
+	const char *const runtime_dir = env_get("XDG_RUNTIME_DIR");
+
+	if(runtime_dir != NULL && runtime_dir[0] != '\0')
+	{
+		/* This directory is private to the user by specification. */
+		copy_str(dir, sizeof(dir), runtime_dir);
 	}
+	else
+	{
+		snprintf(dir, sizeof(dir), "%s/vifm-%lu", get_tmpdir(),
+				(unsigned long)getuid());
+		if(mkdir(dir, 0700) != 0 && errno != EEXIST)
+		{
+			LOG_SERROR_MSG(errno, "Can't create directory for IPC socket");
+			return 1;
+		}
+
+		/* Directory in a shared location might have been created by someone
+		 * else. */
+		if(lstat(dir, &st) != 0 || !S_ISDIR(st.st_mode) ||
+				st.st_uid != getuid() || (st.st_mode & 077) != 0)
+		{
+			LOG_ERROR_MSG("Directory for IPC socket isn't private: %s", dir);
+			return 1;
+		}
+	}
+
+	if((size_t)snprintf(buf, buf_len, "%s/vifm-ipc", dir) >= buf_len)
+	{
+		LOG_ERROR_MSG("Path to IPC socket is too long");
+		return 1;
+	}
+	return 0;
+}
+
+/* Checks whether socket file isn't used by a server anymore.  Returns non-zero
+ * if so, otherwise zero is returned. */
+static int
+is_stale_socket(const addr_t *addr)
+{
+	int stale;
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd == -1)
+	{
+		return 0;
+	}
+
+	stale = connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) != 0
+	     && errno == ECONNREFUSED;
+	close(fd);
+	return stale;
 }
 
-/* Receives data from the socket, parses it and executes commands. */
+#endif
+
+/* Makes operations on the socket non-blocking. */
 static void
-receive_data(void)
+set_nonblocking(int fd)
 {
-	char buf[8192];
-	const ssize_t nread = recv(sock, buf, sizeof(buf), 0);
-	if(nread == -1)
+#ifndef _WIN32
+	const int flags = fcntl(fd, F_GETFL);
+	if(flags != -1)
 	{
-		LOG_ERROR_MSG("Can't read socket data");
+		(void)fcntl(fd, F_SETFL, flags | O_NONBLOCK);
 	}
-	else if(nread != 0)
+#else
+	u_long nonblocking = 1;
+	(void)ioctlsocket(fd, FIONBIO, &nonblocking);
+#endif
+}
+
+/* Accepts waiting clients while there are free slots for them. */
+static void
+accept_clients(void)
+{
+	while(nclients < MAX_CLIENTS)
+	{
+		client_t *client;
+		const int fd = accept(sock, NULL, NULL);
+		if(fd == -1)
+		{
+			break;
+		}
+
+#ifndef _WIN32
+		(void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+		set_nonblocking(fd);
+
+		client = &clients[nclients++];
+		memset(client, 0, sizeof(*client));
+		client->fd = fd;
+		client->deadline = time(NULL) + CLIENT_TIMEOUT;
+	}
+}
+
+/* Receives data of the client that is available without blocking.  Returns
+ * positive number when request is complete, zero if more data is expected and
+ * negative number on error. */
+static int
+recv_request(client_t *client)
+{
+	while(1)
 	{
-		assert(buf[nread - 1] == '\0' && "Received data should end with \\0.");
-		parse_data(buf);
+		char *dst;
+		size_t size;
+		ssize_t n;
+
+		if(client->header_got < sizeof(client->header))
+		{
+			dst = (char *)&client->header + client->header_got;
+			size = sizeof(client->header) - client->header_got;
+		}
+		else
+		{
+			if(client->data == NULL)
+			{
+				client->len = ntohl(client->header);
+				if(client->len > MAX_FRAME_LEN)
+				{
+					LOG_ERROR_MSG("IPC request is too big: %lu",
+							(unsigned long)client->len);
+					return -1;
+				}
+				client->data = malloc(client->len + 1);
+				if(client->data == NULL)
+				{
+					return -1;
+				}
+			}
+
+			if(client->got == client->len)
+			{
+				return 1;
+			}
+			dst = client->data + client->got;
+			size = client->len - client->got;
+		}
+
+		n = recv(client->fd, dst, size, 0);
+		if(n == 0)
+		{
+			return -1;
+		}
+		if(n < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			return would_block() ? 0 : -1;
+		}
+
+		if(client->header_got < sizeof(client->header))
+		{
+			client->header_got += n;
+		}
+		else
+		{
+			client->got += n;
+		}
 	}
 }
 
+/* Processes complete request of the client and sends back the result. */
 static void
-parse_data(const char *buf)
+reply_to_client(client_t *client)
+{
+	const uint32_t result =
+		htonl((uint32_t)parse_data(client->data, client->len));
+
+	/* Socket buffer of a new connection has more than enough room for the
+	 * reply, so it's sent without blocking. */
+	if(send_frame(client->fd, (const char *)&result, sizeof(result)) != 0)
+	{
+		LOG_ERROR_MSG("Can't send IPC reply");
+	}
+}
+
+/* Removes i-th element of the clients array without freeing its resources. */
+static void
+drop_client(int i)
+{
+	clients[i] = clients[--nclients];
+}
+
+/* Checks whether last socket operation failed because it would block.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+would_block(void)
+{
+#ifndef _WIN32
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+#else
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#endif
+}
+
+/* Splits payload of a request into arguments and passes them to the callback.
+ * Returns result of the callback or -1 for malformed requests. */
+static int
+parse_data(const char buf[], size_t len)
 {
 	char **array = NULL;
-	size_t len = 0;
-	while(*buf != '\0')
+	size_t count = 0;
+	const char *const end = buf + len;
+	int result;
+
+	if(len == 0 || buf[len - 1] != '\0')
 	{
-		len = add_to_string_array(&array, len, 1, buf);
+		LOG_ERROR_MSG("Malformed IPC request");
+		return -1;
+	}
+
+	while(buf != end)
+	{
+		count = add_to_string_array(&array, count, 1, buf);
 		buf += strlen(buf) + 1;
 	}
-	len = put_into_string_array(&array, len, NULL);
-	callback(array);
-	free_string_array(array, len);
+	count = put_into_string_array(&array, count, NULL);
+	result = callback(array);
+	free_string_array(array, count);
+	return result;
 }
 
-void
+int
 ipc_send(char *data[])
 {
-	char buf[8192];
+	addr_t addr;
+	char *request;
+	char *reply;
 	size_t len;
-	struct sockaddr_in addr;
-	int result;
+	int fd;
+	int result = -1;
 
 	if(server)
-		return;
+		return -1;
 
 	assert(initialized || sock != -1);
 	if(initialized < 0)
-		return;
+		return -1;
+
+	if(make_addr(&addr) != 0)
+		return -1;
+
+	request = format_request(data, &len);
+	if(request == NULL)
+		return -1;
+
+#ifndef _WIN32
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+#else
+	fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+#endif
+	if(fd == -1)
+	{
+		LOG_ERROR_MSG("Can't create socket");
+		free(request);
+		return -1;
+	}
 
-	if(getcwd(buf, sizeof(buf)) == NULL)
+	if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+	{
+		/* There is no server, which is fine. */
+		LOG_INFO_MSG("Can't connect to IPC server");
+	}
+	else if(send_frame(fd, request, len) != 0)
+	{
+		LOG_ERROR_MSG("Can't send data over a socket");
+	}
+	else
+	{
+		/* Processing of the request can take a while (e.g., when it asks user a
+		 * question), so there is no timeout here. */
+		size_t reply_len;
+		reply = recv_frame(fd, &reply_len);
+		if(reply != NULL && reply_len == sizeof(uint32_t))
+		{
+			uint32_t value;
+			memcpy(&value, reply, sizeof(value));
+			result = (int)ntohl(value);
+		}
+		else
+		{
+			LOG_ERROR_MSG("Can't read IPC reply");
+		}
+		free(reply);
+	}
+
+	close_fd(fd);
+	free(request);
+	return result;
+}
+
+/* Forms payload of a request out of current working directory and the data.
+ * Returns newly allocated buffer of *len bytes or NULL on error. */
+static char *
+format_request(char *data[], size_t *len)
+{
+	char cwd[PATH_MAX];
+	char *buf;
+	size_t i;
+
+	if(getcwd(cwd, sizeof(cwd)) == NULL)
 	{
 		LOG_ERROR_MSG("Can't get working directory");
-		return;
+		return NULL;
 	}
-	len = strlen(buf) + 1;
 #ifdef _WIN32
-	to_forward_slash(buf);
+	to_forward_slash(cwd);
 #endif
 
-	while(*data != NULL)
+	*len = strlen(cwd) + 1;
+	for(i = 0; data[i] != NULL; ++i)
 	{
-		strcpy(buf + len, *data);
-		len += strlen(*data) + 1;
-		data++;
+		*len += strlen(data[i]) + 1;
 	}
-	buf[len++] = '\0';
 
-	addr.sin_family = AF_INET;
-	addr.sin_addr.s_addr = inet_addr("127.0.0.1");
-	addr.sin_port = htons(PORT);
-	result = sendto(sock, buf, len, 0, (struct sockaddr *)&addr, sizeof(addr));
-	if(result == -1)
+	buf = malloc(*len);
+	if(buf == NULL)
 	{
-		LOG_ERROR_MSG("Can't send data over a socket");
+		return NULL;
+	}
+
+	strcpy(buf, cwd);
+	*len = strlen(cwd) + 1;
+	for(i = 0; data[i] != NULL; ++i)
+	{
+		strcpy(buf + *len, data[i]);
+		*len += strlen(data[i]) + 1;
+	}
+
+	return buf;
+}
+
+/* Sends length-prefixed frame.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+send_frame(int fd, const char data[], size_t len)
+{
+	const uint32_t header = htonl((uint32_t)len);
+	if(len > MAX_FRAME_LEN)
+	{
+		LOG_ERROR_MSG("IPC frame is too big: %lu", (unsigned long)len);
+		return 1;
+	}
+	return send_all(fd, (const char *)&header, sizeof(header)) != 0
+	    || send_all(fd, data, len) != 0;
+}
+
+/* Receives length-prefixed frame.  Returns newly allocated payload of *len
+ * bytes or NULL on error. */
+static char *
+recv_frame(int fd, size_t *len)
+{
+	uint32_t header;
+	char *data;
+
+	if(recv_all(fd, (char *)&header, sizeof(header)) != 0)
+	{
+		return NULL;
+	}
+
+	*len = ntohl(header);
+	if(*len > MAX_FRAME_LEN)
+	{
+		return NULL;
 	}
+
+	data = malloc(*len + 1);
+	if(data == NULL)
+	{
+		return NULL;
+	}
+
+	if(recv_all(fd, data, *len) != 0)
+	{
+		free(data);
+		return NULL;
+	}
+
+	return data;
+}
+
+/* Sends whole buffer handling partial writes.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+send_all(int fd, const char data[], size_t len)
+{
+#ifdef MSG_NOSIGNAL
+	/* Peer might go away, which shouldn't kill this process. */
+	const int flags = MSG_NOSIGNAL;
+#else
+	const int flags = 0;
+#endif
+
+	while(len != 0)
+	{
+		const ssize_t n = send(fd, data, len, flags);
+		if(n < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			return 1;
+		}
+		data += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/* Receives exactly len bytes.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+recv_all(int fd, char data[], size_t len)
+{
+	while(len != 0)
+	{
+		const ssize_t n = recv(fd, data, len, 0);
+		if(n <= 0)
+		{
+			if(n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			return 1;
+		}
+		data += n;
+		len -= n;
+	}
+	return 0;
 }
 
 int
@@ -19,7 +19,10 @@
 #ifndef VIFM__IPC_H__
 #define VIFM__IPC_H__
 
-typedef void (*recieve_callback)(char *args[]);
+/* Processes arguments received from a client.  The first argument is working
+ * directory of the client.  Returns zero on success, otherwise non-zero is
+ * returned, which is passed back to the client. */
+typedef int (*recieve_callback)(char *args[]);
 
 /* Initializes IPC unit basic state. */
 void ipc_pre_init(void);
@@ -28,11 +31,28 @@ void ipc_pre_init(void);
  * ipc_check(). */
 void ipc_init(recieve_callback callback_func);
 
-/* Checks for incoming messages.  Calls callback passed to ipc_init(). */
+/* Checks for incoming messages without blocking.  Calls callback passed to
+ * ipc_init(). */
 void ipc_check(void);
 
-/* Sends data to server.  The data array should end with NULL. */
-void ipc_send(char *data[]);
+/* Maximum number of descriptors returned by ipc_get_fds(). */
+#define IPC_MAX_FDS 16
+
+/* Retrieves descriptors that become readable when there is incoming data for
+ * ipc_check() to process, suitable for poll().  Stores at most max descriptors
+ * into the fds array.  Returns number of stored descriptors, which is zero if
+ * current instance isn't a server. */
+int ipc_get_fds(int fds[], int max);
+
+/* Checks whether there are clients whose requests aren't received in full yet
+ * and need ipc_check() to be called even without incoming data to expire them.
+ * Returns non-zero if so, otherwise zero is returned. */
+int ipc_has_clients(void);
+
+/* Sends data to server and waits for it to be processed.  The data array
+ * should end with NULL.  Returns result of processing reported by the server or
+ * -1 if the data wasn't delivered. */
+int ipc_send(char *data[]);
 
 /* Returns non-zero value if current instance is a server. */
 int ipc_server(void);
@@ -36,12 +36,23 @@ show_jobs_menu(FileView *view)
 {
 	job_t *p;
 	int i;
+	int workers, busy, queued;
 
 	static menu_info m;
 	init_menu_info(&m, JOBS_MENU, strdup("No jobs currently running"));
-	m.title = strdup(" Pid --- Command ");
 	m.execute_handler = &execute_jobs_cb;
 
+	bg_get_executor_stats(&workers, &busy, &queued);
+	if(workers == 0)
+	{
+		m.title = strdup(" Pid --- Command ");
+	}
+	else
+	{
+		m.title = format_str(" Pid --- Command (workers: %d/%d busy, queued: %d) ",
+				busy, workers, queued);
+	}
+
 	check_background_jobs();
 
 	bg_jobs_freeze();
@@ -60,6 +71,10 @@ show_jobs_menu(FileView *view)
 			{
 				snprintf(info_buf, sizeof(info_buf), PRINTF_PID_T, p->pid);
 			}
+			else if(bg_job_is_queued(p))
+			{
+				snprintf(info_buf, sizeof(info_buf), "queued");
+			}
 			else if(p->total == BG_UNDEFINED_TOTAL)
 			{
 				snprintf(info_buf, sizeof(info_buf), "n/a");
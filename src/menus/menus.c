@@ -21,15 +21,24 @@
 
 #include <curses.h>
 
+#ifndef _WIN32
+#include <sys/types.h> /* pid_t ssize_t */
+#include <fcntl.h> /* F_GETFL F_SETFL O_NONBLOCK fcntl() */
+#include <signal.h> /* SIGINT kill() */
+#include <unistd.h> /* read() */
+#endif
+
 #include <assert.h> /* assert() */
+#include <errno.h> /* EAGAIN EINTR EWOULDBLOCK errno */
 #include <stddef.h> /* NULL size_t */
-#include <stdlib.h> /* free() malloc() */
-#include <string.h> /* memmove() memset() strdup() strcat() strncat() strchr()
-                       strlen() strrchr() */
+#include <stdlib.h> /* free() malloc() realloc() */
+#include <string.h> /* memchr() memcpy() memmove() memset() strdup() strcat()
+                       strncat() strchr() strlen() strrchr() */
 #include <wchar.h> /* wchar_t wcscmp() */
 
 #include "../cfg/config.h"
 #include "../compat/os.h"
+#include "../engine/mode.h"
 #include "../modes/dialogs/msg_dialog.h"
 #include "../modes/cmdline.h"
 #include "../modes/menu.h"
@@ -67,6 +76,39 @@ static void normalize_top(menu_info *m);
 static void append_to_string(char **str, const char suffix[]);
 static char * expand_tabulation_a(const char line[], size_t tab_stops);
 static size_t chars_in_str(const char s[], char c);
+#ifndef _WIN32
+static int read_captured_output(void);
+static void add_captured_data(const char data[], size_t len);
+static void add_captured_line(void);
+static void finish_capture(int report_errors);
+#endif
+
+#ifndef _WIN32
+
+/* Maximum number of reads of command output per single update of the menu. */
+#define MAX_CAPTURE_READS 64
+
+/* State of capturing output of an external command into a menu. */
+typedef struct
+{
+	menu_info *m;            /* Menu being populated, NULL if there is none. */
+	FileView *view;          /* View for which the menu was opened. */
+	pid_t pid;               /* Process of the command. */
+	FILE *out;               /* Output of the command. */
+	FILE *err;               /* Error stream of the command. */
+	size_t capacity;         /* Number of allocated elements of m->items. */
+	int *matches;            /* m->matches with capacity elements or NULL. */
+	size_t title_len;        /* Length of the title without status suffix. */
+	char *partial;           /* Incomplete line of output. */
+	size_t partial_len;      /* Length of incomplete line. */
+	size_t partial_capacity; /* Size of memory allocated for partial. */
+}
+capture_t;
+
+/* Menu that is being populated in background. */
+static capture_t capture;
+
+#endif
 
 static void
 show_position_in_menu(menu_info *m)
@@ -194,6 +236,15 @@ init_menu_info(menu_info *m, int menu_type, char empty_msg[])
 void
 reset_popup_menu(menu_info *m)
 {
+#ifndef _WIN32
+	/* Nobody will see the rest of the output. */
+	if(capture.m == m)
+	{
+		(void)kill(capture.pid, SIGINT);
+		finish_capture(0);
+	}
+#endif
+
 	free(m->args);
 	/* Menu elements don't always have data associated with them.  That's why we
 	 * need this check. */
@@ -588,6 +639,73 @@ normalize_top(menu_info *m)
 int
 capture_output_to_menu(FileView *view, const char cmd[], menu_info *m)
 {
+#ifndef _WIN32
+	FILE *file, *err;
+	pid_t pid;
+	int eof;
+	int cancelled;
+
+	LOG_INFO_MSG("Capturing output of the command to a menu: %s", cmd);
+
+	if(capture.m != NULL)
+	{
+		(void)kill(capture.pid, SIGINT);
+		finish_capture(0);
+	}
+
+	pid = background_and_capture((char *)cmd, &file, &err);
+	if(pid == (pid_t)-1)
+	{
+		show_error_msgf("Trouble running command", "Unable to run: %s", cmd);
+		return 0;
+	}
+
+	capture.m = m;
+	capture.view = view;
+	capture.pid = pid;
+	capture.out = file;
+	capture.err = err;
+	capture.capacity = 0U;
+	capture.matches = NULL;
+	capture.partial_len = 0U;
+	(void)fcntl(fileno(file), F_SETFL, fcntl(fileno(file), F_GETFL) | O_NONBLOCK);
+
+	show_progress("", 0);
+
+	ui_cancellation_reset();
+	ui_cancellation_enable();
+
+	/* Wait for the first line of output to have something to display, after
+	 * cancellation wait for the command to finish. */
+	do
+	{
+		wait_for_data_from(pid, file, 0);
+		show_progress("Loading menu", 1000);
+		eof = read_captured_output();
+		cancelled = ui_cancellation_requested();
+	}
+	while(!eof && (m->len == 0 || cancelled));
+
+	ui_cancellation_disable();
+
+	if(eof)
+	{
+		finish_capture(1);
+		if(cancelled)
+		{
+			append_to_string(&m->title, "(cancelled) ");
+			append_to_string(&m->empty_msg, " (cancelled)");
+		}
+	}
+	else
+	{
+		/* Indicate that the menu is still being populated. */
+		capture.title_len = (m->title == NULL) ? 0U : strlen(m->title);
+		append_to_string(&m->title, "(running) ");
+	}
+
+	return display_menu(m, view);
+#else
 	FILE *file, *err;
 	char *line = NULL;
 	int x;
@@ -637,8 +755,223 @@ capture_output_to_menu(FileView *view, const char cmd[], menu_info *m)
 	}
 
 	return display_menu(m, view);
+#endif
 }
 
+int
+menu_check_for_updates(void)
+{
+#ifndef _WIN32
+	menu_info *const m = capture.m;
+	int old_len;
+	int eof;
+
+	if(m == NULL)
+	{
+		return 0;
+	}
+
+	old_len = m->len;
+	eof = read_captured_output();
+	if(eof)
+	{
+		finish_capture(1);
+		m->title[capture.title_len] = '\0';
+	}
+
+	if((eof || m->len != old_len) && vle_mode_is(MENU_MODE))
+	{
+		redraw_menu(m);
+	}
+
+	return !eof;
+#else
+	return 0;
+#endif
+}
+
+int
+stop_capturing_output(menu_info *m)
+{
+#ifndef _WIN32
+	if(capture.m == NULL || capture.m != m)
+	{
+		return 0;
+	}
+
+	if(kill(capture.pid, SIGINT) != 0)
+	{
+		LOG_SERROR_MSG(errno, "Failed to send SIGINT to " PRINTF_PID_T,
+				capture.pid);
+	}
+	finish_capture(0);
+
+	m->title[capture.title_len] = '\0';
+	append_to_string(&m->title, "(cancelled) ");
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+#ifndef _WIN32
+
+/* Reads output of the command that is available without blocking and appends
+ * complete lines to the menu.  Reads at most a limited amount of data per call
+ * to keep UI responsive.  Returns non-zero on end of output, otherwise zero is
+ * returned. */
+static int
+read_captured_output(void)
+{
+	char buf[4096];
+	int i;
+
+	for(i = 0; i < MAX_CAPTURE_READS; ++i)
+	{
+		const ssize_t n = read(fileno(capture.out), buf, sizeof(buf));
+		if(n > 0)
+		{
+			add_captured_data(buf, n);
+			continue;
+		}
+
+		if(n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			return 0;
+		}
+
+		/* End of output or an error. */
+		if(capture.partial_len != 0U)
+		{
+			add_captured_line();
+		}
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Splits data into lines, which are appended to the menu, remembering
+ * incomplete last line. */
+static void
+add_captured_data(const char data[], size_t len)
+{
+	while(len != 0U)
+	{
+		const char *const nl = memchr(data, '\n', len);
+		const size_t part_len = (nl == NULL) ? len : (size_t)(nl - data);
+
+		if(capture.partial_len + part_len + 1U > capture.partial_capacity)
+		{
+			const size_t new_capacity = MAX(capture.partial_capacity*2U,
+					capture.partial_len + part_len + 1U);
+			char *const partial = realloc(capture.partial, new_capacity);
+			if(partial == NULL)
+			{
+				return;
+			}
+			capture.partial = partial;
+			capture.partial_capacity = new_capacity;
+		}
+
+		memcpy(capture.partial + capture.partial_len, data, part_len);
+		capture.partial_len += part_len;
+
+		if(nl == NULL)
+		{
+			break;
+		}
+
+		add_captured_line();
+		data += part_len + 1U;
+		len -= part_len + 1U;
+	}
+}
+
+/* Appends line accumulated in capture.partial to the menu growing item storage
+ * geometrically. */
+static void
+add_captured_line(void)
+{
+	menu_info *const m = capture.m;
+	char *line;
+
+	capture.partial[capture.partial_len] = '\0';
+	capture.partial_len = 0U;
+
+	line = expand_tabulation_a(capture.partial, cfg.tab_stop);
+	if(line == NULL)
+	{
+		return;
+	}
+
+	if((size_t)m->len == capture.capacity)
+	{
+		const size_t new_capacity = (capture.capacity == 0U)
+		                          ? 64U
+		                          : capture.capacity*2U;
+		char **const items = realloc(m->items, sizeof(*items)*new_capacity);
+		if(items == NULL)
+		{
+			free(line);
+			return;
+		}
+		m->items = items;
+		capture.capacity = new_capacity;
+		capture.matches = NULL;
+	}
+
+	/* Search allocates array of matches only for items that existed at the time,
+	 * make it cover new items as well. */
+	if(m->matches != NULL && m->matches != capture.matches)
+	{
+		int *const matches = realloc(m->matches,
+				sizeof(*matches)*capture.capacity);
+		if(matches == NULL)
+		{
+			free(line);
+			return;
+		}
+		m->matches = matches;
+		capture.matches = matches;
+	}
+
+	if(m->matches != NULL)
+	{
+		m->matches[m->len] = 0;
+	}
+	m->items[m->len++] = line;
+}
+
+/* Stops capturing output of the command.  Errors of the command are reported if
+ * report_errors is non-zero. */
+static void
+finish_capture(int report_errors)
+{
+	capture.m = NULL;
+
+	fclose(capture.out);
+	if(report_errors)
+	{
+		print_errors(capture.err);
+	}
+	else
+	{
+		fclose(capture.err);
+	}
+
+	free(capture.partial);
+	capture.partial = NULL;
+	capture.partial_capacity = 0U;
+	capture.partial_len = 0U;
+}
+
+#endif
+
 /* Replaces *str with a copy of the with string extended by the suffix.  *str
  * can be NULL in which case it's treated as empty string. equal to the with (then function does nothing).  Returns non-zero if memory allocation
  * failed. */
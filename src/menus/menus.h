@@ -145,10 +145,21 @@ void print_errors(FILE *ef);
  * otherwise NULL is returned. */
 char * get_cmd_target(void);
 
-/* Runs external command and puts its output to the m menu.  Returns non-zero if
- * status bar message should be saved. */
+/* Runs external command and puts its output to the m menu.  The menu is
+ * displayed as soon as the first line of output is available, the rest is
+ * appended to it in background.  Returns non-zero if status bar message should
+ * be saved. */
 int capture_output_to_menu(FileView *view, const char cmd[], menu_info *m);
 
+/* Appends lines of output that arrived since the last call to the menu that is
+ * populated by capture_output_to_menu() and redraws it.  Returns non-zero if
+ * output is still being captured, otherwise zero is returned. */
+int menu_check_for_updates(void);
+
+/* Stops command which output is still being captured to the m menu.  Returns
+ * non-zero if there was such a command, otherwise zero is returned. */
+int stop_capturing_output(menu_info *m);
+
 /* Prepares menu, draws it and switches to the menu mode.  Returns non-zero if
  * status bar message should be saved. */
 int display_menu(menu_info *m, FileView *view);
@@ -41,7 +41,6 @@
 #include "../utils/fs.h"
 #include "../utils/fs_limits.h"
 #include "../utils/macros.h"
-#include "../utils/tree.h"
 #include "../utils/utils.h"
 #include "../filelist.h"
 #include "../file_magic.h"
@@ -133,13 +132,7 @@ redraw_file_info_dialog(void)
 	snprintf(name_buf, sizeof(name_buf), "%s",
 			view->dir_entry[view->list_pos].name);
 
-	size = 0;
-	if(view->dir_entry[view->list_pos].type == DIRECTORY)
-		tree_get_data(curr_stats.dirsize_cache,
-				view->dir_entry[view->list_pos].name, &size);
-
-	if(size == 0)
-		size = view->dir_entry[view->list_pos].size;
+	size = get_file_size_by_entry(view, view->list_pos);
 
 	size_not_precise = friendly_size_notation(size, sizeof(size_buf), size_buf);
 
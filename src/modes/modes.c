@@ -25,12 +25,14 @@
 
 #include "../engine/keys.h"
 #include "../engine/mode.h"
+#include "../menus/menus.h"
 #include "../ui/statusbar.h"
 #include "../ui/statusline.h"
 #include "../ui/ui.h"
 #include "../utils/log.h"
 #include "../utils/macros.h"
 #include "../event_loop.h"
+#include "../quickview.h"
 #include "../status.h"
 #include "dialogs/attr_dialog.h"
 #include "dialogs/change_dialog.h"
@@ -108,7 +110,7 @@ void
 modes_pre(void)
 {
 	/* Trigger possible view updates. */
-	view_check_for_updates();
+	(void)view_check_for_updates();
 
 	if(vle_mode_is(CMDLINE_MODE))
 	{
@@ -138,6 +140,23 @@ modes_pre(void)
 	}
 }
 
+int
+modes_periodic(void)
+{
+	int polling = 0;
+
+	/* Keep views that follow changing files or their indexing up to date. */
+	polling |= view_check_for_updates();
+	qv_check_for_updates();
+	polling |= menu_check_for_updates();
+	if(vle_mode_is(VIEW_MODE))
+	{
+		view_ruler_update();
+	}
+
+	return polling;
+}
+
 void
 modes_post(void)
 {
@@ -43,6 +43,11 @@ void modes_pre(void);
 
 void modes_post(void);
 
+/* Performs periodic actions while waiting for input.  Returns non-zero if some
+ * of the actions track state that doesn't signal its changes and thus should
+ * be performed again shortly, otherwise zero is returned. */
+int modes_periodic(void);
+
 void modes_redraw(void);
 
 void modes_update(void);
@@ -454,6 +454,7 @@ cmd_ctrl_b(key_info_t key_info, keys_info_t *keys_info)
 static void
 cmd_ctrl_c(key_info_t key_info, keys_info_t *keys_info)
 {
+	cancel_dir_loading(curr_view);
 	clean_selected_files(curr_view);
 	redraw_current_view();
 	curs_set(FALSE);
@@ -23,21 +23,25 @@
 #include <regex.h>
 
 #include <assert.h> /* assert() */
+#include <limits.h> /* INT_MAX */
 #include <stddef.h> /* ptrdiff_t size_t */
-#include <string.h> /* memset() strdup() */
+#include <string.h> /* memcpy() memset() strdup() */
 #include <stdio.h>  /* fclose() snprintf() */
-#include <stdlib.h> /* free() malloc() */
+#include <stdlib.h> /* free() malloc() realloc() */
 
 #include "../cfg/config.h"
 #include "../compat/os.h"
 #include "../engine/keys.h"
 #include "../engine/mode.h"
 #include "../modes/dialogs/msg_dialog.h"
+#include "../ui/cancellation.h"
 #include "../ui/statusbar.h"
 #include "../ui/ui.h"
 #include "../utils/fs.h"
 #include "../utils/fs_limits.h"
+#include "../utils/line_index.h"
 #include "../utils/macros.h"
+#include "../utils/match_index.h"
 #include "../utils/path.h"
 #include "../utils/str.h"
 #include "../utils/string_array.h"
@@ -61,6 +65,16 @@
 /* Column at which view content should be displayed. */
 #define COL 1
 
+/* Number of entries in cache of highlighted lines. */
+#define HL_CACHE_SIZE 128
+
+/* How long to wait for match index at a time before checking for Ctrl-C (in
+ * milliseconds). */
+#define SEARCH_WAIT_STEP_MS 100
+
+/* Number of lines to check between checks for Ctrl-C on scanning lines. */
+#define SEARCH_SCAN_CHUNK 1024
+
 /* Named boolean values of "silent" parameter for better readability. */
 enum
 {
@@ -68,10 +82,30 @@ enum
 	SILENT,   /* Do not display error message dialog. */
 };
 
+/* Lines searched by background thread.  They are kept outside of view_info_t,
+ * because its instances are moved around. */
+typedef struct
+{
+	char **lines;        /* Lines of the view or NULL. */
+	int nlines;          /* Number of elements in lines. */
+	line_index_t *li;    /* Index of lines of the view or NULL. */
+	li_cursor_t *cursor; /* Cursor for reading lines of the li. */
+}
+search_src_t;
+
+/* Entry of cache of highlighted lines. */
+typedef struct
+{
+	int line;   /* Number of the line. */
+	char *text; /* Line with highlighted matches or NULL for unused entry. */
+}
+hl_line_t;
+
 typedef struct
 {
 	char **lines;
 	int (*widths)[2];
+	int nwidths; /* Number of allocated elements of widths. */
 	int nlines;
 	int nlinesv;
 	int line;
@@ -89,6 +123,18 @@ typedef struct
 
 	int auto_forward;       /* Whether auto forwarding (tail -F) is enabled. */
 	timestamp_t file_mtime; /* Time stamp for auto forwarding mode. */
+
+	/* Lines of indexed file, in which case lines field is NULL and nlines
+	 * is number of lines indexed so far. */
+	line_index_t *li;
+	int follow_index;    /* Keep view at the bottom until li is complete. */
+	int follow_linev;    /* Value of linev after last scroll to the bottom. */
+
+	/* State of the last search, valid when last_search_backward isn't -1. */
+	char *pattern;                     /* Source of the re. */
+	match_index_t *mi;                 /* Lines matching the re or NULL. */
+	search_src_t *search_src;          /* Lines the mi is built from. */
+	hl_line_t hl_cache[HL_CACHE_SIZE]; /* Lines with highlighted matches. */
 }
 view_info_t;
 
@@ -108,9 +154,22 @@ static void init_view_info(view_info_t *vi);
 static void free_view_info(view_info_t *vi);
 static void redraw(void);
 static void calc_vlines(void);
-static void calc_vlines_wrapped(view_info_t *vi);
-static void calc_vlines_non_wrapped(view_info_t *vi);
+static void calc_vlines_wrapped(view_info_t *vi, int first);
+static void calc_vlines_non_wrapped(view_info_t *vi, int first);
+static int fetch_lines(view_info_t *vi, int nlines);
+static int sync_index(view_info_t *vi);
+static void trim_lines(view_info_t *vi, int nlines);
+static void add_lines(view_info_t *vi, int nlines);
+static const char * get_line(view_info_t *vi, int line);
+static int get_line_width(view_info_t *vi, int line);
+static int measure_line(const char line[]);
 static void draw(void);
+static const char * get_highlighted(view_info_t *vi, int line,
+		const char text[]);
+static void clear_hl_cache(view_info_t *vi);
+static void start_search(view_info_t *vi);
+static void stop_search(view_info_t *vi);
+static char * get_search_line(int n, void *arg);
 static int get_part(const char line[], int offset, size_t max_len, char part[]);
 static void display_error(const char error_msg[]);
 static void cmd_ctrl_l(key_info_t key_info, keys_info_t *keys_info);
@@ -160,6 +219,9 @@ static void goto_search_result(int repeat_count, int inverse_direction);
 static void search(int repeat_count, int backward);
 static void find_previous(int vline_offset);
 static void find_next(void);
+static int find_in_line(view_info_t *vi, int l, int from, int backward);
+static int get_line_end(const view_info_t *vi, int l);
+static void report_match_count(void);
 static void cmd_q(key_info_t key_info, keys_info_t *keys_info);
 static void cmd_u(key_info_t key_info, keys_info_t *keys_info);
 static void update_with_half_win(key_info_t *const key_info);
@@ -171,8 +233,13 @@ static int is_trying_the_same_file(void);
 static int get_file_to_explore(const FileView *view, char buf[],
 		size_t buf_len);
 static int forward_if_changed(view_info_t *vi);
+static int follow_index(view_info_t *vi);
+static int follow_end(view_info_t *vi);
 static int scroll_to_bottom(view_info_t *vi);
-static void reload_view(view_info_t *vi, int silent);
+static int find_match_line(view_info_t *vi, int backward);
+static int scan_for_match(view_info_t *vi, int backward);
+static int find_line_of_vline(const view_info_t *vi, int vline);
+static int reload_view(view_info_t *vi, int silent);
 
 view_info_t view_info[VI_COUNT];
 view_info_t* vi = &view_info[VI_QV];
@@ -398,7 +465,14 @@ void
 view_ruler_update(void)
 {
 	char buf[POS_WIN_MIN_WIDTH + 1];
-	snprintf(buf, sizeof(buf), "%d-%d ", vi->line + 1, vi->nlines);
+	int complete = 1;
+	if(vi->li != NULL)
+	{
+		(void)li_count(vi->li, &complete);
+	}
+	/* Marker of incomplete index takes place of the trailing space to fit. */
+	snprintf(buf, sizeof(buf), "%d-%d%c", vi->line + 1, vi->nlines,
+			complete ? ' ' : '+');
 
 	ui_ruler_set(buf);
 }
@@ -497,7 +571,17 @@ init_view_info(view_info_t *vi)
 static void
 free_view_info(view_info_t *vi)
 {
-	free_string_array(vi->lines, vi->nlines);
+	stop_search(vi);
+	free(vi->pattern);
+
+	if(vi->li != NULL)
+	{
+		li_close(vi->li);
+	}
+	else
+	{
+		free_string_array(vi->lines, vi->nlines);
+	}
 	free(vi->widths);
 	if(vi->last_search_backward != -1)
 	{
@@ -527,44 +611,194 @@ calc_vlines(void)
 	vi->width = vi->view->window_width - 1;
 	vi->wrap = cfg.wrap_quick_view;
 
+	vi->nlinesv = 0;
 	if(vi->wrap)
 	{
-		calc_vlines_wrapped(vi);
+		calc_vlines_wrapped(vi, 0);
 	}
 	else
 	{
-		calc_vlines_non_wrapped(vi);
+		calc_vlines_non_wrapped(vi, 0);
 	}
 }
 
-/* Recalculates virtual lines of a view with line wrapping. */
+/* Calculates virtual lines of a view with line wrapping starting with the
+ * first line.  Expects nlinesv to account for lines before the first one. */
 static void
-calc_vlines_wrapped(view_info_t *vi)
+calc_vlines_wrapped(view_info_t *vi, int first)
 {
 	int i;
-	vi->nlinesv = 0;
-	for(i = 0; i < vi->nlines; i++)
+
+	if(vi->li != NULL)
+	{
+		/* Widths are fetched in chunks as each access to the index involves
+		 * locking. */
+		int chunk[1024];
+		while(first < vi->nlines)
+		{
+			const int n = li_widths(vi->li, first,
+					MIN((int)ARRAY_LEN(chunk), vi->nlines - first), chunk);
+			if(n == 0)
+			{
+				break;
+			}
+
+			for(i = 0; i < n; ++i, ++first)
+			{
+				vi->widths[first][0] = vi->nlinesv++;
+				vi->widths[first][1] = chunk[i];
+				vi->nlinesv += chunk[i]/vi->width;
+			}
+		}
+	}
+
+	for(i = first; i < vi->nlines; i++)
 	{
 		vi->widths[i][0] = vi->nlinesv++;
-		vi->widths[i][1] = get_screen_string_length(vi->lines[i]) -
-			esc_str_overhead(vi->lines[i]);
+		vi->widths[i][1] = get_line_width(vi, i);
 		vi->nlinesv += vi->widths[i][1]/vi->width;
 	}
 }
 
-/* Recalculates virtual lines of a view without line wrapping. */
+/* Calculates virtual lines of a view without line wrapping starting with the
+ * first line. */
 static void
-calc_vlines_non_wrapped(view_info_t *vi)
+calc_vlines_non_wrapped(view_info_t *vi, int first)
 {
 	int i;
 	vi->nlinesv = vi->nlines;
-	for(i = 0; i < vi->nlines; i++)
+	for(i = first; i < vi->nlines; i++)
 	{
 		vi->widths[i][0] = i;
 		vi->widths[i][1] = vi->width;
 	}
 }
 
+/* Makes sure that at least nlines lines of indexed file are available waiting
+ * for the indexer if necessary.  Doesn't add more lines than requested.
+ * Returns number of available lines. */
+static int
+fetch_lines(view_info_t *vi, int nlines)
+{
+	if(vi->li != NULL && nlines > vi->nlines)
+	{
+		add_lines(vi, MIN(li_wait(vi->li, nlines), nlines));
+	}
+	return vi->nlines;
+}
+
+/* Makes lines indexed so far available without waiting.  Returns non-zero if
+ * the whole file is indexed, otherwise zero is returned. */
+static int
+sync_index(view_info_t *vi)
+{
+	int complete;
+	add_lines(vi, li_count(vi->li, &complete));
+	return complete;
+}
+
+/* Reduces number of lines of an indexed file. */
+static void
+trim_lines(view_info_t *vi, int nlines)
+{
+	if(nlines >= vi->nlines)
+	{
+		return;
+	}
+
+	vi->nlines = nlines;
+	if(vi->width > 0)
+	{
+		vi->nlinesv = vi->widths[nlines][0];
+	}
+
+	if(vi->line >= nlines)
+	{
+		vi->line = MAX(nlines - 1, 0);
+	}
+	if(vi->linev >= vi->nlinesv)
+	{
+		vi->linev = MAX(vi->nlinesv - 1, 0);
+	}
+}
+
+/* Extends number of lines of an indexed file and computes their virtual
+ * lines. */
+static void
+add_lines(view_info_t *vi, int nlines)
+{
+	const int first = vi->nlines;
+
+	if(nlines <= vi->nlines)
+	{
+		return;
+	}
+
+	if(nlines > vi->nwidths)
+	{
+		const int nwidths = MAX(vi->nwidths*2, nlines);
+		void *const widths = realloc(vi->widths, sizeof(*vi->widths)*nwidths);
+		if(widths == NULL)
+		{
+			return;
+		}
+		vi->widths = widths;
+		vi->nwidths = nwidths;
+	}
+
+	vi->nlines = nlines;
+
+	/* Virtual lines are calculated on first redraw otherwise. */
+	if(vi->width > 0)
+	{
+		if(vi->wrap)
+		{
+			calc_vlines_wrapped(vi, first);
+		}
+		else
+		{
+			calc_vlines_non_wrapped(vi, first);
+		}
+	}
+}
+
+/* Retrieves line of the view as null-terminated string.  Returns pointer that
+ * is valid until next call. */
+static const char *
+get_line(view_info_t *vi, int line)
+{
+	const char *data;
+
+	if(vi->li == NULL)
+	{
+		return vi->lines[line];
+	}
+
+	data = li_get(vi->li, line);
+	return (data == NULL) ? "" : data;
+}
+
+/* Computes screen width of a line of the view.  Returns the width. */
+static int
+get_line_width(view_info_t *vi, int line)
+{
+	if(vi->li == NULL)
+	{
+		return measure_line(vi->lines[line]);
+	}
+
+	/* Width was computed by the indexer. */
+	return li_width(vi->li, line);
+}
+
+/* Computes screen width of a line skipping escape sequences.  Might be called
+ * from indexing thread.  Returns the width. */
+static int
+measure_line(const char line[])
+{
+	return get_screen_string_length(line) - esc_str_overhead(line);
+}
+
 static void
 draw(void)
 {
@@ -572,7 +806,7 @@ draw(void)
 	const col_scheme_t *cs = ui_view_get_cs(vi->view);
 	const int height = vi->view->window_rows - 1;
 	const int width = vi->view->window_width - 1;
-	const int max_l = MIN(vi->line + height, vi->nlines);
+	const int max_l = MIN(vi->line + height, fetch_lines(vi, vi->line + height));
 	const int searched = (vi->last_search_backward != -1);
 	esc_state state;
 
@@ -584,8 +818,8 @@ draw(void)
 	{
 		int offset = 0;
 		int t = 0;
-		char *const line = vi->lines[l];
-		char *p = searched ? esc_highlight_pattern(line, &vi->re) : line;
+		const char *const line = get_line(vi, l);
+		const char *const p = searched ? get_highlighted(vi, l, line) : line;
 		do
 		{
 			int printed;
@@ -596,12 +830,120 @@ draw(void)
 			t++;
 		}
 		while(vi->wrap && p[offset] != '\0' && vl < height);
-		if(searched)
+	}
+	refresh_view_win(vi->view);
+}
+
+/* Retrieves line with highlighted matches of the last search pattern.  Lines
+ * that are known not to match are returned as is.  Returns pointer to the line,
+ * which is valid until the next call. */
+static const char *
+get_highlighted(view_info_t *vi, int line, const char text[])
+{
+	hl_line_t *entry;
+
+	if(vi->mi != NULL && mi_is_match(vi->mi, line) == 0)
+	{
+		return text;
+	}
+
+	entry = &vi->hl_cache[line%HL_CACHE_SIZE];
+	if(entry->text == NULL || entry->line != line)
+	{
+		char *const highlighted = esc_highlight_pattern(text, &vi->re);
+		if(highlighted == NULL)
 		{
-			free(p);
+			return text;
 		}
+
+		free(entry->text);
+		entry->text = highlighted;
+		entry->line = line;
 	}
-	refresh_view_win(vi->view);
+
+	return entry->text;
+}
+
+/* Empties cache of highlighted lines. */
+static void
+clear_hl_cache(view_info_t *vi)
+{
+	int i;
+	for(i = 0; i < HL_CACHE_SIZE; ++i)
+	{
+		free(vi->hl_cache[i].text);
+		vi->hl_cache[i].text = NULL;
+	}
+}
+
+/* Starts looking for matches of the last search pattern in background. */
+static void
+start_search(view_info_t *vi)
+{
+	search_src_t *const src = calloc(1U, sizeof(*src));
+	if(src == NULL)
+	{
+		return;
+	}
+
+	src->lines = vi->lines;
+	src->nlines = vi->nlines;
+	src->li = vi->li;
+	if(vi->li != NULL && (src->cursor = li_cursor_new(vi->li)) == NULL)
+	{
+		free(src);
+		return;
+	}
+
+	vi->mi = mi_start(vi->pattern, get_regexp_cflags(vi->pattern),
+			&get_search_line, src);
+	if(vi->mi == NULL)
+	{
+		li_cursor_free(src->cursor);
+		free(src);
+		return;
+	}
+
+	vi->search_src = src;
+}
+
+/* Stops looking for matches and frees the results. */
+static void
+stop_search(view_info_t *vi)
+{
+	mi_free(vi->mi);
+	vi->mi = NULL;
+
+	if(vi->search_src != NULL)
+	{
+		li_cursor_free(vi->search_src->cursor);
+		free(vi->search_src);
+		vi->search_src = NULL;
+	}
+
+	clear_hl_cache(vi);
+}
+
+/* Provides lines for matching with escape sequences removed.  Called from
+ * background thread.  Returns newly allocated string or NULL. */
+static char *
+get_search_line(int n, void *arg)
+{
+	const search_src_t *const src = arg;
+	const char *line;
+
+	if(src->li == NULL)
+	{
+		return (n < src->nlines) ? esc_remove(src->lines[n]) : NULL;
+	}
+
+	if(li_wait(src->li, n + 1) <= n)
+	{
+		return NULL;
+	}
+
+	line = li_cursor_get(src->cursor, n);
+	return (line == NULL) ? NULL : esc_remove(line);
 }
 
 int
@@ -613,7 +955,10 @@ find_vwpattern(const char *pattern, int backward)
 		return 0;
 
 	if(vi->last_search_backward != -1)
+	{
+		stop_search(vi);
 		regfree(&vi->re);
+	}
 	vi->last_search_backward = -1;
 	if((err = regcomp(&vi->re, pattern, get_regexp_cflags(pattern))) != 0)
 	{
@@ -624,6 +969,8 @@ find_vwpattern(const char *pattern, int backward)
 	}
 
 	vi->last_search_backward = backward;
+	(void)replace_string(&vi->pattern, pattern);
+	start_search(vi);
 
 	search(vi->search_repeat, backward);
 
@@ -858,7 +1205,18 @@ cmd_percent(key_info_t key_info, keys_info_t *keys_info)
 	if(key_info.count > 100)
 		key_info.count = 100;
 
-	vi->line = (key_info.count*vi->nlinesv)/100;
+	if(vi->li != NULL)
+	{
+		/* Size of virtual lines is unknown until whole file is indexed, so use
+		 * offset in the file instead. */
+		const uint64_t offset = (li_size(vi->li)*key_info.count)/100U;
+		vi->line = li_find(vi->li, offset);
+		(void)fetch_lines(vi, vi->line + 1);
+	}
+	else
+	{
+		vi->line = (key_info.count*vi->nlinesv)/100;
+	}
 	if(vi->line >= vi->nlines)
 		vi->line = vi->nlines - 1;
 	vi->linev = vi->widths[vi->line][0];
@@ -914,7 +1272,7 @@ cmd_F(key_info_t key_info, keys_info_t *keys_info)
 	vi->auto_forward = !vi->auto_forward;
 	if(vi->auto_forward)
 	{
-		if(forward_if_changed(vi) || scroll_to_bottom(vi))
+		if(forward_if_changed(vi) || follow_end(vi))
 		{
 			draw();
 		}
@@ -932,7 +1290,7 @@ cmd_G(key_info_t key_info, keys_info_t *keys_info)
 		return;
 	}
 
-	if(scroll_to_bottom(vi))
+	if(follow_end(vi))
 	{
 		draw();
 	}
@@ -948,7 +1306,7 @@ cmd_N(key_info_t key_info, keys_info_t *keys_info)
 static void
 cmd_R(key_info_t key_info, keys_info_t *keys_info)
 {
-	reload_view(vi, NOSILENT);
+	(void)reload_view(vi, NOSILENT);
 }
 
 /* Loads list of strings and related data into view_info_t structure from
@@ -988,6 +1346,12 @@ load_view_data(view_info_t *vi, const char action[], const char file_to_view[],
 			return 1;
 	}
 
+	if(vi->li != NULL)
+	{
+		/* Lines are added by fetch_lines(). */
+		return 0;
+	}
+
 	vi->widths = malloc(sizeof(*vi->widths)*vi->nlines);
 	if(vi->widths == NULL)
 	{
@@ -1019,7 +1383,20 @@ get_view_data(view_info_t *vi, const char file_to_view[])
 		{
 			return 1;
 		}
-		else if((fp = os_fopen(file_to_view, "rb")) == NULL)
+
+		vi->li = li_open(file_to_view, &measure_line);
+		if(vi->li != NULL)
+		{
+			if(fetch_lines(vi, 1) == 0)
+			{
+				li_close(vi->li);
+				vi->li = NULL;
+				return 4;
+			}
+			return 0;
+		}
+
+		if((fp = os_fopen(file_to_view, "rb")) == NULL)
 		{
 			return 2;
 		}
@@ -1056,6 +1433,8 @@ replace_vi(view_info_t *const orig, view_info_t *const new)
 		new->last_search_backward = orig->last_search_backward;
 		new->re = orig->re;
 		orig->last_search_backward = -1;
+		new->pattern = orig->pattern;
+		orig->pattern = NULL;
 	}
 
 	new->win_size = orig->win_size;
@@ -1066,8 +1445,16 @@ replace_vi(view_info_t *const orig, view_info_t *const new)
 	new->auto_forward = orig->auto_forward;
 	ts_assign(&new->file_mtime, &orig->file_mtime);
 
+	(void)fetch_lines(new, new->line + 1);
+
 	free_view_info(orig);
 	*orig = *new;
+
+	/* Results of the search are bound to lines. */
+	if(orig->last_search_backward != -1)
+	{
+		start_search(orig);
+	}
 }
 
 static void
@@ -1107,6 +1494,7 @@ cmd_g(key_info_t key_info, keys_info_t *keys_info)
 	if(key_info.count == NO_COUNT_GIVEN)
 		key_info.count = 1;
 
+	(void)fetch_lines(vi, key_info.count + (vi->view->window_rows - 1));
 	key_info.count = MIN(vi->nlinesv - (vi->view->window_rows - 1),
 			key_info.count);
 	key_info.count = MAX(1, key_info.count);
@@ -1121,6 +1509,9 @@ cmd_g(key_info_t key_info, keys_info_t *keys_info)
 static void
 cmd_j(key_info_t key_info, keys_info_t *keys_info)
 {
+	(void)fetch_lines(vi, vi->line + MAX(key_info.count, 1) +
+			(vi->view->window_rows - 1) + 1);
+
 	if(key_info.reg == NO_REG_GIVEN)
 	{
 		if((vi->linev + 1) + (vi->view->window_rows - 1) > vi->nlinesv)
@@ -1214,94 +1605,239 @@ search(int repeat_count, int backward)
 			find_next();
 		}
 	}
+
+	if(curr_stats.save_msg == 0)
+	{
+		report_match_count();
+	}
 }
 
+/* Moves to the previous match of the last search pattern.  Virtual lines of
+ * the current line are checked first, other lines are looked up in the match
+ * index. */
 static void
 find_previous(int vline_offset)
 {
-	int i;
-	int offset = 0;
-	char buf[(vi->view->window_width - 1)*4];
-	int vl, l;
-
-	vl = vi->linev - vline_offset;
-	l = vi->line;
+	const int vl = vi->linev - vline_offset;
+	int l = vi->line;
+	int found = -1;
 
-	if(l > 0 && vl < vi->widths[l][0])
-		l--;
+	if(vl >= vi->widths[l][0])
+	{
+		found = find_in_line(vi, l, vl, 1);
+	}
 
-	for(i = 0; i <= vl - vi->widths[l][0]; i++)
-		offset = get_part(vi->lines[l], offset, vi->view->window_width - 1, buf);
+	if(found < 0 && (l = find_match_line(vi, 1)) == MI_PENDING)
+	{
+		draw();
+		display_error("Search interrupted");
+		return;
+	}
 
-	/* Don't stop until we go above first virtual line of the first line. */
-	while(l >= 0 && vl >= 0)
+	if(found < 0 && l >= 0)
 	{
-		if(regexec(&vi->re, buf, 0, NULL, 0) == 0)
-		{
-			vi->linev = vl;
-			vi->line = l;
-			break;
-		}
-		if(l > 0 && vl - 1 < vi->widths[l][0])
+		found = find_in_line(vi, l, get_line_end(vi, l) - 1, 1);
+		if(found < 0)
 		{
-			l--;
-			offset = 0;
-			for(i = 0; i <= vl - 1 - vi->widths[l][0]; i++)
-				offset = get_part(vi->lines[l], offset, vi->view->window_width - 1,
-						buf);
+			/* Match spans several virtual lines. */
+			found = vi->widths[l][0];
 		}
-		else
-			offset = get_part(vi->lines[l], offset, vi->view->window_width - 1, buf);
-		vl--;
 	}
+
+	if(found >= 0)
+	{
+		vi->line = l;
+		vi->linev = found;
+	}
+
 	draw();
-	if(vi->line != l)
+	if(found < 0)
 	{
 		display_error("Pattern not found");
 	}
 }
 
+/* Moves to the next match of the last search pattern.  Virtual lines of the
+ * current line are checked first, other lines are looked up in the match
+ * index. */
 static void
 find_next(void)
 {
-	int i;
-	int offset = 0;
-	char buf[(vi->view->window_width - 1)*4];
-	int vl, l;
+	const int vl = vi->linev + 1;
+	int l = vi->line;
+	int found = -1;
 
-	vl = vi->linev + 1;
-	l = vi->line;
+	if(vl < get_line_end(vi, l))
+	{
+		found = find_in_line(vi, l, vl, 0);
+	}
 
-	if(l < vi->nlines - 1 && vl == vi->widths[l + 1][0])
-		l++;
+	if(found < 0 && (l = find_match_line(vi, 0)) == MI_PENDING)
+	{
+		draw();
+		display_error("Search interrupted");
+		return;
+	}
 
-	for(i = 0; i <= vl - vi->widths[l][0]; i++)
-		offset = get_part(vi->lines[l], offset, vi->view->window_width - 1, buf);
+	if(found < 0 && l >= 0)
+	{
+		(void)fetch_lines(vi, l + 1);
+		found = find_in_line(vi, l, vi->widths[l][0], 0);
+		if(found < 0)
+		{
+			/* Match spans several virtual lines. */
+			found = vi->widths[l][0];
+		}
+	}
 
-	while(l < vi->nlines)
+	if(found >= 0)
 	{
-		if(regexec(&vi->re, buf, 0, NULL, 0) == 0)
+		vi->line = l;
+		vi->linev = found;
+	}
+
+	draw();
+	if(found < 0)
+	{
+		display_error("Pattern not found");
+	}
+}
+
+/* Finds the closest line after or before (for non-zero backward) the current
+ * one that matches the last search pattern.  Waiting for the match index can be
+ * interrupted with Ctrl-C.  Without the index lines are checked one by one.
+ * Returns line number, -1 if there is no match or MI_PENDING if search was
+ * interrupted. */
+static int
+find_match_line(view_info_t *vi, int backward)
+{
+	int l = MI_PENDING;
+
+	if(vi->mi != NULL)
+	{
+		l = backward ? mi_try_prev(vi->mi, vi->line, 0)
+		             : mi_try_next(vi->mi, vi->line, 0);
+		if(l != MI_PENDING)
 		{
-			vi->linev = vl;
-			vi->line = l;
-			break;
+			return l;
 		}
-		if(l < vi->nlines && (l == vi->nlines - 1 ||
-				vl + 1 >= vi->widths[l + 1][0]))
+	}
+
+	ui_sb_quick_msgf("%s", "Searching... (press Ctrl-C to cancel)");
+	ui_cancellation_reset();
+	ui_cancellation_enable();
+
+	if(vi->mi == NULL)
+	{
+		l = scan_for_match(vi, backward);
+	}
+	else
+	{
+		while(l == MI_PENDING && !ui_cancellation_requested())
 		{
-			if(l == vi->nlines - 1)
+			l = backward ? mi_try_prev(vi->mi, vi->line, SEARCH_WAIT_STEP_MS)
+			             : mi_try_next(vi->mi, vi->line, SEARCH_WAIT_STEP_MS);
+		}
+	}
+
+	ui_cancellation_disable();
+	return l;
+}
+
+/* Checks lines one by one looking for a match, which is used when there is no
+ * match index.  Returns line number, -1 if there is no match or MI_PENDING if
+ * search was interrupted. */
+static int
+scan_for_match(view_info_t *vi, int backward)
+{
+	int l = vi->line;
+	while(1)
+	{
+		l += backward ? -1 : 1;
+		if(l < 0)
+		{
+			return -1;
+		}
+		if(l >= vi->nlines && fetch_lines(vi, l + SEARCH_SCAN_CHUNK) <= l)
+		{
+			return -1;
+		}
+		if(l%SEARCH_SCAN_CHUNK == 0 && ui_cancellation_requested())
+		{
+			return MI_PENDING;
+		}
+		if(find_in_line(vi, l, backward ? get_line_end(vi, l) - 1
+		                                : vi->widths[l][0], backward) >= 0)
+		{
+			return l;
+		}
+	}
+}
+
+/* Looks for virtual line of the line that matches the last search pattern
+ * starting at the from virtual line and going in specified direction.
+ * Returns the virtual line or -1 if there is no match. */
+static int
+find_in_line(view_info_t *vi, int l, int from, int backward)
+{
+	const int max_len = vi->view->window_width - 1;
+	char buf[max_len*4];
+	const char *const line = get_line(vi, l);
+	const int end = get_line_end(vi, l);
+	int offset = 0;
+	int found = -1;
+	int vl;
+
+	for(vl = vi->widths[l][0]; vl < end; ++vl)
+	{
+		offset = get_part(line, offset, max_len, buf);
+
+		if(backward ? vl > from : vl < from)
+		{
+			if(backward)
+			{
 				break;
-			l++;
-			offset = 0;
+			}
+			continue;
+		}
+
+		if(regexec(&vi->re, buf, 0, NULL, 0) == 0)
+		{
+			found = vl;
+			if(!backward)
+			{
+				break;
+			}
 		}
-		offset = get_part(vi->lines[l], offset, vi->view->window_width - 1, buf);
-		vl++;
 	}
-	draw();
-	if(vi->line != l)
+
+	return found;
+}
+
+/* Computes virtual line that follows the last virtual line of the line.
+ * Returns the virtual line. */
+static int
+get_line_end(const view_info_t *vi, int l)
+{
+	return (l + 1 < vi->nlines) ? vi->widths[l + 1][0] : vi->nlinesv;
+}
+
+/* Displays position of the current line among lines that match the last search
+ * pattern. */
+static void
+report_match_count(void)
+{
+	int before, complete, count;
+
+	if(vi->mi == NULL || mi_is_match(vi->mi, vi->line) != 1)
 	{
-		display_error("Pattern not found");
+		return;
 	}
+
+	count = mi_count(vi->mi, vi->line, &before, &complete);
+	status_bar_messagef("Match %d of %d%s", before + 1, count,
+			complete ? "" : "+");
+	curr_stats.save_msg = 1;
 }
 
 /* Extracts part of the line replacing all occurrences of horizontal tabulation
@@ -1474,19 +2010,33 @@ get_file_to_explore(const FileView *view, char buf[], size_t buf_len)
 	}
 }
 
-void
+int
 view_check_for_updates(void)
 {
 	int need_redraw = 0;
+	int i;
 
 	need_redraw += forward_if_changed(&view_info[VI_QV]);
 	need_redraw += forward_if_changed(&view_info[VI_LWIN]);
 	need_redraw += forward_if_changed(&view_info[VI_RWIN]);
 
+	need_redraw += follow_index(&view_info[VI_QV]);
+	need_redraw += follow_index(&view_info[VI_LWIN]);
+	need_redraw += follow_index(&view_info[VI_RWIN]);
+
 	if(need_redraw)
 	{
 		schedule_redraw();
 	}
+
+	for(i = 0; i < VI_COUNT; ++i)
+	{
+		if(view_info[i].auto_forward || view_info[i].follow_index)
+		{
+			return 1;
+		}
+	}
+	return 0;
 }
 
 /* Forwards the view if underlying file changed.  Returns non-zero if reload
@@ -1512,8 +2062,75 @@ forward_if_changed(view_info_t *vi)
 	}
 
 	ts_assign(&vi->file_mtime, &mtime);
-	reload_view(vi, SILENT);
-	return scroll_to_bottom(vi);
+
+	/* Searching reads lines of the index, which can't be updated meanwhile. */
+	mi_pause(vi->mi);
+
+	if(vi->li != NULL && li_update(vi->li) == 0)
+	{
+		/* Only appended part of the file needs to be processed. */
+		const int nlines = vi->nlines;
+		int complete;
+		const int kept = li_count(vi->li, &complete);
+		trim_lines(vi, kept);
+		mi_resume(vi->mi, kept);
+		clear_hl_cache(vi);
+		(void)fetch_lines(vi, nlines);
+	}
+	else
+	{
+		/* The file might have been truncated or replaced, so old position can be
+		 * out of range. */
+		vi->line = 0;
+		vi->linev = 0;
+		if(reload_view(vi, SILENT) != 0)
+		{
+			/* Old lines are still there. */
+			mi_resume(vi->mi, INT_MAX);
+		}
+	}
+
+	(void)follow_end(vi);
+	return 1;
+}
+
+/* Keeps view at the bottom while file is being indexed after G.  Stops doing
+ * that once user scrolls the view.  Returns non-zero if position was changed,
+ * otherwise zero is returned. */
+static int
+follow_index(view_info_t *vi)
+{
+	if(!vi->follow_index)
+	{
+		return 0;
+	}
+
+	if(vi->linev != vi->follow_linev)
+	{
+		vi->follow_index = 0;
+		return 0;
+	}
+
+	return follow_end(vi);
+}
+
+/* Scrolls view to the bottom.  Indexing of a file isn't waited for, instead
+ * the view is kept at the bottom by view_check_for_updates() until that
+ * happens.  Returns non-zero if position was changed, otherwise zero is
+ * returned. */
+static int
+follow_end(view_info_t *vi)
+{
+	int scrolled;
+
+	if(vi->li != NULL)
+	{
+		vi->follow_index = !sync_index(vi);
+	}
+
+	scrolled = scroll_to_bottom(vi);
+	vi->follow_linev = vi->linev;
+	return scrolled;
 }
 
 /* Scrolls view to the bottom if there is any room for that.  Returns non-zero
@@ -1527,20 +2144,36 @@ scroll_to_bottom(view_info_t *vi)
 	}
 
 	vi->linev = vi->nlinesv - (vi->view->window_rows - 1);
-	for(vi->line = 0; vi->line < vi->nlines - 1; ++vi->line)
+	vi->line = find_line_of_vline(vi, vi->linev);
+	return 1;
+}
+
+/* Finds line that contains the virtual line.  Virtual lines of lines grow
+ * monotonically, so binary search is used, which matters for huge files.
+ * Returns the line number. */
+static int
+find_line_of_vline(const view_info_t *vi, int vline)
+{
+	int l = 0, r = vi->nlines - 1;
+	while(l < r)
 	{
-		if(vi->linev < vi->widths[vi->line + 1][0])
+		const int m = l + (r - l + 1)/2;
+		if(vi->widths[m][0] <= vline)
 		{
-			break;
+			l = m;
+		}
+		else
+		{
+			r = m - 1;
 		}
 	}
-
-	return 1;
+	return l;
 }
 
 /* Reloads contents of the specified view by rerunning corresponding viewer or
- * just rereading a file. */
-static void
+ * just rereading a file.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
 reload_view(view_info_t *vi, int silent)
 {
 	view_info_t new_vi;
@@ -1548,11 +2181,14 @@ reload_view(view_info_t *vi, int silent)
 	init_view_info(&new_vi);
 
 	if(load_view_data(&new_vi, "File exploring reload", vi->filename, silent)
-			== 0)
+			!= 0)
 	{
-		replace_vi(vi, &new_vi);
-		view_redraw();
+		return 1;
 	}
+
+	replace_vi(vi, &new_vi);
+	view_redraw();
+	return 0;
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
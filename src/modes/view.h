@@ -56,8 +56,10 @@ void view_switch_views(void);
  * Returns non-zero on success, otherwise zero is returned. */
 int draw_abandoned_view_mode(void);
 
-/* Checks whether contents of either view should be updated. */
-void view_check_for_updates(void);
+/* Checks whether contents of either view should be updated.  Returns non-zero
+ * if some view follows a file or its indexing and should be checked again
+ * shortly, otherwise zero is returned. */
+int view_check_for_updates(void);
 
 #endif /* VIFM__MODES__VIEW_H__ */
 
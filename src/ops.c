@@ -165,7 +165,7 @@ ops_enqueue(ops_t *ops, const char src[], const char dst[])
 	}
 
 	/* Check once and cache result, it should be the same for each invocation. */
-	if(ops->estim->total_items == 0)
+	if(ops->total == 1)
 	{
 		switch(ops->main_op)
 		{
@@ -201,9 +201,16 @@ ops_enqueue(ops_t *ops, const char src[], const char dst[])
 		}
 	}
 
-	ui_cancellation_enable();
-	ioeta_calculate(ops->estim, src, ops->shallow_eta);
-	ui_cancellation_disable();
+	if(ops->shallow_eta)
+	{
+		ioeta_calculate(ops->estim, src, 1);
+	}
+	else
+	{
+		/* Operation doesn't wait for full traversal of the tree, totals are
+		 * refined as it goes. */
+		ioeta_calculate_bg(ops->estim, src);
+	}
 }
 
 void
@@ -433,6 +440,7 @@ op_cp(ops_t *ops, void *data, const char src[], const char dst[],
 		.arg3.crs = ca_to_crs(conflict_action),
 
 		.cancellable = data == NULL,
+		.parallelism = cfg.copy_threads,
 	};
 	return exec_io_op(ops, &ior_cp, &args);
 }
@@ -534,6 +542,7 @@ op_mv(ops_t *ops, void *data, const char src[], const char dst[],
 			.arg3.crs = ca_to_crs(conflict_action),
 
 			.cancellable = data == NULL,
+			.parallelism = cfg.copy_threads,
 		};
 		result = exec_io_op(ops, &ior_mv, &args);
 	}
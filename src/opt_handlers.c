@@ -99,6 +99,7 @@ static const char * pick_out_decoration(const char classify_item[],
 		FileType *type);
 static void columns_handler(OPT_OP op, optval_t val);
 static void confirm_handler(OPT_OP op, optval_t val);
+static void copythreads_handler(OPT_OP op, optval_t val);
 static void cpoptions_handler(OPT_OP op, optval_t val);
 static void dotdirs_handler(OPT_OP op, optval_t val);
 static void fastrun_handler(OPT_OP op, optval_t val);
@@ -118,6 +119,7 @@ static void laststatus_handler(OPT_OP op, optval_t val);
 static void lines_handler(OPT_OP op, optval_t val);
 static void locateprg_handler(OPT_OP op, optval_t val);
 static void mintimeoutlen_handler(OPT_OP op, optval_t val);
+static void parallelsort_handler(OPT_OP op, optval_t val);
 static void scroll_line_down(FileView *view);
 static void rulerformat_handler(OPT_OP op, optval_t val);
 static void runexec_handler(OPT_OP op, optval_t val);
@@ -301,6 +303,10 @@ options[] =
 	  OPT_BOOL, 0, NULL, &confirm_handler,
 	  { .ref.bool_val = &cfg.confirm },
 	},
+	{ "copythreads", "",
+	  OPT_INT, 0, NULL, &copythreads_handler,
+	  { .ref.int_val = &cfg.copy_threads },
+	},
 	{ "cpoptions", "cpo",
 	  OPT_CHARSET, cpoptions_count, &cpoptions_vals, &cpoptions_handler,
 	  { .init = &init_cpoptions },
@@ -373,6 +379,10 @@ options[] =
 	  OPT_INT, 0, NULL, &mintimeoutlen_handler,
 	  { .ref.int_val = &cfg.min_timeout_len },
 	},
+	{ "parallelsort", "",
+	  OPT_INT, 0, NULL, &parallelsort_handler,
+	  { .ref.int_val = &cfg.parallel_sort },
+	},
 	{ "rulerformat", "ruf",
 	  OPT_STR, 0, NULL, &rulerformat_handler,
 	  { .ref.str_val = &cfg.ruler_format },
@@ -936,6 +946,20 @@ confirm_handler(OPT_OP op, optval_t val)
 	cfg.confirm = val.bool_val;
 }
 
+static void
+copythreads_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val < 1)
+	{
+		text_buffer_addf("Argument must be > 0: %d", val.int_val);
+		error = 1;
+		reset_option_to_default("copythreads");
+		return;
+	}
+
+	cfg.copy_threads = val.int_val;
+}
+
 /* Parses set of compatibility flags and changes configuration accordingly. */
 static void
 cpoptions_handler(OPT_OP op, optval_t val)
@@ -1180,6 +1204,20 @@ mintimeoutlen_handler(OPT_OP op, optval_t val)
 	cfg.min_timeout_len = val.int_val;
 }
 
+static void
+parallelsort_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val < 0)
+	{
+		text_buffer_addf("Argument must be >= 0: %d", val.int_val);
+		error = 1;
+		reset_option_to_default("parallelsort");
+		return;
+	}
+
+	cfg.parallel_sort = val.int_val;
+}
+
 static void
 scroll_line_down(FileView *view)
 {
@@ -18,9 +18,18 @@
 
 #include "path_env.h"
 
+#ifndef _WIN32
+#include <sys/stat.h> /* stat */
+#include <dirent.h> /* DT_DIR DT_REG */
+#include <unistd.h> /* X_OK */
+#endif
+
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
 #include <stdio.h> /* snprintf() sprintf() */
-#include <stdlib.h> /* malloc() free() */
-#include <string.h> /* strchr() strlen() */
+#include <stdlib.h> /* calloc() free() malloc() qsort() */
+#include <string.h> /* strchr() strcmp() strdup() strlen() */
+#include <time.h> /* time() time_t */
 
 #include "cfg/config.h"
 #include "compat/os.h"
@@ -31,16 +40,69 @@
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
+#include "utils/utils.h"
+
+#ifndef _WIN32
+
+/* File found in one of PATH directories. */
+typedef struct
+{
+	char *name;     /* Name of the file, NULL for unused slot. */
+	int dir;        /* Index of the first directory in paths that contains it. */
+	int executable; /* Whether the file was executable at the time of indexing
+	                   in any of the directories. */
+}
+exec_entry_t;
+
+#endif
 
 static int path_env_was_changed(int force);
 static void append_scripts_dirs(void);
 static void add_dirs_to_path(const char *path);
 static void add_to_path(const char *path);
 static void split_path_list(void);
+#ifndef _WIN32
+static void ensure_exec_index(void);
+static int exec_index_is_outdated(void);
+static void build_exec_index(void);
+static int add_exec(const char name[], int dir, int executable);
+static exec_entry_t * find_exec(const char name[]);
+static void free_exec_index(void);
+static int get_dir_mtime(const char path[], struct timespec *mtime);
+static int names_cmp(const void *a, const void *b);
+static size_t hash_name(const char name[]);
+#endif
 
 static char **paths;
 static int paths_count;
 
+#ifndef _WIN32
+
+/* Minimal interval between checks of modification times of directories listed
+ * in PATH (in seconds). */
+#define EXEC_INDEX_CHECK_INTERVAL 1
+
+/* Hash table of files in absolute directories of PATH.  Files that aren't
+ * executable are indexed too, because they can become executable without
+ * changing modification time of their directory. */
+static exec_entry_t *exec_table;
+/* Number of slots in the exec_table (power of two). */
+static size_t exec_table_size;
+/* Number of used slots in the exec_table. */
+static size_t exec_count;
+/* Sorted names of executables (point into exec_table). */
+static char **exec_names;
+/* Number of elements in exec_names. */
+static size_t exec_names_count;
+/* Modification times of directories from paths at the time of indexing. */
+static struct timespec *dir_mtimes;
+/* Whether the index corresponds to current paths. */
+static int exec_index_valid;
+/* When modification times of directories were checked last time. */
+static time_t exec_index_checked;
+
+#endif
+
 static char *clean_path;
 static char *real_path;
 
@@ -162,6 +224,10 @@ split_path_list(void)
 	if(paths != NULL)
 		free_string_array(paths, paths_count);
 
+#ifndef _WIN32
+	exec_index_valid = 0;
+#endif
+
 	paths_count = 1;
 	p = path;
 	while((p = strchr(p, ':')) != NULL)
@@ -251,5 +317,345 @@ load_real_path_env(void)
 	real_path = NULL;
 }
 
+#ifndef _WIN32
+
+int
+find_path_exec(const char name[], size_t path_len, char path[])
+{
+	const exec_entry_t *entry;
+	int i;
+
+	ensure_exec_index();
+
+	/* All files of absolute directories are in the index, so only directories
+	 * starting with the first one that contains the file need checking.  Making
+	 * a file executable doesn't change modification time of its directory, hence
+	 * the check of permissions.  Relative directories depend on current working
+	 * directory and can't be indexed, so check them each time.  Incomplete index
+	 * (e.g., after failing to allocate memory) can't be relied upon. */
+	entry = find_exec(name);
+	for(i = 0; i < paths_count; ++i)
+	{
+		char full_path[PATH_MAX];
+
+		if(exec_index_valid && is_path_absolute(paths[i]) &&
+				(entry == NULL || i < entry->dir))
+		{
+			continue;
+		}
+
+		snprintf(full_path, sizeof(full_path), "%s/%s", paths[i], name);
+		if(executable_exists(full_path))
+		{
+			break;
+		}
+	}
+
+	if(i == paths_count)
+	{
+		return 1;
+	}
+
+	if(path != NULL)
+	{
+		snprintf(path, path_len, "%s/%s", paths[i], name);
+	}
+	return 0;
+}
+
+char **
+get_path_execs(size_t *count)
+{
+	ensure_exec_index();
+	*count = exec_names_count;
+	return exec_names;
+}
+
+/* Makes sure that index of executables corresponds to the current state of
+ * directories listed in PATH. */
+static void
+ensure_exec_index(void)
+{
+	update_path_env(0);
+
+	if(exec_index_valid)
+	{
+		const time_t now = time(NULL);
+		if(now - exec_index_checked < EXEC_INDEX_CHECK_INTERVAL)
+		{
+			return;
+		}
+		exec_index_checked = now;
+
+		if(!exec_index_is_outdated())
+		{
+			return;
+		}
+	}
+
+	build_exec_index();
+}
+
+/* Checks whether any of directories of PATH was modified since indexing.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+exec_index_is_outdated(void)
+{
+	int i;
+	for(i = 0; i < paths_count; ++i)
+	{
+		struct timespec mtime;
+		(void)get_dir_mtime(paths[i], &mtime);
+		if(mtime.tv_sec != dir_mtimes[i].tv_sec ||
+				mtime.tv_nsec != dir_mtimes[i].tv_nsec)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Rebuilds index of executables from scratch. */
+static void
+build_exec_index(void)
+{
+	int i;
+	size_t j, k;
+
+	free_exec_index();
+
+	exec_index_valid = 1;
+	exec_index_checked = time(NULL);
+
+	dir_mtimes = calloc(paths_count, sizeof(*dir_mtimes));
+	if(paths_count != 0 && dir_mtimes == NULL)
+	{
+		exec_index_valid = 0;
+		return;
+	}
+
+	for(i = 0; i < paths_count; ++i)
+	{
+		DIR *dir;
+		struct dirent *d;
+
+		if(get_dir_mtime(paths[i], &dir_mtimes[i]) != 0 ||
+				!is_path_absolute(paths[i]))
+		{
+			continue;
+		}
+
+		dir = os_opendir(paths[i]);
+		if(dir == NULL)
+		{
+			continue;
+		}
+
+		while((d = os_readdir(dir)) != NULL)
+		{
+			char full_path[PATH_MAX];
+			exec_entry_t *entry;
+			int executable;
+
+			if(is_builtin_dir(d->d_name) || d->d_type == DT_DIR)
+			{
+				continue;
+			}
+
+			entry = find_exec(d->d_name);
+			if(entry != NULL && entry->executable)
+			{
+				continue;
+			}
+
+			snprintf(full_path, sizeof(full_path), "%s/%s", paths[i], d->d_name);
+			if(d->d_type != DT_REG && is_dir(full_path))
+			{
+				continue;
+			}
+
+			executable = (os_access(full_path, X_OK) == 0);
+			if(entry != NULL)
+			{
+				entry->executable = executable;
+			}
+			else if(add_exec(d->d_name, i, executable) != 0)
+			{
+				exec_index_valid = 0;
+				break;
+			}
+		}
+
+		os_closedir(dir);
+	}
+
+	exec_names = malloc(sizeof(*exec_names)*exec_count);
+	if(exec_count != 0U && exec_names == NULL)
+	{
+		exec_index_valid = 0;
+		return;
+	}
+
+	for(j = 0U, k = 0U; j < exec_table_size; ++j)
+	{
+		if(exec_table[j].name != NULL && exec_table[j].executable)
+		{
+			exec_names[k++] = exec_table[j].name;
+		}
+	}
+	exec_names_count = k;
+	qsort(exec_names, exec_names_count, sizeof(*exec_names), &names_cmp);
+}
+
+/* Adds file found in dir-th directory of paths to the index.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+add_exec(const char name[], int dir, int executable)
+{
+	size_t slot;
+
+	if((exec_count + 1U)*2U > exec_table_size)
+	{
+		const size_t new_size = (exec_table_size == 0U) ? 1024U
+		                                                : exec_table_size*2U;
+		exec_entry_t *const table = calloc(new_size, sizeof(*table));
+		size_t i;
+
+		if(table == NULL)
+		{
+			return 1;
+		}
+
+		for(i = 0U; i < exec_table_size; ++i)
+		{
+			if(exec_table[i].name == NULL)
+			{
+				continue;
+			}
+
+			slot = hash_name(exec_table[i].name) & (new_size - 1U);
+			while(table[slot].name != NULL)
+			{
+				slot = (slot + 1U) & (new_size - 1U);
+			}
+			table[slot] = exec_table[i];
+		}
+
+		free(exec_table);
+		exec_table = table;
+		exec_table_size = new_size;
+	}
+
+	slot = hash_name(name) & (exec_table_size - 1U);
+	while(exec_table[slot].name != NULL)
+	{
+		slot = (slot + 1U) & (exec_table_size - 1U);
+	}
+
+	exec_table[slot].name = strdup(name);
+	if(exec_table[slot].name == NULL)
+	{
+		return 1;
+	}
+	exec_table[slot].dir = dir;
+	exec_table[slot].executable = executable;
+	++exec_count;
+	return 0;
+}
+
+/* Looks up file in the index.  Returns pointer to its entry or NULL if there is
+ * no such file. */
+static exec_entry_t *
+find_exec(const char name[])
+{
+	size_t slot;
+
+	if(exec_table_size == 0U)
+	{
+		return NULL;
+	}
+
+	slot = hash_name(name) & (exec_table_size - 1U);
+	while(exec_table[slot].name != NULL)
+	{
+		if(strcmp(exec_table[slot].name, name) == 0)
+		{
+			return &exec_table[slot];
+		}
+		slot = (slot + 1U) & (exec_table_size - 1U);
+	}
+	return NULL;
+}
+
+/* Frees all memory occupied by index of executables. */
+static void
+free_exec_index(void)
+{
+	size_t i;
+	for(i = 0U; i < exec_table_size; ++i)
+	{
+		free(exec_table[i].name);
+	}
+	free(exec_table);
+	exec_table = NULL;
+	exec_table_size = 0U;
+	exec_count = 0U;
+	exec_names_count = 0U;
+
+	free(exec_names);
+	exec_names = NULL;
+
+	free(dir_mtimes);
+	dir_mtimes = NULL;
+
+	exec_index_valid = 0;
+}
+
+/* Queries modification time of the directory.  On error the time is zeroed.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+get_dir_mtime(const char path[], struct timespec *mtime)
+{
+	struct stat s;
+
+	mtime->tv_sec = 0;
+	mtime->tv_nsec = 0;
+
+	if(os_stat(path, &s) != 0)
+	{
+		return 1;
+	}
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+	*mtime = s.st_mtim;
+#else
+	mtime->tv_sec = s.st_mtime;
+#endif
+	return 0;
+}
+
+/* qsort() comparer of names of executables.  Returns standard -1, 0, 1 for
+ * comparisons. */
+static int
+names_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Computes FNV-1a hash of the name.  Returns the hash. */
+static size_t
+hash_name(const char name[])
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	while(*name != '\0')
+	{
+		h ^= (unsigned char)*name++;
+		h *= 0x100000001b3ULL;
+	}
+	return (size_t)(h ^ (h >> 32));
+}
+
+#endif
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -37,6 +37,26 @@ void load_clean_path_env(void);
  * needs. */
 void load_real_path_env(void);
 
+#ifndef _WIN32
+
+/* Looks up executable by its name in directories listed in PATH using index of
+ * their contents, which is updated when PATH or the directories change.  Names
+ * missing from the index are rejected without accessing file system (except
+ * for relative directories), while permissions of indexed files are checked on
+ * each lookup, so files that became executable are found as well.  On success,
+ * full path to the executable is stored in the path buffer when it's not NULL.
+ * Returns zero on success, otherwise non-zero is returned. */
+int find_path_exec(const char name[], size_t path_len, char path[]);
+
+/* Gets names of all executables found in absolute directories of PATH.  Files
+ * that became executable after indexing aren't listed until their directory is
+ * modified.  Returns sorted list of unique names, which shouldn't be freed by
+ * the caller and is valid until next call of functions of this unit.  The
+ * number of names is returned through the count argument. */
+char ** get_path_execs(size_t *count);
+
+#endif
+
 #endif /* VIFM__PATH_ENV_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
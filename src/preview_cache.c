@@ -0,0 +1,377 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "preview_cache.h"
+
+#include <pthread.h>
+
+#include <sys/stat.h> /* stat */
+
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* memcmp() memcpy() strlen() */
+
+#include "compat/os.h"
+
+/* Number of hash table buckets (must be a power of two). */
+#define BUCKET_COUNT 256U
+
+/* Single stored preview. */
+typedef struct entry_t entry_t;
+struct entry_t
+{
+	char *key;        /* Path and command separated by null character. */
+	size_t key_len;   /* Length of the key. */
+	size_t hash;      /* Hash of the key. */
+	pc_stamp_t stamp; /* State of the file when the preview was made. */
+	char *data;       /* Contents of the preview. */
+	size_t len;       /* Length of the preview. */
+
+	entry_t *prev;  /* More recently used entry. */
+	entry_t *next;  /* Less recently used entry. */
+	entry_t *chain; /* Next entry of the same bucket. */
+};
+
+struct preview_cache_t
+{
+	pthread_mutex_t lock;           /* Protects all fields below. */
+	entry_t *buckets[BUCKET_COUNT]; /* Hash table with separate chaining. */
+	entry_t *head;                  /* Most recently used entry. */
+	entry_t *tail;                  /* Least recently used entry. */
+	size_t size;                    /* Total size of entries. */
+	size_t max_size;                /* Limit on total size of entries. */
+};
+
+static char * make_key(const char path[], const char cmd[], size_t *len);
+static entry_t ** find_entry(preview_cache_t *pc, const char key[], size_t len,
+		size_t hash);
+static void remove_entry(preview_cache_t *pc, entry_t **link);
+static void unlink_entry(preview_cache_t *pc, entry_t *entry);
+static void link_entry(preview_cache_t *pc, entry_t *entry);
+static void free_entry(entry_t *entry);
+static size_t entry_size(const entry_t *entry);
+static int same_stamps(const pc_stamp_t *a, const pc_stamp_t *b);
+static size_t hash_key(const char key[], size_t len);
+
+preview_cache_t *
+pc_create(size_t max_size)
+{
+	preview_cache_t *const pc = calloc(1U, sizeof(*pc));
+	if(pc == NULL)
+	{
+		return NULL;
+	}
+
+	(void)pthread_mutex_init(&pc->lock, NULL);
+	pc->max_size = max_size;
+	return pc;
+}
+
+void
+pc_free(preview_cache_t *pc)
+{
+	if(pc == NULL)
+	{
+		return;
+	}
+
+	while(pc->head != NULL)
+	{
+		entry_t *const next = pc->head->next;
+		free_entry(pc->head);
+		pc->head = next;
+	}
+
+	pthread_mutex_destroy(&pc->lock);
+	free(pc);
+}
+
+int
+pc_stamp(const char path[], pc_stamp_t *stamp)
+{
+	struct stat s;
+	if(os_stat(path, &s) != 0)
+	{
+		return 1;
+	}
+
+	stamp->size = s.st_size;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+	stamp->mtime_sec = s.st_mtim.tv_sec;
+	stamp->mtime_nsec = s.st_mtim.tv_nsec;
+#else
+	stamp->mtime_sec = s.st_mtime;
+	stamp->mtime_nsec = 0U;
+#endif
+	return 0;
+}
+
+int
+pc_put(preview_cache_t *pc, const char path[], const char cmd[],
+		const pc_stamp_t *stamp, const char data[], size_t len)
+{
+	entry_t **link;
+	entry_t *const entry = calloc(1U, sizeof(*entry));
+	if(entry == NULL)
+	{
+		return 1;
+	}
+
+	entry->key = make_key(path, cmd, &entry->key_len);
+	entry->data = malloc(len + 1U);
+	if(entry->key == NULL || entry->data == NULL)
+	{
+		free_entry(entry);
+		return 1;
+	}
+
+	memcpy(entry->data, data, len);
+	entry->data[len] = '\0';
+	entry->len = len;
+	entry->stamp = *stamp;
+	entry->hash = hash_key(entry->key, entry->key_len);
+
+	if(entry_size(entry) > pc->max_size)
+	{
+		free_entry(entry);
+		return 1;
+	}
+
+	pthread_mutex_lock(&pc->lock);
+
+	link = find_entry(pc, entry->key, entry->key_len, entry->hash);
+	if(*link != NULL)
+	{
+		remove_entry(pc, link);
+	}
+
+	while(pc->size + entry_size(entry) > pc->max_size)
+	{
+		const entry_t *const lru = pc->tail;
+		remove_entry(pc, find_entry(pc, lru->key, lru->key_len, lru->hash));
+	}
+
+	link = &pc->buckets[entry->hash & (BUCKET_COUNT - 1U)];
+	entry->chain = *link;
+	*link = entry;
+	link_entry(pc, entry);
+	pc->size += entry_size(entry);
+
+	pthread_mutex_unlock(&pc->lock);
+	return 0;
+}
+
+char *
+pc_get(preview_cache_t *pc, const char path[], const char cmd[],
+		const pc_stamp_t *stamp, size_t *len)
+{
+	size_t key_len;
+	size_t hash;
+	entry_t **link;
+	char *copy = NULL;
+
+	char *const key = make_key(path, cmd, &key_len);
+	if(key == NULL)
+	{
+		return NULL;
+	}
+	hash = hash_key(key, key_len);
+
+	pthread_mutex_lock(&pc->lock);
+
+	link = find_entry(pc, key, key_len, hash);
+	if(*link != NULL && !same_stamps(&(*link)->stamp, stamp))
+	{
+		/* The file has changed, so the preview is of no use anymore. */
+		remove_entry(pc, link);
+	}
+	else if(*link != NULL)
+	{
+		entry_t *const entry = *link;
+		copy = malloc(entry->len + 1U);
+		if(copy != NULL)
+		{
+			memcpy(copy, entry->data, entry->len + 1U);
+			*len = entry->len;
+		}
+
+		unlink_entry(pc, entry);
+		link_entry(pc, entry);
+	}
+
+	pthread_mutex_unlock(&pc->lock);
+
+	free(key);
+	return copy;
+}
+
+int
+pc_has(preview_cache_t *pc, const char path[], const char cmd[],
+		const pc_stamp_t *stamp)
+{
+	size_t key_len;
+	entry_t **link;
+	int found;
+
+	char *const key = make_key(path, cmd, &key_len);
+	if(key == NULL)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&pc->lock);
+	link = find_entry(pc, key, key_len, hash_key(key, key_len));
+	found = (*link != NULL && same_stamps(&(*link)->stamp, stamp));
+	pthread_mutex_unlock(&pc->lock);
+
+	free(key);
+	return found;
+}
+
+/* Composes key that identifies preview.  *len is set to length of the key.
+ * Returns newly allocated key or NULL on error. */
+static char *
+make_key(const char path[], const char cmd[], size_t *len)
+{
+	const size_t path_len = strlen(path);
+	const size_t cmd_len = strlen(cmd);
+	char *const key = malloc(path_len + 1U + cmd_len);
+	if(key == NULL)
+	{
+		return NULL;
+	}
+
+	memcpy(key, path, path_len + 1U);
+	memcpy(key + path_len + 1U, cmd, cmd_len);
+	*len = path_len + 1U + cmd_len;
+	return key;
+}
+
+/* Looks up entry by its key.  Must be called with the lock held.  Returns
+ * pointer to the link that points to the entry or to null link at the end of
+ * the chain if there is no such entry. */
+static entry_t **
+find_entry(preview_cache_t *pc, const char key[], size_t len, size_t hash)
+{
+	entry_t **link = &pc->buckets[hash & (BUCKET_COUNT - 1U)];
+	while(*link != NULL && ((*link)->hash != hash || (*link)->key_len != len ||
+				memcmp((*link)->key, key, len) != 0))
+	{
+		link = &(*link)->chain;
+	}
+	return link;
+}
+
+/* Removes entry pointed to by the link from the cache and frees it.  Must be
+ * called with the lock held. */
+static void
+remove_entry(preview_cache_t *pc, entry_t **link)
+{
+	entry_t *const entry = *link;
+	*link = entry->chain;
+	unlink_entry(pc, entry);
+	pc->size -= entry_size(entry);
+	free_entry(entry);
+}
+
+/* Excludes entry from the list of recently used entries.  Must be called with
+ * the lock held. */
+static void
+unlink_entry(preview_cache_t *pc, entry_t *entry)
+{
+	if(entry->prev == NULL)
+	{
+		pc->head = entry->next;
+	}
+	else
+	{
+		entry->prev->next = entry->next;
+	}
+
+	if(entry->next == NULL)
+	{
+		pc->tail = entry->prev;
+	}
+	else
+	{
+		entry->next->prev = entry->prev;
+	}
+}
+
+/* Makes the entry most recently used one.  Must be called with the lock
+ * held. */
+static void
+link_entry(preview_cache_t *pc, entry_t *entry)
+{
+	entry->prev = NULL;
+	entry->next = pc->head;
+	if(pc->head == NULL)
+	{
+		pc->tail = entry;
+	}
+	else
+	{
+		pc->head->prev = entry;
+	}
+	pc->head = entry;
+}
+
+/* Frees memory occupied by the entry. */
+static void
+free_entry(entry_t *entry)
+{
+	free(entry->key);
+	free(entry->data);
+	free(entry);
+}
+
+/* Computes how much of cache capacity the entry occupies.  Returns the
+ * size. */
+static size_t
+entry_size(const entry_t *entry)
+{
+	return sizeof(*entry) + entry->key_len + entry->len + 1U;
+}
+
+/* Checks whether two stamps describe the same state of a file.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+same_stamps(const pc_stamp_t *a, const pc_stamp_t *b)
+{
+	return a->size == b->size
+	    && a->mtime_sec == b->mtime_sec
+	    && a->mtime_nsec == b->mtime_nsec;
+}
+
+/* Computes FNV-1a hash of the key.  Returns the hash. */
+static size_t
+hash_key(const char key[], size_t len)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	size_t i;
+	for(i = 0U; i < len; ++i)
+	{
+		h ^= (unsigned char)key[i];
+		h *= 0x100000001b3ULL;
+	}
+	return (size_t)(h ^ (h >> 32));
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,76 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__PREVIEW_CACHE_H__
+#define VIFM__PREVIEW_CACHE_H__
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+
+/* Storage of output of viewers, which is used to display previews of files
+ * without running viewers again.  Previews are identified by path to the file
+ * and command that produced them, they are considered outdated once size or
+ * modification time of the file changes.  When total size of stored previews
+ * exceeds the limit, least recently used ones are dropped.  All functions are
+ * thread-safe. */
+
+/* Opaque cache type. */
+typedef struct preview_cache_t preview_cache_t;
+
+/* State of a file at the moment its preview is being generated. */
+typedef struct
+{
+	uint64_t size;       /* Size of the file. */
+	uint64_t mtime_sec;  /* Modification time (seconds part). */
+	uint64_t mtime_nsec; /* Modification time (nanoseconds part). */
+}
+pc_stamp_t;
+
+/* Creates empty cache that holds at most max_size bytes of previews.  Returns
+ * the cache or NULL on error. */
+preview_cache_t * pc_create(size_t max_size);
+
+/* Frees the cache.  The pc can be NULL. */
+void pc_free(preview_cache_t *pc);
+
+/* Queries current state of the file following symbolic links.  Returns zero on
+ * success, otherwise non-zero is returned. */
+int pc_stamp(const char path[], pc_stamp_t *stamp);
+
+/* Stores copy of the preview of the file produced by the cmd when the file was
+ * in the state described by the stamp.  Returns zero on success, otherwise
+ * non-zero is returned. */
+int pc_put(preview_cache_t *pc, const char path[], const char cmd[],
+		const pc_stamp_t *stamp, const char data[], size_t len);
+
+/* Looks up preview of the file produced by the cmd, which matches the stamp.
+ * *len is set to length of the preview.  Returns newly allocated
+ * null-terminated copy of the preview or NULL if it's missing or outdated. */
+char * pc_get(preview_cache_t *pc, const char path[], const char cmd[],
+		const pc_stamp_t *stamp, size_t *len);
+
+/* Checks whether up to date preview of the file produced by the cmd is in the
+ * cache without making a copy of it.  Returns non-zero if so, otherwise zero is
+ * returned. */
+int pc_has(preview_cache_t *pc, const char path[], const char cmd[],
+		const pc_stamp_t *stamp);
+
+#endif /* VIFM__PREVIEW_CACHE_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
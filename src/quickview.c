@@ -21,10 +21,21 @@
 
 #include <curses.h> /* mvwaddstr() werase() wattrset() */
 
+#ifndef _WIN32
+#include <pthread.h>
+#include <sys/time.h> /* gettimeofday() timeval */
+#include <sys/types.h> /* pid_t ssize_t */
+#include <fcntl.h> /* FD_CLOEXEC F_SETFD fcntl() */
+#include <signal.h> /* SIGTERM kill() */
+#include <unistd.h> /* close() fork() pipe() read() setpgid() */
+#endif
+
+#include <errno.h> /* EINTR ETIMEDOUT errno */
 #include <stddef.h> /* NULL size_t */
-#include <stdio.h> /* FILE fclose() feof() */
-#include <stdlib.h> /* free() */
-#include <string.h> /* memmove() strlen() strncat() */
+#include <stdio.h> /* FILE fclose() feof() fmemopen() */
+#include <stdlib.h> /* calloc() free() realloc() */
+#include <string.h> /* memmove() strcmp() strdup() strlen() strncat() */
+#include <time.h> /* timespec */
 
 #include "cfg/config.h"
 #include "compat/os.h"
@@ -35,15 +46,19 @@
 #include "utils/file_streams.h"
 #include "utils/fs.h"
 #include "utils/fs_limits.h"
+#include "utils/macros.h"
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/utf8.h"
+#include "utils/utils.h"
+#include "utils/wakeup.h"
 #include "color_manager.h"
 #include "color_scheme.h"
 #include "colors.h"
 #include "escape.h"
 #include "filelist.h"
 #include "filetype.h"
+#include "preview_cache.h"
 #include "status.h"
 #include "types.h"
 
@@ -55,6 +70,77 @@
 /* Size of buffer holding preview line (in characters). */
 #define PREVIEW_LINE_BUF_LEN 4096
 
+#ifndef _WIN32
+
+/* Maximum number of bytes of viewer output that is read, the rest won't fit on
+ * the screen anyway. */
+#define MAX_PREVIEW_LEN (256*1024)
+
+/* Limit on total size of cached previews (in bytes). */
+#define PREVIEW_CACHE_SIZE (8*1024*1024)
+
+/* For how long to wait for a viewer before displaying a placeholder, so that
+ * fast viewers don't cause flickering (in milliseconds). */
+#define SYNC_WAIT_MS 30
+
+/* Number of entries before and after the current one for which previews are
+ * generated in advance.  Should be small enough for prefetched previews of
+ * maximum size not to evict each other from the cache. */
+#define PREFETCH_RADIUS 3
+
+/* Maximum number of viewers that run in background to prefetch previews.  Also
+ * bounds memory used by unfinished prefetches. */
+#define PREFETCH_JOBS 2
+
+/* Preview that is being generated by a viewer in background. */
+typedef struct
+{
+	char *path;       /* Path to the file being previewed. */
+	char *cmd;        /* Command that produces the preview. */
+	pc_stamp_t stamp; /* State of the file when the viewer was started. */
+	pid_t pid;        /* Process group of the viewer. */
+	int fd;           /* Read end of pipe connected to output of the viewer. */
+	int shown;        /* Whether complete preview was displayed. */
+
+	pthread_mutex_t lock; /* Protects fields below. */
+	pthread_cond_t cond;  /* Signaled when the job is done. */
+	int done;             /* Whether output of the viewer was read. */
+	int abandoned;        /* Whether nobody needs the preview anymore. */
+	char *data;           /* Output of the viewer. */
+	size_t len;           /* Length of the output. */
+}
+preview_job_t;
+
+static int show_async_preview(const char path[], const char viewer[]);
+static int is_same_job(const preview_job_t *job, const char path[],
+		const char cmd[], const pc_stamp_t *stamp);
+static preview_job_t * start_job(const char path[], const char cmd[],
+		const pc_stamp_t *stamp);
+static void * job_thread(void *arg);
+static int wait_for_job(preview_job_t *job, int timeout);
+static void cancel_job(void);
+static void abandon_job(preview_job_t *job);
+static void free_job(preview_job_t *job);
+static void print_preview(char data[], size_t len);
+static preview_job_t * take_prefetched(const char path[], const char cmd[],
+		const pc_stamp_t *stamp);
+static void schedule_prefetch(FileView *view);
+static int is_in_prefetch_range(FileView *view, const char path[]);
+static void prefetch_entry(FileView *view, int pos);
+static int reap_prefetch_jobs(void);
+static void cancel_prefetch(void);
+static int get_prefetch_pos(const FileView *view, int i);
+
+/* Preview of file under cursor, can be NULL. */
+static preview_job_t *current_job;
+/* Previews of files around the cursor that are being generated in advance,
+ * elements can be NULL. */
+static preview_job_t *prefetch_jobs[PREFETCH_JOBS];
+/* Previews of recently viewed files, can be NULL. */
+static preview_cache_t *cache;
+
+#endif
+
 static void view_file(FILE *fp, int wrapped);
 static int shift_line(char line[], size_t len, size_t offset);
 static size_t add_to_line(FILE *fp, size_t max, char line[], size_t len);
@@ -66,6 +152,11 @@ toggle_quick_view(void)
 	{
 		curr_stats.view = 0;
 
+#ifndef _WIN32
+		cancel_job();
+		cancel_prefetch();
+#endif
+
 		if(ui_view_is_visible(other_view))
 		{
 			draw_dir_list(other_view);
@@ -84,6 +175,7 @@ quick_view_file(FileView *view)
 {
 	char path[PATH_MAX];
 	const dir_entry_t *entry;
+	int async = 0;
 
 	if(curr_stats.load_stage < 2)
 	{
@@ -152,6 +244,13 @@ quick_view_file(FileView *view)
 					mvwaddstr(other_view->win, LINE, COL, "File is a Directory");
 					break;
 				}
+#ifndef _WIN32
+				if(!is_null_or_empty(viewer) && show_async_preview(path, viewer) == 0)
+				{
+					async = 1;
+					break;
+				}
+#endif
 				if(is_null_or_empty(viewer))
 				{
 					fp = os_fopen(path, "rb");
@@ -174,11 +273,594 @@ quick_view_file(FileView *view)
 				break;
 			}
 	}
+
+#ifndef _WIN32
+	if(!async)
+	{
+		cancel_job();
+	}
+	if(view == curr_view)
+	{
+		schedule_prefetch(view);
+	}
+#else
+	(void)async;
+#endif
+
 	refresh_view_win(other_view);
 
 	ui_view_title_update(other_view);
 }
 
+void
+qv_check_for_updates(void)
+{
+#ifndef _WIN32
+	int done;
+
+	if(!curr_stats.view)
+	{
+		return;
+	}
+
+	if(reap_prefetch_jobs())
+	{
+		schedule_prefetch(curr_view);
+	}
+
+	if(current_job == NULL || current_job->shown)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&current_job->lock);
+	done = current_job->done;
+	pthread_mutex_unlock(&current_job->lock);
+
+	if(done)
+	{
+		quick_view_file(curr_view);
+	}
+#endif
+}
+
+#ifndef _WIN32
+
+/* Displays output of the viewer for the file taking it from the cache or
+ * running the viewer in background.  Returns zero on success, otherwise
+ * non-zero is returned and preview should be produced synchronously. */
+static int
+show_async_preview(const char path[], const char viewer[])
+{
+	pc_stamp_t stamp;
+	char *cmd;
+
+	if(pc_stamp(path, &stamp) != 0)
+	{
+		return 1;
+	}
+
+	cmd = get_viewer_command(viewer);
+	if(cmd == NULL)
+	{
+		return 1;
+	}
+
+	if(!is_same_job(current_job, path, cmd, &stamp))
+	{
+		char *data;
+		size_t len;
+
+		cancel_job();
+
+		if(cache == NULL)
+		{
+			cache = pc_create(PREVIEW_CACHE_SIZE);
+		}
+
+		data = (cache == NULL) ? NULL : pc_get(cache, path, cmd, &stamp, &len);
+		if(data != NULL)
+		{
+			print_preview(data, len);
+			free(data);
+			free(cmd);
+			return 0;
+		}
+
+		current_job = take_prefetched(path, cmd, &stamp);
+		if(current_job == NULL)
+		{
+			current_job = start_job(path, cmd, &stamp);
+		}
+		if(current_job == NULL)
+		{
+			free(cmd);
+			return 1;
+		}
+	}
+	free(cmd);
+
+	if(wait_for_job(current_job, SYNC_WAIT_MS))
+	{
+		print_preview(current_job->data, current_job->len);
+		current_job->shown = 1;
+	}
+	else
+	{
+		mvwaddstr(other_view->win, LINE, COL, "Generating preview...");
+	}
+	return 0;
+}
+
+/* Checks whether the job generates specified preview.  The job can be NULL.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+is_same_job(const preview_job_t *job, const char path[], const char cmd[],
+		const pc_stamp_t *stamp)
+{
+	return job != NULL
+	    && strcmp(job->path, path) == 0
+	    && strcmp(job->cmd, cmd) == 0
+	    && job->stamp.size == stamp->size
+	    && job->stamp.mtime_sec == stamp->mtime_sec
+	    && job->stamp.mtime_nsec == stamp->mtime_nsec;
+}
+
+/* Starts the viewer in a separate process group and a thread that collects its
+ * output.  Returns the job or NULL on error. */
+static preview_job_t *
+start_job(const char path[], const char cmd[], const pc_stamp_t *stamp)
+{
+	int out_pipe[2];
+	pthread_attr_t attr;
+	pthread_t thread;
+	int failed;
+	preview_job_t *const job = calloc(1U, sizeof(*job));
+	if(job == NULL)
+	{
+		return NULL;
+	}
+
+	job->path = strdup(path);
+	job->cmd = strdup(cmd);
+	job->stamp = *stamp;
+	if(job->path == NULL || job->cmd == NULL || pipe(out_pipe) != 0)
+	{
+		free(job->path);
+		free(job->cmd);
+		free(job);
+		return NULL;
+	}
+
+	job->pid = fork();
+	if(job->pid == 0)
+	{
+		/* Put the viewer and its children into a separate group to be able to
+		 * kill them all at once. */
+		(void)setpgid(0, 0);
+		run_from_fork(out_pipe, 0, job->cmd);
+	}
+
+	close(out_pipe[1]);
+	if(job->pid == (pid_t)-1)
+	{
+		close(out_pipe[0]);
+		free(job->path);
+		free(job->cmd);
+		free(job);
+		return NULL;
+	}
+
+	/* Avoid racing with the child, the group must exist before we kill it. */
+	(void)setpgid(job->pid, job->pid);
+	(void)fcntl(out_pipe[0], F_SETFD, FD_CLOEXEC);
+	job->fd = out_pipe[0];
+
+	(void)pthread_mutex_init(&job->lock, NULL);
+	(void)pthread_cond_init(&job->cond, NULL);
+
+	(void)pthread_attr_init(&attr);
+	(void)pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	failed = (pthread_create(&thread, &attr, &job_thread, job) != 0);
+	(void)pthread_attr_destroy(&attr);
+
+	if(failed)
+	{
+		(void)kill(-job->pid, SIGTERM);
+		free_job(job);
+		return NULL;
+	}
+
+	return job;
+}
+
+/* Entry point of a thread that reads output of the viewer.  Returns NULL. */
+static void *
+job_thread(void *arg)
+{
+	preview_job_t *const job = arg;
+	char *data = NULL;
+	size_t len = 0U;
+	size_t capacity = 0U;
+	int abandoned;
+
+	while(len < MAX_PREVIEW_LEN)
+	{
+		ssize_t n;
+
+		if(len == capacity)
+		{
+			const size_t new_capacity = (capacity == 0U) ? 4096U : capacity*2U;
+			char *const new_data = realloc(data, new_capacity + 1U);
+			if(new_data == NULL)
+			{
+				break;
+			}
+			data = new_data;
+			capacity = new_capacity;
+		}
+
+		n = read(job->fd, data + len, MIN(capacity, MAX_PREVIEW_LEN) - len);
+		if(n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(n <= 0)
+		{
+			break;
+		}
+		len += n;
+	}
+
+	if(data != NULL)
+	{
+		data[len] = '\0';
+	}
+
+	pthread_mutex_lock(&job->lock);
+	abandoned = job->abandoned;
+	if(!abandoned)
+	{
+		if(len == MAX_PREVIEW_LEN)
+		{
+			/* The rest of the output isn't needed. */
+			(void)kill(-job->pid, SIGTERM);
+		}
+
+		if(cache != NULL)
+		{
+			(void)pc_put(cache, job->path, job->cmd, &job->stamp,
+					(data == NULL) ? "" : data, len);
+		}
+
+		job->data = data;
+		job->len = len;
+		data = NULL;
+	}
+	job->done = 1;
+	pthread_cond_signal(&job->cond);
+	pthread_mutex_unlock(&job->lock);
+
+	wakeup_notify();
+
+	free(data);
+	if(abandoned)
+	{
+		/* Main thread has forgotten about the job, so it's ours to free. */
+		free_job(job);
+	}
+
+	return NULL;
+}
+
+/* Waits for the job to finish for at most timeout milliseconds.  Returns
+ * non-zero if the job is done, otherwise zero is returned. */
+static int
+wait_for_job(preview_job_t *job, int timeout)
+{
+	struct timeval tv;
+	struct timespec deadline;
+	int done;
+
+	(void)gettimeofday(&tv, NULL);
+	deadline.tv_sec = tv.tv_sec + timeout/1000;
+	deadline.tv_nsec = tv.tv_usec*1000L + (timeout%1000)*1000000L;
+	if(deadline.tv_nsec >= 1000000000L)
+	{
+		++deadline.tv_sec;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	pthread_mutex_lock(&job->lock);
+	while(!job->done)
+	{
+		if(pthread_cond_timedwait(&job->cond, &job->lock, &deadline) == ETIMEDOUT)
+		{
+			break;
+		}
+	}
+	done = job->done;
+	pthread_mutex_unlock(&job->lock);
+
+	return done;
+}
+
+/* Forgets about current job killing its viewer if it's still running. */
+static void
+cancel_job(void)
+{
+	preview_job_t *const job = current_job;
+	if(job != NULL)
+	{
+		current_job = NULL;
+		abandon_job(job);
+	}
+}
+
+/* Kills viewer of the job if it's still running and frees the job either
+ * immediately or once its thread finishes. */
+static void
+abandon_job(preview_job_t *job)
+{
+	int done;
+
+	pthread_mutex_lock(&job->lock);
+	done = job->done;
+	if(!done)
+	{
+		job->abandoned = 1;
+		(void)kill(-job->pid, SIGTERM);
+	}
+	pthread_mutex_unlock(&job->lock);
+
+	if(done)
+	{
+		free_job(job);
+	}
+}
+
+/* Frees resources of the job. */
+static void
+free_job(preview_job_t *job)
+{
+	close(job->fd);
+	pthread_cond_destroy(&job->cond);
+	pthread_mutex_destroy(&job->lock);
+	free(job->path);
+	free(job->cmd);
+	free(job->data);
+	free(job);
+}
+
+/* Looks up prefetch job that generates specified preview and removes it from
+ * the list of prefetch jobs.  Returns the job or NULL if there is none. */
+static preview_job_t *
+take_prefetched(const char path[], const char cmd[], const pc_stamp_t *stamp)
+{
+	size_t i;
+	for(i = 0U; i < ARRAY_LEN(prefetch_jobs); ++i)
+	{
+		preview_job_t *const job = prefetch_jobs[i];
+		if(is_same_job(job, path, cmd, stamp))
+		{
+			prefetch_jobs[i] = NULL;
+			return job;
+		}
+	}
+	return NULL;
+}
+
+/* Cancels prefetching of previews for files that are no longer around the
+ * cursor and starts prefetching for the closest files that have no previews
+ * yet while there are free slots. */
+static void
+schedule_prefetch(FileView *view)
+{
+	size_t i;
+	int j;
+
+	if(cache == NULL || view->list_rows == 0)
+	{
+		return;
+	}
+
+	for(i = 0U; i < ARRAY_LEN(prefetch_jobs); ++i)
+	{
+		if(prefetch_jobs[i] != NULL &&
+				!is_in_prefetch_range(view, prefetch_jobs[i]->path))
+		{
+			abandon_job(prefetch_jobs[i]);
+			prefetch_jobs[i] = NULL;
+		}
+	}
+
+	for(j = 0; j < PREFETCH_RADIUS*2; ++j)
+	{
+		const int pos = get_prefetch_pos(view, j);
+		if(pos >= 0)
+		{
+			prefetch_entry(view, pos);
+		}
+	}
+}
+
+/* Checks whether path points to one of the files around the cursor.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+is_in_prefetch_range(FileView *view, const char path[])
+{
+	int j;
+	for(j = 0; j < PREFETCH_RADIUS*2; ++j)
+	{
+		char full_path[PATH_MAX];
+		const int pos = get_prefetch_pos(view, j);
+		if(pos < 0)
+		{
+			continue;
+		}
+
+		get_full_path_of(&view->dir_entry[pos], sizeof(full_path), full_path);
+		if(strcmp(full_path, path) == 0)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Starts generating preview of the entry of the view at specified position
+ * unless it's already available or being generated or there are no free
+ * slots. */
+static void
+prefetch_entry(FileView *view, int pos)
+{
+	char path[PATH_MAX];
+	pc_stamp_t stamp;
+	const char *viewer;
+	char *typed_fname;
+	char *cmd;
+	size_t i;
+	size_t free_slot = ARRAY_LEN(prefetch_jobs);
+	const dir_entry_t *const entry = &view->dir_entry[pos];
+
+	/* Links and other special files are resolved or reported on display, there
+	 * is nothing to gain by handling them here. */
+	if(entry->type != REGULAR && entry->type != EXECUTABLE)
+	{
+		return;
+	}
+
+	for(i = 0U; i < ARRAY_LEN(prefetch_jobs); ++i)
+	{
+		if(prefetch_jobs[i] == NULL)
+		{
+			free_slot = i;
+			break;
+		}
+	}
+	if(free_slot == ARRAY_LEN(prefetch_jobs))
+	{
+		return;
+	}
+
+	get_full_path_of(entry, sizeof(path), path);
+
+	typed_fname = get_typed_fname(path);
+	viewer = ft_get_viewer(typed_fname);
+	free(typed_fname);
+
+	if(is_null_or_empty(viewer) || pc_stamp(path, &stamp) != 0)
+	{
+		return;
+	}
+
+	cmd = get_entry_viewer_command(viewer, entry);
+	if(cmd == NULL)
+	{
+		return;
+	}
+
+	if(!pc_has(cache, path, cmd, &stamp) &&
+			!is_same_job(current_job, path, cmd, &stamp))
+	{
+		for(i = 0U; i < ARRAY_LEN(prefetch_jobs); ++i)
+		{
+			if(is_same_job(prefetch_jobs[i], path, cmd, &stamp))
+			{
+				break;
+			}
+		}
+		if(i == ARRAY_LEN(prefetch_jobs))
+		{
+			prefetch_jobs[free_slot] = start_job(path, cmd, &stamp);
+		}
+	}
+
+	free(cmd);
+}
+
+/* Frees prefetch jobs that have finished, their results are in the cache by
+ * now.  Returns non-zero if any slot was freed, otherwise zero is returned. */
+static int
+reap_prefetch_jobs(void)
+{
+	int reaped = 0;
+	size_t i;
+	for(i = 0U; i < ARRAY_LEN(prefetch_jobs); ++i)
+	{
+		preview_job_t *const job = prefetch_jobs[i];
+		int done;
+
+		if(job == NULL)
+		{
+			continue;
+		}
+
+		pthread_mutex_lock(&job->lock);
+		done = job->done;
+		pthread_mutex_unlock(&job->lock);
+
+		if(done)
+		{
+			free_job(job);
+			prefetch_jobs[i] = NULL;
+			reaped = 1;
+		}
+	}
+	return reaped;
+}
+
+/* Stops all prefetch jobs. */
+static void
+cancel_prefetch(void)
+{
+	size_t i;
+	for(i = 0U; i < ARRAY_LEN(prefetch_jobs); ++i)
+	{
+		if(prefetch_jobs[i] != NULL)
+		{
+			abandon_job(prefetch_jobs[i]);
+			prefetch_jobs[i] = NULL;
+		}
+	}
+}
+
+/* Maps index of prefetch candidate to position in the list, candidates are
+ * ordered by distance from the cursor alternating between files below and
+ * above it.  Returns the position or -1 if it's out of the list. */
+static int
+get_prefetch_pos(const FileView *view, int i)
+{
+	const int offset = (i/2 + 1)*((i%2 == 0) ? 1 : -1);
+	const int pos = view->list_pos + offset;
+	return (pos >= 0 && pos < view->list_rows) ? pos : -1;
+}
+
+/* Displays preview from memory in the other pane. */
+static void
+print_preview(char data[], size_t len)
+{
+	FILE *fp;
+
+	if(len == 0U)
+	{
+		return;
+	}
+
+	fp = fmemopen(data, len, "r");
+	if(fp == NULL)
+	{
+		mvwaddstr(other_view->win, LINE, COL, "Cannot open file");
+		return;
+	}
+
+	wattrset(other_view->win, 0);
+	view_file(fp, cfg.wrap_quick_view);
+	fclose(fp);
+}
+
+#endif
+
 /* Displays contents read from the fp in the other pane starting from the second
  * line and second column.  The wrapped parameter determines whether lines
  * should be wrapped. */
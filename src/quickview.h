@@ -26,6 +26,9 @@ void quick_view_file(FileView * view);
 
 void toggle_quick_view(void);
 
+/* Displays preview that was generated in background once it's ready. */
+void qv_check_for_updates(void);
+
 /* Quits preview pane or view modes. */
 void preview_close(void);
 
@@ -45,6 +45,7 @@ static void _gnuc_noreturn shutdown_nicely(void);
 #include <stdlib.h> /* exit() */
 
 #include "utils/macros.h"
+#include "utils/wakeup.h"
 #include "background.h"
 #include "status.h"
 
@@ -81,6 +82,10 @@ received_sigchld(void)
 	/* This needs to be a loop in case of multiple blocked signals. */
 	while((pid = waitpid(-1, &status, WNOHANG)) > 0)
 		add_finished_job(pid, status);
+
+	/* The signal might have been delivered to a thread other than the main
+	 * one. */
+	wakeup_notify();
 }
 
 static void
@@ -19,78 +19,602 @@
 
 #include "sort.h"
 
+#include <pthread.h> /* pthread_create() pthread_join() pthread_t */
+
 #include <assert.h> /* assert() */
 #include <ctype.h>
-#include <stdlib.h> /* abs() qsort() */
-#include <string.h> /* strrchr() */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* int64_t */
+#include <stdlib.h> /* abs() free() malloc() qsort() */
+#include <string.h> /* memcpy() strcmp() strpbrk() strrchr() */
 
 #include "cfg/config.h"
 #include "ui/ui.h"
+#include "utils/arena.h"
 #include "utils/fs_limits.h"
+#include "utils/log.h"
+#include "utils/macros.h"
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/test_helpers.h"
-#include "utils/tree.h"
 #include "utils/utils.h"
 #include "filelist.h"
 #include "status.h"
 #include "types.h"
 
-static FileView* view;
-static int sort_descending;
-static int sort_type;
+/* Maximum number of keys of a composite key: each sorting key produces at most
+ * two keys plus there might be implicit sorting by type. */
+#define MAX_KEYS (2*(SK_COUNT + 1))
+
+/* Maximum number of threads used for sorting. */
+#define MAX_SORT_THREADS 16
+
+/* Minimal number of records per thread, smaller runs aren't worth it. */
+#define MIN_RUN_LEN 1024
+
+/* Kinds of keys, which determine how their values are compared. */
+typedef enum
+{
+	KK_NUM,   /* Number. */
+	KK_NAME,  /* File name, dot files go first. */
+	KK_FNAME, /* Part of file name. */
+	KK_STR,   /* Plain string. */
+}
+KeyKind;
+
+/* Description of one of the keys of a composite key. */
+typedef struct
+{
+	KeyKind kind;   /* How to compare the key. */
+	int descending; /* Whether order of the key is reversed. */
+}
+key_info_t;
 
-static void sort_by_key(char key);
-static int sort_dir_list(const void *one, const void *two);
+/* Precomputed value of a key. */
+typedef union
+{
+	const char *str; /* Value of string keys. */
+	int64_t num;     /* Value of numeric keys. */
+}
+key_value_t;
+
+/* Sorting record of a file entry.  Records have variable size, which depends
+ * on number of keys. */
+typedef struct
+{
+	int index;             /* Position of the entry in the unsorted list. */
+	int is_parent;         /* Whether entry is "..", which always goes first. */
+	unsigned int no_digits; /* Bit per string key, set if it has no digits. */
+	key_value_t keys[];     /* Values of the keys in order of their priority. */
+}
+sort_record_t;
+
+/* Part of records sorted by a separate thread and then merged with others. */
+typedef struct
+{
+	char *records;      /* The first record of the run. */
+	size_t count;       /* Number of records in the run. */
+	size_t record_size; /* Size of a single record. */
+}
+run_t;
+
+/* Keys of current sorting, they are used by the comparer of records. */
+static key_info_t key_infos[MAX_KEYS];
+/* Number of elements in the key_infos array. */
+static int nkeys;
+
+static int find_bound(FileView *v, dir_entry_t *entry, int index);
+static int setup_keys(const FileView *v, int sort_keys[]);
+static void add_key(char key);
+static void add_key_info(KeyKind kind, int descending);
+static void fill_record(sort_record_t *record, dir_entry_t *entry,
+		const int sort_keys[], int nsort_keys, arena_t *arena);
+static int parallel_sort(char records[], int count, size_t record_size,
+		const dir_entry_t entries[], dir_entry_t sorted[]);
+static void * sort_run(void *arg);
+static void merge_runs(run_t runs[], int nruns, const dir_entry_t entries[],
+		dir_entry_t sorted[]);
+static void sift_down(run_t *heap[], int size, int i);
+static int compare_records(const void *one, const void *two);
+static int compare_key(const sort_record_t *first, const sort_record_t *second,
+		int i);
 TSTATIC int strnumcmp(const char s[], const char t[]);
 #if !defined(HAVE_STRVERSCMP_FUNC) || !HAVE_STRVERSCMP_FUNC
 static int vercmp(const char s[], const char t[]);
 #else
 static char * skip_leading_zeros(const char str[]);
 #endif
-static int compare_file_names(const char s[], const char t[],
-		int ignore_case);
+static int compare_file_names(const char s[], const char t[], int plain);
+static int plain_strnumcmp(const char s[], const char t[]);
 
 void
 sort_view(FileView *v)
 {
+	/* Sorting keys are applied in order of precedence, each key is mapped to
+	 * one or two elements of the composite key. */
+	int sort_keys[SK_COUNT + 1];
+	const int nsort_keys = setup_keys(v, sort_keys);
+	size_t record_size;
+	char *records;
+	dir_entry_t *sorted;
+	arena_t arena = ARENA_INITIALIZER;
 	int i;
 
-	view = v;
-	i = SK_COUNT;
-	while(--i >= 0)
+	if(v->list_rows < 2)
 	{
-		const char sorting_key = view->sort[i];
+		return;
+	}
 
-		if(abs(sorting_key) > SK_LAST)
+	record_size = sizeof(sort_record_t) + nkeys*sizeof(key_value_t);
+	records = malloc(v->list_rows*record_size);
+	sorted = malloc(v->list_rows*sizeof(*sorted));
+	if(records == NULL || sorted == NULL)
+	{
+		LOG_ERROR_MSG("Not enough memory to sort %d entries", v->list_rows);
+		free(records);
+		free(sorted);
+		return;
+	}
+
+	for(i = 0; i < v->list_rows; ++i)
+	{
+		sort_record_t *const record = (sort_record_t *)&records[i*record_size];
+		record->index = i;
+		fill_record(record, &v->dir_entry[i], sort_keys, nsort_keys, &arena);
+	}
+
+	if(cfg.parallel_sort == 0 || v->list_rows < cfg.parallel_sort ||
+			parallel_sort(records, v->list_rows, record_size, v->dir_entry,
+				sorted) != 0)
+	{
+		qsort(records, v->list_rows, record_size, &compare_records);
+		for(i = 0; i < v->list_rows; ++i)
 		{
-			continue;
+			const sort_record_t *const record =
+				(const sort_record_t *)&records[i*record_size];
+			sorted[i] = v->dir_entry[record->index];
 		}
+	}
+	memcpy(v->dir_entry, sorted, v->list_rows*sizeof(*sorted));
 
-		sort_by_key(sorting_key);
+	free(sorted);
+	free(records);
+	arena_free(&arena);
+}
+
+int
+sort_find_pos(FileView *v, dir_entry_t *entry)
+{
+	/* New entry goes after entries that are equal to it. */
+	return find_bound(v, entry, v->list_rows);
+}
+
+int
+sort_find_entry(FileView *v, dir_entry_t *entry)
+{
+	/* Entries that are equal to the entry with respect to sorting form a range
+	 * that needs to be checked by name. */
+	const int first = find_bound(v, entry, -1);
+	const int last = find_bound(v, entry, v->list_rows);
+	int i;
+
+	for(i = first; i < last; ++i)
+	{
+		if(stroscmp(v->dir_entry[i].name, entry->name) == 0)
+		{
+			return i;
+		}
 	}
+	return -1;
+}
 
+/* Finds position in sorted file list of the view before which the entry should
+ * go if it were at the index position in unsorted list, which resolves ties.
+ * Returns the position. */
+static int
+find_bound(FileView *v, dir_entry_t *entry, int index)
+{
+	int sort_keys[SK_COUNT + 1];
+	const int nsort_keys = setup_keys(v, sort_keys);
+	const size_t record_size = sizeof(sort_record_t) + nkeys*sizeof(key_value_t);
+	arena_t arena = ARENA_INITIALIZER;
+	sort_record_t *record, *probe;
+	int lo = 0, hi = v->list_rows;
+
+	record = malloc(record_size);
+	probe = malloc(record_size);
+	if(record == NULL || probe == NULL)
+	{
+		free(record);
+		free(probe);
+		return v->list_rows;
+	}
+
+	record->index = index;
+	fill_record(record, entry, sort_keys, nsort_keys, &arena);
+
+	while(lo < hi)
+	{
+		const int mid = lo + (hi - lo)/2;
+		probe->index = mid;
+		fill_record(probe, &v->dir_entry[mid], sort_keys, nsort_keys, &arena);
+		if(compare_records(probe, record) < 0)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	free(record);
+	free(probe);
+	arena_free(&arena);
+	return lo;
+}
+
+/* Fills key_infos array and sort_keys array of keys used for sorting the view.
+ * Returns number of elements put into sort_keys. */
+static int
+setup_keys(const FileView *v, int sort_keys[])
+{
+	int nsort_keys = 0;
+	int i;
+
+	nkeys = 0;
 	if(!ui_view_sort_list_contains(v->sort, SK_BY_TYPE))
 	{
-		sort_by_key(SK_BY_TYPE);
+		sort_keys[nsort_keys++] = SK_BY_TYPE;
+		add_key(SK_BY_TYPE);
+	}
+	for(i = 0; i < SK_COUNT; ++i)
+	{
+		if(abs(v->sort[i]) <= SK_LAST)
+		{
+			sort_keys[nsort_keys++] = abs(v->sort[i]);
+			add_key(v->sort[i]);
+		}
+	}
+	return nsort_keys;
+}
+
+/* Appends description of keys corresponding to the sorting key to the
+ * key_infos array. */
+static void
+add_key(char key)
+{
+	const int descending = (key < 0);
+
+	switch(abs(key))
+	{
+		case SK_BY_NAME:
+		case SK_BY_INAME:
+			add_key_info(KK_NAME, descending);
+			break;
+		case SK_BY_EXTENSION:
+			/* Whether there is no extension and the extension (or name). */
+			add_key_info(KK_NUM, descending);
+			add_key_info(KK_FNAME, descending);
+			break;
+#ifndef _WIN32
+		case SK_BY_PERMISSIONS:
+			add_key_info(KK_STR, descending);
+			break;
+#endif
+
+		default:
+			add_key_info(KK_NUM, descending);
+			break;
+	}
+}
+
+/* Appends single key description to the key_infos array. */
+static void
+add_key_info(KeyKind kind, int descending)
+{
+	assert(nkeys < MAX_KEYS && "Too many keys.");
+	key_infos[nkeys].kind = kind;
+	key_infos[nkeys].descending = descending;
+	++nkeys;
+}
+
+/* Computes values of all keys of the entry.  Strings that have to be produced
+ * are allocated in the arena. */
+static void
+fill_record(sort_record_t *record, dir_entry_t *entry, const int sort_keys[],
+		int nsort_keys, arena_t *arena)
+{
+	const int is_dir = is_directory_entry(entry);
+	key_value_t *value = &record->keys[0];
+	int i;
+
+	record->is_parent = is_parent_dir(entry->name);
+	record->no_digits = 0U;
+
+	for(i = 0; i < nsort_keys; ++i)
+	{
+		const char *ext;
+		char *str;
+
+		switch(sort_keys[i])
+		{
+			case SK_BY_NAME:
+				value++->str = entry->name;
+				break;
+			case SK_BY_INAME:
+				str = arena_strdup(arena, entry->name);
+				if(str != NULL)
+				{
+					str_to_lower(str);
+				}
+				value++->str = (str == NULL) ? entry->name : str;
+				break;
+			case SK_BY_TYPE:
+				value++->num = !is_dir;
+				break;
+			case SK_BY_EXTENSION:
+				ext = strrchr(entry->name, '.');
+				value++->num = (ext == NULL);
+				value++->str = (ext == NULL) ? entry->name : (ext + 1);
+				break;
+			case SK_BY_SIZE:
+				if(is_dir)
+				{
+					char full_path[PATH_MAX];
+					get_full_path_of(entry, sizeof(full_path), full_path);
+					(void)dsc_get(curr_stats.dirsize_cache, full_path, &entry->size);
+				}
+				value++->num = entry->size;
+				break;
+			case SK_BY_TIME_MODIFIED:
+				value++->num = entry->mtime;
+				break;
+			case SK_BY_TIME_ACCESSED:
+				value++->num = entry->atime;
+				break;
+			case SK_BY_TIME_CHANGED:
+				value++->num = entry->ctime;
+				break;
+#ifndef _WIN32
+			case SK_BY_MODE:
+				value++->num = entry->mode;
+				break;
+			case SK_BY_OWNER_NAME: /* FIXME */
+			case SK_BY_OWNER_ID:
+				value++->num = entry->uid;
+				break;
+			case SK_BY_GROUP_NAME: /* FIXME */
+			case SK_BY_GROUP_ID:
+				value++->num = entry->gid;
+				break;
+			case SK_BY_PERMISSIONS:
+				str = arena_alloc(arena, 11U);
+				if(str != NULL)
+				{
+					get_perm_string(str, 11U, entry->mode);
+				}
+				value++->str = (str == NULL) ? "" : str;
+				break;
+#endif
+
+			default:
+				assert(0 && "All possible sort options should be handled");
+				value++->num = 0;
+				break;
+		}
+	}
+
+	/* Knowing that a string has no digits allows comparing it in a cheaper
+	 * way. */
+	for(i = 0; i < nkeys; ++i)
+	{
+		if(key_infos[i].kind != KK_NUM && key_infos[i].kind != KK_STR &&
+				strpbrk(record->keys[i].str, "0123456789") == NULL)
+		{
+			record->no_digits |= 1U << i;
+		}
+	}
+}
+
+/* Sorts records by splitting them into runs sorted concurrently and merging
+ * the runs, which doesn't affect the order as records never compare equal.
+ * Puts entries into sorted array in resulting order.  Returns zero on success,
+ * otherwise non-zero is returned and records should be sorted serially. */
+static int
+parallel_sort(char records[], int count, size_t record_size,
+		const dir_entry_t entries[], dir_entry_t sorted[])
+{
+	run_t runs[MAX_SORT_THREADS];
+	pthread_t ids[MAX_SORT_THREADS];
+	int started[MAX_SORT_THREADS];
+	int nruns = MIN(get_cpu_count(), MAX_SORT_THREADS);
+	size_t offset = 0U;
+	int i;
+
+	nruns = MIN(nruns, count/MIN_RUN_LEN);
+	if(nruns < 2)
+	{
+		return 1;
+	}
+
+	for(i = 0; i < nruns; ++i)
+	{
+		/* Distribute remainder of division among the first runs. */
+		const size_t len = count/nruns + (i < count%nruns);
+		runs[i].records = &records[offset*record_size];
+		runs[i].count = len;
+		runs[i].record_size = record_size;
+		offset += len;
+	}
+
+	/* The first run is sorted by this thread. */
+	for(i = 1; i < nruns; ++i)
+	{
+		started[i] = (pthread_create(&ids[i], NULL, &sort_run, &runs[i]) == 0);
+	}
+
+	(void)sort_run(&runs[0]);
+
+	for(i = 1; i < nruns; ++i)
+	{
+		if(started[i])
+		{
+			(void)pthread_join(ids[i], NULL);
+		}
+		else
+		{
+			(void)sort_run(&runs[i]);
+		}
+	}
+
+	merge_runs(runs, nruns, entries, sorted);
+	return 0;
+}
+
+/* Entry point of threads that sort runs.  Returns NULL. */
+static void *
+sort_run(void *arg)
+{
+	run_t *const run = arg;
+	qsort(run->records, run->count, run->record_size, &compare_records);
+	return NULL;
+}
+
+/* Performs k-way merge of sorted runs putting entries into the sorted array.
+ * Runs are consumed in the process. */
+static void
+merge_runs(run_t runs[], int nruns, const dir_entry_t entries[],
+		dir_entry_t sorted[])
+{
+	/* Min-heap of runs ordered by their first records. */
+	run_t *heap[MAX_SORT_THREADS];
+	int size = nruns;
+	int i;
+
+	for(i = 0; i < nruns; ++i)
+	{
+		heap[i] = &runs[i];
+	}
+	for(i = size/2 - 1; i >= 0; --i)
+	{
+		sift_down(heap, size, i);
+	}
+
+	while(size != 0)
+	{
+		run_t *const run = heap[0];
+		const sort_record_t *const record = (const sort_record_t *)run->records;
+
+		*sorted++ = entries[record->index];
+
+		run->records += run->record_size;
+		if(--run->count == 0U)
+		{
+			heap[0] = heap[--size];
+		}
+		sift_down(heap, size, 0);
 	}
 }
 
-/* Sorts view by the key in a stable way. */
+/* Restores heap property of the heap of runs starting at i-th element. */
 static void
-sort_by_key(char key)
+sift_down(run_t *heap[], int size, int i)
 {
-	int j;
+	while(1)
+	{
+		const int left = 2*i + 1;
+		const int right = left + 1;
+		int smallest = i;
+		run_t *tmp;
 
-	sort_descending = (key < 0);
-	sort_type = abs(key);
+		if(left < size &&
+				compare_records(heap[left]->records, heap[smallest]->records) < 0)
+		{
+			smallest = left;
+		}
+		if(right < size &&
+				compare_records(heap[right]->records, heap[smallest]->records) < 0)
+		{
+			smallest = right;
+		}
+
+		if(smallest == i)
+		{
+			break;
+		}
 
-	for(j = 0; j < view->list_rows; j++)
+		tmp = heap[i];
+		heap[i] = heap[smallest];
+		heap[smallest] = tmp;
+		i = smallest;
+	}
+}
+
+/* Compares two sorting records by all keys.  Returns positive value if one is
+ * greater than two, zero if they are equal, otherwise negative value is
+ * returned. */
+static int
+compare_records(const void *one, const void *two)
+{
+	const sort_record_t *const first = one;
+	const sort_record_t *const second = two;
+	int i;
+
+	if(first->is_parent)
 	{
-		view->dir_entry[j].list_num = j;
+		return -1;
+	}
+	else if(second->is_parent)
+	{
+		return 1;
+	}
+
+	for(i = 0; i < nkeys; ++i)
+	{
+		const int result = compare_key(first, second, i);
+		if(result != 0)
+		{
+			return key_infos[i].descending ? -result : result;
+		}
 	}
 
-	qsort(view->dir_entry, view->list_rows, sizeof(dir_entry_t), sort_dir_list);
+	/* Keep original order of equal entries. */
+	return first->index - second->index;
+}
+
+/* Compares i-th key of two records.  Returns positive value if the first one is
+ * greater than the second one, zero if they are equal, otherwise negative value
+ * is returned. */
+static int
+compare_key(const sort_record_t *first, const sort_record_t *second, int i)
+{
+	const key_value_t *const a = &first->keys[i];
+	const key_value_t *const b = &second->keys[i];
+	const int plain = ((first->no_digits | second->no_digits) >> i) & 1U;
+
+	switch(key_infos[i].kind)
+	{
+		case KK_NUM:
+			return (a->num < b->num) ? -1 : (a->num > b->num);
+		case KK_NAME:
+			if(a->str[0] == '.' && b->str[0] != '.')
+			{
+				return -1;
+			}
+			if(a->str[0] != '.' && b->str[0] == '.')
+			{
+				return 1;
+			}
+			return compare_file_names(a->str, b->str, plain);
+		case KK_FNAME:
+			return compare_file_names(a->str, b->str, plain);
+		case KK_STR:
+			return strcmp(a->str, b->str);
+	}
+
+	assert(0 && "Unhandled kind of key.");
+	return 0;
 }
 
 /* Compares file names containing numbers correctly. */
@@ -154,157 +678,39 @@ skip_leading_zeros(const char str[])
 }
 #endif
 
+/* Compares two file names or their parts.  Non-zero plain means that at least
+ * one of the strings contains no digits, so taking numbers into account won't
+ * change the result.  Returns positive value if s greater than t, zero if they
+ * are equal, otherwise negative value is returned. */
 static int
-sort_dir_list(const void *one, const void *two)
+compare_file_names(const char s[], const char t[], int plain)
 {
-	int retval;
-	char *pfirst, *psecond;
-	dir_entry_t *const first = (dir_entry_t *)one;
-	dir_entry_t *const second = (dir_entry_t *)two;
-	int first_is_dir;
-	int second_is_dir;
-
-	if(is_parent_dir(first->name))
-	{
-		return -1;
-	}
-	else if(is_parent_dir(second->name))
-	{
-		return 1;
-	}
-
-	first_is_dir = is_directory_entry(first);
-	second_is_dir = is_directory_entry(second);
-
-	retval = 0;
-	switch(sort_type)
+	if(!cfg.sort_numbers)
 	{
-		case SK_BY_NAME:
-		case SK_BY_INAME:
-			if(first->name[0] == '.' && second->name[0] != '.')
-				retval = -1;
-			else if(first->name[0] != '.' && second->name[0] == '.')
-				retval = 1;
-			else
-				retval = compare_file_names(first->name, second->name,
-						sort_type == SK_BY_INAME);
-			break;
-
-		case SK_BY_TYPE:
-			if(first_is_dir != second_is_dir)
-			{
-				retval = first_is_dir ? -1 : 1;
-			}
-			break;
-
-		case SK_BY_EXTENSION:
-			pfirst  = strrchr(first->name,  '.');
-			psecond = strrchr(second->name, '.');
-
-			if(pfirst && psecond)
-				retval = compare_file_names(++pfirst, ++psecond, 0);
-			else if(pfirst || psecond)
-				retval = pfirst ? -1 : 1;
-			else
-				retval = compare_file_names(first->name, second->name, 0);
-			break;
-
-		case SK_BY_SIZE:
-			{
-				if(first_is_dir)
-				{
-					char full_path[PATH_MAX];
-					get_full_path_of(first, sizeof(full_path), full_path);
-					tree_get_data(curr_stats.dirsize_cache, full_path, &first->size);
-				}
-
-				if(second_is_dir)
-				{
-					char full_path[PATH_MAX];
-					get_full_path_of(second, sizeof(full_path), full_path);
-					tree_get_data(curr_stats.dirsize_cache, full_path, &second->size);
-				}
-
-				retval = (first->size < second->size)
-				       ? -1
-				       : (first->size > second->size);
-			}
-			break;
-
-		case SK_BY_TIME_MODIFIED:
-			retval = first->mtime - second->mtime;
-			break;
-
-		case SK_BY_TIME_ACCESSED:
-			retval = first->atime - second->atime;
-			break;
-
-		case SK_BY_TIME_CHANGED:
-			retval = first->ctime - second->ctime;
-			break;
-#ifndef _WIN32
-		case SK_BY_MODE:
-			retval = first->mode - second->mode;
-			break;
-
-		case SK_BY_OWNER_NAME: /* FIXME */
-		case SK_BY_OWNER_ID:
-			retval = first->uid - second->uid;
-			break;
-
-		case SK_BY_GROUP_NAME: /* FIXME */
-		case SK_BY_GROUP_ID:
-			retval = first->gid - second->gid;
-			break;
-
-		case SK_BY_PERMISSIONS:
-			{
-				char first_perm[11], second_perm[11];
-				get_perm_string(first_perm, sizeof(first_perm), first->mode);
-				get_perm_string(second_perm, sizeof(second_perm), second->mode);
-				retval = strcmp(first_perm, second_perm);
-			}
-			break;
-#endif
-
-		default:
-			assert(0 && "All possible sort options should be handled");
-			break;
-	}
-
-	if(retval == 0)
-	{
-		retval = first->list_num - second->list_num;
-	}
-	else if(sort_descending)
-	{
-		retval = -retval;
+		return strcmp(s, t);
 	}
-
-	return retval;
+	return plain ? plain_strnumcmp(s, t) : strnumcmp(s, t);
 }
 
-/* Compares two filenames.  Returns positive value if s greater than t, zero if
- * they are equal, otherwise negative value is returned. */
+/* Equivalent of strnumcmp() for the case when at least one of the strings has
+ * no digits, which boils down to comparing characters the same way strnumcmp()
+ * does (signedness of characters matters for non-ASCII names).  Returns
+ * positive value if s greater than t, zero if they are equal, otherwise
+ * negative value is returned. */
 static int
-compare_file_names(const char s[], const char t[], int ignore_case)
+plain_strnumcmp(const char s[], const char t[])
 {
-	char s_buf[NAME_MAX];
-	char t_buf[NAME_MAX];
-
-	if(ignore_case)
+#if !defined(HAVE_STRVERSCMP_FUNC) || !HAVE_STRVERSCMP_FUNC
+	while(*s != '\0' && *s == *t)
 	{
-		copy_str(s_buf, sizeof(s_buf), s);
-		s = s_buf;
-
-		copy_str(t_buf, sizeof(t_buf), t);
-		t = t_buf;
-
-		str_to_lower(s_buf);
-		str_to_lower(t_buf);
+		++s;
+		++t;
 	}
-
-	return cfg.sort_numbers ? strnumcmp(s, t) : strcmp(s, t);
+	return *s - *t;
+#else
+	/* strverscmp() compares characters as unsigned, just like strcmp() does. */
+	return strcmp(s, t);
+#endif
 }
 
 int
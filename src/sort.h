@@ -24,6 +24,17 @@
 #include "utils/test_helpers.h"
 
 void sort_view(FileView *view);
+
+/* Finds position at which the entry should be inserted into file list of the
+ * view, which is assumed to be sorted.  Returns the position. */
+int sort_find_pos(FileView *view, dir_entry_t *entry);
+
+/* Finds entry of file list of the view, which is assumed to be sorted, that has
+ * the same name as the entry by searching for position of the entry.  Entries
+ * whose attributes that affect sorting have changed aren't found.  Returns the
+ * position or -1 if there is no such entry. */
+int sort_find_entry(FileView *view, dir_entry_t *entry);
+
 /* Maps primary sort key to second column type. */
 int get_secondary_key(int primary_key);
 
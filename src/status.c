@@ -37,8 +37,8 @@
 #include "utils/macros.h"
 #include "utils/path.h"
 #include "utils/str.h"
-#include "utils/tree.h"
 #include "utils/utils.h"
+#include "utils/wakeup.h"
 #include "colors.h"
 
 /* Environment variables by which application hosted by terminal multiplexer can
@@ -89,7 +89,7 @@ load_def_values(status_t *stats, config_t *config)
 	stats->use_input_bar = 1;
 	stats->load_stage = 0;
 	stats->too_small_term = 0;
-	stats->dirsize_cache = NULL_TREE;
+	stats->dirsize_cache = NULL;
 	stats->ch_pos = 1;
 	stats->confirmed = 0;
 	stats->skip_shellout_redraw = 0;
@@ -151,15 +151,16 @@ reset_status(const config_t *config)
 static int
 reset_dircache(status_t *stats)
 {
-	tree_free(stats->dirsize_cache);
-	stats->dirsize_cache = tree_create(0, 0);
-	return stats->dirsize_cache == NULL_TREE;
+	dsc_free(stats->dirsize_cache);
+	stats->dirsize_cache = dsc_create();
+	return stats->dirsize_cache == NULL;
 }
 
 void
 schedule_redraw(void)
 {
 	pending_redraw = 1;
+	wakeup_notify();
 }
 
 int
@@ -20,10 +20,10 @@
 #ifndef VIFM__STATUS_H__
 #define VIFM__STATUS_H__
 
-#include "utils/tree.h"
 #include "utils/fs_limits.h"
 
 #include "color_scheme.h"
+#include "dirsize_cache.h"
 
 struct config_t;
 
@@ -93,7 +93,7 @@ typedef struct
 
 	int too_small_term;
 
-	tree_t dirsize_cache; /* ga command results */
+	dirsize_cache_t *dirsize_cache; /* ga command results */
 
 	int last_search_backward;
 
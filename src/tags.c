@@ -31,6 +31,7 @@ const char *tags[] = {
 	"vifm-'co'",
 	"vifm-'columns'",
 	"vifm-'confirm'",
+	"vifm-'copythreads'",
 	"vifm-'cpo'",
 	"vifm-'cpoptions'",
 	"vifm-'dotdirs'",
@@ -62,6 +63,7 @@ const char *tags[] = {
 	"vifm-'number'",
 	"vifm-'numberwidth'",
 	"vifm-'nuw'",
+	"vifm-'parallelsort'",
 	"vifm-'relativenumber'",
 	"vifm-'rnu'",
 	"vifm-'ruf'",
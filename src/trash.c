@@ -19,13 +19,17 @@
 #include "trash.h"
 
 #include <sys/stat.h> /* stat */
+#include <pthread.h> /* PTHREAD_MUTEX_INITIALIZER pthread_mutex_t
+                        pthread_mutex_lock() pthread_mutex_unlock() */
 
 #include <assert.h> /* assert() */
+#include <ctype.h> /* tolower() */
 #include <errno.h> /* errno */
 #include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
 #include <stdio.h> /* snprintf() */
-#include <stdlib.h> /* free() */
-#include <string.h> /* strchr() strcmp() strdup() strlen() strspn() */
+#include <stdlib.h> /* calloc() free() realloc() */
+#include <string.h> /* memmove() strchr() strcmp() strdup() strlen() strspn() */
 
 #include "cfg/config.h"
 #include "compat/os.h"
@@ -69,6 +73,23 @@ typedef struct
 }
 trashes_list;
 
+/* Single slot of a name_map_t. */
+typedef struct
+{
+	char *key; /* Key of the slot, NULL for unused one. */
+	int value; /* Value associated with the key. */
+}
+name_slot_t;
+
+/* Hash table that maps paths to integers (compares keys with stroscmp()). */
+typedef struct
+{
+	name_slot_t *slots; /* Open addressing hash table. */
+	size_t capacity;    /* Number of slots (zero or a power of two). */
+	size_t count;       /* Number of used slots. */
+}
+name_map_t;
+
 /* State for get_list_of_trashes() traverser. */
 typedef struct
 {
@@ -97,10 +118,37 @@ static int is_trash_directory_traverser(const char path[],
 static void traverse_specs(const char base_path[], traverser client, void *arg);
 static char * get_rooted_trash_dir(const char base_path[], const char spec[]);
 static char * format_root_spec(const char spec[], const char mount_point[]);
+static int find_entry(const char trash_name[]);
+static int ensure_index(void);
+static int map_get(const name_map_t *map, const char key[], int *value);
+static int map_set(name_map_t *map, const char key[], int value);
+static void map_remove(name_map_t *map, const char key[]);
+static name_slot_t * map_find_slot(const name_map_t *map, const char key[]);
+static int map_grow(name_map_t *map);
+static void map_clear(name_map_t *map);
+static size_t hash_name(const char name[]);
+
+/* Initial number of slots of a name_map_t (must be a power of two). */
+#define INITIAL_MAP_CAPACITY 64U
+
+/* Maximum number of elements in name_counters, it's emptied on reaching it. */
+#define MAX_NAME_COUNTERS 4096U
 
 static char **specs;
 static int nspecs;
 
+/* Number of elements trash_list has room for. */
+static int trash_capacity;
+/* Maps trash_name of elements of trash_list to their indexes. */
+static name_map_t entries_index;
+/* Whether entries_index is out of sync with the trash_list. */
+static int index_outdated;
+/* Maps "<trash dir>/<name>" to next number to try for trash name of a file
+ * named <name>. */
+static name_map_t name_counters;
+/* Protects name_counters, which is used by background operations as well. */
+static pthread_mutex_t name_counters_lock = PTHREAD_MUTEX_INITIALIZER;
+
 int
 set_trash_dir(const char new_specs[])
 {
@@ -239,7 +287,7 @@ empty_trash_dir(const char trash_dir[])
 
 	char *const trash_dir_copy = strdup(trash_dir);
 
-	if(bg_execute(task_desc, BG_UNDEFINED_TOTAL, 1, &empty_trash_in_bg,
+	if(bg_execute(task_desc, trash_dir, BG_UNDEFINED_TOTAL, 1, &empty_trash_in_bg,
 			trash_dir_copy) != 0)
 	{
 		free(trash_dir_copy);
@@ -273,13 +321,19 @@ empty_trash_list(void)
 	free(trash_list);
 	trash_list = NULL;
 	nentries = 0;
+	trash_capacity = 0;
+
+	map_clear(&entries_index);
+	index_outdated = 0;
+
+	pthread_mutex_lock(&name_counters_lock);
+	map_clear(&name_counters);
+	pthread_mutex_unlock(&name_counters_lock);
 }
 
 int
 add_to_trash(const char path[], const char trash_name[])
 {
-	void *p;
-
 	if(!exists_in_trash(trash_name))
 	{
 		return -1;
@@ -290,11 +344,17 @@ add_to_trash(const char path[], const char trash_name[])
 		return 0;
 	}
 
-	if((p = realloc(trash_list, sizeof(*trash_list)*(nentries + 1))) == NULL)
+	if(nentries == trash_capacity)
 	{
-		return -1;
+		const int new_capacity = (trash_capacity == 0) ? 16 : trash_capacity*2;
+		void *const p = realloc(trash_list, sizeof(*trash_list)*new_capacity);
+		if(p == NULL)
+		{
+			return -1;
+		}
+		trash_list = p;
+		trash_capacity = new_capacity;
 	}
-	trash_list = p;
 
 	trash_list[nentries].path = strdup(path);
 	trash_list[nentries].trash_name = strdup(trash_name);
@@ -306,19 +366,64 @@ add_to_trash(const char path[], const char trash_name[])
 		return -1;
 	}
 
+	if(!index_outdated &&
+			map_set(&entries_index, trash_list[nentries].trash_name, nentries) != 0)
+	{
+		index_outdated = 1;
+	}
+
 	nentries++;
 	return 0;
 }
 
 int
 is_in_trash(const char trash_name[])
+{
+	return find_entry(trash_name) >= 0;
+}
+
+/* Finds element of the trash_list by its trash name.  Returns index of the
+ * element or -1 if there is no such element. */
+static int
+find_entry(const char trash_name[])
 {
 	int i;
+
+	if(ensure_index() == 0)
+	{
+		return map_get(&entries_index, trash_name, &i) == 0 ? i : -1;
+	}
+
 	for(i = 0; i < nentries; i++)
 	{
 		if(stroscmp(trash_list[i].trash_name, trash_name) == 0)
+			return i;
+	}
+	return -1;
+}
+
+/* Makes sure that entries_index corresponds to the trash_list.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+ensure_index(void)
+{
+	int i;
+
+	if(!index_outdated)
+	{
+		return 0;
+	}
+
+	map_clear(&entries_index);
+	for(i = 0; i < nentries; ++i)
+	{
+		if(map_set(&entries_index, trash_list[i].trash_name, i) != 0)
+		{
 			return 1;
+		}
 	}
+
+	index_outdated = 0;
 	return 0;
 }
 
@@ -401,16 +506,11 @@ exists_in_trash(const char trash_name[])
 int
 restore_from_trash(const char trash_name[])
 {
-	int i;
 	char full[PATH_MAX];
 	char buf[PATH_MAX];
+	const int i = find_entry(trash_name);
 
-	for(i = 0; i < nentries; i++)
-	{
-		if(stroscmp(trash_list[i].trash_name, trash_name) == 0)
-			break;
-	}
-	if(i >= nentries)
+	if(i < 0)
 		return -1;
 
 	copy_str(buf, sizeof(buf), trash_list[i].path);
@@ -446,21 +546,30 @@ restore_from_trash(const char trash_name[])
 int
 remove_from_trash(const char trash_name[])
 {
-	int i;
-	for(i = 0; i < nentries; i++)
+	const int i = find_entry(trash_name);
+	if(i < 0)
+		return -1;
+
+	if(!index_outdated)
 	{
-		if(stroscmp(trash_list[i].trash_name, trash_name) == 0)
-			break;
+		map_remove(&entries_index, trash_list[i].trash_name);
 	}
-	if(i >= nentries)
-		return -1;
 
 	free(trash_list[i].path);
 	free(trash_list[i].trash_name);
-	memmove(trash_list + i, trash_list + i + 1,
-			sizeof(*trash_list)*((nentries - 1) - i));
 
+	/* Move the last element into the hole, which keeps removal cheap at the
+	 * cost of changing order of elements. */
 	nentries--;
+	if(i != nentries)
+	{
+		trash_list[i] = trash_list[nentries];
+		if(!index_outdated &&
+				map_set(&entries_index, trash_list[i].trash_name, i) != 0)
+		{
+			index_outdated = 1;
+		}
+	}
 	return 0;
 }
 
@@ -469,6 +578,7 @@ gen_trash_name(const char base_path[], const char name[])
 {
 	struct stat st;
 	char buf[PATH_MAX];
+	char key[PATH_MAX];
 	int i;
 	char *const trash_dir = pick_trash_dir(base_path);
 
@@ -477,7 +587,15 @@ gen_trash_name(const char base_path[], const char name[])
 		return NULL;
 	}
 
+	/* Start probing after the number used last time for the same name to avoid
+	 * checking all the names that were taken before. */
+	snprintf(key, sizeof(key), "%s/%s", trash_dir, name);
+	chosp(key);
 	i = 0;
+	pthread_mutex_lock(&name_counters_lock);
+	(void)map_get(&name_counters, key, &i);
+	pthread_mutex_unlock(&name_counters_lock);
+
 	do
 	{
 		snprintf(buf, sizeof(buf), "%s/%03d_%s", trash_dir, i++, name);
@@ -485,6 +603,14 @@ gen_trash_name(const char base_path[], const char name[])
 	}
 	while(os_lstat(buf, &st) == 0);
 
+	pthread_mutex_lock(&name_counters_lock);
+	if(name_counters.count >= MAX_NAME_COUNTERS)
+	{
+		map_clear(&name_counters);
+	}
+	(void)map_set(&name_counters, key, i);
+	pthread_mutex_unlock(&name_counters_lock);
+
 	free(trash_dir);
 
 	return strdup(buf);
@@ -674,7 +800,182 @@ trash_prune_dead_entries(void)
 
 		trash_list[j++] = trash_list[i];
 	}
-	nentries = j;
+
+	if(nentries != j)
+	{
+		nentries = j;
+		index_outdated = 1;
+	}
+
+	/* Counters only speed up generation of names and don't need to survive
+	 * changes of trash contents. */
+	pthread_mutex_lock(&name_counters_lock);
+	map_clear(&name_counters);
+	pthread_mutex_unlock(&name_counters_lock);
+}
+
+/* Looks up value by its key in the map.  Returns zero and sets *value on
+ * success, otherwise non-zero is returned. */
+static int
+map_get(const name_map_t *map, const char key[], int *value)
+{
+	const name_slot_t *const slot = map_find_slot(map, key);
+	if(slot == NULL || slot->key == NULL)
+	{
+		return 1;
+	}
+	*value = slot->value;
+	return 0;
+}
+
+/* Associates value with the key in the map replacing previous value if there
+ * was one.  Returns zero on success, otherwise non-zero is returned. */
+static int
+map_set(name_map_t *map, const char key[], int value)
+{
+	name_slot_t *slot;
+
+	if((map->count + 1U)*2U > map->capacity && map_grow(map) != 0)
+	{
+		return 1;
+	}
+
+	slot = map_find_slot(map, key);
+	if(slot->key == NULL)
+	{
+		slot->key = strdup(key);
+		if(slot->key == NULL)
+		{
+			return 1;
+		}
+		++map->count;
+	}
+	slot->value = value;
+	return 0;
+}
+
+/* Removes element with the key from the map if it's there. */
+static void
+map_remove(name_map_t *map, const char key[])
+{
+	name_slot_t *const slot = map_find_slot(map, key);
+	const size_t mask = map->capacity - 1U;
+	size_t hole, i;
+
+	if(slot == NULL || slot->key == NULL)
+	{
+		return;
+	}
+
+	free(slot->key);
+	slot->key = NULL;
+	--map->count;
+
+	/* Move following elements of the probe sequence into the hole unless they
+	 * would become unreachable from their home slots. */
+	hole = slot - map->slots;
+	i = hole;
+	while(1)
+	{
+		size_t home;
+
+		i = (i + 1U) & mask;
+		if(map->slots[i].key == NULL)
+		{
+			break;
+		}
+
+		home = hash_name(map->slots[i].key) & mask;
+		if(((i - home) & mask) >= ((i - hole) & mask))
+		{
+			map->slots[hole] = map->slots[i];
+			map->slots[i].key = NULL;
+			hole = i;
+		}
+	}
+}
+
+/* Finds slot that either contains the key or should contain it.  Returns the
+ * slot or NULL if the map has no slots. */
+static name_slot_t *
+map_find_slot(const name_map_t *map, const char key[])
+{
+	size_t i;
+
+	if(map->capacity == 0U)
+	{
+		return NULL;
+	}
+
+	i = hash_name(key) & (map->capacity - 1U);
+	while(map->slots[i].key != NULL && stroscmp(map->slots[i].key, key) != 0)
+	{
+		i = (i + 1U) & (map->capacity - 1U);
+	}
+	return &map->slots[i];
+}
+
+/* Doubles capacity of the map rehashing its elements.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+map_grow(name_map_t *map)
+{
+	name_map_t new_map;
+	size_t i;
+
+	new_map.capacity = (map->capacity == 0U) ? INITIAL_MAP_CAPACITY
+	                                         : map->capacity*2U;
+	new_map.count = map->count;
+	new_map.slots = calloc(new_map.capacity, sizeof(*new_map.slots));
+	if(new_map.slots == NULL)
+	{
+		return 1;
+	}
+
+	for(i = 0U; i < map->capacity; ++i)
+	{
+		if(map->slots[i].key != NULL)
+		{
+			*map_find_slot(&new_map, map->slots[i].key) = map->slots[i];
+		}
+	}
+
+	free(map->slots);
+	*map = new_map;
+	return 0;
+}
+
+/* Removes all elements of the map and frees its memory. */
+static void
+map_clear(name_map_t *map)
+{
+	size_t i;
+	for(i = 0U; i < map->capacity; ++i)
+	{
+		free(map->slots[i].key);
+	}
+	free(map->slots);
+	map->slots = NULL;
+	map->capacity = 0U;
+	map->count = 0U;
+}
+
+/* Computes FNV-1a hash of the name (ignoring case where file names are case
+ * insensitive).  Returns the hash. */
+static size_t
+hash_name(const char name[])
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	while(*name != '\0')
+	{
+#ifndef _WIN32
+		h ^= (unsigned char)*name++;
+#else
+		h ^= (unsigned char)tolower((unsigned char)*name++);
+#endif
+		h *= 0x100000001b3ULL;
+	}
+	return (size_t)(h ^ (h >> 32));
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
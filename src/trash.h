@@ -27,7 +27,8 @@ typedef struct
 }
 trash_entry_t;
 
-/* List of items in trashes. */
+/* List of items in trashes.  Removal of an item can change order of the
+ * others. */
 trash_entry_t *trash_list;
 
 /* Number of items in the trash_list. */
@@ -61,6 +62,8 @@ int exists_in_trash(const char trash_name[]);
  * zero on success, otherwise non-zero is returned. */
 int restore_from_trash(const char trash_name[]);
 
+/* Removes entry specified by its trash_name from the trash_list.  Returns zero
+ * on success, otherwise non-zero is returned. */
 int remove_from_trash(const char trash_name[]);
 
 /* Generates unique name for a file at base_path location named name (doesn't
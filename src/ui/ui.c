@@ -52,6 +52,7 @@
 #include "../utils/str.h"
 #include "../utils/utf8.h"
 #include "../utils/utils.h"
+#include "../utils/wakeup.h"
 #include "../color_manager.h"
 #include "../color_scheme.h"
 #include "../colors.h"
@@ -1402,18 +1403,21 @@ void
 ui_view_schedule_redraw(FileView *view)
 {
 	view->postponed_redraw = get_updated_time(view->postponed_redraw);
+	wakeup_notify();
 }
 
 void
 ui_view_schedule_reload(FileView *view)
 {
 	view->postponed_reload = get_updated_time(view->postponed_reload);
+	wakeup_notify();
 }
 
 void
 ui_view_schedule_full_reload(FileView *view)
 {
 	view->postponed_full_reload = get_updated_time(view->postponed_full_reload);
+	wakeup_notify();
 }
 
 /* Gets updated timestamp ensuring that it differs from the previous value.
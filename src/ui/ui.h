@@ -31,6 +31,7 @@
 #include <sys/types.h>
 #include <time.h> /* time_t */
 
+#include "../utils/arena.h"
 #include "../utils/filter.h"
 #include "../utils/fs_limits.h"
 #include "../utils/ts.h"
@@ -149,8 +150,6 @@ typedef struct
 
 	int search_match;
 
-	int list_num;     /* Used by sorting comparer to perform stable sort. */
-
 	int marked;       /* Whether file should be processed. */
 
 	int hi_num;       /* File highlighting parameters cache (initially -1). */
@@ -164,6 +163,9 @@ typedef struct
 	char curr_dir[PATH_MAX];
 #ifndef _WIN32
 	timestamp_t dir_mtime;
+	/* Watcher of changes in watched_dir or NULL when it's not available. */
+	struct fswatch_t *dir_watcher;
+	char watched_dir[PATH_MAX];
 #else
 	FILETIME dir_mtime;
 	HANDLE dir_watcher;
@@ -186,6 +188,9 @@ typedef struct
 	int selected_files;
 	int local_cs; /* Whether directory-specific color scheme is in use. */
 	dir_entry_t *dir_entry;
+	/* Storage of names of entries of the dir_entry list (and of unfiltered list
+	 * of local filter), which is released at once on reloading the list. */
+	arena_t names;
 	char ** selected_filelist;
 	int nsaved_selection;
 	char ** saved_selection;
@@ -268,6 +273,12 @@ typedef struct
 	uint64_t last_reload; /* Time of last [full] reload. */
 
 	int on_slow_fs; /* Whether current directory has access penalties. */
+
+	/* Loader of file list running in background, NULL when list is complete. */
+	struct dir_loader_t *loader;
+	/* Cursor position set automatically during background loading.  Used to
+	 * detect whether user has moved the cursor since then. */
+	int loader_pos;
 }
 FileView;
 
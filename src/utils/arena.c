@@ -0,0 +1,187 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+
+#include "arena.h"
+
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* memcpy() strlen() */
+
+/* Size of the first chunk of an arena. */
+#define MIN_CHUNK_SIZE (4U*1024U)
+
+/* Chunks stop growing after reaching this size. */
+#define MAX_CHUNK_SIZE (1024U*1024U)
+
+/* Type with the strictest alignment requirements. */
+typedef union
+{
+	long double ld;
+	long long ll;
+	void *ptr;
+	void (*func)(void);
+}
+max_align_t_;
+
+struct arena_chunk_t
+{
+	arena_chunk_t *next; /* Next (older) chunk or NULL. */
+	size_t size;         /* Number of bytes in the data. */
+	size_t used;         /* Number of bytes of the data that are occupied. */
+	max_align_t_ data[]; /* Memory of the chunk. */
+};
+
+static void * alloc_aligned(arena_t *arena, size_t size, size_t align);
+static arena_chunk_t * add_chunk(arena_t *arena, size_t min_size);
+static size_t align_up(size_t size, size_t align);
+
+void *
+arena_alloc(arena_t *arena, size_t size)
+{
+	return alloc_aligned(arena, size, sizeof(max_align_t_));
+}
+
+char *
+arena_strdup(arena_t *arena, const char str[])
+{
+	const size_t len = strlen(str) + 1U;
+	char *const copy = alloc_aligned(arena, len, 1U);
+	if(copy != NULL)
+	{
+		memcpy(copy, str, len);
+	}
+	return copy;
+}
+
+void
+arena_reset(arena_t *arena)
+{
+	arena_chunk_t *largest = arena->head;
+	arena_chunk_t *chunk = arena->head;
+
+	while(chunk != NULL)
+	{
+		if(chunk->size > largest->size)
+		{
+			largest = chunk;
+		}
+		chunk = chunk->next;
+	}
+
+	chunk = arena->head;
+	while(chunk != NULL)
+	{
+		arena_chunk_t *const next = chunk->next;
+		if(chunk != largest)
+		{
+			free(chunk);
+		}
+		chunk = next;
+	}
+
+	arena->head = largest;
+	if(largest != NULL)
+	{
+		largest->next = NULL;
+		largest->used = 0U;
+	}
+}
+
+void
+arena_free(arena_t *arena)
+{
+	arena_chunk_t *chunk = arena->head;
+	while(chunk != NULL)
+	{
+		arena_chunk_t *const next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+
+	arena->head = NULL;
+	arena->next_size = 0U;
+}
+
+/* Allocates size bytes with specified alignment, which must be a divisor of
+ * alignment of chunk data.  Returns pointer to the memory or NULL on error. */
+static void *
+alloc_aligned(arena_t *arena, size_t size, size_t align)
+{
+	arena_chunk_t *chunk = arena->head;
+	size_t offset = (chunk == NULL) ? 0U : align_up(chunk->used, align);
+	void *ptr;
+
+	if(chunk == NULL || offset > chunk->size || chunk->size - offset < size)
+	{
+		chunk = add_chunk(arena, size);
+		if(chunk == NULL)
+		{
+			return NULL;
+		}
+		offset = 0U;
+	}
+
+	ptr = (char *)chunk->data + offset;
+	chunk->used = offset + size;
+	return ptr;
+}
+
+/* Allocates new chunk of at least min_size bytes and makes it head of the
+ * arena.  Returns the chunk or NULL on error. */
+static arena_chunk_t *
+add_chunk(arena_t *arena, size_t min_size)
+{
+	arena_chunk_t *chunk;
+	size_t size = (arena->next_size == 0U) ? MIN_CHUNK_SIZE : arena->next_size;
+
+	if(size < min_size)
+	{
+		size = min_size;
+	}
+
+	chunk = malloc(sizeof(*chunk) + size);
+	if(chunk == NULL)
+	{
+		return NULL;
+	}
+
+	chunk->next = arena->head;
+	chunk->size = size;
+	chunk->used = 0U;
+	arena->head = chunk;
+
+	if(arena->next_size < MAX_CHUNK_SIZE)
+	{
+		arena->next_size = (arena->next_size == 0U)
+		                 ? MIN_CHUNK_SIZE*2U
+		                 : arena->next_size*2U;
+	}
+
+	return chunk;
+}
+
+/* Rounds size up to a multiple of the align.  Returns the result. */
+static size_t
+align_up(size_t size, size_t align)
+{
+	return (size + align - 1U)/align*align;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
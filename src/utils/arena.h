@@ -0,0 +1,61 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+
+#ifndef VIFM__UTILS__ARENA_H__
+#define VIFM__UTILS__ARENA_H__
+
+#include <stddef.h> /* size_t */
+
+/* Arena (region) allocator.  Memory is handed out from big chunks of
+ * geometrically increasing size, separate allocations are never freed, all of
+ * them are released at once instead.  Zero-initialized structure is a valid
+ * empty arena. */
+
+/* Opaque chunk of memory. */
+typedef struct arena_chunk_t arena_chunk_t;
+
+/* Arena state. */
+typedef struct
+{
+	arena_chunk_t *head; /* Chunk to allocate from, followed by older chunks. */
+	size_t next_size;    /* Size of the next chunk or zero for the default. */
+}
+arena_t;
+
+#define ARENA_INITIALIZER { NULL, 0U }
+
+/* Allocates size bytes of memory suitably aligned for any kind of variable.
+ * Returns pointer to the memory or NULL on error. */
+void * arena_alloc(arena_t *arena, size_t size);
+
+/* Copies the str into the arena.  Returns pointer to the copy or NULL on
+ * error. */
+char * arena_strdup(arena_t *arena, const char str[]);
+
+/* Invalidates all allocations made from the arena.  The largest chunk is kept
+ * for reuse, the rest are freed. */
+void arena_reset(arena_t *arena);
+
+/* Frees all memory of the arena leaving it empty. */
+void arena_free(arena_t *arena);
+
+#endif /* VIFM__UTILS__ARENA_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
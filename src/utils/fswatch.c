@@ -0,0 +1,279 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "fswatch.h"
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h> /* IN_* inotify_add_watch() inotify_event
+                            inotify_init1() */
+#include <unistd.h> /* close() read() */
+#endif
+
+#include <errno.h> /* EAGAIN EINTR errno */
+#include <stddef.h> /* NULL */
+#include <stdlib.h> /* free() malloc() realloc() */
+#include <string.h> /* strcmp() strdup() */
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+/* Events of the directory that affect its listing.  IN_MODIFY is left out,
+ * because every write() to a file would trigger an update, IN_CLOSE_WRITE
+ * reports such files once writing is over. */
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO \
+                  | IN_ATTRIB | IN_CLOSE_WRITE \
+                  | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK)
+
+/* Maximum number of changes collected by fswatch_poll_changes(), having more
+ * of them means that rereading the whole directory is likely to be cheaper. */
+#define MAX_CHANGES 1024
+
+/* Watcher state. */
+struct fswatch_t
+{
+	int fd; /* inotify file descriptor. */
+};
+
+static int find_change(const fswatch_change_t changes[], int count,
+		const char name[]);
+static int add_change(fswatch_change_t **changes, int count,
+		const struct inotify_event *e);
+
+fswatch_t *
+fswatch_create(const char path[])
+{
+	fswatch_t *const w = malloc(sizeof(*w));
+	if(w == NULL)
+	{
+		return NULL;
+	}
+
+	w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(w->fd == -1)
+	{
+		free(w);
+		return NULL;
+	}
+
+	if(inotify_add_watch(w->fd, path, WATCH_MASK) == -1)
+	{
+		fswatch_free(w);
+		return NULL;
+	}
+
+	return w;
+}
+
+void
+fswatch_free(fswatch_t *w)
+{
+	if(w != NULL)
+	{
+		close(w->fd);
+		free(w);
+	}
+}
+
+FSWatchState
+fswatch_poll(fswatch_t *w)
+{
+	return fswatch_poll_changes(w, NULL, NULL);
+}
+
+FSWatchState
+fswatch_poll_changes(fswatch_t *w, fswatch_change_t **changes, int *count)
+{
+	/* Buffer suitably aligned for inotify_event structures. */
+	union
+	{
+		struct inotify_event event;
+		char bytes[4096];
+	}
+	buf;
+
+	FSWatchState state = FSWS_UNCHANGED;
+	/* Whether changes are collected. */
+	int track = (changes != NULL);
+	fswatch_change_t *list = NULL;
+	int len = 0;
+
+	for(;;)
+	{
+		const char *p;
+		const ssize_t nread = read(w->fd, buf.bytes, sizeof(buf.bytes));
+
+		if(nread == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if(nread == -1 && errno == EAGAIN)
+		{
+			break;
+		}
+		if(nread <= 0)
+		{
+			fswatch_free_changes(list, len);
+			return FSWS_ERRORED;
+		}
+
+		for(p = buf.bytes; p < buf.bytes + nread; )
+		{
+			const struct inotify_event *const e = (const struct inotify_event *)p;
+			p += sizeof(*e) + e->len;
+
+			if(e->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT | IN_IGNORED))
+			{
+				fswatch_free_changes(list, len);
+				return FSWS_ERRORED;
+			}
+
+			/* Attributes of the directory itself don't affect its listing. */
+			if((e->mask & IN_ATTRIB) && e->len == 0)
+			{
+				continue;
+			}
+
+			state = FSWS_UPDATED;
+
+			if(!track)
+			{
+				continue;
+			}
+
+			/* Events lost on queue overflow can't be recovered. */
+			if(!(e->mask & IN_Q_OVERFLOW) && e->len != 0 &&
+					find_change(list, len, e->name) >= 0)
+			{
+				continue;
+			}
+
+			if((e->mask & IN_Q_OVERFLOW) || e->len == 0 || len == MAX_CHANGES ||
+					add_change(&list, len, e) != 0)
+			{
+				fswatch_free_changes(list, len);
+				list = NULL;
+				len = 0;
+				track = 0;
+				continue;
+			}
+			++len;
+		}
+	}
+
+	if(changes != NULL)
+	{
+		*changes = list;
+		*count = len;
+	}
+	return state;
+}
+
+/* Looks for a change of the named entry.  Returns index of the change or -1 if
+ * there is no such change. */
+static int
+find_change(const fswatch_change_t changes[], int count, const char name[])
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		if(strcmp(changes[i].name, name) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* Appends change described by the event to the list of count elements.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+add_change(fswatch_change_t **changes, int count,
+		const struct inotify_event *e)
+{
+	fswatch_change_t *const list = realloc(*changes, sizeof(*list)*(count + 1));
+	if(list == NULL)
+	{
+		return 1;
+	}
+	*changes = list;
+
+	list[count].name = strdup(e->name);
+	if(list[count].name == NULL)
+	{
+		return 1;
+	}
+	list[count].existed = !(e->mask & (IN_CREATE | IN_MOVED_TO));
+	return 0;
+}
+
+void
+fswatch_free_changes(fswatch_change_t changes[], int count)
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		free(changes[i].name);
+	}
+	free(changes);
+}
+
+int
+fswatch_get_fd(const fswatch_t *w)
+{
+	return w->fd;
+}
+
+#else
+
+fswatch_t *
+fswatch_create(const char path[])
+{
+	return NULL;
+}
+
+void
+fswatch_free(fswatch_t *w)
+{
+}
+
+FSWatchState
+fswatch_poll(fswatch_t *w)
+{
+	return FSWS_ERRORED;
+}
+
+FSWatchState
+fswatch_poll_changes(fswatch_t *w, fswatch_change_t **changes, int *count)
+{
+	return FSWS_ERRORED;
+}
+
+void
+fswatch_free_changes(fswatch_change_t changes[], int count)
+{
+}
+
+int
+fswatch_get_fd(const fswatch_t *w)
+{
+	return -1;
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
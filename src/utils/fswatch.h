@@ -0,0 +1,76 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__FSWATCH_H__
+#define VIFM__UTILS__FSWATCH_H__
+
+/* Watcher of changes in directory contents.  Implemented on top of inotify
+ * where it's available, on other systems creation of watchers always fails and
+ * callers should fall back to checking modification times. */
+
+/* Result of polling a watcher. */
+typedef enum
+{
+	FSWS_UNCHANGED, /* Nothing has changed since last poll. */
+	FSWS_UPDATED,   /* Directory contents changed. */
+	FSWS_ERRORED,   /* Watcher doesn't work anymore (e.g. directory is gone). */
+}
+FSWatchState;
+
+/* Change of a single entry of the directory. */
+typedef struct
+{
+	char *name;  /* Name of the entry. */
+	int existed; /* Whether the entry existed before the first event about it. */
+}
+fswatch_change_t;
+
+/* Opaque declaration of watcher type. */
+typedef struct fswatch_t fswatch_t;
+
+/* Starts watching the directory.  Returns NULL if watching isn't possible,
+ * otherwise watcher that should be freed with fswatch_free() is returned. */
+fswatch_t * fswatch_create(const char path[]);
+
+/* Stops watching and frees resources of the watcher.  The w can be NULL. */
+void fswatch_free(fswatch_t *w);
+
+/* Checks whether anything happened to the directory since the last call
+ * without blocking.  Returns the state. */
+FSWatchState fswatch_poll(fswatch_t *w);
+
+/* Same as fswatch_poll(), but also reports which entries of the directory were
+ * created, removed, renamed or modified (each entry is reported once, files
+ * being written are reported after they are closed).  On FSWS_UPDATED,
+ * *changes is set to array of *count elements that should be freed with
+ * fswatch_free_changes() or to NULL if changes weren't tracked in detail (e.g.
+ * there were too many of them). */
+FSWatchState fswatch_poll_changes(fswatch_t *w, fswatch_change_t **changes,
+		int *count);
+
+/* Frees array of changes returned by fswatch_poll_changes(). */
+void fswatch_free_changes(fswatch_change_t changes[], int count);
+
+/* Retrieves file descriptor of the watcher that becomes readable when there are
+ * events to process, suitable for select().  Returns the descriptor. */
+int fswatch_get_fd(const fswatch_t *w);
+
+#endif /* VIFM__UTILS__FSWATCH_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,640 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "line_index.h"
+
+#ifndef _WIN32
+#include <sys/stat.h> /* S_ISREG fstat() stat() stat */
+#include <fcntl.h> /* O_RDONLY open() */
+#include <unistd.h> /* close() pread() */
+#endif
+
+#include <sys/types.h> /* dev_t ino_t ssize_t */
+#include <pthread.h>
+
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* calloc() free() realloc() */
+#include <string.h> /* memcpy() memmove() strdup() */
+
+#include "macros.h"
+
+/* Number of lines the indexing thread collects before publishing them. */
+#define BATCH_SIZE 4096
+
+/* Minimal number of bytes read from the file at once. */
+#define READ_SIZE (64*1024)
+
+/* Buffered window into contents of a file. */
+typedef struct
+{
+	int fd;          /* File descriptor to read from. */
+	uint64_t size;   /* Size of the file. */
+	uint64_t offset; /* Offset of the first byte of the buf in the file. */
+	char *buf;       /* Buffer with one extra byte at the end. */
+	size_t len;      /* Number of bytes in the buf. */
+	size_t capacity; /* Size of the buf not counting the extra byte. */
+}
+reader_t;
+
+struct li_cursor_t
+{
+	line_index_t *li; /* Index this cursor belongs to. */
+	reader_t r;       /* Buffer for lines. */
+};
+
+struct line_index_t
+{
+	char *path;              /* Path to the file. */
+	dev_t dev;               /* Device of the file. */
+	ino_t ino;               /* Inode of the file. */
+	int fd;                  /* Descriptor of the opened file. */
+	uint64_t size;           /* Size of the file being indexed. */
+	uint64_t start;          /* Offset at which indexing thread starts. */
+	li_measure_func measure; /* Callback that computes screen width or NULL. */
+	li_cursor_t cursor;      /* Cursor used by li_get(). */
+
+	pthread_t thread;         /* Indexing thread. */
+	int running;              /* Whether indexing thread was started. */
+	pthread_mutex_t lock;     /* Protects all fields below. */
+	pthread_cond_t progress;  /* Signaled when new lines are indexed. */
+	uint64_t *offsets;        /* Offsets of beginnings of lines. */
+	int *widths;              /* Screen widths of lines. */
+	int count;                /* Number of indexed lines. */
+	int capacity;             /* Number of elements offsets and widths fit. */
+	int complete;             /* Whether the whole file has been indexed. */
+	int stop;                 /* Whether indexing thread should quit. */
+};
+
+#ifndef _WIN32
+static int start_indexing(line_index_t *li);
+static void stop_indexing(line_index_t *li);
+static void * index_thread(void *arg);
+static int measure_line(const line_index_t *li, reader_t *r, uint64_t pos,
+		uint64_t len);
+static int publish(line_index_t *li, const uint64_t offsets[],
+		const int widths[], int n, int final);
+static uint64_t get_line_len(reader_t *r, uint64_t pos);
+static uint64_t skip_eol(reader_t *r, uint64_t pos);
+static int is_eol(const reader_t *r, uint64_t pos);
+static int load(reader_t *r, uint64_t keep, uint64_t pos);
+#endif
+
+line_index_t *
+li_open(const char path[], li_measure_func measure)
+{
+#ifndef _WIN32
+	struct stat st;
+	line_index_t *li;
+
+	const int fd = open(path, O_RDONLY);
+	if(fd == -1)
+	{
+		return NULL;
+	}
+
+	if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	li = calloc(1U, sizeof(*li));
+	if(li == NULL || (li->path = strdup(path)) == NULL)
+	{
+		free(li);
+		close(fd);
+		return NULL;
+	}
+
+	li->dev = st.st_dev;
+	li->ino = st.st_ino;
+	li->fd = fd;
+	li->size = st.st_size;
+	li->measure = measure;
+	li->cursor.li = li;
+	li->cursor.r.fd = fd;
+	(void)pthread_mutex_init(&li->lock, NULL);
+	(void)pthread_cond_init(&li->progress, NULL);
+
+	if(start_indexing(li) != 0)
+	{
+		pthread_cond_destroy(&li->progress);
+		pthread_mutex_destroy(&li->lock);
+		close(fd);
+		free(li->path);
+		free(li);
+		return NULL;
+	}
+
+	return li;
+#else
+	return NULL;
+#endif
+}
+
+void
+li_close(line_index_t *li)
+{
+#ifndef _WIN32
+	if(li == NULL)
+	{
+		return;
+	}
+
+	stop_indexing(li);
+
+	pthread_cond_destroy(&li->progress);
+	pthread_mutex_destroy(&li->lock);
+	close(li->fd);
+	free(li->cursor.r.buf);
+	free(li->offsets);
+	free(li->widths);
+	free(li->path);
+	free(li);
+#endif
+}
+
+int
+li_update(line_index_t *li)
+{
+#ifndef _WIN32
+	struct stat st;
+
+	if(stat(li->path, &st) != 0 || st.st_dev != li->dev ||
+			st.st_ino != li->ino || (uint64_t)st.st_size < li->size)
+	{
+		/* The file was replaced (e.g. rotated) or truncated. */
+		return 1;
+	}
+
+	if((uint64_t)st.st_size == li->size)
+	{
+		return 0;
+	}
+
+	stop_indexing(li);
+
+	/* Last line might have been incomplete, so it's indexed anew along with the
+	 * appended data.  Lines before it stay untouched. */
+	li->size = st.st_size;
+	li->start = 0U;
+	if(li->count != 0)
+	{
+		li->start = li->offsets[--li->count];
+	}
+	li->complete = 0;
+	li->stop = 0;
+
+	if(start_indexing(li) != 0)
+	{
+		li->complete = 1;
+		return 1;
+	}
+
+	return 0;
+#else
+	return 1;
+#endif
+}
+
+int
+li_count(line_index_t *li, int *complete)
+{
+	int count;
+
+	pthread_mutex_lock(&li->lock);
+	count = li->count;
+	*complete = li->complete;
+	pthread_mutex_unlock(&li->lock);
+
+	return count;
+}
+
+int
+li_wait(line_index_t *li, int n)
+{
+	int count;
+
+	pthread_mutex_lock(&li->lock);
+	while(li->count < n && !li->complete)
+	{
+		pthread_cond_wait(&li->progress, &li->lock);
+	}
+	count = li->count;
+	pthread_mutex_unlock(&li->lock);
+
+	return count;
+}
+
+int
+li_find(line_index_t *li, uint64_t offset)
+{
+	int l, u;
+
+	pthread_mutex_lock(&li->lock);
+
+	/* Until next line is indexed, the last one can't be said to contain the
+	 * offset. */
+	while(!li->complete &&
+			(li->count == 0 || li->offsets[li->count - 1] <= offset))
+	{
+		pthread_cond_wait(&li->progress, &li->lock);
+	}
+
+	/* Look for the last line that starts at or before the offset. */
+	l = 0;
+	u = li->count - 1;
+	while(l < u)
+	{
+		const int m = l + (u - l + 1)/2;
+		if(li->offsets[m] <= offset)
+		{
+			l = m;
+		}
+		else
+		{
+			u = m - 1;
+		}
+	}
+
+	pthread_mutex_unlock(&li->lock);
+
+	return l;
+}
+
+uint64_t
+li_size(const line_index_t *li)
+{
+	return li->size;
+}
+
+int
+li_width(line_index_t *li, int n)
+{
+	int width = 0;
+
+	pthread_mutex_lock(&li->lock);
+	if(n >= 0 && n < li->count)
+	{
+		width = li->widths[n];
+	}
+	pthread_mutex_unlock(&li->lock);
+
+	return width;
+}
+
+int
+li_widths(line_index_t *li, int first, int n, int widths[])
+{
+	pthread_mutex_lock(&li->lock);
+	n = (first < 0 || first >= li->count) ? 0 : MIN(n, li->count - first);
+	if(n > 0)
+	{
+		memcpy(widths, li->widths + first, sizeof(*widths)*n);
+	}
+	pthread_mutex_unlock(&li->lock);
+
+	return MAX(n, 0);
+}
+
+const char *
+li_get(line_index_t *li, int n)
+{
+	return li_cursor_get(&li->cursor, n);
+}
+
+li_cursor_t *
+li_cursor_new(line_index_t *li)
+{
+	li_cursor_t *const cursor = calloc(1U, sizeof(*cursor));
+	if(cursor != NULL)
+	{
+		cursor->li = li;
+		cursor->r.fd = li->fd;
+	}
+	return cursor;
+}
+
+void
+li_cursor_free(li_cursor_t *cursor)
+{
+	if(cursor != NULL)
+	{
+		free(cursor->r.buf);
+		free(cursor);
+	}
+}
+
+const char *
+li_cursor_get(li_cursor_t *cursor, int n)
+{
+#ifndef _WIN32
+	line_index_t *const li = cursor->li;
+	reader_t *const r = &cursor->r;
+	uint64_t pos;
+	uint64_t len;
+	char *line;
+
+	pthread_mutex_lock(&li->lock);
+	if(n < 0 || n >= li->count)
+	{
+		pthread_mutex_unlock(&li->lock);
+		return NULL;
+	}
+	pos = li->offsets[n];
+	pthread_mutex_unlock(&li->lock);
+
+	/* Contents of the buffer is reused, which is helpful when lines are
+	 * retrieved in order. */
+	r->size = li->size;
+	len = get_line_len(r, pos);
+	if(r->buf == NULL)
+	{
+		return "";
+	}
+
+	line = r->buf + (pos - r->offset);
+	line[len] = '\0';
+	return line;
+#else
+	return NULL;
+#endif
+}
+
+#ifndef _WIN32
+
+/* Starts indexing thread.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+start_indexing(line_index_t *li)
+{
+	li->running = (pthread_create(&li->thread, NULL, &index_thread, li) == 0);
+	return !li->running;
+}
+
+/* Makes indexing thread quit and waits for it. */
+static void
+stop_indexing(line_index_t *li)
+{
+	if(!li->running)
+	{
+		return;
+	}
+
+	li->running = 0;
+	pthread_mutex_lock(&li->lock);
+	li->stop = 1;
+	pthread_mutex_unlock(&li->lock);
+	(void)pthread_join(li->thread, NULL);
+}
+
+/* Entry point of indexing thread.  Returns NULL. */
+static void *
+index_thread(void *arg)
+{
+	line_index_t *const li = arg;
+	uint64_t offsets[BATCH_SIZE];
+	int widths[BATCH_SIZE];
+	int n = 0;
+	reader_t r = { .fd = li->fd, .size = li->size, .offset = li->start };
+	uint64_t pos = li->start;
+
+	while(pos < r.size)
+	{
+		const uint64_t len = get_line_len(&r, pos);
+
+		offsets[n] = pos;
+		widths[n] = measure_line(li, &r, pos, len);
+		++n;
+
+		pos = skip_eol(&r, pos + len);
+
+		if(n == BATCH_SIZE && pos < r.size)
+		{
+			if(publish(li, offsets, widths, n, 0) != 0)
+			{
+				break;
+			}
+			n = 0;
+		}
+	}
+
+	/* Reader reduces size if the file gets shorter, so this is always reached
+	 * unless indexing was stopped. */
+	if(pos >= r.size)
+	{
+		(void)publish(li, offsets, widths, n, 1);
+	}
+
+	free(r.buf);
+	return NULL;
+}
+
+/* Invokes measure callback for a line, which must be loaded into the reader.
+ * Returns the width or zero if there is no callback. */
+static int
+measure_line(const line_index_t *li, reader_t *r, uint64_t pos, uint64_t len)
+{
+	char *line;
+	char c;
+	int width;
+
+	if(li->measure == NULL || r->buf == NULL)
+	{
+		return 0;
+	}
+
+	/* There is always room for terminating null character. */
+	line = r->buf + (pos - r->offset);
+	c = line[len];
+	line[len] = '\0';
+	width = li->measure(line);
+	line[len] = c;
+
+	return width;
+}
+
+/* Appends batch of lines to the index and wakes up waiters.  Returns non-zero
+ * if indexing should be stopped, otherwise zero is returned. */
+static int
+publish(line_index_t *li, const uint64_t offsets[], const int widths[], int n,
+		int final)
+{
+	int stop;
+
+	pthread_mutex_lock(&li->lock);
+
+	stop = li->stop;
+	if(stop)
+	{
+		pthread_mutex_unlock(&li->lock);
+		return 1;
+	}
+
+	if(li->count + n > li->capacity)
+	{
+		const int capacity = MAX(li->capacity*2, li->count + n);
+		uint64_t *const new_offsets =
+			realloc(li->offsets, sizeof(*li->offsets)*capacity);
+		int *const new_widths = (new_offsets == NULL)
+		                      ? NULL
+		                      : realloc(li->widths, sizeof(*li->widths)*capacity);
+
+		if(new_offsets != NULL)
+		{
+			li->offsets = new_offsets;
+		}
+		if(new_widths != NULL)
+		{
+			li->widths = new_widths;
+			li->capacity = capacity;
+		}
+		else
+		{
+			/* Out of memory, provide at least what we have so far. */
+			final = 1;
+			stop = 1;
+			n = 0;
+		}
+	}
+
+	if(n != 0)
+	{
+		memcpy(li->offsets + li->count, offsets, sizeof(*offsets)*n);
+		memcpy(li->widths + li->count, widths, sizeof(*widths)*n);
+		li->count += n;
+	}
+	li->complete = final;
+
+	pthread_cond_broadcast(&li->progress);
+	pthread_mutex_unlock(&li->lock);
+
+	return stop;
+}
+
+/* Computes length of line that starts at specified position and loads it into
+ * the reader.  Returns the length. */
+static uint64_t
+get_line_len(reader_t *r, uint64_t pos)
+{
+	uint64_t end = pos;
+	while(load(r, pos, end) == 0 && !is_eol(r, end))
+	{
+		++end;
+	}
+	return end - pos;
+}
+
+/* Skips end of line sequence at specified position.  Returns position of the
+ * next line. */
+static uint64_t
+skip_eol(reader_t *r, uint64_t pos)
+{
+	if(load(r, pos, pos) != 0)
+	{
+		return pos;
+	}
+
+	switch(r->buf[pos - r->offset])
+	{
+		case '\n':
+			return pos + 1U;
+		case '\r':
+			++pos;
+			return (load(r, pos, pos) == 0 && r->buf[pos - r->offset] == '\n')
+			     ? pos + 1U
+			     : pos;
+
+		default:
+			/* Nul characters are treated as line breaks and collapsed. */
+			while(load(r, pos, pos) == 0 && r->buf[pos - r->offset] == '\0')
+			{
+				++pos;
+			}
+			return pos;
+	}
+}
+
+/* Checks whether loaded byte at specified position is a line break.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+is_eol(const reader_t *r, uint64_t pos)
+{
+	const char c = r->buf[pos - r->offset];
+	return c == '\n' || c == '\r' || c == '\0';
+}
+
+/* Makes sure that byte at pos is in the buffer of the reader preserving bytes
+ * starting at keep, which is either loaded or equal to pos.  Returns zero on
+ * success and non-zero at the end of file or on error. */
+static int
+load(reader_t *r, uint64_t keep, uint64_t pos)
+{
+	ssize_t nread;
+
+	while(pos >= r->offset + r->len || pos < r->offset)
+	{
+		if(pos >= r->size)
+		{
+			return 1;
+		}
+
+		if(keep < r->offset || keep > r->offset + r->len)
+		{
+			/* Nothing to preserve. */
+			r->offset = keep;
+			r->len = 0U;
+		}
+		else if(keep != r->offset)
+		{
+			r->len -= keep - r->offset;
+			memmove(r->buf, r->buf + (keep - r->offset), r->len);
+			r->offset = keep;
+		}
+
+		if(r->capacity - r->len < READ_SIZE)
+		{
+			const size_t capacity = MAX(r->capacity*2, r->len + READ_SIZE);
+			char *const buf = realloc(r->buf, capacity + 1U);
+			if(buf == NULL)
+			{
+				return 1;
+			}
+			r->buf = buf;
+			r->capacity = capacity;
+		}
+
+		nread = pread(r->fd, r->buf + r->len, r->capacity - r->len,
+				r->offset + r->len);
+		if(nread <= 0)
+		{
+			/* The file got shorter, pretend that it ends here. */
+			r->size = r->offset + r->len;
+			return 1;
+		}
+		r->len += nread;
+	}
+
+	return 0;
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
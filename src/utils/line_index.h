@@ -0,0 +1,102 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__LINE_INDEX_H__
+#define VIFM__UTILS__LINE_INDEX_H__
+
+#include <stdint.h> /* uint64_t */
+
+/* Lines of a file, which is read on demand.  File contents isn't kept in
+ * memory, only offsets of lines are stored.  The index is built by a background
+ * thread starting from the beginning of the file, callers wait for the part
+ * they need.  Lines are split the same way read_file_lines() does it.
+ * Functions must be called from a single thread, except for li_wait() and
+ * cursors, which allow reading lines from other threads.
+ *
+ * The file isn't mapped into memory on purpose: accessing mapping of a file
+ * that was truncated raises SIGBUS, while the file can be a log that is being
+ * written to and rotated. */
+
+/* Opaque index type. */
+typedef struct line_index_t line_index_t;
+
+/* Opaque type of reader of lines, which can be used by another thread. */
+typedef struct li_cursor_t li_cursor_t;
+
+/* Computes width of a line on the screen.  Called from the indexing thread, so
+ * must be thread-safe. */
+typedef int (*li_measure_func)(const char line[]);
+
+/* Opens regular file and starts indexing it.  The measure can be NULL.  Returns
+ * the index or NULL if file can't be indexed (e.g. it's empty). */
+line_index_t * li_open(const char path[], li_measure_func measure);
+
+/* Stops indexing and closes the file.  The li can be NULL. */
+void li_close(line_index_t *li);
+
+/* Checks whether the file has grown and indexes appended data starting with
+ * the last line, which is removed from the index until it's processed again.
+ * Contents of the file before its old end is assumed to be unchanged.  Returns
+ * zero if the file was only appended to or didn't change, otherwise (the file
+ * was truncated, replaced or an error occurred) non-zero is returned and the
+ * index should be reopened. */
+int li_update(line_index_t *li);
+
+/* Retrieves number of lines indexed so far without waiting.  *complete is set
+ * to non-zero when whole file is indexed.  Returns the number. */
+int li_count(line_index_t *li, int *complete);
+
+/* Waits until at least n lines are indexed or the end of file is reached.
+ * Returns number of indexed lines. */
+int li_wait(line_index_t *li, int n);
+
+/* Finds line that contains byte at specified offset waiting for indexer to get
+ * there.  Returns index of the line. */
+int li_find(line_index_t *li, uint64_t offset);
+
+/* Retrieves size of the indexed part of the file.  Returns the size. */
+uint64_t li_size(const line_index_t *li);
+
+/* Retrieves width of an indexed line.  Returns value computed by the measure
+ * callback or zero if it wasn't specified or n is out of range. */
+int li_width(line_index_t *li, int n);
+
+/* Retrieves widths of up to n indexed lines starting with the first one in a
+ * single step, which is much cheaper than calling li_width() for each of them.
+ * Returns number of widths stored in the widths array. */
+int li_widths(line_index_t *li, int first, int n, int widths[]);
+
+/* Reads an indexed line.  Returns pointer to null-terminated string, which is
+ * valid until the next call, or NULL if n is out of range. */
+const char * li_get(line_index_t *li, int n);
+
+/* Creates a cursor, which provides access to lines of the index from another
+ * thread.  li_update() and li_close() must not be called while the cursor is in
+ * use.  Returns the cursor or NULL on error. */
+li_cursor_t * li_cursor_new(line_index_t *li);
+
+/* Frees the cursor.  The cursor can be NULL. */
+void li_cursor_free(li_cursor_t *cursor);
+
+/* Same as li_get(), but uses buffer of the cursor. */
+const char * li_cursor_get(li_cursor_t *cursor, int n);
+
+#endif /* VIFM__UTILS__LINE_INDEX_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,391 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "match_index.h"
+
+#include <pthread.h>
+#include <regex.h> /* regcomp() regexec() regfree() regex_t */
+
+#include <errno.h> /* ETIMEDOUT */
+#include <stdlib.h> /* calloc() free() realloc() */
+#include <sys/time.h> /* gettimeofday() timeval */
+#include <time.h> /* timespec */
+
+#include "macros.h"
+
+/* Number of processed lines after which waiters are notified even if nothing
+ * matched. */
+#define NOTIFY_PERIOD 1024
+
+struct match_index_t
+{
+	regex_t re;                /* Compiled pattern. */
+	mi_get_line_func get_line; /* Source of lines. */
+	void *arg;                 /* Argument of get_line. */
+
+	pthread_t thread;         /* Matching thread. */
+	int running;              /* Whether matching thread was started. */
+	pthread_mutex_t lock;     /* Protects all fields below. */
+	pthread_cond_t progress;  /* Signaled on new matches and periodically. */
+	int *matches;             /* Sorted numbers of matching lines. */
+	int count;                /* Number of matches. */
+	int capacity;             /* Number of elements matches can hold. */
+	int processed;            /* Number of processed lines. */
+	int complete;             /* Whether all lines were processed. */
+	int stop;                 /* Whether matching thread should quit. */
+};
+
+static int start_matching(match_index_t *mi);
+static void * match_thread(void *arg);
+static int add_match(match_index_t *mi, int line);
+static int find_first_after(const match_index_t *mi, int line);
+static void make_deadline(struct timespec *deadline, int timeout);
+static int wait_for_progress(match_index_t *mi, int timeout,
+		const struct timespec *deadline);
+
+match_index_t *
+mi_start(const char pattern[], int cflags, mi_get_line_func get_line,
+		void *arg)
+{
+	match_index_t *const mi = calloc(1U, sizeof(*mi));
+	if(mi == NULL)
+	{
+		return NULL;
+	}
+
+	if(regcomp(&mi->re, pattern, cflags) != 0)
+	{
+		regfree(&mi->re);
+		free(mi);
+		return NULL;
+	}
+
+	mi->get_line = get_line;
+	mi->arg = arg;
+	(void)pthread_mutex_init(&mi->lock, NULL);
+	(void)pthread_cond_init(&mi->progress, NULL);
+
+	if(start_matching(mi) != 0)
+	{
+		mi->running = 0;
+		mi_free(mi);
+		return NULL;
+	}
+
+	return mi;
+}
+
+void
+mi_free(match_index_t *mi)
+{
+	if(mi == NULL)
+	{
+		return;
+	}
+
+	mi_pause(mi);
+
+	pthread_cond_destroy(&mi->progress);
+	pthread_mutex_destroy(&mi->lock);
+	regfree(&mi->re);
+	free(mi->matches);
+	free(mi);
+}
+
+void
+mi_pause(match_index_t *mi)
+{
+	if(mi == NULL || !mi->running)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&mi->lock);
+	mi->stop = 1;
+	pthread_mutex_unlock(&mi->lock);
+
+	(void)pthread_join(mi->thread, NULL);
+	mi->running = 0;
+}
+
+void
+mi_resume(match_index_t *mi, int first)
+{
+	if(mi == NULL)
+	{
+		return;
+	}
+
+	mi_pause(mi);
+
+	mi->count = find_first_after(mi, first - 1);
+	mi->processed = MIN(mi->processed, first);
+	mi->complete = 0;
+	mi->stop = 0;
+
+	if(start_matching(mi) != 0)
+	{
+		/* Nothing else can be done, so pretend there are no more lines. */
+		mi->complete = 1;
+	}
+}
+
+int
+mi_next(match_index_t *mi, int line)
+{
+	return mi_try_next(mi, line, -1);
+}
+
+int
+mi_try_next(match_index_t *mi, int line, int timeout)
+{
+	struct timespec deadline;
+	int result = MI_PENDING;
+
+	make_deadline(&deadline, timeout);
+
+	pthread_mutex_lock(&mi->lock);
+	while(1)
+	{
+		const int i = find_first_after(mi, line);
+		if(i < mi->count)
+		{
+			result = mi->matches[i];
+			break;
+		}
+		if(mi->complete)
+		{
+			result = -1;
+			break;
+		}
+		if(wait_for_progress(mi, timeout, &deadline) != 0)
+		{
+			break;
+		}
+	}
+	pthread_mutex_unlock(&mi->lock);
+
+	return result;
+}
+
+int
+mi_prev(match_index_t *mi, int line)
+{
+	return mi_try_prev(mi, line, -1);
+}
+
+int
+mi_try_prev(match_index_t *mi, int line, int timeout)
+{
+	struct timespec deadline;
+	int result = MI_PENDING;
+
+	make_deadline(&deadline, timeout);
+
+	pthread_mutex_lock(&mi->lock);
+	while(mi->processed < line && !mi->complete)
+	{
+		if(wait_for_progress(mi, timeout, &deadline) != 0)
+		{
+			break;
+		}
+	}
+	if(mi->processed >= line || mi->complete)
+	{
+		const int i = find_first_after(mi, line - 1);
+		result = (i == 0) ? -1 : mi->matches[i - 1];
+	}
+	pthread_mutex_unlock(&mi->lock);
+
+	return result;
+}
+
+int
+mi_is_match(match_index_t *mi, int line)
+{
+	int result = -1;
+
+	pthread_mutex_lock(&mi->lock);
+	if(line < mi->processed)
+	{
+		const int i = find_first_after(mi, line - 1);
+		result = (i < mi->count && mi->matches[i] == line);
+	}
+	pthread_mutex_unlock(&mi->lock);
+
+	return result;
+}
+
+int
+mi_count(match_index_t *mi, int line, int *before, int *complete)
+{
+	int count;
+
+	pthread_mutex_lock(&mi->lock);
+	count = mi->count;
+	*before = find_first_after(mi, line - 1);
+	*complete = mi->complete;
+	pthread_mutex_unlock(&mi->lock);
+
+	return count;
+}
+
+/* Starts matching thread.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+start_matching(match_index_t *mi)
+{
+	mi->running = (pthread_create(&mi->thread, NULL, &match_thread, mi) == 0);
+	return !mi->running;
+}
+
+/* Entry point of matching thread.  Returns NULL. */
+static void *
+match_thread(void *arg)
+{
+	match_index_t *const mi = arg;
+	char *line;
+	int n;
+
+	/* Nobody else changes this field while the thread is running. */
+	n = mi->processed;
+
+	while((line = mi->get_line(n, mi->arg)) != NULL)
+	{
+		const int matched = (regexec(&mi->re, line, 0, NULL, 0) == 0);
+		free(line);
+
+		if(matched || (n + 1)%NOTIFY_PERIOD == 0)
+		{
+			pthread_mutex_lock(&mi->lock);
+			if(mi->stop)
+			{
+				pthread_mutex_unlock(&mi->lock);
+				return NULL;
+			}
+			if(matched && add_match(mi, n) != 0)
+			{
+				/* Out of memory, provide at least what we have so far. */
+				mi->complete = 1;
+				pthread_cond_broadcast(&mi->progress);
+				pthread_mutex_unlock(&mi->lock);
+				return NULL;
+			}
+			mi->processed = n + 1;
+			pthread_cond_broadcast(&mi->progress);
+			pthread_mutex_unlock(&mi->lock);
+		}
+
+		++n;
+	}
+
+	pthread_mutex_lock(&mi->lock);
+	if(!mi->stop)
+	{
+		mi->processed = n;
+		mi->complete = 1;
+		pthread_cond_broadcast(&mi->progress);
+	}
+	pthread_mutex_unlock(&mi->lock);
+
+	return NULL;
+}
+
+/* Appends line to the list of matches.  Must be called with the lock held.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+add_match(match_index_t *mi, int line)
+{
+	if(mi->count == mi->capacity)
+	{
+		const int capacity = MAX(mi->capacity*2, 64);
+		int *const matches = realloc(mi->matches, sizeof(*matches)*capacity);
+		if(matches == NULL)
+		{
+			return 1;
+		}
+		mi->matches = matches;
+		mi->capacity = capacity;
+	}
+
+	mi->matches[mi->count++] = line;
+	return 0;
+}
+
+/* Finds first match that goes after the line.  Must be called with the lock
+ * held.  Returns index in the list of matches, which is equal to number of
+ * matches if there is no such match. */
+static int
+find_first_after(const match_index_t *mi, int line)
+{
+	int l = 0, u = mi->count;
+	while(l < u)
+	{
+		const int m = l + (u - l)/2;
+		if(mi->matches[m] <= line)
+		{
+			l = m + 1;
+		}
+		else
+		{
+			u = m;
+		}
+	}
+	return l;
+}
+
+/* Computes moment of time that's timeout milliseconds away from now.  Negative
+ * timeout means no deadline, in which case nothing is done. */
+static void
+make_deadline(struct timespec *deadline, int timeout)
+{
+	struct timeval tv;
+
+	if(timeout < 0)
+	{
+		return;
+	}
+
+	(void)gettimeofday(&tv, NULL);
+	deadline->tv_sec = tv.tv_sec + timeout/1000;
+	deadline->tv_nsec = tv.tv_usec*1000L + (timeout%1000)*1000000L;
+	if(deadline->tv_nsec >= 1000000000L)
+	{
+		++deadline->tv_sec;
+		deadline->tv_nsec -= 1000000000L;
+	}
+}
+
+/* Waits for the matching thread to make progress.  Must be called with
+ * mi->lock held.  Returns non-zero if deadline was reached, otherwise zero is
+ * returned. */
+static int
+wait_for_progress(match_index_t *mi, int timeout,
+		const struct timespec *deadline)
+{
+	if(timeout < 0)
+	{
+		pthread_cond_wait(&mi->progress, &mi->lock);
+		return 0;
+	}
+	return pthread_cond_timedwait(&mi->progress, &mi->lock, deadline)
+	    == ETIMEDOUT;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,83 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__MATCH_INDEX_H__
+#define VIFM__UTILS__MATCH_INDEX_H__
+
+/* Sorted list of numbers of lines that match a regular expression.  Lines are
+ * matched in order by a background thread, queries wait for it to get far
+ * enough to answer them.  Functions must be called from a single thread. */
+
+/* Opaque index type. */
+typedef struct match_index_t match_index_t;
+
+/* Retrieves nth line to be matched.  Called from the background thread.
+ * Returns newly allocated string or NULL if there is no such line. */
+typedef char * (*mi_get_line_func)(int n, void *arg);
+
+/* Starts matching lines against the pattern.  Returns the index or NULL if the
+ * pattern is invalid or on error. */
+match_index_t * mi_start(const char pattern[], int cflags,
+		mi_get_line_func get_line, void *arg);
+
+/* Stops matching and frees the index.  The mi can be NULL. */
+void mi_free(match_index_t *mi);
+
+/* Suspends matching, so that lines can be changed.  The mi can be NULL. */
+void mi_pause(match_index_t *mi);
+
+/* Forgets about lines starting with the first one and resumes matching from
+ * there.  The mi can be NULL. */
+void mi_resume(match_index_t *mi, int first);
+
+/* Value returned by mi_try_next() and mi_try_prev() when result isn't known
+ * yet. */
+#define MI_PENDING (-2)
+
+/* Finds the first matching line after the specified one waiting for it to be
+ * found.  Returns line number or -1 if there is no such line. */
+int mi_next(match_index_t *mi, int line);
+
+/* Same as mi_next(), but waits at most timeout milliseconds (negative value
+ * means no limit).  Returns line number, -1 if there is no such line or
+ * MI_PENDING if it's not known yet. */
+int mi_try_next(match_index_t *mi, int line, int timeout);
+
+/* Finds the last matching line before the specified one waiting for lines to
+ * be processed up to there.  Returns line number or -1 if there is no such
+ * line. */
+int mi_prev(match_index_t *mi, int line);
+
+/* Same as mi_prev(), but waits at most timeout milliseconds (negative value
+ * means no limit).  Returns line number, -1 if there is no such line or
+ * MI_PENDING if it's not known yet. */
+int mi_try_prev(match_index_t *mi, int line, int timeout);
+
+/* Checks whether the line matches without waiting.  Returns 1 if it does, 0 if
+ * it doesn't and -1 if the line wasn't processed yet. */
+int mi_is_match(match_index_t *mi, int line);
+
+/* Retrieves number of matches found so far.  *complete is set to non-zero if
+ * all lines were processed.  *before is set to number of matches that precede
+ * the line.  Returns the number. */
+int mi_count(match_index_t *mi, int line, int *before, int *complete);
+
+#endif /* VIFM__UTILS__MATCH_INDEX_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
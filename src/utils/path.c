@@ -668,6 +668,13 @@ find_cmd_in_path(const char cmd[], size_t path_len, char path[])
 	size_t paths_count;
 	char **paths;
 
+#ifndef _WIN32
+	if(strchr(cmd, '/') == NULL)
+	{
+		return find_path_exec(cmd, path_len, path);
+	}
+#endif
+
 	paths = get_paths(&paths_count);
 	for(i = 0; i < paths_count; i++)
 	{
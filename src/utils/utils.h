@@ -196,6 +196,10 @@ void stop_process(void);
  * by Vifm messed it up. */
 void update_terminal_settings(void);
 
+/* Queries number of processors available to the application.  Returns the
+ * number, which is at least one. */
+int get_cpu_count(void);
+
 #ifdef _WIN32
 #include "utils_win.h"
 #else
@@ -28,7 +28,7 @@
 #include <fcntl.h> /* O_RDONLY open() close() */
 #include <grp.h> /* getgrnam() */
 #include <pwd.h> /* getpwnam() */
-#include <unistd.h> /* X_OK dup2() getpid() pause() */
+#include <unistd.h> /* X_OK dup2() getpid() pause() sysconf() */
 
 #include <assert.h> /* assert() */
 #include <ctype.h> /* isdigit() */
@@ -285,7 +285,14 @@ get_perm_string(char buf[], int len, mode_t mode)
 int
 refers_to_slower_fs(const char from[], const char to[])
 {
-	const int i = find_path_prefix_index(to, cfg.slow_fs_list);
+	return refers_to_slower_fs_in(from, to, cfg.slow_fs_list);
+}
+
+int
+refers_to_slower_fs_in(const char from[], const char to[],
+		const char slow_fs_list[])
+{
+	const int i = find_path_prefix_index(to, slow_fs_list);
 	/* When destination is not on slow file system, no performance penalties are
 	 * expected. */
 	if(i == -1)
@@ -294,7 +301,7 @@ refers_to_slower_fs(const char from[], const char to[])
 	}
 
 	/* Otherwise, same slowdown as we have for the source location is bearable. */
-	return find_path_prefix_index(from, cfg.slow_fs_list) != i;
+	return find_path_prefix_index(from, slow_fs_list) != i;
 }
 
 int
@@ -664,5 +671,12 @@ update_terminal_settings(void)
 	/* Do nothing. */
 }
 
+int
+get_cpu_count(void)
+{
+	const long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count < 1) ? 1 : (int)count;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
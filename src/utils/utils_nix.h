@@ -47,6 +47,12 @@ int get_gid(const char group[], gid_t *gid);
 
 int S_ISEXE(mode_t mode);
 
+/* Same as refers_to_slower_fs(), but takes value of 'slowfs' explicitly, which
+ * allows using it outside of the main thread.  Returns non-zero if so,
+ * otherwise zero is returned. */
+int refers_to_slower_fs_in(const char from[], const char to[],
+		const char slow_fs_list[]);
+
 #endif /* VIFM__UTILS__UTILS_NIX_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
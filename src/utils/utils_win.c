@@ -716,5 +716,13 @@ update_terminal_settings(void)
 			ENABLE_MOUSE_INPUT | ENABLE_QUICK_EDIT_MODE);
 }
 
+int
+get_cpu_count(void)
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (info.dwNumberOfProcessors < 1) ? 1 : (int)info.dwNumberOfProcessors;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
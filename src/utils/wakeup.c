@@ -0,0 +1,123 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+
+#include "wakeup.h"
+
+#ifndef _WIN32
+#include <fcntl.h> /* FD_CLOEXEC F_GETFL F_SETFD F_SETFL O_NONBLOCK fcntl() */
+#include <unistd.h> /* close() pipe() read() write() */
+#endif
+
+#include <errno.h> /* errno */
+
+#ifndef _WIN32
+static int set_flags(int fd);
+#endif
+
+/* Both ends of the pipe, -1 if it wasn't created. */
+static int pipe_fds[2] = { -1, -1 };
+
+int
+wakeup_init(void)
+{
+#ifndef _WIN32
+	int fds[2];
+
+	if(pipe_fds[0] != -1)
+	{
+		return 0;
+	}
+
+	if(pipe(fds) != 0)
+	{
+		return 1;
+	}
+
+	if(set_flags(fds[0]) != 0 || set_flags(fds[1]) != 0)
+	{
+		close(fds[0]);
+		close(fds[1]);
+		return 1;
+	}
+
+	pipe_fds[0] = fds[0];
+	pipe_fds[1] = fds[1];
+	return 0;
+#else
+	return 1;
+#endif
+}
+
+#ifndef _WIN32
+
+/* Makes the descriptor non-blocking and not inheritable by child processes.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+set_flags(int fd)
+{
+	const int flags = fcntl(fd, F_GETFL);
+	return flags == -1
+	    || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1
+	    || fcntl(fd, F_SETFD, FD_CLOEXEC) == -1;
+}
+
+#endif
+
+void
+wakeup_notify(void)
+{
+#ifndef _WIN32
+	if(pipe_fds[1] != -1)
+	{
+		/* Full pipe is fine, the reading end is readable already then.  Keep errno
+		 * intact for the sake of signal handlers. */
+		const int saved_errno = errno;
+		const char c = '\0';
+		(void)write(pipe_fds[1], &c, 1);
+		errno = saved_errno;
+	}
+#endif
+}
+
+int
+wakeup_get_fd(void)
+{
+	return pipe_fds[0];
+}
+
+void
+wakeup_drain(void)
+{
+#ifndef _WIN32
+	char buf[64];
+
+	if(pipe_fds[0] == -1)
+	{
+		return;
+	}
+
+	while(read(pipe_fds[0], buf, sizeof(buf)) > 0)
+	{
+		/* Nothing to do with the data. */
+	}
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,45 @@
+/* vifm
+ * Copyright (C) 2015 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+
+#ifndef VIFM__UTILS__WAKEUP_H__
+#define VIFM__UTILS__WAKEUP_H__
+
+/* Self-pipe that lets background threads and signal handlers interrupt waiting
+ * for events in the main loop.  Notifications are ignored until wakeup_init()
+ * is called and on systems without pipes. */
+
+/* Creates the pipe.  Returns zero on success, otherwise non-zero is
+ * returned. */
+int wakeup_init(void);
+
+/* Makes descriptor of the pipe readable.  Safe to call from any thread and from
+ * signal handlers. */
+void wakeup_notify(void);
+
+/* Retrieves descriptor that becomes readable after wakeup_notify(), suitable
+ * for poll().  Returns the descriptor or -1 if there is none. */
+int wakeup_get_fd(void);
+
+/* Consumes all pending notifications without blocking. */
+void wakeup_drain(void);
+
+#endif /* VIFM__UTILS__WAKEUP_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
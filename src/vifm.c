@@ -95,7 +95,7 @@ static int pair_in_use(short int pair);
 static void move_pair(short int from, short int to);
 static int undo_perform_func(OPS op, void *data, const char src[],
 		const char dst[]);
-static void parse_recieved_arguments(char *args[]);
+static int parse_recieved_arguments(char *args[]);
 static void remote_cd(FileView *view, const char *path, int handle);
 static int need_to_switch_active_pane(const char lwin_path[],
 		const char rwin_path[]);
@@ -199,7 +199,11 @@ parse_args(int argc, char *argv[], const char *dir, char *lwin_path,
 		{
 			if(!ipc_server())
 			{
-				ipc_send(argv + x + 1);
+				const int result = ipc_send(argv + x + 1);
+				if(result == 0 && curr_stats.load_stage == 0)
+				{
+					exit(EXIT_SUCCESS);
+				}
 				quit_on_arg_parsing();
 			}
 		}
@@ -511,7 +515,9 @@ undo_perform_func(OPS op, void *data, const char src[], const char dst[])
 	return perform_operation(op, NULL, data, src, dst);
 }
 
-static void
+/* Applies arguments received from a remote instance.  Returns zero on success
+ * and non-zero if paths couldn't be opened in current mode. */
+static int
 parse_recieved_arguments(char *args[])
 {
 	char lwin_path[PATH_MAX] = "";
@@ -530,7 +536,7 @@ parse_recieved_arguments(char *args[])
 
 	if(NONE(vle_mode_is, NORMAL_MODE, VIEW_MODE))
 	{
-		return;
+		return 1;
 	}
 
 #ifdef _WIN32
@@ -556,6 +562,7 @@ parse_recieved_arguments(char *args[])
 
 	clean_status_bar();
 	curr_stats.save_msg = 0;
+	return 0;
 }
 
 static void
@@ -0,0 +1,173 @@
+/* Compares throughput of copying a file by iop_cp() with the plain loop over
+ * fread() and fwrite() with 32 KiB buffer, which was used before.
+ *
+ * Usage: cp [size-in-MiB [directory]]
+ *
+ * Source file of the given size (256 MiB by default) is created in the
+ * directory (current one by default) and copied there several times by each
+ * method.  Page cache isn't dropped, so both methods read cached data. */
+
+#include <sys/time.h> /* gettimeofday() timeval */
+#include <unistd.h> /* unlink() */
+
+#include <stdio.h> /* FILE fclose() fopen() fread() fwrite() printf()
+                      snprintf() */
+#include <stdlib.h> /* atol() malloc() free() */
+#include <string.h> /* memset() */
+
+#include "../../src/io/iop.h"
+#include "../../src/utils/fs_limits.h"
+
+/* Number of copies made by each method, the best time is taken. */
+#define RUNS 3
+
+static int make_source(const char path[], long size_mb);
+static int loop_cp(const char src[], const char dst[]);
+static int iop_cp_wrapper(const char src[], const char dst[]);
+static double best_time(int (*cp)(const char src[], const char dst[]),
+		const char src[], const char dst[]);
+static double now_ms(void);
+
+int
+main(int argc, char *argv[])
+{
+	const long size_mb = (argc > 1) ? atol(argv[1]) : 256L;
+	const char *const dir = (argc > 2) ? argv[2] : ".";
+	char src[PATH_MAX];
+	char dst[PATH_MAX];
+	double loop_ms, iop_ms;
+
+	snprintf(src, sizeof(src), "%s/cp-bench-src", dir);
+	snprintf(dst, sizeof(dst), "%s/cp-bench-dst", dir);
+
+	if(make_source(src, size_mb) != 0)
+	{
+		fprintf(stderr, "Failed to create %s\n", src);
+		return 1;
+	}
+
+	loop_ms = best_time(&loop_cp, src, dst);
+	iop_ms = best_time(&iop_cp_wrapper, src, dst);
+
+	printf("%-14s %9.1f ms %9.1f MiB/s\n", "fread/fwrite", loop_ms,
+			size_mb*1000.0/loop_ms);
+	printf("%-14s %9.1f ms %9.1f MiB/s\n", "iop_cp", iop_ms,
+			size_mb*1000.0/iop_ms);
+
+	unlink(src);
+	return 0;
+}
+
+/* Creates file of specified size filled with non-zero data.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+make_source(const char path[], long size_mb)
+{
+	static char block[1024*1024];
+	long i;
+
+	FILE *const f = fopen(path, "wb");
+	if(f == NULL)
+	{
+		return 1;
+	}
+
+	memset(block, 'x', sizeof(block));
+	for(i = 0L; i < size_mb; ++i)
+	{
+		if(fwrite(block, sizeof(block), 1U, f) != 1U)
+		{
+			fclose(f);
+			return 1;
+		}
+	}
+
+	return fclose(f) != 0;
+}
+
+/* Copies file the way iop_cp() used to.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+loop_cp(const char src[], const char dst[])
+{
+	char block[32*1024];
+	size_t nread;
+	int error = 0;
+
+	FILE *const in = fopen(src, "rb");
+	FILE *const out = fopen(dst, "wb");
+	if(in == NULL || out == NULL)
+	{
+		error = 1;
+	}
+
+	while(!error && (nread = fread(&block, 1, sizeof(block), in)) != 0U)
+	{
+		error = (fwrite(&block, 1, nread, out) != nread);
+	}
+
+	if(in != NULL)
+	{
+		fclose(in);
+	}
+	if(out != NULL)
+	{
+		error |= (fclose(out) != 0);
+	}
+	return error;
+}
+
+/* Copies file with iop_cp().  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+iop_cp_wrapper(const char src[], const char dst[])
+{
+	io_args_t args =
+	{
+		.arg1.src = src,
+		.arg2.dst = dst,
+		.arg3.crs = IO_CRS_REPLACE_FILES,
+	};
+	return iop_cp(&args);
+}
+
+/* Copies file several times removing the copy after each run.  Returns the
+ * best time in milliseconds. */
+static double
+best_time(int (*cp)(const char src[], const char dst[]), const char src[],
+		const char dst[])
+{
+	double best = -1.0;
+	int i;
+
+	for(i = 0; i < RUNS; ++i)
+	{
+		double elapsed;
+		const double start = now_ms();
+		if(cp(src, dst) != 0)
+		{
+			fprintf(stderr, "Copying failed\n");
+		}
+		elapsed = now_ms() - start;
+		unlink(dst);
+
+		if(best < 0.0 || elapsed < best)
+		{
+			best = elapsed;
+		}
+	}
+
+	return best;
+}
+
+/* Retrieves current time.  Returns the time in milliseconds. */
+static double
+now_ms(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec*1000.0 + tv.tv_usec/1000.0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,92 @@
+/* Compares cost of looking up program associated with a file by compiling
+ * patterns of associations on every lookup, which was done before, with
+ * ft_get_program() that uses precompiled patterns and index of extensions.
+ *
+ * Usage: filetype [number-of-associations [number-of-lookups]]
+ *
+ * Associations (200 by default) have patterns of "*.ext{N}" form and are
+ * looked up for files (1000 by default) that match the last association. */
+
+#include <sys/time.h> /* gettimeofday() timeval */
+
+#include <stdio.h> /* printf() snprintf() */
+#include <stdlib.h> /* atol() */
+
+#include "../../src/filetype.h"
+#include "../../src/globals.h"
+
+static const char * old_get_program(const char file[]);
+static double now_ms(void);
+
+int
+main(int argc, char *argv[])
+{
+	const long count = (argc > 1) ? atol(argv[1]) : 200L;
+	const long lookups = (argc > 2) ? atol(argv[2]) : 1000L;
+	char file[64];
+	double start, old_ms, new_ms;
+	long i;
+
+	ft_init(NULL);
+	ft_reset(0);
+
+	for(i = 0L; i < count; ++i)
+	{
+		char pattern[64], prog[64];
+		snprintf(pattern, sizeof(pattern), "*.ext%ld", i);
+		snprintf(prog, sizeof(prog), "prog%ld", i);
+		ft_set_programs(pattern, prog, 0, 0);
+	}
+
+	snprintf(file, sizeof(file), "file.ext%ld", count - 1L);
+
+	start = now_ms();
+	for(i = 0L; i < lookups; ++i)
+	{
+		(void)old_get_program(file);
+	}
+	old_ms = now_ms() - start;
+
+	start = now_ms();
+	for(i = 0L; i < lookups; ++i)
+	{
+		(void)ft_get_program(file);
+	}
+	new_ms = now_ms() - start;
+
+	printf("%-14s %9.1f ms %9.3f us/lookup\n", "compile+match", old_ms,
+			old_ms*1000.0/lookups);
+	printf("%-14s %9.1f ms %9.3f us/lookup\n", "indexed", new_ms,
+			new_ms*1000.0/lookups);
+
+	ft_reset(0);
+	return 0;
+}
+
+/* Finds program the way ft_get_program() used to, by matching patterns with
+ * global_matches().  Returns the command or NULL. */
+static const char *
+old_get_program(const char file[])
+{
+	int i;
+	for(i = 0; i < filetypes.count; ++i)
+	{
+		if(global_matches(filetypes.list[i].pattern, file))
+		{
+			return filetypes.list[i].records.list[0].command;
+		}
+	}
+	return NULL;
+}
+
+/* Retrieves current time.  Returns the time in milliseconds. */
+static double
+now_ms(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec*1000.0 + tv.tv_usec/1000.0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,162 @@
+/* Measures time and peak memory usage of loading lists of files of big
+ * directories.
+ *
+ * Usage: populate [number-of-files...]
+ *
+ * Each directory size is measured in a separate process to get independent
+ * peak RSS values.  Directories are created in $TMPDIR (/tmp by default). */
+
+#include <sys/resource.h> /* getrusage() rusage */
+#include <sys/stat.h> /* mkdir() */
+#include <sys/time.h> /* gettimeofday() timeval */
+#include <sys/types.h> /* pid_t */
+#include <sys/wait.h> /* waitpid() */
+#include <fcntl.h> /* O_CREAT O_WRONLY open() */
+#include <unistd.h> /* close() fork() rmdir() unlink() */
+
+#include <stdio.h> /* fprintf() printf() snprintf() */
+#include <stdlib.h> /* atol() exit() getenv() mkdtemp() */
+#include <string.h> /* memset() strcpy() strdup() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/filter.h"
+#include "../../src/filelist.h"
+#include "../../src/sort.h"
+
+static void bench_dir(long count);
+static void make_files(const char dir[], long count);
+static void remove_files(const char dir[], long count);
+static void measure(const char dir[], long count);
+static double now_ms(void);
+
+int
+main(int argc, char *argv[])
+{
+	if(argc < 2)
+	{
+		bench_dir(100000L);
+		bench_dir(1000000L);
+	}
+	else
+	{
+		int i;
+		for(i = 1; i < argc; ++i)
+		{
+			bench_dir(atol(argv[i]));
+		}
+	}
+	return 0;
+}
+
+/* Runs benchmark for a directory of count files. */
+static void
+bench_dir(long count)
+{
+	const char *const tmp = (getenv("TMPDIR") == NULL) ? "/tmp" : getenv("TMPDIR");
+	char dir[PATH_MAX];
+	pid_t pid;
+
+	snprintf(dir, sizeof(dir), "%s/vifm-bench-XXXXXX", tmp);
+	if(mkdtemp(dir) == NULL)
+	{
+		perror("mkdtemp");
+		exit(EXIT_FAILURE);
+	}
+
+	make_files(dir, count);
+
+	pid = fork();
+	if(pid == 0)
+	{
+		measure(dir, count);
+		_exit(EXIT_SUCCESS);
+	}
+	(void)waitpid(pid, NULL, 0);
+
+	remove_files(dir, count);
+}
+
+/* Populates the dir with count empty files. */
+static void
+make_files(const char dir[], long count)
+{
+	long i;
+	for(i = 0L; i < count; ++i)
+	{
+		char path[PATH_MAX];
+		int fd;
+
+		snprintf(path, sizeof(path), "%s/file-%07ld", dir, i);
+		fd = open(path, O_WRONLY | O_CREAT, 0600);
+		if(fd == -1)
+		{
+			perror(path);
+			exit(EXIT_FAILURE);
+		}
+		close(fd);
+	}
+}
+
+/* Removes files created by make_files() and the dir itself. */
+static void
+remove_files(const char dir[], long count)
+{
+	long i;
+	for(i = 0L; i < count; ++i)
+	{
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s/file-%07ld", dir, i);
+		(void)unlink(path);
+	}
+	(void)rmdir(dir);
+}
+
+/* Loads list of files of the dir twice (initial load and reload) and prints
+ * statistics. */
+static void
+measure(const char dir[], long count)
+{
+	struct rusage usage;
+	double start, load_time, reload_time;
+
+	cfg.slow_fs_list = strdup("");
+	filter_init(&lwin.manual_filter, 1);
+	filter_init(&lwin.auto_filter, 1);
+	lwin.invert = 1;
+	lwin.sort[0] = SK_BY_NAME;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+	lwin.window_rows = 40;
+	lwin.window_width = 80;
+	lwin.window_cells = 40;
+	lwin.column_count = 1;
+	strcpy(lwin.curr_dir, dir);
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	start = now_ms();
+	populate_dir_list(&lwin, 1);
+	load_time = now_ms() - start;
+
+	start = now_ms();
+	populate_dir_list(&lwin, 1);
+	reload_time = now_ms() - start;
+
+	(void)getrusage(RUSAGE_SELF, &usage);
+
+	printf("%8ld files: load %9.1f ms, reload %9.1f ms, peak RSS %8ld KiB\n",
+			count, load_time, reload_time, usage.ru_maxrss);
+	fflush(stdout);
+}
+
+/* Retrieves current time.  Returns it in milliseconds. */
+static double
+now_ms(void)
+{
+	struct timeval tv;
+	(void)gettimeofday(&tv, NULL);
+	return tv.tv_sec*1000.0 + tv.tv_usec/1000.0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,139 @@
+/* Measures time of sorting big lists of files by each of sorting keys in a
+ * single thread and in parallel.
+ *
+ * Usage: sort [number-of-entries]
+ *
+ * The list consists of synthetic entries (1000000 by default) with names of
+ * varying case, numbers and extensions and random attributes. */
+
+#include <sys/time.h> /* gettimeofday() timeval */
+
+#include <stdio.h> /* printf() snprintf() */
+#include <stdlib.h> /* atol() calloc() free() malloc() rand() srand() */
+#include <string.h> /* memcpy() memset() strdup() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/ui.h"
+#include "../../src/sort.h"
+#include "../../src/status.h"
+
+/* Description of a sorting key. */
+typedef struct
+{
+	const char *name; /* Name to print. */
+	int key;          /* The key itself. */
+}
+key_t_;
+
+static const key_t_ keys[] = {
+	{ "name",        SK_BY_NAME },
+	{ "iname",       SK_BY_INAME },
+	{ "extension",   SK_BY_EXTENSION },
+	{ "size",        SK_BY_SIZE },
+	{ "mtime",       SK_BY_TIME_MODIFIED },
+	{ "atime",       SK_BY_TIME_ACCESSED },
+	{ "ctime",       SK_BY_TIME_CHANGED },
+	{ "type",        SK_BY_TYPE },
+#ifndef _WIN32
+	{ "mode",        SK_BY_MODE },
+	{ "uid",         SK_BY_OWNER_ID },
+	{ "gid",         SK_BY_GROUP_ID },
+	{ "permissions", SK_BY_PERMISSIONS },
+#endif
+};
+
+static dir_entry_t * make_entries(long count);
+static double sort_time(const dir_entry_t entries[], long count, int key,
+		int parallel_sort);
+static double now_ms(void);
+
+int
+main(int argc, char *argv[])
+{
+	const long count = (argc > 1) ? atol(argv[1]) : 1000000L;
+	dir_entry_t *const entries = make_entries(count);
+	size_t i;
+
+	cfg.sort_numbers = 1;
+	curr_stats.dirsize_cache = dsc_create();
+	strcpy(lwin.curr_dir, "/bench");
+	lwin.list_rows = count;
+	lwin.dir_entry = malloc(count*sizeof(*lwin.dir_entry));
+
+	printf("%-12s %12s %12s\n", "key", "serial", "parallel");
+	for(i = 0U; i < sizeof(keys)/sizeof(keys[0]); ++i)
+	{
+		const double serial = sort_time(entries, count, keys[i].key, 0);
+		const double parallel = sort_time(entries, count, keys[i].key, 1);
+		printf("%-12s %9.1f ms %9.1f ms\n", keys[i].name, serial, parallel);
+		fflush(stdout);
+	}
+
+	return 0;
+}
+
+/* Sorts copy of entries by the key with specified value of 'parallelsort'.
+ * Returns time spent in milliseconds. */
+static double
+sort_time(const dir_entry_t entries[], long count, int key, int parallel_sort)
+{
+	double start;
+
+	memcpy(lwin.dir_entry, entries, count*sizeof(*entries));
+	lwin.sort[0] = key;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+	cfg.parallel_sort = parallel_sort;
+
+	start = now_ms();
+	sort_view(&lwin);
+	return now_ms() - start;
+}
+
+/* Generates count synthetic entries.  Returns the entries. */
+static dir_entry_t *
+make_entries(long count)
+{
+	static const char *const exts[] = { "", ".c", ".h", ".txt", ".tar.gz" };
+	static const char *const stems[] = { "file", "File", "IMG_", "report-v",
+		"a" };
+
+	dir_entry_t *const entries = calloc(count, sizeof(*entries));
+	long i;
+
+	srand(1);
+	for(i = 0L; i < count; ++i)
+	{
+		char name[64];
+		dir_entry_t *const entry = &entries[i];
+
+		snprintf(name, sizeof(name), "%s%ld%s", stems[rand()%5], (long)rand(),
+				exts[rand()%5]);
+
+		entry->name = strdup(name);
+		entry->origin = lwin.curr_dir;
+		entry->type = (rand()%10 == 0) ? DIRECTORY : REGULAR;
+		entry->size = rand();
+		entry->mtime = rand();
+		entry->atime = rand();
+		entry->ctime = rand();
+#ifndef _WIN32
+		entry->mode = (entry->type == DIRECTORY ? 0040000 : 0100000)
+		            | (rand() & 0777);
+		entry->uid = rand()%8;
+		entry->gid = rand()%8;
+#endif
+	}
+	return entries;
+}
+
+/* Retrieves current time.  Returns it in milliseconds. */
+static double
+now_ms(void)
+{
+	struct timeval tv;
+	(void)gettimeofday(&tv, NULL);
+	return tv.tv_sec*1000.0 + tv.tv_usec/1000.0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,124 @@
+/* Measures cost of moving many files with the same name to trash, looking them
+ * up and removing them from the list of trash entries, which used to be
+ * quadratic because of probing of taken names and linear lookups.
+ *
+ * Usage: trash [number-of-files [directory]]
+ *
+ * Empty files (50000 by default) named "index.html" are trashed into the
+ * "trash-bench" subdirectory of the directory (current one by default), which
+ * is removed afterwards. */
+
+#include <sys/stat.h> /* mkdir() */
+#include <sys/time.h> /* gettimeofday() timeval */
+#include <unistd.h> /* rmdir() unlink() */
+
+#include <stdio.h> /* FILE fclose() fopen() fprintf() printf() snprintf() */
+#include <stdlib.h> /* atol() free() malloc() realpath() */
+
+#include "../../src/utils/fs_limits.h"
+#include "../../src/trash.h"
+
+static int create_file(const char path[]);
+static double now_ms(void);
+
+int
+main(int argc, char *argv[])
+{
+	const long count = (argc > 1) ? atol(argv[1]) : 50000L;
+	const char *const dir = (argc > 2) ? argv[2] : ".";
+	char trash_dir[PATH_MAX + 16];
+	char path[PATH_MAX];
+	char **names;
+	double start, add_ms, lookup_ms, remove_ms;
+	long i;
+
+	if(realpath(dir, path) == NULL)
+	{
+		fprintf(stderr, "Failed to resolve %s\n", dir);
+		return 1;
+	}
+	snprintf(trash_dir, sizeof(trash_dir), "%s/trash-bench", path);
+
+	names = malloc(sizeof(*names)*count);
+	if(names == NULL || mkdir(trash_dir, 0700) != 0 ||
+			set_trash_dir(trash_dir) != 0)
+	{
+		fprintf(stderr, "Failed to create %s\n", trash_dir);
+		free(names);
+		return 1;
+	}
+
+	start = now_ms();
+	for(i = 0L; i < count; ++i)
+	{
+		names[i] = gen_trash_name(trash_dir, "index.html");
+		if(names[i] == NULL || create_file(names[i]) != 0 ||
+				add_to_trash("/some/path/index.html", names[i]) != 0)
+		{
+			fprintf(stderr, "Failed to trash file #%ld\n", i);
+			return 1;
+		}
+	}
+	add_ms = now_ms() - start;
+
+	start = now_ms();
+	for(i = 0L; i < count; ++i)
+	{
+		(void)is_in_trash(names[i]);
+	}
+	lookup_ms = now_ms() - start;
+
+	/* Remove entries from the middle, which shifts the rest of them. */
+	start = now_ms();
+	for(i = count/2L; i < count; ++i)
+	{
+		(void)remove_from_trash(names[i]);
+	}
+	for(i = count/2L - 1L; i >= 0L; --i)
+	{
+		(void)remove_from_trash(names[i]);
+	}
+	remove_ms = now_ms() - start;
+
+	printf("%-8s %9.1f ms %9.3f us/file\n", "trash", add_ms,
+			add_ms*1000.0/count);
+	printf("%-8s %9.1f ms %9.3f us/file\n", "lookup", lookup_ms,
+			lookup_ms*1000.0/count);
+	printf("%-8s %9.1f ms %9.3f us/file\n", "remove", remove_ms,
+			remove_ms*1000.0/count);
+
+	for(i = 0L; i < count; ++i)
+	{
+		(void)unlink(names[i]);
+		free(names[i]);
+	}
+	free(names);
+	(void)rmdir(trash_dir);
+	return 0;
+}
+
+/* Creates empty file at the path.  Returns zero on success, otherwise non-zero
+ * is returned. */
+static int
+create_file(const char path[])
+{
+	FILE *const f = fopen(path, "w");
+	if(f == NULL)
+	{
+		return 1;
+	}
+	fclose(f);
+	return 0;
+}
+
+/* Retrieves current time.  Returns the time in milliseconds. */
+static double
+now_ms(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec*1000.0 + tv.tv_usec/1000.0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
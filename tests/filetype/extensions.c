@@ -0,0 +1,106 @@
+#include <stdlib.h>
+
+#include "seatest.h"
+
+#include "../../src/filetype.h"
+
+static void
+test_extension_is_matched_case_insensitively(void)
+{
+	ft_set_programs("*.TxT", "prog", 0, 0);
+
+	assert_string_equal("prog", ft_get_program("file.txt"));
+	assert_string_equal("prog", ft_get_program("FILE.TXT"));
+	assert_true(ft_get_program("file.txt2") == NULL);
+}
+
+static void
+test_extension_does_not_match_dot_files(void)
+{
+	ft_set_programs("*.txt", "prog", 0, 0);
+
+	assert_true(ft_get_program(".txt") == NULL);
+	assert_true(ft_get_program(".file.txt") == NULL);
+}
+
+static void
+test_compound_extension_is_matched(void)
+{
+	ft_set_programs("*.bz2", "bz2", 0, 0);
+	ft_set_programs("*.tar.bz2", "tar", 0, 0);
+
+	assert_string_equal("bz2", ft_get_program("file.version.tar.bz2"));
+	assert_string_equal("bz2", ft_get_program("file.bz2"));
+	assert_true(ft_get_program("tar.bz2x") == NULL);
+}
+
+static void
+test_order_of_definition_is_preserved(void)
+{
+	ft_set_programs("*.c", "first", 0, 0);
+	ft_set_programs("[a-z]*.c", "second", 0, 0);
+	ft_set_programs("*.h,*.c", "third", 0, 0);
+
+	assert_string_equal("first", ft_get_program("main.c"));
+	assert_string_equal("third", ft_get_program("main.h"));
+}
+
+static void
+test_complex_pattern_defined_earlier_wins(void)
+{
+	ft_set_programs("main.*", "complex", 0, 0);
+	ft_set_programs("*.c", "ext", 0, 0);
+
+	assert_string_equal("complex", ft_get_program("main.c"));
+	assert_string_equal("ext", ft_get_program("other.c"));
+}
+
+static void
+test_all_programs_are_listed_in_order(void)
+{
+	assoc_records_t ft;
+
+	ft_set_programs("*.jpg,*.JPEG", "a", 0, 0);
+	ft_set_programs("*.jpeg", "b", 0, 0);
+	ft_set_programs("*", "c", 0, 0);
+	ft_set_programs("*.jpeg,*.jpeg", "d", 0, 0);
+
+	ft = ft_get_all_programs("photo.jpeg");
+	assert_int_equal(4, ft.count);
+	if(ft.count == 4)
+	{
+		assert_string_equal("a", ft.list[0].command);
+		assert_string_equal("b", ft.list[1].command);
+		assert_string_equal("c", ft.list[2].command);
+		assert_string_equal("d", ft.list[3].command);
+	}
+	ft_assoc_records_free(&ft);
+}
+
+static void
+test_viewers_use_extensions(void)
+{
+	ft_set_viewers("*.md", "cat");
+	ft_set_viewers("*.MD", "less");
+
+	assert_string_equal("cat", ft_get_viewer("README.md"));
+}
+
+void
+extensions_tests(void)
+{
+	test_fixture_start();
+
+	run_test(test_extension_is_matched_case_insensitively);
+	run_test(test_extension_does_not_match_dot_files);
+	run_test(test_compound_extension_is_matched);
+	run_test(test_order_of_definition_is_preserved);
+	run_test(test_complex_pattern_defined_earlier_wins);
+	run_test(test_all_programs_are_listed_in_order);
+	run_test(test_viewers_use_extensions);
+
+	test_fixture_end();
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -27,12 +27,25 @@ test_find_program(void)
 	assert_string_equal("console prog", prog_cmd);
 }
 
+static void
+test_invalid_pattern_does_not_match(void)
+{
+	ft_init(&prog_exists);
+
+	ft_set_programs("[", "console prog", 0, 0);
+	ft_set_programs("*.[", "console prog", 0, 0);
+
+	assert_true(ft_get_program("[") == NULL);
+	assert_true(ft_get_program("a.[") == NULL);
+}
+
 void
 find_program_tests(void)
 {
 	test_fixture_start();
 
 	run_test(test_find_program);
+	run_test(test_invalid_pattern_does_not_match);
 
 	test_fixture_end();
 }
@@ -12,6 +12,7 @@ void replace_double_comma_tests(void);
 void description_tests(void);
 void find_program_tests(void);
 void viewers_tests(void);
+void extensions_tests(void);
 
 static void
 setup(void)
@@ -35,6 +36,7 @@ all_tests(void)
 	description_tests();
 	find_program_tests();
 	viewers_tests();
+	extensions_tests();
 }
 
 int
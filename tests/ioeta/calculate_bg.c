@@ -0,0 +1,96 @@
+#include "seatest.h"
+
+#include <unistd.h> /* usleep() */
+
+#include <stddef.h> /* NULL */
+
+#include "../../src/io/private/ioeta.h"
+#include "../../src/io/ioeta.h"
+
+static void wait_for_estimation(ioeta_estim_t *estim);
+
+static void
+test_background_estimation_matches_synchronous_one(void)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL);
+
+	ioeta_calculate_bg(estim, "test-data/various-sizes");
+	ioeta_calculate_bg(estim, "test-data/existing-files");
+	wait_for_estimation(estim);
+
+	assert_int_equal(10, estim->total_items);
+	assert_int_equal(0, estim->current_item);
+	assert_int_equal(73728, estim->total_bytes);
+	assert_int_equal(0, estim->current_byte);
+
+	ioeta_free(estim);
+}
+
+static void
+test_background_estimation_can_be_mixed_with_shallow_one(void)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL);
+
+	ioeta_calculate(estim, "test-data/various-sizes", 1);
+	ioeta_calculate_bg(estim, "test-data/various-sizes");
+	wait_for_estimation(estim);
+
+	assert_int_equal(8, estim->total_items);
+	assert_int_equal(73728, estim->total_bytes);
+
+	ioeta_free(estim);
+}
+
+static void
+test_progress_is_merged_with_background_estimates(void)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL);
+
+	ioeta_calculate_bg(estim, "test-data/various-sizes");
+	wait_for_estimation(estim);
+
+	ioeta_update(estim, "file", 1, 100);
+
+	assert_int_equal(7, estim->total_items);
+	assert_int_equal(1, estim->current_item);
+	assert_int_equal(73728, estim->total_bytes);
+	assert_int_equal(100, estim->current_byte);
+
+	ioeta_free(estim);
+}
+
+static void
+test_estimation_in_progress_is_stopped_on_free(void)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL);
+
+	ioeta_calculate_bg(estim, "/");
+	ioeta_free(estim);
+}
+
+static void
+wait_for_estimation(ioeta_estim_t *estim)
+{
+	ioeta_sync(estim);
+	while(estim->estimating)
+	{
+		usleep(1000);
+		ioeta_sync(estim);
+	}
+}
+
+void
+calculate_bg_tests(void)
+{
+	test_fixture_start();
+
+	run_test(test_background_estimation_matches_synchronous_one);
+	run_test(test_background_estimation_can_be_mixed_with_shallow_one);
+	run_test(test_progress_is_merged_with_background_estimates);
+	run_test(test_estimation_in_progress_is_stopped_on_free);
+
+	test_fixture_end();
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -1,6 +1,7 @@
 #include "seatest.h"
 
 void calculate_tests(void);
+void calculate_bg_tests(void);
 void lifetime_tests(void);
 void update_tests(void);
 
@@ -8,6 +9,7 @@ void
 all_tests(void)
 {
 	calculate_tests();
+	calculate_bg_tests();
 	lifetime_tests();
 	update_tests();
 }
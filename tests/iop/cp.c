@@ -1,15 +1,22 @@
 #include "seatest.h"
 
-#include <stdio.h> /* EOF FILE fclose() fopen() fread() */
+#include <stdio.h> /* EOF FILE fclose() fopen() fputc() fread() */
 
-#include <sys/types.h> /* stat */
+#include <sys/types.h> /* off_t stat */
 #include <sys/stat.h> /* stat */
-#include <unistd.h> /* lstat() */
+#include <fcntl.h> /* O_CREAT O_TRUNC O_WRONLY open() */
+#include <unistd.h> /* close() ftruncate() lstat() pwrite() unlink() */
+
+#include <stdint.h> /* uint64_t */
 
 #include "../../src/io/iop.h"
 #include "../../src/utils/fs.h"
 #include "../../src/utils/fs_limits.h"
 
+#ifndef _WIN32
+static void sparse_file_is_copied(int data_at_end);
+#endif
+
 static int
 files_are_identical(const char a[], const char b[])
 {
@@ -225,6 +232,117 @@ test_double_block_size_plus_one_file_is_copied(void)
 	file_is_copied("../various-sizes/double-block-size-plus-one-file");
 }
 
+static void
+test_file_bigger_than_buffer_is_copied(void)
+{
+	int i;
+	FILE *const f = fopen("big", "wb");
+	assert_false(f == NULL);
+	for(i = 0; i < 1024*1024 + 1; ++i)
+	{
+		fputc(i%251, f);
+	}
+	fclose(f);
+
+	file_is_copied("big");
+
+	{
+		io_args_t args =
+		{
+			.arg1.path = "big",
+		};
+		assert_int_equal(0, iop_rmfile(&args));
+	}
+}
+
+#ifndef _WIN32
+
+static void
+test_holes_in_middle_are_preserved(void)
+{
+	sparse_file_is_copied(1);
+}
+
+static void
+test_trailing_hole_is_preserved(void)
+{
+	sparse_file_is_copied(0);
+}
+
+static void
+sparse_file_is_copied(int data_at_end)
+{
+	struct stat src, dst;
+	const off_t size = 4*1024*1024;
+	static const char data[] = "data";
+
+	const int fd = open("sparse", O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	assert_true(fd >= 0);
+	assert_int_equal(0, ftruncate(fd, size));
+	assert_int_equal(sizeof(data), pwrite(fd, data, sizeof(data), size/2));
+	if(data_at_end)
+	{
+		assert_int_equal(sizeof(data),
+				pwrite(fd, data, sizeof(data), size - sizeof(data)));
+	}
+	close(fd);
+
+	{
+		io_args_t args =
+		{
+			.arg1.src = "sparse",
+			.arg2.dst = "sparse-copy",
+		};
+		assert_int_equal(0, iop_cp(&args));
+	}
+
+	assert_true(files_are_identical("sparse", "sparse-copy"));
+
+	assert_int_equal(0, stat("sparse", &src));
+	assert_int_equal(0, stat("sparse-copy", &dst));
+	assert_true(src.st_size == dst.st_size);
+	/* File system might not support holes at all. */
+	if((uint64_t)src.st_blocks*512U < (uint64_t)src.st_size)
+	{
+		assert_true((uint64_t)dst.st_blocks*512U < (uint64_t)dst.st_size);
+		assert_true(dst.st_blocks <= src.st_blocks);
+	}
+
+	assert_int_equal(0, unlink("sparse"));
+	assert_int_equal(0, unlink("sparse-copy"));
+}
+
+#endif
+
+#ifdef __linux__
+
+static void
+test_file_of_zero_reported_size_is_copied(void)
+{
+	/* Files in /proc report zero size, yet have contents. */
+	{
+		io_args_t args =
+		{
+			.arg1.src = "/proc/version",
+			.arg2.dst = "version",
+		};
+		assert_int_equal(0, iop_cp(&args));
+	}
+
+	assert_true(files_are_identical("/proc/version", "version"));
+	assert_false(get_file_size("version") == 0);
+
+	{
+		io_args_t args =
+		{
+			.arg1.path = "version",
+		};
+		assert_int_equal(0, iop_rmfile(&args));
+	}
+}
+
+#endif
+
 static void
 test_appending_works_for_files(void)
 {
@@ -491,10 +609,17 @@ cp_tests(void)
 	run_test(test_double_block_size_file_is_copied);
 	run_test(test_double_block_size_minus_one_file_is_copied);
 	run_test(test_double_block_size_plus_one_file_is_copied);
+	run_test(test_file_bigger_than_buffer_is_copied);
 	run_test(test_appending_works_for_files);
 	run_test(test_appending_does_not_shrink_files);
 
+#ifdef __linux__
+	run_test(test_file_of_zero_reported_size_is_copied);
+#endif
+
 #ifndef _WIN32
+	run_test(test_holes_in_middle_are_preserved);
+	run_test(test_trailing_hole_is_preserved);
 	run_test(test_file_permissions_are_preserved);
 
 	/* Creating symbolic links on Windows requires administrator rights. */
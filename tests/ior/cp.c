@@ -4,10 +4,13 @@
 #include <sys/types.h> /* stat */
 #include <unistd.h> /* F_OK access() lstat() */
 
+#include <stdio.h> /* FILE fclose() fopen() fprintf() snprintf() */
+
 #include "../../src/compat/os.h"
 #include "../../src/io/iop.h"
 #include "../../src/io/ior.h"
 #include "../../src/utils/fs.h"
+#include "../../src/utils/fs_limits.h"
 #include "utils.h"
 
 static void
@@ -428,6 +431,109 @@ test_permissions_are_set_in_correct_order(void)
 	}
 }
 
+static void
+test_many_files_are_copied_concurrently(void)
+{
+	char path[PATH_MAX];
+	int i;
+
+	create_empty_nested_dir("dir", "nested-dir");
+	for(i = 0; i < 50; ++i)
+	{
+		FILE *f;
+		snprintf(path, sizeof(path), "dir/%s%d", (i%2 == 0) ? "nested-dir/" : "",
+				i);
+		f = fopen(path, "w");
+		assert_false(f == NULL);
+		fprintf(f, "%d", i);
+		fclose(f);
+	}
+
+	{
+		io_args_t args =
+		{
+			.arg1.src = "dir",
+			.arg2.dst = "dir-copy",
+			.parallelism = 4,
+		};
+		assert_int_equal(0, ior_cp(&args));
+	}
+
+	for(i = 0; i < 50; ++i)
+	{
+		snprintf(path, sizeof(path), "dir-copy/%s%d",
+				(i%2 == 0) ? "nested-dir/" : "", i);
+		assert_int_equal(i < 10 ? 1 : 2, get_file_size(path));
+	}
+
+	{
+		io_args_t args =
+		{
+			.arg1.path = "dir",
+		};
+		assert_int_equal(0, ior_rm(&args));
+	}
+
+	{
+		io_args_t args =
+		{
+			.arg1.path = "dir-copy",
+		};
+		assert_int_equal(0, ior_rm(&args));
+	}
+}
+
+static void
+test_permissions_are_set_after_concurrent_copy(void)
+{
+	struct stat src;
+	struct stat dst;
+
+	create_non_empty_nested_dir("dir", "nested-dir", "file");
+	create_empty_file("dir/file");
+	assert_int_equal(0, chmod("dir/nested-dir", 0500));
+	assert_int_equal(0, chmod("dir", 0500));
+
+	{
+		io_args_t args =
+		{
+			.arg1.src = "dir",
+			.arg2.dst = "dir-copy",
+			.parallelism = 4,
+		};
+		assert_int_equal(0, ior_cp(&args));
+	}
+
+	assert_int_equal(0, os_stat("dir", &src));
+	assert_int_equal(0, os_stat("dir-copy", &dst));
+	assert_int_equal(src.st_mode & 0777, dst.st_mode & 0777);
+	assert_int_equal(0, os_stat("dir-copy/nested-dir", &dst));
+	assert_int_equal(0500, dst.st_mode & 0777);
+	assert_int_equal(0, access("dir-copy/nested-dir/file", F_OK));
+	assert_int_equal(0, access("dir-copy/file", F_OK));
+
+	assert_int_equal(0, chmod("dir", 0700));
+	assert_int_equal(0, chmod("dir/nested-dir", 0700));
+	assert_int_equal(0, chmod("dir-copy", 0700));
+	assert_int_equal(0, chmod("dir-copy/nested-dir", 0700));
+
+	{
+		io_args_t args =
+		{
+			.arg1.path = "dir",
+		};
+		assert_int_equal(0, ior_rm(&args));
+	}
+
+	{
+		io_args_t args =
+		{
+			.arg1.path = "dir-copy",
+		};
+		assert_int_equal(0, ior_rm(&args));
+	}
+}
+
 #ifndef WIN32
 
 static void
@@ -538,6 +644,9 @@ cp_tests(void)
 	run_test(test_dir_permissions_are_preserved);
 	run_test(test_permissions_are_set_in_correct_order);
 
+	run_test(test_many_files_are_copied_concurrently);
+	run_test(test_permissions_are_set_after_concurrent_copy);
+
 #ifndef WIN32
 	/* Creating symbolic links on Windows requires administrator rights. */
 	run_test(test_symlink_to_file_is_symlink_after_copy);
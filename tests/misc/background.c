@@ -0,0 +1,192 @@
+#include "seatest.h"
+
+#include <pthread.h>
+#include <unistd.h> /* usleep() */
+
+#include "../../src/background.h"
+
+#define NTASKS 8
+
+static void counting_task(void *arg);
+static void blocking_task(void *arg);
+static void recording_task(void *arg);
+static void release_blocker(void);
+static void wait_for_tasks(int count);
+static void remove_finished_jobs(void);
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static int running;
+static int max_running;
+static int finished;
+static int released;
+static int order[2];
+static int norder;
+
+static void
+setup(void)
+{
+	running = 0;
+	max_running = 0;
+	finished = 0;
+	released = 0;
+	norder = 0;
+}
+
+static void
+teardown(void)
+{
+	remove_finished_jobs();
+}
+
+static void
+test_tasks_on_the_same_device_are_limited(void)
+{
+	int i;
+	for(i = 0; i < NTASKS; ++i)
+	{
+		assert_int_equal(0, bg_execute("count", ".", BG_UNDEFINED_TOTAL, 0,
+					&counting_task, NULL));
+	}
+
+	wait_for_tasks(NTASKS);
+
+	assert_true(max_running >= 1);
+	/* Two is the limit of concurrent tasks per device. */
+	assert_true(max_running <= 2);
+}
+
+static void
+test_operations_are_started_before_tasks(void)
+{
+	static int task_id = 0, op_id = 1;
+
+	assert_int_equal(0, bg_execute("block", ".", BG_UNDEFINED_TOTAL, 0,
+				&blocking_task, NULL));
+	assert_int_equal(0, bg_execute("block", ".", BG_UNDEFINED_TOTAL, 0,
+				&blocking_task, NULL));
+
+	pthread_mutex_lock(&lock);
+	while(running != 2)
+	{
+		pthread_cond_wait(&cond, &lock);
+	}
+	pthread_mutex_unlock(&lock);
+
+	/* Both of these have to wait for the device. */
+	assert_int_equal(0, bg_execute("task", ".", BG_UNDEFINED_TOTAL, 0,
+				&recording_task, &task_id));
+	assert_int_equal(0, bg_execute("op", ".", BG_UNDEFINED_TOTAL, 1,
+				&recording_task, &op_id));
+
+	/* Free one slot at a time, the other blocker keeps device busy until the
+	 * first of queued tasks is done. */
+	release_blocker();
+	wait_for_tasks(2);
+	assert_true(norder >= 1);
+	assert_int_equal(op_id, order[0]);
+
+	release_blocker();
+	wait_for_tasks(4);
+	assert_int_equal(2, norder);
+	assert_int_equal(task_id, order[1]);
+}
+
+/* Tracks maximum number of tasks running at the same time. */
+static void
+counting_task(void *arg)
+{
+	pthread_mutex_lock(&lock);
+	if(++running > max_running)
+	{
+		max_running = running;
+	}
+	pthread_mutex_unlock(&lock);
+
+	usleep(20000);
+
+	pthread_mutex_lock(&lock);
+	--running;
+	++finished;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+}
+
+/* Doesn't finish until released by release_blocker(). */
+static void
+blocking_task(void *arg)
+{
+	pthread_mutex_lock(&lock);
+	++running;
+	pthread_cond_broadcast(&cond);
+	while(released == 0)
+	{
+		pthread_cond_wait(&cond, &lock);
+	}
+	--released;
+	--running;
+	++finished;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+}
+
+/* Records the order in which tasks are started. */
+static void
+recording_task(void *arg)
+{
+	pthread_mutex_lock(&lock);
+	order[norder++] = *(int *)arg;
+	++finished;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+}
+
+/* Lets one of blocking tasks finish. */
+static void
+release_blocker(void)
+{
+	pthread_mutex_lock(&lock);
+	++released;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+}
+
+/* Waits until at least specified number of tasks is finished. */
+static void
+wait_for_tasks(int count)
+{
+	pthread_mutex_lock(&lock);
+	while(finished < count)
+	{
+		pthread_cond_wait(&cond, &lock);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+/* Waits for all jobs to be marked as finished and frees them. */
+static void
+remove_finished_jobs(void)
+{
+	while(jobs != NULL)
+	{
+		check_background_jobs();
+		usleep(1000);
+	}
+}
+
+void
+background_tests(void)
+{
+	test_fixture_start();
+
+	fixture_setup(setup);
+	fixture_teardown(teardown);
+
+	run_test(test_tasks_on_the_same_device_are_limited);
+	run_test(test_operations_are_started_before_tasks);
+
+	test_fixture_end();
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,139 @@
+#include "seatest.h"
+
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* free() qsort() */
+#include <string.h> /* strcmp() strdup() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/ui.h"
+#include "../../src/dir_loader.h"
+#include "../../src/types.h"
+
+static void load_all(const char path[], dir_entry_t **entries, size_t *count);
+static void free_all(dir_entry_t entries[], size_t count);
+static int name_cmp(const void *a, const void *b);
+
+static void
+test_all_entries_are_loaded(void)
+{
+	dir_entry_t *entries;
+	size_t count;
+
+	load_all("test-data/existing-files", &entries, &count);
+
+	/* "." is skipped, while ".." is left for the caller to decide. */
+	assert_int_equal(4, count);
+	qsort(entries, count, sizeof(*entries), &name_cmp);
+	assert_string_equal("..", entries[0].name);
+	assert_string_equal("a", entries[1].name);
+	assert_string_equal("b", entries[2].name);
+	assert_string_equal("c", entries[3].name);
+	assert_true(entries[1].type == REGULAR);
+	assert_true(entries[0].type == DIRECTORY);
+	assert_true(entries[1].origin == NULL);
+
+	free_all(entries, count);
+}
+
+static void
+test_missing_directory_fails(void)
+{
+	dir_entry_t *entries;
+	size_t count;
+
+	dir_loader_t *const dl = dl_start("test-data/no-such-directory");
+	assert_false(dl == NULL);
+
+	dl_wait(dl, 1U, 10000);
+	assert_true(dl_take(dl, &entries, &count));
+	assert_int_equal(0, count);
+	assert_true(dl_failed(dl));
+
+	free(entries);
+	dl_release(dl);
+}
+
+static void
+test_release_without_taking_is_fine(void)
+{
+	dir_loader_t *const dl = dl_start("test-data/existing-files");
+	assert_false(dl == NULL);
+	dl_release(dl);
+}
+
+static void
+load_all(const char path[], dir_entry_t **entries, size_t *count)
+{
+	dir_loader_t *const dl = dl_start(path);
+	assert_false(dl == NULL);
+
+	*entries = NULL;
+	*count = 0U;
+	while(1)
+	{
+		dir_entry_t *batch;
+		size_t batch_len;
+		size_t i;
+		int finished;
+
+		dl_wait(dl, 1U, 1000);
+		finished = dl_take(dl, &batch, &batch_len);
+
+		*entries = realloc(*entries, (*count + batch_len)*sizeof(**entries));
+		for(i = 0U; i < batch_len; ++i)
+		{
+			/* Names belong to the loader, which is released below. */
+			batch[i].name = strdup(batch[i].name);
+			(*entries)[*count + i] = batch[i];
+		}
+		*count += batch_len;
+		free(batch);
+
+		if(finished)
+		{
+			break;
+		}
+	}
+
+	assert_false(dl_failed(dl));
+	dl_release(dl);
+}
+
+static void
+free_all(dir_entry_t entries[], size_t count)
+{
+	size_t i;
+	for(i = 0U; i < count; ++i)
+	{
+		free(entries[i].name);
+	}
+	free(entries);
+}
+
+static int
+name_cmp(const void *a, const void *b)
+{
+	const dir_entry_t *const x = a;
+	const dir_entry_t *const y = b;
+	return strcmp(x->name, y->name);
+}
+
+void
+dir_loader_tests(void)
+{
+	test_fixture_start();
+
+	cfg.slow_fs_list = strdup("");
+
+	run_test(test_all_entries_are_loaded);
+	run_test(test_missing_directory_fails);
+	run_test(test_release_without_taking_is_fine);
+
+	free(cfg.slow_fs_list);
+	cfg.slow_fs_list = NULL;
+
+	test_fixture_end();
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
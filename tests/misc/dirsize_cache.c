@@ -0,0 +1,186 @@
+#include "seatest.h"
+
+#include <sys/stat.h> /* mkdir() */
+#include <unistd.h> /* rmdir() */
+#include <utime.h> /* utime() utimbuf */
+
+#include <stdint.h> /* uint64_t */
+
+#include "../../src/dirsize_cache.h"
+
+#define SANDBOX_DIR "test-data/sandbox/dirsize"
+
+static dirsize_cache_t *dsc;
+
+static void
+setup(void)
+{
+	dsc = dsc_create();
+	assert_false(dsc == NULL);
+}
+
+static void
+teardown(void)
+{
+	dsc_free(dsc);
+	dsc = NULL;
+}
+
+static void
+test_unknown_directory_is_not_found(void)
+{
+	uint64_t size = 10;
+	assert_true(dsc_get(dsc, "test-data/existing-files", &size) != 0);
+	assert_int_equal(10, size);
+}
+
+static void
+test_missing_directory_is_not_stored(void)
+{
+	assert_true(dsc_set(dsc, "test-data/no-such-directory", 10) != 0);
+}
+
+static void
+test_lookup_does_not_depend_on_path_spelling(void)
+{
+	uint64_t size = 0;
+
+	assert_int_equal(0, dsc_set(dsc, "test-data/existing-files", 123));
+
+	assert_int_equal(0, dsc_get(dsc, "test-data/existing-files/", &size));
+	assert_int_equal(123, size);
+
+	size = 0;
+	assert_int_equal(0,
+			dsc_get(dsc, "test-data/../test-data/./existing-files", &size));
+	assert_int_equal(123, size);
+}
+
+static void
+test_size_is_updated(void)
+{
+	uint64_t size = 0;
+
+	assert_int_equal(0, dsc_set(dsc, "test-data/existing-files", 1));
+	assert_int_equal(0, dsc_set(dsc, "test-data/existing-files", 2));
+
+	assert_int_equal(0, dsc_get(dsc, "test-data/existing-files", &size));
+	assert_int_equal(2, size);
+}
+
+static void
+test_directories_are_distinguished(void)
+{
+	uint64_t size = 0;
+
+	assert_int_equal(0, dsc_set(dsc, "test-data/existing-files", 1));
+	assert_int_equal(0, dsc_set(dsc, "test-data/read", 2));
+
+	assert_int_equal(0, dsc_get(dsc, "test-data/existing-files", &size));
+	assert_int_equal(1, size);
+	assert_int_equal(0, dsc_get(dsc, "test-data/read", &size));
+	assert_int_equal(2, size);
+}
+
+static void
+test_size_is_outdated_by_modification_of_directory(void)
+{
+	struct utimbuf times = { 1000, 1000 };
+	uint64_t size = 0;
+
+	assert_int_equal(0, mkdir(SANDBOX_DIR, 0700));
+	assert_int_equal(0, utime(SANDBOX_DIR, &times));
+
+	assert_int_equal(0, dsc_set(dsc, SANDBOX_DIR, 10));
+	assert_int_equal(0, dsc_get(dsc, SANDBOX_DIR, &size));
+	assert_int_equal(10, size);
+
+	times.modtime = 2000;
+	assert_int_equal(0, utime(SANDBOX_DIR, &times));
+
+	/* Identity of the path is remembered until revalidation. */
+	assert_int_equal(0, dsc_get(dsc, SANDBOX_DIR, &size));
+	assert_true(dsc_get_fresh(dsc, SANDBOX_DIR, &size) != 0);
+
+	dsc_revalidate(dsc);
+
+	size = 0;
+	assert_true(dsc_get(dsc, SANDBOX_DIR, &size) != 0);
+	assert_int_equal(0, size);
+
+	assert_int_equal(0, rmdir(SANDBOX_DIR));
+}
+
+static void
+test_changed_size_of_subdirectory_outdates_parents(void)
+{
+	uint64_t size = 0;
+
+	assert_int_equal(0, mkdir(SANDBOX_DIR, 0700));
+	assert_int_equal(0, mkdir(SANDBOX_DIR "/sub", 0700));
+
+	assert_int_equal(0, dsc_set(dsc, SANDBOX_DIR "/sub", 10));
+	assert_int_equal(0, dsc_set(dsc, SANDBOX_DIR, 100));
+
+	/* Same size doesn't affect parents. */
+	assert_int_equal(0, dsc_set(dsc, SANDBOX_DIR "/sub", 10));
+	assert_int_equal(0, dsc_get(dsc, SANDBOX_DIR, &size));
+	assert_int_equal(100, size);
+
+	assert_int_equal(0, dsc_set(dsc, SANDBOX_DIR "/sub", 20));
+	assert_true(dsc_get(dsc, SANDBOX_DIR, &size) != 0);
+	assert_int_equal(0, dsc_get(dsc, SANDBOX_DIR "/sub", &size));
+	assert_int_equal(20, size);
+
+	assert_int_equal(0, dsc_set(dsc, SANDBOX_DIR, 110));
+	assert_int_equal(0, dsc_get(dsc, SANDBOX_DIR, &size));
+	assert_int_equal(110, size);
+
+	assert_int_equal(0, rmdir(SANDBOX_DIR "/sub"));
+	assert_int_equal(0, rmdir(SANDBOX_DIR));
+}
+
+static void
+test_partial_size_is_not_a_size(void)
+{
+	uint64_t size = 0;
+
+	assert_int_equal(0, dsc_set_partial(dsc, "test-data/existing-files", 5));
+	assert_true(dsc_get(dsc, "test-data/existing-files", &size) != 0);
+	assert_true(dsc_get_fresh(dsc, "test-data/existing-files", &size) != 0);
+	assert_int_equal(0, dsc_get_partial(dsc, "test-data/existing-files", &size));
+	assert_int_equal(5, size);
+
+	assert_int_equal(0, dsc_set(dsc, "test-data/existing-files", 7));
+	assert_true(dsc_get_partial(dsc, "test-data/existing-files", &size) != 0);
+	assert_int_equal(0, dsc_get(dsc, "test-data/existing-files", &size));
+	assert_int_equal(7, size);
+
+	/* Partial size doesn't replace known one. */
+	assert_int_equal(0, dsc_set_partial(dsc, "test-data/existing-files", 1));
+	assert_int_equal(0, dsc_get(dsc, "test-data/existing-files", &size));
+	assert_int_equal(7, size);
+}
+
+void
+dirsize_cache_tests(void)
+{
+	test_fixture_start();
+
+	fixture_setup(setup);
+	fixture_teardown(teardown);
+
+	run_test(test_unknown_directory_is_not_found);
+	run_test(test_missing_directory_is_not_stored);
+	run_test(test_lookup_does_not_depend_on_path_spelling);
+	run_test(test_size_is_updated);
+	run_test(test_directories_are_distinguished);
+	run_test(test_size_is_outdated_by_modification_of_directory);
+	run_test(test_changed_size_of_subdirectory_outdates_parents);
+	run_test(test_partial_size_is_not_a_size);
+
+	test_fixture_end();
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,166 @@
+#include "seatest.h"
+
+#include <sys/stat.h> /* mkdir() */
+#include <unistd.h> /* link() rmdir() unlink() */
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fopen() fputc() snprintf() */
+
+#include "../../src/utils/fs_limits.h"
+#include "../../src/dirsize_cache.h"
+#include "../../src/dirsize_calc.h"
+
+#define ROOT "test-data/sandbox/dirsize"
+
+/* Number of subdirectories in the wide tree. */
+#define WIDTH 64
+
+static void make_file(const char path[], int size);
+
+static dirsize_cache_t *dsc;
+
+static void
+setup(void)
+{
+	dsc = dsc_create();
+	assert_false(dsc == NULL);
+}
+
+static void
+teardown(void)
+{
+	dsc_free(dsc);
+	dsc = NULL;
+}
+
+static void
+test_missing_directory_has_zero_size(void)
+{
+	assert_int_equal(0, dsc_calc(dsc, ROOT "/missing", 0, NULL, NULL));
+}
+
+static void
+test_nested_directories_are_summed_up(void)
+{
+	uint64_t size = 0;
+
+	assert_int_equal(0, mkdir(ROOT, 0700));
+	assert_int_equal(0, mkdir(ROOT "/sub", 0700));
+	assert_int_equal(0, mkdir(ROOT "/sub/deep", 0700));
+	make_file(ROOT "/a", 10);
+	make_file(ROOT "/sub/b", 20);
+	make_file(ROOT "/sub/deep/c", 30);
+
+	assert_int_equal(60, dsc_calc(dsc, ROOT, 0, NULL, NULL));
+
+	assert_int_equal(0, dsc_get(dsc, ROOT, &size));
+	assert_int_equal(60, size);
+	assert_int_equal(0, dsc_get(dsc, ROOT "/sub", &size));
+	assert_int_equal(50, size);
+	assert_int_equal(0, dsc_get(dsc, ROOT "/sub/deep", &size));
+	assert_int_equal(30, size);
+
+	assert_int_equal(0, unlink(ROOT "/sub/deep/c"));
+	assert_int_equal(0, unlink(ROOT "/sub/b"));
+	assert_int_equal(0, unlink(ROOT "/a"));
+	assert_int_equal(0, rmdir(ROOT "/sub/deep"));
+	assert_int_equal(0, rmdir(ROOT "/sub"));
+	assert_int_equal(0, rmdir(ROOT));
+}
+
+static void
+test_cached_sizes_are_reused_unless_forced(void)
+{
+	assert_int_equal(0, mkdir(ROOT, 0700));
+	assert_int_equal(0, mkdir(ROOT "/sub", 0700));
+	make_file(ROOT "/sub/a", 10);
+
+	assert_int_equal(0, dsc_set(dsc, ROOT "/sub", 100));
+	assert_int_equal(100, dsc_calc(dsc, ROOT, 0, NULL, NULL));
+	assert_int_equal(10, dsc_calc(dsc, ROOT, 1, NULL, NULL));
+
+	assert_int_equal(0, unlink(ROOT "/sub/a"));
+	assert_int_equal(0, rmdir(ROOT "/sub"));
+	assert_int_equal(0, rmdir(ROOT));
+}
+
+static void
+test_hard_links_are_counted_once(void)
+{
+	assert_int_equal(0, mkdir(ROOT, 0700));
+	assert_int_equal(0, mkdir(ROOT "/sub", 0700));
+	make_file(ROOT "/a", 10);
+	assert_int_equal(0, link(ROOT "/a", ROOT "/b"));
+	assert_int_equal(0, link(ROOT "/a", ROOT "/sub/c"));
+
+	assert_int_equal(10, dsc_calc(dsc, ROOT, 0, NULL, NULL));
+
+	assert_int_equal(0, unlink(ROOT "/sub/c"));
+	assert_int_equal(0, unlink(ROOT "/b"));
+	assert_int_equal(0, unlink(ROOT "/a"));
+	assert_int_equal(0, rmdir(ROOT "/sub"));
+	assert_int_equal(0, rmdir(ROOT));
+}
+
+static void
+test_wide_tree_is_processed_completely(void)
+{
+	char path[PATH_MAX];
+	int i;
+
+	assert_int_equal(0, mkdir(ROOT, 0700));
+	for(i = 0; i < WIDTH; ++i)
+	{
+		snprintf(path, sizeof(path), ROOT "/%d", i);
+		assert_int_equal(0, mkdir(path, 0700));
+		snprintf(path, sizeof(path), ROOT "/%d/%d", i, i);
+		assert_int_equal(0, mkdir(path, 0700));
+		snprintf(path, sizeof(path), ROOT "/%d/%d/file", i, i);
+		make_file(path, i);
+	}
+
+	assert_int_equal(WIDTH*(WIDTH - 1)/2, dsc_calc(dsc, ROOT, 0, NULL, NULL));
+
+	for(i = 0; i < WIDTH; ++i)
+	{
+		snprintf(path, sizeof(path), ROOT "/%d/%d/file", i, i);
+		assert_int_equal(0, unlink(path));
+		snprintf(path, sizeof(path), ROOT "/%d/%d", i, i);
+		assert_int_equal(0, rmdir(path));
+		snprintf(path, sizeof(path), ROOT "/%d", i);
+		assert_int_equal(0, rmdir(path));
+	}
+	assert_int_equal(0, rmdir(ROOT));
+}
+
+static void
+make_file(const char path[], int size)
+{
+	FILE *const f = fopen(path, "w");
+	assert_false(f == NULL);
+	while(size-- > 0)
+	{
+		fputc('x', f);
+	}
+	fclose(f);
+}
+
+void
+dirsize_calc_tests(void)
+{
+	test_fixture_start();
+
+	fixture_setup(setup);
+	fixture_teardown(teardown);
+
+	run_test(test_missing_directory_has_zero_size);
+	run_test(test_nested_directories_are_summed_up);
+	run_test(test_cached_sizes_are_reused_unless_forced);
+	run_test(test_hard_links_are_counted_once);
+	run_test(test_wide_tree_is_processed_completely);
+
+	test_fixture_end();
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -1,6 +1,22 @@
 #include "seatest.h"
 
+#ifndef _WIN32
+#include <sys/stat.h> /* chmod() */
+#include <unistd.h> /* getcwd() unlink() */
+#endif
+
+#include <stdio.h> /* FILE fclose() fopen() snprintf() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strdup() strlen() */
+
+#include "../../src/utils/env.h"
+#include "../../src/utils/fs_limits.h"
+#include "../../src/utils/path.h"
 #include "../../src/commands_completion.h"
+#include "../../src/path_env.h"
+
+#define SANDBOX_DIR "test-data/sandbox"
+#define EXEC_NAME "vifm-test-exec"
 
 static void
 test_system_shell_exists(void)
@@ -14,12 +30,102 @@ test_system_shell_exists(void)
 	assert_true(exists);
 }
 
+static void
+test_missing_command_does_not_exist(void)
+{
+	assert_false(external_command_exists("vifm-no-such-command"));
+}
+
+#ifndef _WIN32
+
+static void
+test_full_path_is_found(void)
+{
+	char path[PATH_MAX];
+	const size_t len = strlen("/sh");
+
+	assert_int_equal(0, find_cmd_in_path("sh", sizeof(path), path));
+	assert_true(strlen(path) > len);
+	assert_string_equal("/sh", path + strlen(path) - len);
+}
+
+static void
+test_new_executable_in_path_is_found(void)
+{
+	char cwd[PATH_MAX - 64];
+	char dir[PATH_MAX];
+	char exec[PATH_MAX];
+	char *const old_path = strdup(env_get("PATH"));
+	FILE *f;
+
+	assert_false(getcwd(cwd, sizeof(cwd)) == NULL);
+	snprintf(dir, sizeof(dir), "%s/" SANDBOX_DIR, cwd);
+	snprintf(exec, sizeof(exec), "%s/" SANDBOX_DIR "/" EXEC_NAME, cwd);
+
+	env_set("PATH", dir);
+	update_path_env(1);
+	assert_false(external_command_exists(EXEC_NAME));
+
+	f = fopen(exec, "w");
+	assert_false(f == NULL);
+	fclose(f);
+	assert_int_equal(0, chmod(exec, 0755));
+
+	/* Directory might be modified within the same second, so force rescan. */
+	update_path_env(1);
+	assert_true(external_command_exists(EXEC_NAME));
+
+	assert_int_equal(0, unlink(exec));
+	env_set("PATH", old_path);
+	update_path_env(1);
+	free(old_path);
+}
+
+static void
+test_file_that_became_executable_is_found(void)
+{
+	char cwd[PATH_MAX - 64];
+	char dir[PATH_MAX];
+	char exec[PATH_MAX];
+	char *const old_path = strdup(env_get("PATH"));
+	FILE *f;
+
+	assert_false(getcwd(cwd, sizeof(cwd)) == NULL);
+	snprintf(dir, sizeof(dir), "%s/" SANDBOX_DIR, cwd);
+	snprintf(exec, sizeof(exec), "%s/" SANDBOX_DIR "/" EXEC_NAME, cwd);
+
+	f = fopen(exec, "w");
+	assert_false(f == NULL);
+	fclose(f);
+
+	env_set("PATH", dir);
+	update_path_env(1);
+	assert_false(external_command_exists(EXEC_NAME));
+
+	/* This doesn't change modification time of the directory. */
+	assert_int_equal(0, chmod(exec, 0755));
+	assert_true(external_command_exists(EXEC_NAME));
+
+	assert_int_equal(0, unlink(exec));
+	env_set("PATH", old_path);
+	update_path_env(1);
+	free(old_path);
+}
+
+#endif
+
 void
 external_command_exists_tests(void)
 {
 	test_fixture_start();
 
 	run_test(test_system_shell_exists);
+	run_test(test_missing_command_does_not_exist);
+#ifndef _WIN32
+	run_test(test_full_path_is_found);
+	run_test(test_new_executable_in_path_is_found);
+	run_test(test_file_that_became_executable_is_found);
+#endif
 
 	test_fixture_end();
 }
@@ -0,0 +1,160 @@
+#include "seatest.h"
+
+#include <sys/stat.h> /* chmod() mkdir() */
+#include <unistd.h> /* rmdir() unlink() */
+
+#include <stdio.h> /* FILE fclose() fopen() fputs() rename() */
+
+#include "../../src/utils/fswatch.h"
+
+#define SANDBOX_DIR "test-data/sandbox/fswatch"
+
+static void
+setup(void)
+{
+	assert_int_equal(0, mkdir(SANDBOX_DIR, 0700));
+}
+
+static void
+teardown(void)
+{
+	(void)rmdir(SANDBOX_DIR);
+}
+
+static void
+test_missing_directory_is_not_watched(void)
+{
+	assert_true(fswatch_create("test-data/no-such-directory") == NULL);
+}
+
+static void
+test_file_creation_is_detected(void)
+{
+	FILE *f;
+	fswatch_t *const w = fswatch_create(SANDBOX_DIR);
+	if(w == NULL)
+	{
+		/* Watching isn't supported on this system. */
+		return;
+	}
+
+	assert_int_equal(FSWS_UNCHANGED, fswatch_poll(w));
+
+	f = fopen(SANDBOX_DIR "/file", "w");
+	assert_false(f == NULL);
+	fclose(f);
+
+	assert_int_equal(FSWS_UPDATED, fswatch_poll(w));
+	assert_int_equal(FSWS_UNCHANGED, fswatch_poll(w));
+
+	assert_int_equal(0, unlink(SANDBOX_DIR "/file"));
+	assert_int_equal(FSWS_UPDATED, fswatch_poll(w));
+
+	fswatch_free(w);
+}
+
+static void
+test_changes_are_reported_once_per_entry(void)
+{
+	FILE *f;
+	fswatch_change_t *changes;
+	int count;
+	fswatch_t *const w = fswatch_create(SANDBOX_DIR);
+	if(w == NULL)
+	{
+		/* Watching isn't supported on this system. */
+		return;
+	}
+
+	f = fopen(SANDBOX_DIR "/old", "w");
+	assert_false(f == NULL);
+	fclose(f);
+	assert_int_equal(FSWS_UPDATED, fswatch_poll(w));
+
+	assert_int_equal(0, rename(SANDBOX_DIR "/old", SANDBOX_DIR "/new"));
+	assert_int_equal(0, unlink(SANDBOX_DIR "/new"));
+
+	assert_int_equal(FSWS_UPDATED, fswatch_poll_changes(w, &changes, &count));
+	assert_false(changes == NULL);
+	assert_int_equal(2, count);
+	assert_string_equal("old", changes[0].name);
+	assert_true(changes[0].existed);
+	assert_string_equal("new", changes[1].name);
+	assert_false(changes[1].existed);
+	fswatch_free_changes(changes, count);
+
+	fswatch_free(w);
+}
+
+static void
+test_modification_of_file_is_reported(void)
+{
+	FILE *f;
+	fswatch_change_t *changes;
+	int count;
+	fswatch_t *const w = fswatch_create(SANDBOX_DIR);
+	if(w == NULL)
+	{
+		/* Watching isn't supported on this system. */
+		return;
+	}
+
+	f = fopen(SANDBOX_DIR "/file", "w");
+	assert_false(f == NULL);
+	fclose(f);
+	assert_int_equal(FSWS_UPDATED, fswatch_poll(w));
+
+	f = fopen(SANDBOX_DIR "/file", "a");
+	assert_false(f == NULL);
+	fputs("data", f);
+	fclose(f);
+
+	assert_int_equal(FSWS_UPDATED, fswatch_poll_changes(w, &changes, &count));
+	assert_false(changes == NULL);
+	assert_int_equal(1, count);
+	assert_string_equal("file", changes[0].name);
+	assert_true(changes[0].existed);
+	fswatch_free_changes(changes, count);
+
+	assert_int_equal(0, chmod(SANDBOX_DIR, 0750));
+	assert_int_equal(FSWS_UNCHANGED, fswatch_poll(w));
+
+	assert_int_equal(0, unlink(SANDBOX_DIR "/file"));
+	fswatch_free(w);
+}
+
+static void
+test_removal_of_directory_breaks_watcher(void)
+{
+	fswatch_t *const w = fswatch_create(SANDBOX_DIR);
+	if(w == NULL)
+	{
+		/* Watching isn't supported on this system. */
+		return;
+	}
+
+	assert_int_equal(0, rmdir(SANDBOX_DIR));
+	assert_int_equal(FSWS_ERRORED, fswatch_poll(w));
+
+	fswatch_free(w);
+}
+
+void
+fswatch_tests(void)
+{
+	test_fixture_start();
+
+	fixture_setup(setup);
+	fixture_teardown(teardown);
+
+	run_test(test_missing_directory_is_not_watched);
+	run_test(test_file_creation_is_detected);
+	run_test(test_changes_are_reported_once_per_entry);
+	run_test(test_modification_of_file_is_reported);
+	run_test(test_removal_of_directory_breaks_watcher);
+
+	test_fixture_end();
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
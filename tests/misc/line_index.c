@@ -0,0 +1,338 @@
+#include "seatest.h"
+
+#include <unistd.h> /* unlink() */
+
+#include <stddef.h> /* NULL */
+#include <stdio.h> /* FILE fclose() fopen() fprintf() fputs() rename() */
+#include <string.h> /* memset() strcmp() strlen() */
+
+#include "../../src/utils/line_index.h"
+#include "../../src/utils/string_array.h"
+
+#define SANDBOX_FILE "test-data/sandbox/line-index"
+
+/* Number of lines of a file that doesn't fit into a single batch. */
+#define MANY_LINES 10000
+
+static void write_file(const char path[], const char mode[],
+		const char contents[]);
+static void line_is(line_index_t *li, int n, const char line[]);
+static void lines_match(const char path[]);
+static int measure(const char line[]);
+
+static void
+test_empty_file_is_not_mapped(void)
+{
+	FILE *const f = fopen(SANDBOX_FILE, "w");
+	assert_false(f == NULL);
+	fclose(f);
+
+	assert_true(li_open(SANDBOX_FILE, NULL) == NULL);
+
+	assert_int_equal(0, unlink(SANDBOX_FILE));
+}
+
+static void
+test_dos_line_endings(void)
+{
+	lines_match("test-data/read/dos-line-endings");
+}
+
+static void
+test_dos_end_of_file(void)
+{
+	lines_match("test-data/read/dos-eof");
+}
+
+static void
+test_binary_data(void)
+{
+	lines_match("test-data/read/binary-data");
+}
+
+static void
+test_many_lines_are_indexed(void)
+{
+	line_index_t *li;
+	int i;
+
+	FILE *const f = fopen(SANDBOX_FILE, "w");
+	assert_false(f == NULL);
+	for(i = 0; i < MANY_LINES; ++i)
+	{
+		fprintf(f, "%d\n", i);
+	}
+	fclose(f);
+
+	li = li_open(SANDBOX_FILE, &measure);
+	assert_false(li == NULL);
+
+	assert_true(li_wait(li, 10) >= 10);
+	assert_int_equal(MANY_LINES, li_wait(li, MANY_LINES + 1));
+
+	assert_true(li_get(li, MANY_LINES) == NULL);
+	line_is(li, MANY_LINES - 1, "9999");
+	line_is(li, 1000, "1000");
+	line_is(li, 0, "0");
+	assert_int_equal(4, li_width(li, MANY_LINES - 1));
+
+	{
+		int widths[4] = { 0, 0, 0, 0 };
+		assert_int_equal(3, li_widths(li, 8, 3, widths));
+		assert_int_equal(1, widths[0]);
+		assert_int_equal(1, widths[1]);
+		assert_int_equal(2, widths[2]);
+		assert_int_equal(1, li_widths(li, MANY_LINES - 1, 4, widths));
+		assert_int_equal(0, li_widths(li, MANY_LINES, 4, widths));
+	}
+
+	/* Line "100" starts at 10*2 + 90*3 == 290. */
+	assert_int_equal(99, li_find(li, 289));
+	assert_int_equal(100, li_find(li, 290));
+	assert_int_equal(100, li_find(li, 293));
+	assert_int_equal(MANY_LINES - 1, li_find(li, li_size(li)));
+
+	li_close(li);
+
+	assert_int_equal(0, unlink(SANDBOX_FILE));
+}
+
+static void
+test_closing_while_indexing_is_fine(void)
+{
+	int i;
+
+	FILE *const f = fopen(SANDBOX_FILE, "w");
+	assert_false(f == NULL);
+	for(i = 0; i < MANY_LINES; ++i)
+	{
+		fprintf(f, "%d\n", i);
+	}
+	fclose(f);
+
+	li_close(li_open(SANDBOX_FILE, &measure));
+
+	assert_int_equal(0, unlink(SANDBOX_FILE));
+}
+
+static void
+test_appended_lines_are_indexed(void)
+{
+	line_index_t *li;
+
+	write_file(SANDBOX_FILE, "w", "first\nsecond\n");
+	li = li_open(SANDBOX_FILE, &measure);
+	assert_false(li == NULL);
+	assert_int_equal(2, li_wait(li, 3));
+
+	write_file(SANDBOX_FILE, "a", "third\n");
+	assert_int_equal(0, li_update(li));
+	assert_int_equal(3, li_wait(li, 4));
+
+	line_is(li, 0, "first");
+	line_is(li, 1, "second");
+	line_is(li, 2, "third");
+
+	li_close(li);
+	assert_int_equal(0, unlink(SANDBOX_FILE));
+}
+
+static void
+test_incomplete_last_line_is_reindexed(void)
+{
+	line_index_t *li;
+
+	write_file(SANDBOX_FILE, "w", "first\nsec");
+	li = li_open(SANDBOX_FILE, &measure);
+	assert_false(li == NULL);
+	assert_int_equal(2, li_wait(li, 3));
+
+	write_file(SANDBOX_FILE, "a", "ond\nthird");
+	assert_int_equal(0, li_update(li));
+	assert_int_equal(3, li_wait(li, 4));
+
+	line_is(li, 0, "first");
+	line_is(li, 1, "second");
+	line_is(li, 2, "third");
+
+	li_close(li);
+	assert_int_equal(0, unlink(SANDBOX_FILE));
+}
+
+static void
+test_unchanged_file_is_not_reindexed(void)
+{
+	line_index_t *li;
+
+	write_file(SANDBOX_FILE, "w", "first\nsecond\n");
+	li = li_open(SANDBOX_FILE, &measure);
+	assert_false(li == NULL);
+	assert_int_equal(2, li_wait(li, 3));
+
+	assert_int_equal(0, li_update(li));
+	assert_int_equal(2, li_wait(li, 3));
+
+	li_close(li);
+	assert_int_equal(0, unlink(SANDBOX_FILE));
+}
+
+static void
+test_truncation_is_detected(void)
+{
+	line_index_t *li;
+
+	write_file(SANDBOX_FILE, "w", "first\nsecond\n");
+	li = li_open(SANDBOX_FILE, &measure);
+	assert_false(li == NULL);
+
+	write_file(SANDBOX_FILE, "w", "new\n");
+	assert_false(li_update(li) == 0);
+
+	li_close(li);
+	assert_int_equal(0, unlink(SANDBOX_FILE));
+}
+
+static void
+test_replacement_is_detected(void)
+{
+	line_index_t *li;
+
+	write_file(SANDBOX_FILE, "w", "first\n");
+	li = li_open(SANDBOX_FILE, &measure);
+	assert_false(li == NULL);
+
+	write_file(SANDBOX_FILE ".new", "w", "first\nsecond\n");
+	assert_int_equal(0, rename(SANDBOX_FILE ".new", SANDBOX_FILE));
+	assert_false(li_update(li) == 0);
+
+	li_close(li);
+	assert_int_equal(0, unlink(SANDBOX_FILE));
+}
+
+static void
+test_long_lines_are_read(void)
+{
+	static char line[200*1024];
+	line_index_t *li;
+
+	memset(line, 'x', sizeof(line) - 1U);
+	write_file(SANDBOX_FILE, "w", line);
+	write_file(SANDBOX_FILE, "a", "\nshort\n");
+	write_file(SANDBOX_FILE, "a", line);
+
+	li = li_open(SANDBOX_FILE, &measure);
+	assert_false(li == NULL);
+	assert_int_equal(3, li_wait(li, 4));
+
+	/* assert_string_equal() can't handle strings this long. */
+	assert_int_equal(0, strcmp(li_get(li, 0), line));
+	line_is(li, 1, "short");
+	assert_int_equal(0, strcmp(li_get(li, 2), line));
+	assert_int_equal(sizeof(line) - 1U, li_width(li, 2));
+
+	li_close(li);
+	assert_int_equal(0, unlink(SANDBOX_FILE));
+}
+
+static void
+test_truncated_file_can_be_read(void)
+{
+	line_index_t *li;
+	int i;
+
+	FILE *const f = fopen(SANDBOX_FILE, "w");
+	assert_false(f == NULL);
+	for(i = 0; i < MANY_LINES; ++i)
+	{
+		fprintf(f, "%d\n", i);
+	}
+	fclose(f);
+
+	li = li_open(SANDBOX_FILE, &measure);
+	assert_false(li == NULL);
+	write_file(SANDBOX_FILE, "w", "0\n");
+
+	assert_true(li_wait(li, MANY_LINES + 1) <= MANY_LINES);
+	assert_false(li_get(li, 0) == NULL);
+
+	li_close(li);
+	assert_int_equal(0, unlink(SANDBOX_FILE));
+}
+
+/* Writes or appends contents to a file. */
+static void
+write_file(const char path[], const char mode[], const char contents[])
+{
+	FILE *const f = fopen(path, mode);
+	assert_false(f == NULL);
+	if(f != NULL)
+	{
+		fputs(contents, f);
+		fclose(f);
+	}
+}
+
+/* Checks that nth line of the index is equal to the line. */
+static void
+line_is(line_index_t *li, int n, const char line[])
+{
+	const char *const data = li_get(li, n);
+	assert_false(data == NULL);
+	if(data != NULL)
+	{
+		assert_string_equal(line, data);
+	}
+}
+
+/* Checks that index agrees with read_file_of_lines(). */
+static void
+lines_match(const char path[])
+{
+	int nlines;
+	int i;
+	char **const lines = read_file_of_lines(path, &nlines);
+	line_index_t *const li = li_open(path, &measure);
+
+	assert_false(li == NULL);
+	assert_int_equal(nlines, li_wait(li, nlines + 1));
+
+	for(i = 0; i < nlines; ++i)
+	{
+		line_is(li, i, lines[i]);
+		assert_int_equal(strlen(lines[i]), li_width(li, i));
+	}
+
+	li_close(li);
+	free_string_array(lines, nlines);
+}
+
+static int
+measure(const char line[])
+{
+	return strlen(line);
+}
+
+void
+line_index_tests(void)
+{
+	test_fixture_start();
+
+	run_test(test_empty_file_is_not_mapped);
+	run_test(test_dos_line_endings);
+	run_test(test_dos_end_of_file);
+	run_test(test_binary_data);
+	run_test(test_many_lines_are_indexed);
+	run_test(test_closing_while_indexing_is_fine);
+	run_test(test_appended_lines_are_indexed);
+	run_test(test_incomplete_last_line_is_reindexed);
+	run_test(test_unchanged_file_is_not_reindexed);
+	run_test(test_truncation_is_detected);
+	run_test(test_replacement_is_detected);
+	run_test(test_long_lines_are_read);
+	run_test(test_truncated_file_can_be_read);
+
+	test_fixture_end();
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
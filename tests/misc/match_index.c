@@ -0,0 +1,170 @@
+#include "seatest.h"
+
+#include <regex.h> /* REG_EXTENDED */
+
+#include <stddef.h> /* NULL */
+#include <string.h> /* strdup() */
+#include <unistd.h> /* usleep() */
+
+#include "../../src/utils/macros.h"
+#include "../../src/utils/match_index.h"
+
+static char * get_line(int n, void *arg);
+
+static const char *lines[] = {
+	"alpha", "beta", "gamma", "delta", "alphabet", "epsilon", "beta2",
+};
+static int nlines = ARRAY_LEN(lines);
+/* Line at which get_line() waits until this variable is changed. */
+static volatile int block_at;
+
+static void
+setup(void)
+{
+	nlines = ARRAY_LEN(lines);
+	block_at = -1;
+}
+
+static void
+test_invalid_pattern_is_rejected(void)
+{
+	assert_true(mi_start("(", REG_EXTENDED, &get_line, NULL) == NULL);
+}
+
+static void
+test_next_match_is_found(void)
+{
+	match_index_t *const mi = mi_start("^al", REG_EXTENDED, &get_line, NULL);
+	assert_false(mi == NULL);
+
+	assert_int_equal(0, mi_next(mi, -1));
+	assert_int_equal(4, mi_next(mi, 0));
+	assert_int_equal(4, mi_next(mi, 3));
+	assert_int_equal(-1, mi_next(mi, 4));
+
+	mi_free(mi);
+}
+
+static void
+test_previous_match_is_found(void)
+{
+	match_index_t *const mi = mi_start("beta", REG_EXTENDED, &get_line, NULL);
+	assert_false(mi == NULL);
+
+	assert_int_equal(-1, mi_prev(mi, 1));
+	assert_int_equal(1, mi_prev(mi, 2));
+	assert_int_equal(1, mi_prev(mi, 6));
+	assert_int_equal(6, mi_prev(mi, 100));
+
+	mi_free(mi);
+}
+
+static void
+test_matches_are_counted(void)
+{
+	int before, complete;
+	match_index_t *const mi = mi_start("a$", REG_EXTENDED, &get_line, NULL);
+	assert_false(mi == NULL);
+
+	/* Wait for all lines to be processed. */
+	assert_int_equal(-1, mi_next(mi, nlines));
+
+	assert_int_equal(4, mi_count(mi, 2, &before, &complete));
+	assert_int_equal(2, before);
+	assert_true(complete);
+
+	assert_int_equal(1, mi_is_match(mi, 2));
+	assert_int_equal(0, mi_is_match(mi, 4));
+
+	mi_free(mi);
+}
+
+static void
+test_resuming_processes_new_lines(void)
+{
+	match_index_t *mi;
+
+	nlines = 3;
+	mi = mi_start("beta", REG_EXTENDED, &get_line, NULL);
+	assert_false(mi == NULL);
+	assert_int_equal(-1, mi_next(mi, 1));
+
+	mi_pause(mi);
+	nlines = ARRAY_LEN(lines);
+	mi_resume(mi, 3);
+
+	assert_int_equal(1, mi_next(mi, -1));
+	assert_int_equal(6, mi_next(mi, 1));
+	assert_int_equal(-1, mi_next(mi, 6));
+
+	mi_free(mi);
+}
+
+static void
+test_resuming_forgets_dropped_lines(void)
+{
+	int before, complete;
+	match_index_t *const mi = mi_start("beta", REG_EXTENDED, &get_line, NULL);
+	assert_false(mi == NULL);
+	assert_int_equal(-1, mi_next(mi, 6));
+
+	mi_pause(mi);
+	nlines = 5;
+	mi_resume(mi, 2);
+
+	assert_int_equal(-1, mi_next(mi, 4));
+	assert_int_equal(1, mi_count(mi, 0, &before, &complete));
+
+	mi_free(mi);
+}
+
+static void
+test_waiting_for_unprocessed_lines_can_time_out(void)
+{
+	match_index_t *mi;
+
+	block_at = 3;
+	mi = mi_start("epsilon", REG_EXTENDED, &get_line, NULL);
+	assert_false(mi == NULL);
+
+	assert_int_equal(MI_PENDING, mi_try_next(mi, -1, 0));
+	assert_int_equal(MI_PENDING, mi_try_next(mi, -1, 10));
+	assert_int_equal(MI_PENDING, mi_try_prev(mi, 6, 10));
+
+	block_at = -1;
+	assert_int_equal(5, mi_try_next(mi, -1, -1));
+	assert_int_equal(5, mi_try_prev(mi, 6, -1));
+
+	mi_free(mi);
+}
+
+static char *
+get_line(int n, void *arg)
+{
+	while(n == block_at)
+	{
+		usleep(1000);
+	}
+	return (n < nlines) ? strdup(lines[n]) : NULL;
+}
+
+void
+match_index_tests(void)
+{
+	test_fixture_start();
+
+	fixture_setup(setup);
+
+	run_test(test_invalid_pattern_is_rejected);
+	run_test(test_next_match_is_found);
+	run_test(test_previous_match_is_found);
+	run_test(test_matches_are_counted);
+	run_test(test_resuming_processes_new_lines);
+	run_test(test_resuming_forgets_dropped_lines);
+	run_test(test_waiting_for_unprocessed_lines_can_time_out);
+
+	test_fixture_end();
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,187 @@
+#include "seatest.h"
+
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* free() */
+#include <string.h> /* memset() strcmp() */
+
+#include "../../src/preview_cache.h"
+
+/* Size of previews used to test eviction. */
+#define BIG_LEN 1000
+
+static preview_cache_t *pc;
+static pc_stamp_t stamp = { .size = 10, .mtime_sec = 20, .mtime_nsec = 30 };
+static char big[BIG_LEN];
+
+static void
+setup(void)
+{
+	memset(big, 'x', sizeof(big));
+	pc = pc_create(2500);
+	assert_false(pc == NULL);
+}
+
+static void
+teardown(void)
+{
+	pc_free(pc);
+	pc = NULL;
+}
+
+static void
+test_unknown_preview_is_not_found(void)
+{
+	size_t len;
+	assert_true(pc_get(pc, "/file", "cat", &stamp, &len) == NULL);
+}
+
+static void
+test_stored_preview_is_found(void)
+{
+	size_t len = 0;
+	char *data;
+
+	assert_int_equal(0, pc_put(pc, "/file", "cat", &stamp, "abc", 3));
+
+	data = pc_get(pc, "/file", "cat", &stamp, &len);
+	assert_false(data == NULL);
+	assert_int_equal(3, len);
+	assert_string_equal("abc", data);
+	free(data);
+}
+
+static void
+test_empty_preview_is_stored(void)
+{
+	size_t len = 10;
+	char *data;
+
+	assert_int_equal(0, pc_put(pc, "/file", "cat", &stamp, "", 0));
+
+	data = pc_get(pc, "/file", "cat", &stamp, &len);
+	assert_false(data == NULL);
+	assert_int_equal(0, len);
+	free(data);
+}
+
+static void
+test_preview_depends_on_command(void)
+{
+	size_t len;
+
+	assert_int_equal(0, pc_put(pc, "/file", "cat", &stamp, "abc", 3));
+
+	assert_true(pc_get(pc, "/file", "less", &stamp, &len) == NULL);
+	assert_true(pc_get(pc, "/file2", "cat", &stamp, &len) == NULL);
+}
+
+static void
+test_changed_file_invalidates_preview(void)
+{
+	size_t len;
+	pc_stamp_t changed = stamp;
+	changed.mtime_nsec = 31;
+
+	assert_int_equal(0, pc_put(pc, "/file", "cat", &stamp, "abc", 3));
+
+	assert_true(pc_get(pc, "/file", "cat", &changed, &len) == NULL);
+	assert_true(pc_get(pc, "/file", "cat", &stamp, &len) == NULL);
+}
+
+static void
+test_preview_is_replaced(void)
+{
+	size_t len;
+	char *data;
+
+	assert_int_equal(0, pc_put(pc, "/file", "cat", &stamp, "abc", 3));
+	assert_int_equal(0, pc_put(pc, "/file", "cat", &stamp, "xy", 2));
+
+	data = pc_get(pc, "/file", "cat", &stamp, &len);
+	assert_false(data == NULL);
+	assert_string_equal("xy", data);
+	free(data);
+}
+
+static void
+test_least_recently_used_preview_is_evicted(void)
+{
+	size_t len;
+
+	assert_int_equal(0, pc_put(pc, "/a", "cat", &stamp, big, BIG_LEN));
+	assert_int_equal(0, pc_put(pc, "/b", "cat", &stamp, big, BIG_LEN));
+	free(pc_get(pc, "/a", "cat", &stamp, &len));
+	assert_int_equal(0, pc_put(pc, "/c", "cat", &stamp, big, BIG_LEN));
+
+	assert_true(pc_get(pc, "/b", "cat", &stamp, &len) == NULL);
+
+	len = 0;
+	free(pc_get(pc, "/a", "cat", &stamp, &len));
+	assert_int_equal(BIG_LEN, len);
+	len = 0;
+	free(pc_get(pc, "/c", "cat", &stamp, &len));
+	assert_int_equal(BIG_LEN, len);
+}
+
+static void
+test_too_big_preview_is_not_stored(void)
+{
+	static char huge[3000];
+	size_t len;
+
+	assert_false(pc_put(pc, "/file", "cat", &stamp, huge, sizeof(huge)) == 0);
+	assert_true(pc_get(pc, "/file", "cat", &stamp, &len) == NULL);
+}
+
+static void
+test_has_checks_presence_and_stamp(void)
+{
+	pc_stamp_t changed = stamp;
+	changed.size = 11;
+
+	assert_false(pc_has(pc, "/file", "cat", &stamp));
+	assert_int_equal(0, pc_put(pc, "/file", "cat", &stamp, "abc", 3));
+	assert_true(pc_has(pc, "/file", "cat", &stamp));
+	assert_false(pc_has(pc, "/file", "cat", &changed));
+}
+
+static void
+test_stamp_of_missing_file_fails(void)
+{
+	pc_stamp_t s;
+	assert_false(pc_stamp("test-data/no-such-file", &s) == 0);
+}
+
+static void
+test_stamp_contains_file_size(void)
+{
+	pc_stamp_t s;
+	assert_int_equal(0, pc_stamp("test-data/read/two-lines", &s));
+	assert_true(s.size > 0);
+}
+
+void
+preview_cache_tests(void)
+{
+	test_fixture_start();
+
+	fixture_setup(setup);
+	fixture_teardown(teardown);
+
+	run_test(test_unknown_preview_is_not_found);
+	run_test(test_stored_preview_is_found);
+	run_test(test_empty_preview_is_stored);
+	run_test(test_preview_depends_on_command);
+	run_test(test_changed_file_invalidates_preview);
+	run_test(test_preview_is_replaced);
+	run_test(test_least_recently_used_preview_is_evicted);
+	run_test(test_too_big_preview_is_not_stored);
+	run_test(test_has_checks_presence_and_stamp);
+	run_test(test_stamp_of_missing_file_fails);
+	run_test(test_stamp_contains_file_size);
+
+	test_fixture_end();
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
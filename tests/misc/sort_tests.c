@@ -1,6 +1,8 @@
 #include <unistd.h> /* chdir() unlink() */
 
-#include <string.h> /* memset() */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* memcpy() memset() strdup() */
 
 #include "seatest.h"
 
@@ -83,6 +85,166 @@ test_symlink_to_dir(void)
 
 #endif
 
+static void
+test_keys_are_applied_in_order_of_precedence(void)
+{
+	lwin.sort[0] = SK_BY_SIZE;
+	lwin.sort[1] = -SK_BY_NAME;
+	memset(&lwin.sort[2], SK_NONE, sizeof(lwin.sort) - 2);
+
+	lwin.dir_entry[0].size = 10;
+	lwin.dir_entry[1].size = 20;
+	lwin.dir_entry[2].size = 10;
+
+	sort_view(&lwin);
+
+	assert_string_equal("a", lwin.dir_entry[0].name);
+	assert_string_equal("A", lwin.dir_entry[1].name);
+	assert_string_equal("_", lwin.dir_entry[2].name);
+}
+
+static void
+test_directories_go_first_and_equal_entries_keep_order(void)
+{
+	lwin.sort[0] = SK_BY_TIME_MODIFIED;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+
+	lwin.dir_entry[2].type = DIRECTORY;
+
+	sort_view(&lwin);
+
+	assert_string_equal("A", lwin.dir_entry[0].name);
+	assert_string_equal("a", lwin.dir_entry[1].name);
+	assert_string_equal("_", lwin.dir_entry[2].name);
+}
+
+static void
+test_numbers_are_compared_by_value_in_names(void)
+{
+	lwin.sort[0] = SK_BY_NAME;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+
+	replace_string(&lwin.dir_entry[0].name, "file10");
+	replace_string(&lwin.dir_entry[1].name, "file9");
+	replace_string(&lwin.dir_entry[2].name, "file");
+
+	sort_view(&lwin);
+
+	assert_string_equal("file", lwin.dir_entry[0].name);
+	assert_string_equal("file9", lwin.dir_entry[1].name);
+	assert_string_equal("file10", lwin.dir_entry[2].name);
+}
+
+static void
+test_names_without_digits_are_ordered_like_strnumcmp(void)
+{
+	lwin.sort[0] = SK_BY_NAME;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+
+	replace_string(&lwin.dir_entry[0].name, "\xc3\xa9");
+	replace_string(&lwin.dir_entry[1].name, "b1");
+	replace_string(&lwin.dir_entry[2].name, "a");
+
+	sort_view(&lwin);
+
+	assert_true(strnumcmp(lwin.dir_entry[0].name, lwin.dir_entry[1].name) < 0);
+	assert_true(strnumcmp(lwin.dir_entry[1].name, lwin.dir_entry[2].name) < 0);
+}
+
+static void
+test_parallel_sorting_matches_serial_one(void)
+{
+	enum { COUNT = 10000 };
+	dir_entry_t *original, *serial;
+	int i;
+
+	teardown();
+
+	lwin.list_rows = COUNT;
+	lwin.dir_entry = calloc(COUNT, sizeof(*lwin.dir_entry));
+	for(i = 0; i < COUNT; ++i)
+	{
+		char name[16];
+		snprintf(name, sizeof(name), "f%d", (i*7919)%COUNT);
+		lwin.dir_entry[i].name = strdup(name);
+		lwin.dir_entry[i].type = REGULAR;
+		/* Lots of equal keys to check that sorting is stable. */
+		lwin.dir_entry[i].mtime = i%10;
+	}
+
+	original = malloc(COUNT*sizeof(*original));
+	serial = malloc(COUNT*sizeof(*serial));
+	memcpy(original, lwin.dir_entry, COUNT*sizeof(*original));
+
+	lwin.sort[0] = -SK_BY_TIME_MODIFIED;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+
+	cfg.parallel_sort = 0;
+	sort_view(&lwin);
+	memcpy(serial, lwin.dir_entry, COUNT*sizeof(*serial));
+
+	memcpy(lwin.dir_entry, original, COUNT*sizeof(*original));
+	cfg.parallel_sort = 1;
+	sort_view(&lwin);
+	cfg.parallel_sort = 0;
+
+	for(i = 0; i < COUNT; ++i)
+	{
+		assert_true(serial[i].name == lwin.dir_entry[i].name);
+	}
+
+	free(serial);
+	free(original);
+}
+
+static void
+test_insertion_position_matches_sorting(void)
+{
+	dir_entry_t entry = { .name = "b", .type = REGULAR };
+
+	lwin.sort[0] = SK_BY_NAME;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+	sort_view(&lwin);
+
+	/* "A", "_", "a" */
+	assert_int_equal(3, sort_find_pos(&lwin, &entry));
+
+	entry.name = "B";
+	assert_int_equal(1, sort_find_pos(&lwin, &entry));
+
+	entry.name = "0";
+	assert_int_equal(0, sort_find_pos(&lwin, &entry));
+
+	/* Directories go before files. */
+	entry.name = "z";
+	entry.type = DIRECTORY;
+	assert_int_equal(0, sort_find_pos(&lwin, &entry));
+}
+
+static void
+test_entry_is_found_by_its_position(void)
+{
+	dir_entry_t entry = { .name = "a", .type = REGULAR };
+
+	lwin.sort[0] = SK_BY_NAME;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+	sort_view(&lwin);
+
+	/* "A", "_", "a" */
+	assert_int_equal(2, sort_find_entry(&lwin, &entry));
+
+	entry.name = "_";
+	assert_int_equal(1, sort_find_entry(&lwin, &entry));
+
+	entry.name = "b";
+	assert_int_equal(-1, sort_find_entry(&lwin, &entry));
+
+	/* Position of a directory is different. */
+	entry.name = "A";
+	entry.type = DIRECTORY;
+	assert_int_equal(-1, sort_find_entry(&lwin, &entry));
+}
+
 static void
 test_versort_without_numbers(void)
 {
@@ -277,6 +439,13 @@ sort_tests(void)
 	fixture_teardown(teardown);
 
 	run_test(test_special_chars_ignore_case_sort);
+	run_test(test_keys_are_applied_in_order_of_precedence);
+	run_test(test_directories_go_first_and_equal_entries_keep_order);
+	run_test(test_numbers_are_compared_by_value_in_names);
+	run_test(test_names_without_digits_are_ordered_like_strnumcmp);
+	run_test(test_parallel_sorting_matches_serial_one);
+	run_test(test_insertion_position_matches_sorting);
+	run_test(test_entry_is_found_by_its_position);
 
 #ifndef _WIN32
 	/* Windows is really bad at handling links. */
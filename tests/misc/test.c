@@ -55,6 +55,16 @@ void expand_status_line_macros_tests(void);
 void surrounded_with_tests(void);
 void is_in_str_list_tests(void);
 void filename_specific_highlight_tests(void);
+void dir_loader_tests(void);
+void dirsize_cache_tests(void);
+void dirsize_calc_tests(void);
+void line_index_tests(void);
+void match_index_tests(void);
+void preview_cache_tests(void);
+void trash_tests(void);
+void fswatch_tests(void);
+void wakeup_tests(void);
+void background_tests(void);
 
 void
 all_tests(void)
@@ -114,6 +124,16 @@ all_tests(void)
 	surrounded_with_tests();
 	is_in_str_list_tests();
 	filename_specific_highlight_tests();
+	dir_loader_tests();
+	dirsize_cache_tests();
+	dirsize_calc_tests();
+	line_index_tests();
+	match_index_tests();
+	preview_cache_tests();
+	trash_tests();
+	fswatch_tests();
+	wakeup_tests();
+	background_tests();
 }
 
 int
@@ -0,0 +1,246 @@
+#include "seatest.h"
+
+#include <sys/stat.h> /* mkdir() */
+#include <unistd.h> /* getcwd() rmdir() unlink() */
+
+#include <pthread.h> /* pthread_create() pthread_join() pthread_t */
+
+#include <stdio.h> /* FILE fclose() fopen() snprintf() */
+#include <stdlib.h> /* free() */
+
+#include "../../src/utils/fs_limits.h"
+#include "../../src/utils/path.h"
+#include "../../src/utils/str.h"
+#include "../../src/trash.h"
+
+#define SANDBOX_DIR "test-data/sandbox/trash"
+#define NFILES 10
+/* Number of names generated by each thread, which is enough for the map of
+ * counters to be grown and emptied several times. */
+#define NTHREAD_NAMES 3000
+
+static void create_file(const char path[]);
+static void remove_trashed_files(void);
+static void * gen_names(void *arg);
+
+static char trash_dir[PATH_MAX];
+
+static void
+setup(void)
+{
+	char cwd[PATH_MAX - 64];
+
+	assert_false(getcwd(cwd, sizeof(cwd)) == NULL);
+	snprintf(trash_dir, sizeof(trash_dir), "%s/" SANDBOX_DIR, cwd);
+
+	assert_int_equal(0, mkdir(SANDBOX_DIR, 0700));
+	assert_int_equal(0, set_trash_dir(trash_dir));
+}
+
+static void
+teardown(void)
+{
+	remove_trashed_files();
+	assert_int_equal(0, rmdir(SANDBOX_DIR));
+}
+
+static void
+test_many_files_with_same_name_get_unique_trash_names(void)
+{
+	int i;
+	char *trash_name = NULL;
+
+	for(i = 0; i < NFILES; ++i)
+	{
+		free(trash_name);
+		trash_name = gen_trash_name(trash_dir, "index.html");
+		assert_false(trash_name == NULL);
+		assert_false(is_in_trash(trash_name));
+
+		create_file(trash_name);
+		assert_int_equal(0, add_to_trash("/some/path/index.html", trash_name));
+	}
+
+	assert_int_equal(NFILES, nentries);
+	assert_string_equal("009_index.html", get_last_path_component(trash_name));
+	assert_true(is_in_trash(trash_name));
+	free(trash_name);
+}
+
+static void
+test_lookup_works_after_removal_from_the_middle(void)
+{
+	char *const first = gen_trash_name(trash_dir, "file");
+	char *second, *third;
+
+	create_file(first);
+	second = gen_trash_name(trash_dir, "file");
+	create_file(second);
+	third = gen_trash_name(trash_dir, "file");
+	create_file(third);
+
+	assert_int_equal(0, add_to_trash("/a/file", first));
+	assert_int_equal(0, add_to_trash("/b/file", second));
+	assert_int_equal(0, add_to_trash("/c/file", third));
+
+	assert_int_equal(0, remove_from_trash(second));
+	assert_true(remove_from_trash(second) != 0);
+
+	assert_true(is_in_trash(first));
+	assert_false(is_in_trash(second));
+	assert_true(is_in_trash(third));
+	assert_int_equal(0, remove_from_trash(third));
+	assert_int_equal(1, nentries);
+	assert_string_equal("/a/file", trash_list[0].path);
+
+	assert_int_equal(0, unlink(second));
+	assert_int_equal(0, unlink(third));
+
+	free(first);
+	free(second);
+	free(third);
+}
+
+static void
+test_lookup_works_after_several_removals(void)
+{
+	char *names[NFILES];
+	int i;
+
+	for(i = 0; i < NFILES; ++i)
+	{
+		names[i] = gen_trash_name(trash_dir, "file");
+		create_file(names[i]);
+		assert_int_equal(0, add_to_trash("/some/path/file", names[i]));
+	}
+
+	for(i = 1; i < NFILES; i += 2)
+	{
+		assert_int_equal(0, remove_from_trash(names[i]));
+		assert_int_equal(0, unlink(names[i]));
+	}
+
+	assert_int_equal(NFILES/2, nentries);
+	for(i = 0; i < NFILES; ++i)
+	{
+		assert_int_equal(i%2 == 0, is_in_trash(names[i]));
+		free(names[i]);
+	}
+}
+
+static void
+test_names_are_unique_after_pruning(void)
+{
+	char *const first = gen_trash_name(trash_dir, "file");
+	char *second;
+
+	create_file(first);
+	assert_int_equal(0, add_to_trash("/a/file", first));
+	trash_prune_dead_entries();
+
+	second = gen_trash_name(trash_dir, "file");
+	assert_true(stroscmp(first, second) != 0);
+
+	free(first);
+	free(second);
+}
+
+static void
+test_names_are_not_reused_after_removal(void)
+{
+	char *const first = gen_trash_name(trash_dir, "file");
+	char *second;
+
+	create_file(first);
+	assert_int_equal(0, add_to_trash("/a/file", first));
+	second = gen_trash_name(trash_dir, "file");
+	assert_false(is_in_trash(second));
+	assert_true(stroscmp(first, second) != 0);
+
+	free(first);
+	free(second);
+}
+
+static void
+test_names_can_be_generated_from_several_threads(void)
+{
+	pthread_t thread;
+	void *main_failures;
+	void *thread_failures;
+
+	assert_int_equal(0, pthread_create(&thread, NULL, &gen_names, "a"));
+	main_failures = gen_names("b");
+	assert_int_equal(0, pthread_join(thread, &thread_failures));
+
+	assert_true(main_failures == NULL);
+	assert_true(thread_failures == NULL);
+}
+
+/* Generates many trash names prefixed with the arg.  Returns NULL on success
+ * and non-NULL on failure. */
+static void *
+gen_names(void *arg)
+{
+	const char *const prefix = arg;
+	int failed = 0;
+	int i;
+
+	for(i = 0; i < NTHREAD_NAMES; ++i)
+	{
+		char name[32];
+		char *trash_name;
+
+		snprintf(name, sizeof(name), "%s%d", prefix, i);
+		trash_name = gen_trash_name(trash_dir, name);
+		failed |= (trash_name == NULL);
+		free(trash_name);
+	}
+
+	return failed ? arg : NULL;
+}
+
+/* Creates empty file at the path. */
+static void
+create_file(const char path[])
+{
+	FILE *const f = fopen(path, "w");
+	assert_false(f == NULL);
+	if(f != NULL)
+	{
+		fclose(f);
+	}
+}
+
+/* Removes files of all trash entries and the entries themselves. */
+static void
+remove_trashed_files(void)
+{
+	int i;
+	for(i = 0; i < nentries; ++i)
+	{
+		assert_int_equal(0, unlink(trash_list[i].trash_name));
+	}
+	trash_prune_dead_entries();
+	assert_int_equal(0, nentries);
+}
+
+void
+trash_tests(void)
+{
+	test_fixture_start();
+
+	fixture_setup(setup);
+	fixture_teardown(teardown);
+
+	run_test(test_many_files_with_same_name_get_unique_trash_names);
+	run_test(test_lookup_works_after_removal_from_the_middle);
+	run_test(test_lookup_works_after_several_removals);
+	run_test(test_names_are_unique_after_pruning);
+	run_test(test_names_are_not_reused_after_removal);
+	run_test(test_names_can_be_generated_from_several_threads);
+
+	test_fixture_end();
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
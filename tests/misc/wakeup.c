@@ -0,0 +1,69 @@
+#include "seatest.h"
+
+#ifndef _WIN32
+#include <poll.h> /* POLLIN poll() pollfd */
+#endif
+
+#include "../../src/utils/wakeup.h"
+
+#ifndef _WIN32
+
+static int is_readable(int fd);
+
+static void
+setup(void)
+{
+	assert_int_equal(0, wakeup_init());
+	wakeup_drain();
+}
+
+static void
+test_notification_makes_descriptor_readable(void)
+{
+	assert_false(is_readable(wakeup_get_fd()));
+	wakeup_notify();
+	assert_true(is_readable(wakeup_get_fd()));
+}
+
+static void
+test_drain_consumes_all_notifications(void)
+{
+	int i;
+	for(i = 0; i < 100000; ++i)
+	{
+		wakeup_notify();
+	}
+	assert_true(is_readable(wakeup_get_fd()));
+
+	wakeup_drain();
+	assert_false(is_readable(wakeup_get_fd()));
+}
+
+/* Checks whether the descriptor can be read without blocking.  Returns non-zero
+ * if so, otherwise zero is returned. */
+static int
+is_readable(int fd)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	return poll(&pfd, 1, 0) == 1;
+}
+
+#endif
+
+void
+wakeup_tests(void)
+{
+	test_fixture_start();
+
+#ifndef _WIN32
+	fixture_setup(setup);
+
+	run_test(test_notification_makes_descriptor_readable);
+	run_test(test_drain_consumes_all_notifications);
+#endif
+
+	test_fixture_end();
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */